@@ -7,6 +7,7 @@ typedef double float64_t;
 #define KLB_DATA_DIMS (5) /* our images at the most have 5 dimensions: x,y,z, c, t */
 #define KLB_METADATA_SIZE (256) /* number of bytes in metadata */
 #define KLB_DEFAULT_HEADER_VERSION (2) /* def */
+#define KLB_INDEXED_HEADER_VERSION (3) /* blocks in any order, block index at the end of the file (see docs/imageHeaderFormat.txt) */
 
 /* Following mylib conventions here are the data types
  */
@@ -26,12 +27,21 @@ enum KLB_DATA_TYPE
 
 /* Compression type look up table (add to the list if you use a different one)
  * To add more compression types just add it here and look for
+ *
+ * The *_ZLIB types apply a reversible filter to each block before a fast
+ * zlib compression (level 1), as Blosc does:
+ * - SHUFFLE_ZLIB: byte shuffle (byte k of all the pixels are stored together)
+ * - BITSHUFFLE_ZLIB: bit shuffle (bit k of all the pixels are stored together)
+ * - DELTA_SHUFFLE_ZLIB: difference with the previous pixel along x, then byte shuffle
  */
 enum KLB_COMPRESSION_TYPE
 {
 	NONE = 0,
 	BZIP2 = 1,
-	ZLIB = 2
+	ZLIB = 2,
+	SHUFFLE_ZLIB = 3,
+	BITSHUFFLE_ZLIB = 4,
+	DELTA_SHUFFLE_ZLIB = 5
 };
 
 #endif
@@ -14,6 +14,7 @@
 #include <string>
 #include "klb_Cwrapper.h"
 #include "klb_imageIO.h"
+#include "klb_imageReader.h"
 
 
 int writeKLBstack(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], KLB_DATA_TYPE dataType, int numThreads = -1, float32_t pixelSize[KLB_DATA_DIMS] = NULL, uint32_t blockSize[KLB_DATA_DIMS] = NULL, KLB_COMPRESSION_TYPE compressionType = KLB_COMPRESSION_TYPE::BZIP2, char metadata[KLB_METADATA_SIZE] = NULL)
@@ -37,6 +38,9 @@ int writeKLBstack(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_
 		case 2:
 			printf("Error during BZIP compression of one of the blocks");
 			break;
+		case 3:
+			printf("Error during ZLIB compression of one of the blocks");
+			break;
 		case 5:
 			printf("Error generating the output file in the specified location");
 			break;
@@ -49,6 +53,72 @@ int writeKLBstack(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_
 	return error;
 }
 
+//================================================================================================================================================
+int writeKLBstackIndexed(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], KLB_DATA_TYPE dataType, int numThreads, float32_t pixelSize[KLB_DATA_DIMS], uint32_t blockSize[KLB_DATA_DIMS], KLB_COMPRESSION_TYPE compressionType, char metadata[KLB_METADATA_SIZE])
+{
+	//initialize I/O object
+	std::string filenameOut(filename);
+	klb_imageIO imgIO(filenameOut);
+
+	//set header
+	imgIO.header.setHeader(xyzct, dataType, pixelSize, blockSize, compressionType, metadata, KLB_INDEXED_HEADER_VERSION);
+
+	int error = imgIO.writeImage((char*)(im), numThreads);
+
+	if (error > 0)
+	{
+		switch (error)
+		{
+		case 2:
+			printf("Error during BZIP compression of one of the blocks");
+			break;
+		case 3:
+			printf("Error during ZLIB compression of one of the blocks");
+			break;
+		case 5:
+			printf("Error writing the output file in the specified location");
+			break;
+		default:
+			printf("Error writing the image");
+		}
+	}
+
+	return error;
+}
+
+//================================================================================================================================================
+int appendKLBtimePoint(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], KLB_DATA_TYPE dataType, int numThreads, float32_t pixelSize[KLB_DATA_DIMS], uint32_t blockSize[KLB_DATA_DIMS], KLB_COMPRESSION_TYPE compressionType, char metadata[KLB_METADATA_SIZE])
+{
+	//initialize I/O object
+	std::string filenameOut(filename);
+	klb_imageIO imgIO(filenameOut);
+
+	//set header (only used if the file does not exist yet)
+	imgIO.header.setHeader(xyzct, dataType, pixelSize, blockSize, compressionType, metadata, KLB_INDEXED_HEADER_VERSION);
+
+	int error = imgIO.appendTimePoint((char*)(im), numThreads);
+
+	if (error > 0)
+	{
+		switch (error)
+		{
+		case 2:
+			printf("Error appending the time point (incompatible file or BZIP compression error)");
+			break;
+		case 3:
+			printf("Error during ZLIB compression of one of the blocks");
+			break;
+		case 5:
+			printf("Error writing the output file in the specified location");
+			break;
+		default:
+			printf("Error appending the time point");
+		}
+	}
+
+	return error;
+}
+
 //================================================================================================================================================
 int writeKLBstackSlices(const void** im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], KLB_DATA_TYPE dataType, int numThreads = -1, float32_t pixelSize[KLB_DATA_DIMS] = NULL, uint32_t blockSize[KLB_DATA_DIMS] = NULL, KLB_COMPRESSION_TYPE compressionType = KLB_COMPRESSION_TYPE::BZIP2, char metadata[KLB_METADATA_SIZE] = NULL)
 {
@@ -188,4 +258,132 @@ int readKLBroiInPlace(const char* filename, void* im, uint32_t xyzctLB[KLB_DATA_
 	}
 
 	return img.readImage((char*)im, &roi, numThreads);
-}
\ No newline at end of file
+}
+//===========================================================================================
+int getKLBnumPyramidLevels(const char* filename)
+{
+	std::string filenameOut(filename);
+	klb_imageIO img(filenameOut);
+
+	return img.getNumPyramidLevels();
+}
+
+//===========================================================================================
+int readKLBpyramidLevelHeader(const char* filename, int level, uint32_t xyzct[KLB_DATA_DIMS], KLB_DATA_TYPE *dataType, float32_t pixelSize[KLB_DATA_DIMS], float32_t filterSigma[3], int32_t filterInfo[2])
+{
+	std::string filenameOut(filename);
+	klb_imageIO img(filenameOut);
+	klb_image_header header;
+
+	int error = img.readPyramidLevelHeader(level, header, filterSigma, filterInfo);
+	if (error != 0)
+	{
+		return error;
+	}
+
+	//parse header
+	memcpy(xyzct, header.xyzct, sizeof(uint32_t)* KLB_DATA_DIMS);
+	*dataType = header.dataType;
+	if (pixelSize != NULL)
+		memcpy(pixelSize, header.pixelSize, sizeof(float32_t)* KLB_DATA_DIMS);
+
+	return error;
+}
+
+//===========================================================================================
+int readKLBpyramidLevelInPlace(const char* filename, int level, void* im, int numThreads)
+{
+	std::string filenameOut(filename);
+	klb_imageIO img(filenameOut);
+
+	return img.readPyramidLevel((char*)im, level, numThreads);
+}
+
+//===========================================================================================
+int writeKLBpyramidLevel(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], float32_t filterSigma[3], int32_t filterInfo[2], int numThreads)
+{
+	std::string filenameOut(filename);
+	klb_imageIO imgIO(filenameOut);
+
+	int error = imgIO.writePyramidLevel((const char*)(im), xyzct, filterSigma, filterInfo, numThreads);
+
+	if (error > 0)
+	{
+		switch (error)
+		{
+		case 2:
+			printf("Error reading the full resolution image header or during BZIP compression of one of the blocks");
+			break;
+		case 3:
+			printf("Error during ZLIB compression of one of the blocks");
+			break;
+		case 5:
+			printf("Error opening the file in the specified location");
+			break;
+		default:
+			printf("Error writing the pyramid level");
+		}
+	}
+
+	return error;
+}
+
+//===========================================================================================
+klb_imageReader* createKLBreader(int numThreads)
+{
+	return new klb_imageReader(numThreads);
+}
+
+//===========================================================================================
+void deleteKLBreader(klb_imageReader* reader)
+{
+	delete reader;
+}
+
+//===========================================================================================
+int readKLBreaderHeader(klb_imageReader* reader, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], KLB_DATA_TYPE *dataType, float32_t pixelSize[KLB_DATA_DIMS], uint32_t blockSize[KLB_DATA_DIMS], KLB_COMPRESSION_TYPE *compressionType, char metadata[KLB_METADATA_SIZE])
+{
+	std::string filenameOut(filename);
+
+	int error = reader->readHeader(filenameOut);
+	if (error > 0)
+		return error;
+
+	//parse header
+	const klb_image_header &header = reader->getHeader();
+	memcpy(xyzct, header.xyzct, sizeof(uint32_t)* KLB_DATA_DIMS);
+	*dataType = header.dataType;
+	if (compressionType != NULL)
+		*compressionType = header.compressionType;
+	if (pixelSize != NULL)
+		memcpy(pixelSize, header.pixelSize, sizeof(float32_t)* KLB_DATA_DIMS);
+	if (metadata != NULL)
+		memcpy(metadata, header.metadata, sizeof(char)* KLB_METADATA_SIZE);
+	if (blockSize != NULL)
+		memcpy(blockSize, header.blockSize, sizeof(uint32_t)* KLB_DATA_DIMS);
+
+	return error;
+}
+
+//===========================================================================================
+int readKLBreaderStackInPlace(klb_imageReader* reader, const char* filename, void* im)
+{
+	std::string filenameOut(filename);
+
+	return reader->readImage(filenameOut, (char*)im);
+}
+
+//===========================================================================================
+int readKLBreaderRoiInPlace(klb_imageReader* reader, const char* filename, void* im, uint32_t xyzctLB[KLB_DATA_DIMS], uint32_t xyzctUB[KLB_DATA_DIMS])
+{
+	std::string filenameOut(filename);
+
+	klb_ROI roi;
+	for (int d = 0; d < KLB_DATA_DIMS; d++)
+	{
+		roi.xyzctLB[d] = xyzctLB[d];
+		roi.xyzctUB[d] = xyzctUB[d];
+	}
+
+	return reader->readImage(filenameOut, (char*)im, &roi);
+}
@@ -39,8 +39,21 @@ extern "C" {
 
 
 
+	/*
+	\brief compressionType is one of KLB_COMPRESSION_TYPE (see common.h). SHUFFLE_ZLIB, BITSHUFFLE_ZLIB and DELTA_SHUFFLE_ZLIB are much faster to decompress than BZIP2 for a slightly lower compression ratio
+	*/
 	DECLSPECIFIER int writeKLBstack(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], enum KLB_DATA_TYPE dataType, int numThreads, float32_t pixelSize[KLB_DATA_DIMS], uint32_t blockSize[KLB_DATA_DIMS], enum KLB_COMPRESSION_TYPE compressionType, char metadata[KLB_METADATA_SIZE]);
 	
+	/*
+	\brief Same as writeKLBstack but the blocks are written as soon as they are compressed (in any order) and the block index is stored at the end of the file (KLB_INDEXED_HEADER_VERSION). Faster when some blocks are much slower to compress than others; the file can only be read by this version of the library (or later)
+	*/
+	DECLSPECIFIER int writeKLBstackIndexed(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], enum KLB_DATA_TYPE dataType, int numThreads, float32_t pixelSize[KLB_DATA_DIMS], uint32_t blockSize[KLB_DATA_DIMS], enum KLB_COMPRESSION_TYPE compressionType, char metadata[KLB_METADATA_SIZE]);
+
+	/*
+	\brief appends the 3D (or 4D with channels) stack im as the next time point of the file: xyzct[4] is ignored, the other dimensions and dataType have to match the ones of the file. If the file does not exist it is created with the other parameters, otherwise they are ignored. Blocks of the file must not span several time points (blockSize[4] = 1)
+	*/
+	DECLSPECIFIER int appendKLBtimePoint(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], enum KLB_DATA_TYPE dataType, int numThreads, float32_t pixelSize[KLB_DATA_DIMS], uint32_t blockSize[KLB_DATA_DIMS], enum KLB_COMPRESSION_TYPE compressionType, char metadata[KLB_METADATA_SIZE]);
+
 	/*
 	\brief Same as writeKLBstack but we use a double pointer to have each slice in a separate address. xyzct[3] = xyzct[4] = 1 (no time or channel information). We assume xyzct[2] = number of slices
 	*/
@@ -65,6 +78,44 @@ extern "C" {
 
 	DECLSPECIFIER int readKLBroiInPlace(const char* filename, void* im, uint32_t xyzctLB[KLB_DATA_DIMS], uint32_t xyzctUB[KLB_DATA_DIMS], int numThreads);
 
+	/*
+	\brief pyramid levels: downsampled copies of the image stored after the full resolution blocks. Level 0 is the full resolution image, stored levels are numbered from 1 to getKLBnumPyramidLevels() (which returns 0 if there is none)
+	*/
+	DECLSPECIFIER int getKLBnumPyramidLevels(const char* filename);
+
+	/*
+	\brief filterSigma is the sigma (in pixels of the full resolution image) of the gaussian filter applied before downsampling (0 if none), filterInfo describes how the level was computed (e.g. filter type and normalization, as given to writeKLBpyramidLevel(), -1 if unknown). pixelSize, filterSigma and filterInfo are optional
+	*/
+	DECLSPECIFIER int readKLBpyramidLevelHeader(const char* filename, int level, uint32_t xyzct[KLB_DATA_DIMS], enum KLB_DATA_TYPE *dataType, float32_t pixelSize[KLB_DATA_DIMS], float32_t filterSigma[3], int32_t filterInfo[2]);
+
+	DECLSPECIFIER int readKLBpyramidLevelInPlace(const char* filename, int level, void* im, int numThreads);
+
+	/*
+	\brief appends a pyramid level (of dimensions xyzct) to an existing klb file. Data type and compression type are the ones of the full resolution image
+	*/
+	DECLSPECIFIER int writeKLBpyramidLevel(const void* im, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], float32_t filterSigma[3], int32_t filterInfo[2], int numThreads);
+
+	/*
+	\brief reader for series of files (time points, tiles, etc): its decompressing threads and their scratch buffers are kept from one file to the next (see klb_imageReader.h). numThreads <= 0 uses as many threads as cores
+	*/
+	typedef struct klb_imageReader klb_imageReader;
+
+	DECLSPECIFIER klb_imageReader* createKLBreader(int numThreads);
+
+	DECLSPECIFIER void deleteKLBreader(klb_imageReader* reader);
+
+	/*
+	\brief the header is kept by the reader, so the following readKLBreaderStackInPlace() on the same file does not parse it again. All the parameters after dataType are optional
+	*/
+	DECLSPECIFIER int readKLBreaderHeader(klb_imageReader* reader, const char* filename, uint32_t xyzct[KLB_DATA_DIMS], enum KLB_DATA_TYPE *dataType, float32_t pixelSize[KLB_DATA_DIMS], uint32_t blockSize[KLB_DATA_DIMS], enum KLB_COMPRESSION_TYPE *compressionType, char metadata[KLB_METADATA_SIZE]);
+
+	/*
+	\brief decompresses the whole image into im, allocated by the caller (use readKLBreaderHeader to know its size)
+	*/
+	DECLSPECIFIER int readKLBreaderStackInPlace(klb_imageReader* reader, const char* filename, void* im);
+
+	DECLSPECIFIER int readKLBreaderRoiInPlace(klb_imageReader* reader, const char* filename, void* im, uint32_t xyzctLB[KLB_DATA_DIMS], uint32_t xyzctUB[KLB_DATA_DIMS]);
+
 
 #ifdef __cplusplus
 } 
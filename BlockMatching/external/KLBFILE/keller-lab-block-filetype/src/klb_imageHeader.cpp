@@ -17,6 +17,11 @@
 #include <algorithm>
 #include "klb_imageHeader.h"
 
+#if defined(_WIN32) || defined(_WIN64)
+//in windows long int is 32 bit, so fseek cannot handle large files
+	#define fseek _fseeki64
+	#define ftell _ftelli64
+#endif
 
 
 using namespace std;
@@ -32,6 +37,8 @@ klb_image_header& klb_image_header::operator=(const klb_image_header& p)
 		
 		resizeBlockOffset(p.Nb);
 		memcpy(blockOffset, p.blockOffset, sizeof(uint64_t)* Nb);	
+		memcpy(blockStart, p.blockStart, sizeof(uint64_t)* Nb);
+		indexOffset = p.indexOffset;
 	}
 	return *this;
 }
@@ -49,6 +56,9 @@ klb_image_header::klb_image_header(const klb_image_header& p)
 	Nb = p.Nb;
 	blockOffset = new std::uint64_t[Nb];
 	memcpy(blockOffset, p.blockOffset, sizeof(uint64_t)* Nb);
+	blockStart = new std::uint64_t[Nb];
+	memcpy(blockStart, p.blockStart, sizeof(uint64_t)* Nb);
+	indexOffset = p.indexOffset;
 
 }
 
@@ -58,6 +68,8 @@ klb_image_header::klb_image_header()
 
 	Nb = 0;
 	blockOffset = NULL;
+	blockStart = NULL;
+	indexOffset = 0;
 
 	setHeader(xyzct_, KLB_DATA_TYPE::UINT16_TYPE);// default values
 
@@ -70,6 +82,8 @@ klb_image_header::~klb_image_header()
 	{
 		delete[] blockOffset;
 		blockOffset = NULL;
+		delete[] blockStart;
+		blockStart = NULL;
 	}
 }
 
@@ -170,7 +184,22 @@ void klb_image_header::writeHeader(FILE* fid)
 	fwrite((char*)(&compressionType), 1, sizeof(uint8_t), fid);
 	fwrite(metadata, 1, sizeof(char) * KLB_METADATA_SIZE, fid);
 	fwrite((char*)blockSize, 1, sizeof(uint32_t)* KLB_DATA_DIMS, fid);
-	fwrite((char*)blockOffset, 1, sizeof(uint64_t)* Nb, fid);//this is the only variable size element
+	if (isIndexed())
+		fwrite((char*)(&indexOffset), 1, sizeof(uint64_t), fid);
+	else
+		fwrite((char*)blockOffset, 1, sizeof(uint64_t)* Nb, fid);//this is the only variable size element
+};
+
+//==============================================================
+void klb_image_header::writeBlockIndex(FILE* fid)
+{
+	std::uint64_t entry[2];
+	for (size_t ii = 0; ii < Nb; ii++)
+	{
+		entry[0] = blockStart[ii];
+		entry[1] = blockOffset[ii] - blockStart[ii];
+		fwrite((char*)entry, 1, 2 * sizeof(uint64_t), fid);
+	}
 };
 
 //=======================================================
@@ -188,7 +217,24 @@ void klb_image_header::readHeader(std::istream &fid)
 	//resize if necessary
 	resizeBlockOffset(calculateNumBlocks());
 	
-	fid.read((char*)blockOffset, sizeof(uint64_t)* Nb);//this is the only variable size element
+	if (isIndexed())
+	{
+		//block index at the end of the blocks
+		fid.read((char*)(&indexOffset), sizeof(uint64_t));
+		fid.seekg(indexOffset, ios::cur);
+		std::uint64_t entry[2];
+		for (size_t ii = 0; ii < Nb; ii++)
+		{
+			fid.read((char*)entry, 2 * sizeof(uint64_t));
+			blockStart[ii] = entry[0];
+			blockOffset[ii] = entry[0] + entry[1];
+		}
+	}
+	else{
+		fid.read((char*)blockOffset, sizeof(uint64_t)* Nb);//this is the only variable size element
+		for (size_t ii = 0; ii < Nb; ii++)
+			blockStart[ii] = (ii == 0 ? 0 : blockOffset[ii - 1]);
+	}
 };
 
 //======================================================
@@ -198,14 +244,24 @@ void klb_image_header::resizeBlockOffset(size_t Nb_)
 	if (Nb != Nb_)
 	{
 		if (Nb != 0)
+		{
 			delete[] blockOffset;
+			delete[] blockStart;
+		}
 		Nb = Nb_;
 		blockOffset = new std::uint64_t[Nb];
+		blockStart = new std::uint64_t[Nb];
 	}
 }
 
 //=======================================================
 int klb_image_header::readHeader(const char *filename)
+{
+	return readHeader(filename, 0);
+};
+
+//=======================================================
+int klb_image_header::readHeader(const char *filename, std::uint64_t offset)
 {
 	ifstream fid(filename, ios::binary | ios::in);
 	if (fid.is_open() == false)
@@ -214,16 +270,127 @@ int klb_image_header::readHeader(const char *filename)
 		return 2;
 	}
 
+	if (offset > 0)
+		fid.seekg(offset, ios::beg);
 	readHeader(fid);
+	if (fid.fail())
+	{
+		cout << "ERROR: klb_image_header::readHeader : header could not be read from file " << filename << " at offset " << offset << endl;
+		fid.close();
+		return 2;
+	}
 	fid.close();
 	return 0;
 };
 
+//=======================================================
+//pyramid directory: one entry per level (uint64 offset, float32 filterSigma[3], int32 filterInfo[2]) followed, at the very end of the file, by the footer (uint64 directoryOffset, uint32 numLevels, char magic[8])
+//directories written before filterInfo was added (magic "KLBPYRMD") have no filterInfo, it is then read as unknown (-1)
+static const char klbPyramidMagic[8] = { 'K', 'L', 'B', 'P', 'Y', 'R', 'M', '2' };
+static const char klbPyramidMagicV1[8] = { 'K', 'L', 'B', 'P', 'Y', 'R', 'M', 'D' };
+static const size_t klbPyramidEntrySize = sizeof(std::uint64_t) + 3 * sizeof(float32_t) + 2 * sizeof(std::int32_t);
+static const size_t klbPyramidEntrySizeV1 = sizeof(std::uint64_t) + 3 * sizeof(float32_t);
+static const size_t klbPyramidFooterSize = sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(klbPyramidMagic);
+
+int klb_image_header::readPyramidDirectory(const char *filename, std::vector<klb_pyramid_level> &levels, std::uint64_t *directoryOffset)
+{
+	levels.clear();
+	*directoryOffset = 0;
+
+	ifstream fid(filename, ios::binary | ios::in);
+	if (fid.is_open() == false)
+	{
+		cout << "ERROR: klb_image_header::readPyramidDirectory : file " << filename << " could not be opened" << endl;
+		return 2;
+	}
+
+	fid.seekg(0, ios::end);
+	std::uint64_t fileSize = fid.tellg();
+	if (fileSize < klbPyramidFooterSize)
+		return 0;
+
+	std::uint64_t offset;
+	std::uint32_t numLevels;
+	char magic[sizeof(klbPyramidMagic)];
+	fid.seekg(fileSize - klbPyramidFooterSize, ios::beg);
+	fid.read((char*)(&offset), sizeof(std::uint64_t));
+	fid.read((char*)(&numLevels), sizeof(std::uint32_t));
+	fid.read(magic, sizeof(klbPyramidMagic));
+	if (fid.fail())
+		return 0;
+	bool hasFilterInfo = (memcmp(magic, klbPyramidMagic, sizeof(klbPyramidMagic)) == 0);
+	if (hasFilterInfo == false && memcmp(magic, klbPyramidMagicV1, sizeof(klbPyramidMagicV1)) != 0)
+		return 0;//no pyramid level
+
+	size_t entrySize = (hasFilterInfo ? klbPyramidEntrySize : klbPyramidEntrySizeV1);
+	if (offset + numLevels * entrySize + klbPyramidFooterSize > fileSize)
+	{
+		cout << "ERROR: klb_image_header::readPyramidDirectory : corrupted pyramid directory in file " << filename << endl;
+		return 2;
+	}
+
+	levels.resize(numLevels);
+	fid.seekg(offset, ios::beg);
+	for (std::uint32_t ii = 0; ii < numLevels; ii++)
+	{
+		fid.read((char*)(&(levels[ii].offset)), sizeof(std::uint64_t));
+		fid.read((char*)(levels[ii].filterSigma), 3 * sizeof(float32_t));
+		if (hasFilterInfo)
+			fid.read((char*)(levels[ii].filterInfo), 2 * sizeof(std::int32_t));
+		else
+			levels[ii].filterInfo[0] = levels[ii].filterInfo[1] = -1;
+	}
+	if (fid.fail())
+	{
+		levels.clear();
+		cout << "ERROR: klb_image_header::readPyramidDirectory : pyramid directory could not be read from file " << filename << endl;
+		return 2;
+	}
+
+	*directoryOffset = offset;
+	return 0;
+}
+
+//=======================================================
+//the footer has to be the last bytes of the file: if the file was longer (the new level is smaller than the previous directory) the footer overwrites the previous one
+int klb_image_header::writePyramidDirectory(FILE* fid, const std::vector<klb_pyramid_level> &levels, std::uint64_t directoryOffset)
+{
+	fseek(fid, 0, SEEK_END);
+	std::uint64_t fileSize = ftell(fid);
+
+	fseek(fid, directoryOffset, SEEK_SET);
+	for (size_t ii = 0; ii < levels.size(); ii++)
+	{
+		fwrite((char*)(&(levels[ii].offset)), 1, sizeof(std::uint64_t), fid);
+		fwrite((char*)(levels[ii].filterSigma), 1, 3 * sizeof(float32_t), fid);
+		fwrite((char*)(levels[ii].filterInfo), 1, 2 * sizeof(std::int32_t), fid);
+	}
+
+	std::uint64_t footerOffset = directoryOffset + levels.size() * klbPyramidEntrySize;
+	if (footerOffset + klbPyramidFooterSize < fileSize)
+		footerOffset = fileSize - klbPyramidFooterSize;
+
+	std::uint32_t numLevels = (std::uint32_t)(levels.size());
+	fseek(fid, footerOffset, SEEK_SET);
+	fwrite((char*)(&directoryOffset), 1, sizeof(std::uint64_t), fid);
+	fwrite((char*)(&numLevels), 1, sizeof(std::uint32_t), fid);
+	if (fwrite(klbPyramidMagic, 1, sizeof(klbPyramidMagic), fid) != sizeof(klbPyramidMagic))
+	{
+		cout << "ERROR: klb_image_header::writePyramidDirectory : pyramid directory could not be written" << endl;
+		return 5;
+	}
+	return 0;
+}
+
 //==========================================================
 size_t  klb_image_header::getBlockCompressedSizeBytes(size_t blockIdx) const
 {
 	if (blockIdx >= Nb)
 		return 0;
+	else if (isIndexed())
+	{
+		return blockOffset[blockIdx] - blockStart[blockIdx];
+	}
 	else if (blockIdx == 0 )//first block
 	{
 		return blockOffset[blockIdx];
@@ -239,6 +406,10 @@ std::uint64_t klb_image_header::getBlockOffset(size_t blockIdx) const
 {
 	if (blockIdx >= Nb)
 		return numeric_limits<std::uint64_t>::max();
+	else if (isIndexed())
+	{
+		return blockStart[blockIdx];
+	}
 	else if (blockIdx == 0)//first block
 	{
 		return 0;
@@ -251,9 +422,41 @@ std::uint64_t klb_image_header::getBlockOffset(size_t blockIdx) const
 //======================================================
 std::uint64_t klb_image_header::getCompressedFileSizeInBytes() const
 {
+	if (isIndexed())
+		return getSizeInBytes() + indexOffset + 2 * Nb * sizeof(std::uint64_t);
 	return getSizeInBytes() + blockOffset[Nb-1];
 }
 
+//======================================================
+bool klb_image_header::isZlibCompression() const
+{
+	switch (compressionType)
+	{
+	case KLB_COMPRESSION_TYPE::ZLIB:
+	case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+	case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+	case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//======================================================
+bool klb_image_header::hasPrefilter() const
+{
+	return (isZlibCompression() && compressionType != KLB_COMPRESSION_TYPE::ZLIB);
+}
+
+//======================================================
+int klb_image_header::getZlibCompressionLevel() const
+{
+	//prefiltered blocks compress well even at the fastest level, so we favor speed
+	if (hasPrefilter())
+		return 1;
+	return -1;//Z_DEFAULT_COMPRESSION
+}
+
 void klb_image_header::setDefaultBlockSize()
 {
 	std::uint32_t bytesPerPixel = getBytesPerPixel();	
@@ -25,6 +25,14 @@
 #include "common.h"
 
 
+//pyramid level: downsampled copy of the image stored (as a complete klb image, header + blocks) after the full resolution blocks. See docs/imageHeaderFormat.txt
+struct klb_pyramid_level
+{
+	std::uint64_t	offset;//offset (in bytes) of the level header within the file
+	float32_t		filterSigma[3];//sigma (in pixels of the full resolution image) of the gaussian filter applied before downsampling. 0 means no filtering
+	std::int32_t	filterInfo[2];//how the level was computed (e.g. type of filter and normalization of the input image), defined by the writer. -1 means unknown
+};
+
 
 #if defined(COMPILE_SHARED_LIBRARY) && defined(_MSC_VER)
 class __declspec(dllexport) klb_image_header
@@ -44,6 +52,9 @@ public:
 	std::uint32_t					blockSize[KLB_DATA_DIMS];     //block size along each dimension to partition the data for bzip. The total size of each block should be ~1MB	
 	std::uint64_t*		blockOffset; //offset (in bytes) within the file for each block, so we can retrieve blocks individually. Nb = prod_i ceil(xyzct[i]/blockSize[i]). I use a pointer (instead of vector) to facilitate dllexport to shared library
 
+	std::uint64_t*		blockStart; //offset (in bytes, without counting header) of the first byte of each block. Only read from / written to the file with KLB_INDEXED_HEADER_VERSION (blocks in any order, blockOffset is then the end of each block); otherwise blockStart[i] = blockOffset[i-1]
+	std::uint64_t		indexOffset; //KLB_INDEXED_HEADER_VERSION only: offset (in bytes, without counting header) of the block index, i.e. size of the blocks
+
 	size_t Nb;//length of blockOffset array
 
 	//constructors 
@@ -56,14 +67,20 @@ public:
 	//main functionality
 	void writeHeader(std::ostream &fid);
 	void writeHeader(FILE* fid);
+	void writeBlockIndex(FILE* fid);//KLB_INDEXED_HEADER_VERSION only: (blockStart, size) for each block
 	void readHeader(std::istream &fid);
 	int readHeader(const char *filename);
+	int readHeader(const char *filename, std::uint64_t offset);//offset of the header within the file (non zero for pyramid levels)
+
+	//pyramid levels directory (stored at the end of the file). levels is empty if the file has no pyramid level
+	static int readPyramidDirectory(const char *filename, std::vector<klb_pyramid_level> &levels, std::uint64_t *directoryOffset);
+	static int writePyramidDirectory(FILE* fid, const std::vector<klb_pyramid_level> &levels, std::uint64_t directoryOffset);
 
 	//set/get functions
 	size_t getNumBlocks() const{ return Nb; };
 	int getMetadataSizeInBytes() const{ return KLB_METADATA_SIZE; };
 	size_t calculateNumBlocks() const;
-	size_t getSizeInBytes()  const{ return KLB_DATA_DIMS * (2 * sizeof(std::uint32_t) + sizeof(float32_t)) + 2 * sizeof(std::uint8_t) + Nb * sizeof(std::uint64_t) + sizeof(char)* (KLB_METADATA_SIZE + 1); };
+	size_t getSizeInBytes()  const{ return getSizeInBytesFixPortion() + (isIndexed() ? sizeof(std::uint64_t) : Nb * sizeof(std::uint64_t)); };
 	size_t getSizeInBytesFixPortion()  const{ return KLB_DATA_DIMS * (2 * sizeof(std::uint32_t) + sizeof(float32_t)) + 2 * sizeof(std::uint8_t) + sizeof(char)* (KLB_METADATA_SIZE + 1); };
 	size_t getBytesPerPixel() const;
 	std::uint32_t getBlockSizeBytes() const;
@@ -72,6 +89,10 @@ public:
 	size_t getBlockCompressedSizeBytes(size_t blockId) const;
 	std::uint64_t getBlockOffset(size_t blockIdx) const;//offset in compressed file without counting header (so you have to add getSizeInBytes() for total offset
 	std::uint64_t getCompressedFileSizeInBytes() const;
+	bool isIndexed() const{ return headerVersion >= KLB_INDEXED_HEADER_VERSION; };//blocks are not stored in order and the block index is at the end of the file
+	bool isZlibCompression() const;//zlib based compression (with or without prefilter)
+	bool hasPrefilter() const;//block is shuffled (and delta encoded) before compression
+	int getZlibCompressionLevel() const;
 	void setDefaultBlockSize();//sets default block size based on our analysis for our own images
 	void resizeBlockOffset(size_t Nb_);
 	void setOptimalBlockSizeInBytes(){ optimalBlockSizeInBytes[0] = 192; optimalBlockSizeInBytes[1] = 192; optimalBlockSizeInBytes[2] = 16; optimalBlockSizeInBytes[3] = 1; optimalBlockSizeInBytes[4] = 1; };
@@ -27,6 +27,14 @@
 #include "bzlib.h"
 #include "zlib.h"
 
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <errno.h>
+#endif
+
 
 #if defined(_WIN32) || defined(_WIN64)
 //in windows long int is 32 bit, so fseek cannot read large files
@@ -34,6 +42,7 @@
 #endif
 
 //#define DEBUG_PRINT_THREADS
+#define USE_MMAP_READ //comment this line to read the compressed blocks with fseek+fread from one file handle per thread (memory mapping is only available in POSIX systems)
 typedef std::chrono::high_resolution_clock Clock;
 using namespace std;
 
@@ -48,6 +57,263 @@ inline T iDivUp(const T a, const T b){
 	return (a % b != 0) ? (a / b + 1) : (a / b);
 }
 
+//========================================================
+//prefilters applied to a block before zlib compression (see KLB_COMPRESSION_TYPE). All of them are exactly reversible for any data type (floats are processed as their bit patterns)
+
+//byte shuffle: out = [byte 0 of all pixels][byte 1 of all pixels]...
+static void shuffleBytes(const char* in, char* out, size_t numPixels, size_t bytesPerPixel)
+{
+	for (size_t b = 0; b < bytesPerPixel; b++)
+	{
+		const char* pIn = in + b;
+		char* pOut = out + b * numPixels;
+		for (size_t ii = 0; ii < numPixels; ii++, pIn += bytesPerPixel)
+			pOut[ii] = *pIn;
+	}
+}
+
+static void unshuffleBytes(const char* in, char* out, size_t numPixels, size_t bytesPerPixel)
+{
+	for (size_t b = 0; b < bytesPerPixel; b++)
+	{
+		const char* pIn = in + b * numPixels;
+		char* pOut = out + b;
+		for (size_t ii = 0; ii < numPixels; ii++, pOut += bytesPerPixel)
+			*pOut = pIn[ii];
+	}
+}
+
+//transposes a 8x8 bit matrix (byte k is row k). It is its own inverse (Hacker's Delight, transpose8)
+static inline std::uint64_t transposeBits8x8(std::uint64_t x)
+{
+	std::uint64_t t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x = x ^ t ^ (t << 28);
+	return x;
+}
+
+//bit shuffle of the first (numPixels / 8) * 8 pixels: bytes are shuffled into aux, then each group of 8 bytes of a byte plane is transposed into 8 bit planes. The remaining pixels are copied as they are
+static void shuffleBits(const char* in, char* out, size_t numPixels, size_t bytesPerPixel, char* aux)
+{
+	const size_t numGroups = numPixels / 8;
+	const size_t n8 = numGroups * 8;
+	shuffleBytes(in, aux, n8, bytesPerPixel);
+	for (size_t b = 0; b < bytesPerPixel; b++)
+	{
+		const unsigned char* plane = (const unsigned char*)(aux + b * n8);
+		unsigned char* pOut = (unsigned char*)(out + b * n8);
+		for (size_t g = 0; g < numGroups; g++, plane += 8)
+		{
+			std::uint64_t x = 0;
+			for (int k = 0; k < 8; k++)
+				x |= ((std::uint64_t)(plane[k])) << (8 * k);
+			x = transposeBits8x8(x);
+			for (int k = 0; k < 8; k++)
+				pOut[k * numGroups + g] = (unsigned char)(x >> (8 * k));
+		}
+	}
+	memcpy(out + n8 * bytesPerPixel, in + n8 * bytesPerPixel, (numPixels - n8) * bytesPerPixel);
+}
+
+static void unshuffleBits(const char* in, char* out, size_t numPixels, size_t bytesPerPixel, char* aux)
+{
+	const size_t numGroups = numPixels / 8;
+	const size_t n8 = numGroups * 8;
+	for (size_t b = 0; b < bytesPerPixel; b++)
+	{
+		const unsigned char* pIn = (const unsigned char*)(in + b * n8);
+		unsigned char* plane = (unsigned char*)(aux + b * n8);
+		for (size_t g = 0; g < numGroups; g++, plane += 8)
+		{
+			std::uint64_t x = 0;
+			for (int k = 0; k < 8; k++)
+				x |= ((std::uint64_t)(pIn[k * numGroups + g])) << (8 * k);
+			x = transposeBits8x8(x);
+			for (int k = 0; k < 8; k++)
+				plane[k] = (unsigned char)(x >> (8 * k));
+		}
+	}
+	unshuffleBytes(aux, out, n8, bytesPerPixel);
+	memcpy(out + n8 * bytesPerPixel, in + n8 * bytesPerPixel, (numPixels - n8) * bytesPerPixel);
+}
+
+//difference with the previous pixel along x (rows of rowLength pixels within the block), with unsigned (modular) arithmetic
+template<class T>
+static void deltaEncode(const char* in, char* out, size_t numPixels, size_t rowLength)
+{
+	const T* pIn = (const T*)in;
+	T* pOut = (T*)out;
+	for (size_t r = 0; r < numPixels; r += rowLength)
+	{
+		pOut[r] = pIn[r];
+		for (size_t ii = r + 1; ii < r + rowLength; ii++)
+			pOut[ii] = (T)(pIn[ii] - pIn[ii - 1]);
+	}
+}
+
+template<class T>
+static void deltaDecode(char* buffer, size_t numPixels, size_t rowLength)
+{
+	T* p = (T*)buffer;
+	for (size_t r = 0; r < numPixels; r += rowLength)
+	{
+		for (size_t ii = r + 1; ii < r + rowLength; ii++)
+			p[ii] = (T)(p[ii] + p[ii - 1]);
+	}
+}
+
+static void deltaEncode(const char* in, char* out, size_t numPixels, size_t bytesPerPixel, size_t rowLength)
+{
+	switch (bytesPerPixel)
+	{
+	case 1:
+		deltaEncode<std::uint8_t>(in, out, numPixels, rowLength);
+		break;
+	case 2:
+		deltaEncode<std::uint16_t>(in, out, numPixels, rowLength);
+		break;
+	case 4:
+		deltaEncode<std::uint32_t>(in, out, numPixels, rowLength);
+		break;
+	default:
+		deltaEncode<std::uint64_t>(in, out, numPixels, rowLength);
+	}
+}
+
+static void deltaDecode(char* buffer, size_t numPixels, size_t bytesPerPixel, size_t rowLength)
+{
+	switch (bytesPerPixel)
+	{
+	case 1:
+		deltaDecode<std::uint8_t>(buffer, numPixels, rowLength);
+		break;
+	case 2:
+		deltaDecode<std::uint16_t>(buffer, numPixels, rowLength);
+		break;
+	case 4:
+		deltaDecode<std::uint32_t>(buffer, numPixels, rowLength);
+		break;
+	default:
+		deltaDecode<std::uint64_t>(buffer, numPixels, rowLength);
+	}
+}
+
+//in -> out. aux is a scratch buffer of the same size
+static void prefilterBlock(KLB_COMPRESSION_TYPE compressionType, const char* in, char* out, size_t numPixels, size_t bytesPerPixel, size_t rowLength, char* aux)
+{
+	switch (compressionType)
+	{
+	case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+		shuffleBytes(in, out, numPixels, bytesPerPixel);
+		break;
+	case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+		shuffleBits(in, out, numPixels, bytesPerPixel, aux);
+		break;
+	case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
+		deltaEncode(in, aux, numPixels, bytesPerPixel, rowLength);
+		shuffleBytes(aux, out, numPixels, bytesPerPixel);
+		break;
+	default:
+		memcpy(out, in, numPixels * bytesPerPixel);
+	}
+}
+
+static void unprefilterBlock(KLB_COMPRESSION_TYPE compressionType, const char* in, char* out, size_t numPixels, size_t bytesPerPixel, size_t rowLength, char* aux)
+{
+	switch (compressionType)
+	{
+	case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+		unshuffleBytes(in, out, numPixels, bytesPerPixel);
+		break;
+	case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+		unshuffleBits(in, out, numPixels, bytesPerPixel, aux);
+		break;
+	case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
+		unshuffleBytes(in, out, numPixels, bytesPerPixel);
+		deltaDecode(out, numPixels, bytesPerPixel, rowLength);
+		break;
+	default:
+		memcpy(out, in, numPixels * bytesPerPixel);
+	}
+}
+
+//========================================================
+//maps the whole file (read only) so decompressing threads read the compressed blocks directly from the page cache (no fseek+fread and no copy). Returns NULL if the file cannot be mapped or is shorter than minLength, so the caller can fall back to fread
+static const char* mapFileReadOnly(const std::string &filename, std::uint64_t minLength, std::uint64_t *length)
+{
+	*length = 0;
+#if defined(_WIN32) || defined(_WIN64)
+	return NULL;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || (std::uint64_t)(st.st_size) < minLength)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	void* p = mmap(NULL, (size_t)(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);//the mapping keeps its own reference to the file
+	if (p == MAP_FAILED)
+		return NULL;
+
+	*length = (std::uint64_t)(st.st_size);
+	return (const char*)p;
+#endif
+}
+
+static void unmapFile(const char* p, std::uint64_t length)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (p != NULL)
+		munmap((void*)p, (size_t)length);
+#endif
+}
+
+//asks the kernel to start reading [offset, offset + size) of a mapped file asynchronously, so the block is (hopefully) in memory when a thread decompresses it
+static void prefetchFileRange(const char* p, std::uint64_t length, std::uint64_t offset, std::uint64_t size)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (p == NULL || offset >= length)
+		return;
+	size = std::min(size, length - offset);
+	const std::uint64_t pageSize = (std::uint64_t)sysconf(_SC_PAGESIZE);
+	const std::uint64_t first = offset - offset % pageSize;//madvise needs page aligned addresses
+	posix_madvise((void*)(p + first), (size_t)(offset + size - first), POSIX_MADV_WILLNEED);
+#endif
+}
+
+//writes length bytes at offset without moving a shared file position, so several threads can write different parts of the file at the same time (out-of-order writing, see KLB_INDEXED_HEADER_VERSION)
+static bool writeBlockAt(int fd, const char* buffer, std::uint64_t length, std::uint64_t offset)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	return false;
+#else
+	while (length > 0)
+	{
+		ssize_t n = pwrite(fd, buffer, (size_t)length, (off_t)offset);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		buffer += n;
+		offset += n;
+		length -= n;
+	}
+	return true;
+#endif
+}
+
 //========================================================
 //======================================================
 void klb_imageIO::blockCompressor(const char* buffer, int* g_blockSize, std::atomic<uint64_t> *blockId, int* g_blockThreadId, klb_circular_dequeue* cq, int threadId, int* errFlag)
@@ -79,10 +345,20 @@ void klb_imageIO::blockCompressor(const char* buffer, int* g_blockSize, std::ato
 			xyzctCum[ii] = xyzctCum[ii - 1] * header.xyzct[ii - 1];
 	}
 	char* bufferIn = new char[blockSizeBytes];
+	char* bufferFilter = NULL;//prefiltered block (see KLB_COMPRESSION_TYPE)
+	char* bufferAux = NULL;
+	if (header.hasPrefilter())
+	{
+		bufferFilter = new char[blockSizeBytes];
+		bufferAux = new char[blockSizeBytes];
+	}
 	
 	BWTblockSize = std::min( BWTblockSize, iDivUp ((int)blockSizeBytes , (int)100000) );//packages of 100,000 bytes
 	
-	
+	//out-of-order writing (cq == NULL, see writeImageOutOfOrder): each thread compresses into its own buffer and writes the block itself
+	char* bufferOut = NULL;
+	if (cq == NULL)
+		bufferOut = new char[maxBlockSizeBytesCompressed];
 
 	std::uint64_t numBlocks = header.getNumBlocks();
 
@@ -166,7 +442,7 @@ void klb_imageIO::blockCompressor(const char* buffer, int* g_blockSize, std::ato
 #endif
 
 		//decide address where we write the compressed block output						
-		char* bufferOutPtr = cq->getWriteBlock(); //this operation is thread safe	
+		char* bufferOutPtr = (cq != NULL ? cq->getWriteBlock() : bufferOut); //this operation is thread safe	
 
 
 
@@ -199,17 +475,27 @@ void klb_imageIO::blockCompressor(const char* buffer, int* g_blockSize, std::ato
 											 break;
 		}
 		case KLB_COMPRESSION_TYPE::ZLIB:
+		case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
 		{									
+										   const char* bufferCompress = bufferIn;
+										   if (header.hasPrefilter())
+										   {
+											   prefilterBlock(header.compressionType, bufferIn, bufferFilter, gcount / bytesPerPixel, bytesPerPixel, blockSizeAux[0], bufferAux);
+											   bufferCompress = bufferFilter;
+										   }
+
 										   z_stream strm;
 										   strm.zalloc = Z_NULL;
 										   strm.zfree = Z_NULL;
 										   strm.opaque = Z_NULL;
-										   //which is an integer in the range of - 1 to 9. Lower compression levels result in faster execution, but less compression.Higher levels result in greater compression, but slower execution.The zlib constant Z_DEFAULT_COMPRESSION, equal to - 1, provides a good compromise between compression and speed and is equivalent to level 6. Level 0 actually does no compression at all
-										   *errFlag = deflateInit(&strm, Z_DEFAULT_COMPRESSION);
+										   //which is an integer in the range of - 1 to 9. Lower compression levels result in faster execution, but less compression.Higher levels result in greater compression, but slower execution.The zlib constant Z_DEFAULT_COMPRESSION, equal to - 1, provides a good compromise between compression and speed and is equivalent to level 6. Level 0 actually does no compression at all. Prefiltered blocks use the fastest level (see getZlibCompressionLevel)
+										   *errFlag = deflateInit(&strm, header.getZlibCompressionLevel());
 										   
 
 										   strm.avail_in = gcount;
-										   strm.next_in = (Bytef*)bufferIn;
+										   strm.next_in = (Bytef*)bufferCompress;
 										   strm.avail_out = maxBlockSizeBytesCompressed;
 										   strm.next_out = (Bytef*)bufferOutPtr;
 										   strm.data_type = Z_BINARY;//data type
@@ -243,6 +529,20 @@ void klb_imageIO::blockCompressor(const char* buffer, int* g_blockSize, std::ato
 		atomic_fetch_add(&g_countCompression, auxChrono);
 #endif
 
+		if (cq == NULL)
+		{
+			//reserve room after the blocks already written (whatever their id) and write the block there
+			std::uint64_t offset = atomic_fetch_add(&g_dataOffset, (std::uint64_t)sizeCompressed);
+			if (writeBlockAt(g_fileDescriptor, bufferOut, sizeCompressed, g_dataStart + offset) == false)
+			{
+				std::cout << "ERROR: workerfunc: writing block " << blockId_t << std::endl;
+				*errFlag = 5;
+			}
+			header.blockStart[blockId_t] = offset;//each block is written by a single thread
+			header.blockOffset[blockId_t] = offset + sizeCompressed;
+			continue;
+		}
+
 		cq->pushWriteBlock();//notify content is ready in the queue
 
 #ifdef DEBUG_PRINT_THREADS
@@ -266,6 +566,13 @@ void klb_imageIO::blockCompressor(const char* buffer, int* g_blockSize, std::ato
 	
 	//release memory
 	delete[] bufferIn;
+	if (bufferFilter != NULL)
+	{
+		delete[] bufferFilter;
+		delete[] bufferAux;
+	}
+	if (bufferOut != NULL)
+		delete[] bufferOut;
 
 }
 //======================================================
@@ -302,6 +609,13 @@ void klb_imageIO::blockCompressorStackSlices(const char** buffer, int* g_blockSi
 			xyzctCum[ii] = xyzctCum[ii - 1] * header.xyzct[ii - 1];
 	}
 	char* bufferIn = new char[blockSizeBytes];
+	char* bufferFilter = NULL;//prefiltered block (see KLB_COMPRESSION_TYPE)
+	char* bufferAux = NULL;
+	if (header.hasPrefilter())
+	{
+		bufferFilter = new char[blockSizeBytes];
+		bufferAux = new char[blockSizeBytes];
+	}
 
 	BWTblockSize = std::min(BWTblockSize, iDivUp((int)blockSizeBytes, (int)100000));//packages of 100,000 bytes
 
@@ -425,17 +739,27 @@ void klb_imageIO::blockCompressorStackSlices(const char** buffer, int* g_blockSi
 											 break;
 		}
 		case KLB_COMPRESSION_TYPE::ZLIB:
+		case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
 		{
+										   const char* bufferCompress = bufferIn;
+										   if (header.hasPrefilter())
+										   {
+											   prefilterBlock(header.compressionType, bufferIn, bufferFilter, gcount / bytesPerPixel, bytesPerPixel, blockSizeAux[0], bufferAux);
+											   bufferCompress = bufferFilter;
+										   }
+
 										   z_stream strm;
 										   strm.zalloc = Z_NULL;
 										   strm.zfree = Z_NULL;
 										   strm.opaque = Z_NULL;
-										   //which is an integer in the range of - 1 to 9. Lower compression levels result in faster execution, but less compression.Higher levels result in greater compression, but slower execution.The zlib constant Z_DEFAULT_COMPRESSION, equal to - 1, provides a good compromise between compression and speed and is equivalent to level 6. Level 0 actually does no compression at all
-										   *errFlag = deflateInit(&strm, Z_DEFAULT_COMPRESSION);
+										   //which is an integer in the range of - 1 to 9. Lower compression levels result in faster execution, but less compression.Higher levels result in greater compression, but slower execution.The zlib constant Z_DEFAULT_COMPRESSION, equal to - 1, provides a good compromise between compression and speed and is equivalent to level 6. Level 0 actually does no compression at all. Prefiltered blocks use the fastest level (see getZlibCompressionLevel)
+										   *errFlag = deflateInit(&strm, header.getZlibCompressionLevel());
 
 
 										   strm.avail_in = gcount;
-										   strm.next_in = (Bytef*)bufferIn;
+										   strm.next_in = (Bytef*)bufferCompress;
 										   strm.avail_out = maxBlockSizeBytesCompressed;
 										   strm.next_out = (Bytef*)bufferOutPtr;
 										   strm.data_type = Z_BINARY;//data type
@@ -493,19 +817,28 @@ void klb_imageIO::blockCompressorStackSlices(const char** buffer, int* g_blockSi
 
 	//release memory
 	delete[] bufferIn;
+	if (bufferFilter != NULL)
+	{
+		delete[] bufferFilter;
+		delete[] bufferAux;
+	}
 
 }
 //======================================================
-void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *blockId, const klb_ROI* ROI, int *errFlag)
+void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *blockId, const klb_ROI* ROI, const char* bufferImgFull, int *errFlag)
 {
 	*errFlag = 0;
-	//open file to read elements
-	FILE* fid = fopen(filename.c_str(), "rb"); 
-	if ( fid == NULL )
+	//open file to read elements (unless the file is already mapped in memory)
+	FILE* fid = NULL;
+	if (bufferImgFull == NULL)
 	{
-		cout << "ERROR: blockUncompressor: thread opening file " << filename << endl;
-		*errFlag = 3;
-		return;
+		fid = fopen(filename.c_str(), "rb");
+		if (fid == NULL)
+		{
+			cout << "ERROR: blockUncompressor: thread opening file " << filename << endl;
+			*errFlag = 3;
+			return;
+		}
 	}
 
 	//define variables
@@ -523,7 +856,7 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 	uint32_t offsetBufferBlock;////starting offset for each buffer within decompressed block
 	uint32_t blockSizeAux[KLB_DATA_DIMS];//for border cases where the blocksize might be different
 	uint64_t xyzctCum[KLB_DATA_DIMS];//to calculate offsets for each dimension in THE ROI
-	uint64_t offsetHeaderBytes = header.getSizeInBytes();
+	uint64_t offsetHeaderBytes = imageOffset + header.getSizeInBytes();
 
 	xyzctCum[0] = bytesPerPixel;
 	for (int ii = 0; ii < KLB_DATA_DIMS; ii++)
@@ -537,7 +870,18 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 
 	std::uint64_t numBlocks = header.getNumBlocks();
 	char* bufferIn = new char[blockSizeBytes];//temporary storage for decompressed block
-	char* bufferFile = new char[blockSizeBytes];//temporary storage for compressed block from file
+	char* bufferFilter = NULL;//prefiltered block (see KLB_COMPRESSION_TYPE)
+	char* bufferAux = NULL;
+	if (header.hasPrefilter())
+	{
+		bufferFilter = new char[blockSizeBytes];
+		bufferAux = new char[blockSizeBytes];
+	}
+	char* bufferFile = NULL;//temporary storage for compressed block from file
+	const char* bufferPtr;//compressed block (either in bufferFile or in the mapped file)
+	const char* bufferSrc;//decompressed block (either in bufferIn or in the mapped file for uncompressed data)
+	if (bufferImgFull == NULL)
+		bufferFile = new char[maximumBlockSizeCompressedInBytes()];
 
 	//main loop to keep processing blocks while they are available
 	while (1)
@@ -585,21 +929,28 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 		sizeCompressed = header.getBlockCompressedSizeBytes(blockId_t);
 		offset = header.getBlockOffset(blockId_t);
 
-		
-		fseek(fid, offsetHeaderBytes + offset, SEEK_SET);
-		fread(bufferFile, 1, sizeCompressed, fid);//read compressed block
+		if (bufferImgFull != NULL)
+		{
+			bufferPtr = &(bufferImgFull[offsetHeaderBytes + offset]);
+		}
+		else{
+			fseek(fid, offsetHeaderBytes + offset, SEEK_SET);
+			fread(bufferFile, 1, sizeCompressed, fid);//read compressed block
+			bufferPtr = bufferFile;
+		}
+		bufferSrc = bufferIn;
 
 		//apply decompression to block
 		switch (header.compressionType)
 		{
 		case KLB_COMPRESSION_TYPE::NONE://no compression
 			gcount = sizeCompressed;
-			memcpy(bufferIn, bufferFile, gcount);
+			bufferSrc = bufferPtr;//no need to copy the block
 			break;
 		case KLB_COMPRESSION_TYPE::BZIP2://bzip2
 		{
 				   gcount = blockSizeBytes;
-				   int ret = BZ2_bzBuffToBuffDecompress(bufferIn, &gcount, bufferFile, sizeCompressed, 0, 0);				   
+				   int ret = BZ2_bzBuffToBuffDecompress(bufferIn, &gcount, (char*)bufferPtr, sizeCompressed, 0, 0);				   
 				   if (ret != BZ_OK)
 				   {
 					   std::cout << "ERROR: workerfunc: uncompressing data at block " << blockId_t << std::endl;
@@ -609,6 +960,9 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 				   break;
 		}
 		case KLB_COMPRESSION_TYPE::ZLIB:
+		case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
 		{
 										   z_stream strm;
 										   strm.zalloc = Z_NULL;
@@ -622,11 +976,11 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 										   strm.avail_out = blockSizeBytes;
 										   strm.next_out = (Bytef*)bufferIn;
 										   strm.avail_in = sizeCompressed;
-										   strm.next_in = (Bytef*)bufferFile;
+										   strm.next_in = (Bytef*)bufferPtr;
 										   strm.data_type = Z_BINARY;//data type
 
 										   int ret = inflate(&strm, Z_FINISH);
-										   //gcount = sizeCompressed - strm.avail_out;
+										   gcount = blockSizeBytes - strm.avail_out;
 										   if (ret != Z_STREAM_END && ret != Z_OK)
 										   {
 											   std::cout << "ERROR: workerfunc: uncompressing data at block " << blockId_t << " with zlib. Error code " << ret << std::endl;
@@ -634,7 +988,7 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 											   gcount = 0;
 										   }
 										   //release strm
-										   (void)deflateEnd(&strm);
+										   (void)inflateEnd(&strm);
 										   break;
 		}
 		default:
@@ -645,6 +999,13 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 
 
 
+		//undo the prefilter applied before compression
+		if (header.hasPrefilter() && gcount > 0)
+		{
+			unprefilterBlock(header.compressionType, bufferIn, bufferFilter, gcount / bytesPerPixel, bytesPerPixel, std::min(header.blockSize[0], (uint32_t)(header.xyzct[0] - coordBlock[0])), bufferAux);
+			bufferSrc = bufferFilter;
+		}
+
 		//-------------------parse bufferIn to bufferOut image buffer-----------------------------------
 		//------------------intersection of two ROI (blopck and image ROI) is another ROI, so we just need to calculate the intersection and its offsets
 
@@ -690,7 +1051,7 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 		int auxDim = 1;
 		const size_t bufferCopySize = bytesPerPixel * blockSizeAux[0];
 		const size_t bufferInOffset = blockSizeAuxCum[1];
-		char* bufferInAux = &(bufferIn[offsetBufferBlock]);
+		const char* bufferInAux = &(bufferSrc[offsetBufferBlock]);
 		while (auxDim < KLB_DATA_DIMS)
 		{
 			//copy fastest moving coordinate all at once for efficiency
@@ -716,7 +1077,7 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 				offsetBuffer += xyzctCum[auxDim]; //update buffer
 				offsetBufferBlock += blockSizeAuxCum[auxDim];
 
-				bufferInAux = &(bufferIn[offsetBufferBlock]);//with ROI it is not a constant increment
+				bufferInAux = &(bufferSrc[offsetBufferBlock]);//with ROI it is not a constant increment
 			}
 		}
 		//-------------------end of parse bufferIn to bufferOut image buffer-----------------------------------
@@ -731,14 +1092,22 @@ void klb_imageIO::blockUncompressor(char* bufferOut, std::atomic<uint64_t> *bloc
 
 
 	//release memory
-	fclose(fid);
+	if (fid != NULL)
+		fclose(fid);
 	delete[] bufferIn;
-	delete[] bufferFile;
+	if (bufferFilter != NULL)
+	{
+		delete[] bufferFilter;
+		delete[] bufferAux;
+	}
+	if (bufferFile != NULL)
+		delete[] bufferFile;
 
 }
 
 //======================================================
-void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>	*blockId, char* bufferImgFull, int *errFlag)
+//bufferImgFull is the whole file (read in memory or mapped). If numBlocksAhead > 0, the compressed block numBlocksAhead positions ahead is prefetched (for mapped files) while the current one is decompressed
+void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>	*blockId, const char* bufferImgFull, std::uint64_t bufferImgFullLength, int numBlocksAhead, int *errFlag, std::vector<char>* scratch)
 {
 	*errFlag = 0;
 	
@@ -756,7 +1125,7 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 	uint64_t offsetBuffer;//starting offset for each buffer within ROI
 	uint32_t blockSizeAux[KLB_DATA_DIMS];//for border cases where the blocksize might be different
 	uint64_t xyzctCum[KLB_DATA_DIMS];//to calculate offsets for each dimension in THE ROI
-	uint64_t offsetHeaderBytes = header.getSizeInBytes();
+	uint64_t offsetHeaderBytes = imageOffset + header.getSizeInBytes();
 
 	xyzctCum[0] = bytesPerPixel;
 	for (int ii = 0; ii < KLB_DATA_DIMS; ii++)
@@ -768,8 +1137,22 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 	}
 
 	std::uint64_t numBlocks = header.getNumBlocks();
-	char* bufferIn = new char[blockSizeBytes];//temporary storage for decompressed block
-	char* bufferPtr;//pointer to preloaded compressed file in memory
+	std::vector<char> scratchLocal;
+	if (scratch == NULL)
+		scratch = &scratchLocal;
+	const size_t scratchSize = (header.hasPrefilter() ? 3 : 1) * (size_t)blockSizeBytes;
+	if (scratch->size() < scratchSize)//only grows, so persistent threads (klb_imageReader) allocate it once for a series of images
+		scratch->resize(scratchSize);
+	char* bufferIn = scratch->data();//temporary storage for decompressed block
+	char* bufferFilter = NULL;//prefiltered block (see KLB_COMPRESSION_TYPE)
+	char* bufferAux = NULL;
+	if (header.hasPrefilter())
+	{
+		bufferFilter = bufferIn + blockSizeBytes;
+		bufferAux = bufferIn + 2 * (size_t)blockSizeBytes;
+	}
+	const char* bufferPtr;//pointer to preloaded compressed file in memory
+	const char* bufferSrc;//decompressed block (either in bufferIn or in bufferImgFull for uncompressed data)
 
 	//main loop to keep processing blocks while they are available
 	while (1)
@@ -797,23 +1180,30 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 #endif
 
 
+		//read ahead the block that will be decompressed later while we decompress this one
+		if (numBlocksAhead > 0 && blockId_t + numBlocksAhead < numBlocks)
+		{
+			prefetchFileRange(bufferImgFull, bufferImgFullLength, offsetHeaderBytes + header.getBlockOffset(blockId_t + numBlocksAhead), header.getBlockCompressedSizeBytes(blockId_t + numBlocksAhead));
+		}
+
 		//uncompress block into temp bufferIn
 		sizeCompressed = header.getBlockCompressedSizeBytes(blockId_t);
 		offset = header.getBlockOffset(blockId_t);
 
 		bufferPtr = &(bufferImgFull[offsetHeaderBytes + offset]);		
+		bufferSrc = bufferIn;
 
 		//apply decompression to block
 		switch (header.compressionType)
 		{
 		case KLB_COMPRESSION_TYPE::NONE://no compression
 			gcount = sizeCompressed;
-			memcpy(bufferIn, bufferPtr, gcount);
+			bufferSrc = bufferPtr;//no need to copy the block
 			break;
 		case KLB_COMPRESSION_TYPE::BZIP2://bzip2
 		{
 				   gcount = blockSizeBytes;
-				   int ret = BZ2_bzBuffToBuffDecompress(bufferIn, &gcount, bufferPtr, sizeCompressed, 0, 0);
+				   int ret = BZ2_bzBuffToBuffDecompress(bufferIn, &gcount, (char*)bufferPtr, sizeCompressed, 0, 0);
 				   if (ret != BZ_OK)
 				   {
 					   std::cout << "ERROR: workerfunc: decompressing data at block " << blockId_t << std::endl;
@@ -823,6 +1213,9 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 				   break;
 		}
 		case KLB_COMPRESSION_TYPE::ZLIB:
+		case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
 		{
 										   z_stream strm;
 										   strm.zalloc = Z_NULL;
@@ -840,7 +1233,7 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 										   strm.data_type = Z_BINARY;//data type
 
 										   int ret = inflate(&strm, Z_FINISH);
-										   //gcount = sizeCompressed - strm.avail_out;
+										   gcount = blockSizeBytes - strm.avail_out;
 										   if (ret != Z_STREAM_END && ret != Z_OK)
 										   {
 											   std::cout << "ERROR: workerfunc: uncompressing data at block " << blockId_t << " with zlib. Error code " << ret << std::endl;
@@ -848,7 +1241,7 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 											   gcount = 0;
 										   }
 										   //release strm
-										   (void)deflateEnd(&strm);
+										   (void)inflateEnd(&strm);
 										   break;
 		}
 		default:
@@ -859,6 +1252,13 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 
 
 
+		//undo the prefilter applied before compression
+		if (header.hasPrefilter() && gcount > 0)
+		{
+			unprefilterBlock(header.compressionType, bufferIn, bufferFilter, gcount / bytesPerPixel, bytesPerPixel, std::min(header.blockSize[0], (uint32_t)(header.xyzct[0] - coordBlock[0])), bufferAux);
+			bufferSrc = bufferFilter;
+		}
+
 		//-------------------parse bufferIn to bufferOut image buffer-----------------------------------		
 
 		//calculate block size in case we had border block				
@@ -882,7 +1282,7 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 		uint32_t bcount[KLB_DATA_DIMS];
 		memset(bcount, 0, sizeof(uint32_t)* KLB_DATA_DIMS);
 		const size_t bufferCopySize = bytesPerPixel * blockSizeAux[0];
-		char* bufferInPtr = bufferIn;
+		const char* bufferInPtr = bufferSrc;
 		while (auxDim < KLB_DATA_DIMS)
 		{
 			
@@ -916,9 +1316,6 @@ void klb_imageIO::blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>
 	}
 
 
-	//release memory
-	delete[] bufferIn;
-
 }
 
 //======================================================
@@ -948,7 +1345,7 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 	uint64_t offsetBuffer;//starting offset for each buffer within ROI
 	uint32_t blockSizeAux[KLB_DATA_DIMS];//for border cases where the blocksize might be different
 	uint64_t xyzctCum[KLB_DATA_DIMS];//to calculate offsets for each dimension in THE ROI
-	uint64_t offsetHeaderBytes = header.getSizeInBytes();
+	uint64_t offsetHeaderBytes = imageOffset + header.getSizeInBytes();
 
 	xyzctCum[0] = bytesPerPixel;
 	for (int ii = 0; ii < KLB_DATA_DIMS; ii++)
@@ -961,7 +1358,15 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 
 	std::uint64_t numBlocks = header.getNumBlocks();
 	char* bufferIn = new char[blockSizeBytes];//temporary storage for decompressed block
+	char* bufferFilter = NULL;//prefiltered block (see KLB_COMPRESSION_TYPE)
+	char* bufferAux = NULL;
+	if (header.hasPrefilter())
+	{
+		bufferFilter = new char[blockSizeBytes];
+		bufferAux = new char[blockSizeBytes];
+	}
 	char* bufferFile = new char[maximumBlockSizeCompressedInBytes()];//temporary storage for compressed block from file
+	const char* bufferSrc;//decompressed block (either in bufferIn or in bufferFilter for prefiltered data)
 
 	//main loop to keep processing blocks while they are available
 	while (1)
@@ -995,6 +1400,7 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 
 		fseek(fid, offsetHeaderBytes + offset, SEEK_SET);
 		fread(bufferFile, 1, sizeCompressed, fid);
+		bufferSrc = bufferIn;
 
 		//apply decompression to block
 		switch (header.compressionType)
@@ -1016,6 +1422,9 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 				   break;
 		}
 		case KLB_COMPRESSION_TYPE::ZLIB:
+		case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+		case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
 		{
 										   z_stream strm;
 										   strm.zalloc = Z_NULL;
@@ -1033,7 +1442,7 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 										   strm.data_type = Z_BINARY;//data type
 
 										   int ret = inflate(&strm, Z_FINISH);
-										   //gcount = sizeCompressed - strm.avail_out;
+										   gcount = blockSizeBytes - strm.avail_out;
 										   if (ret != Z_STREAM_END && ret != Z_OK)
 										   {
 											   std::cout << "ERROR: workerfunc: uncompressing data at block " << blockId_t << " with zlib. Error code " << ret << std::endl;
@@ -1041,7 +1450,7 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 											   gcount = 0;
 										   }
 										   //release strm
-										   (void)deflateEnd(&strm);
+										   (void)inflateEnd(&strm);
 										   break;
 		}
 		default:
@@ -1052,6 +1461,13 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 
 
 
+		//undo the prefilter applied before compression
+		if (header.hasPrefilter() && gcount > 0)
+		{
+			unprefilterBlock(header.compressionType, bufferIn, bufferFilter, gcount / bytesPerPixel, bytesPerPixel, std::min(header.blockSize[0], (uint32_t)(header.xyzct[0] - coordBlock[0])), bufferAux);
+			bufferSrc = bufferFilter;
+		}
+
 		//-------------------parse bufferIn to bufferOut image buffer-----------------------------------		
 
 		//calculate block size in case we had border block				
@@ -1075,7 +1491,7 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 		uint32_t bcount[KLB_DATA_DIMS];
 		memset(bcount, 0, sizeof(uint32_t)* KLB_DATA_DIMS);
 		const size_t bufferCopySize = bytesPerPixel * blockSizeAux[0];
-		char* bufferInPtr = bufferIn;
+		const char* bufferInPtr = bufferSrc;
 		while (auxDim < KLB_DATA_DIMS)
 		{
 
@@ -1112,6 +1528,11 @@ void klb_imageIO::blockUncompressorImageFull(char* bufferOut, std::atomic<uint64
 	//release memory
 	fclose(fid);
 	delete[] bufferIn;
+	if (bufferFilter != NULL)
+	{
+		delete[] bufferFilter;
+		delete[] bufferAux;
+	}
 	delete[] bufferFile;
 }
 
@@ -1175,6 +1596,7 @@ void klb_imageIO::blockWriter(FILE* fout, int* g_blockSize, int* g_blockThreadId
 #endif
 		//now we can release data
 		cq[g_blockThreadId[nextBlockId]]->popReadBlock();
+		header.blockStart[nextBlockId] = offset;
 		offset += blockSize;
 
 		//update header blockOffset
@@ -1187,9 +1609,19 @@ void klb_imageIO::blockWriter(FILE* fout, int* g_blockSize, int* g_blockThreadId
 	//flush the rest of the buffer
 	fwrite(bufferMem, 1, bufferOffset, fout);
 #endif
-	//update header.blockOffset	
-	fseek(fout, header.getSizeInBytesFixPortion(), SEEK_SET);
-	fwrite((char*)(&(header.blockOffset[0])), 1, header.Nb * sizeof(std::uint64_t), fout);
+	if (header.isIndexed())
+	{
+		//block index after the blocks, then its offset in the header
+		header.indexOffset = offset;
+		header.writeBlockIndex(fout);
+		fseek(fout, imageOffset + header.getSizeInBytesFixPortion(), SEEK_SET);
+		fwrite((char*)(&(header.indexOffset)), 1, sizeof(std::uint64_t), fout);
+	}
+	else{
+		//update header.blockOffset	
+		fseek(fout, imageOffset + header.getSizeInBytesFixPortion(), SEEK_SET);
+		fwrite((char*)(&(header.blockOffset[0])), 1, header.Nb * sizeof(std::uint64_t), fout);
+	}
 
 	//close file	
 	fclose(fout);
@@ -1209,12 +1641,18 @@ void klb_imageIO::blockWriter(FILE* fout, int* g_blockSize, int* g_blockThreadId
 klb_imageIO::klb_imageIO()
 {
 	numThreads = std::thread::hardware_concurrency();
+	imageOffset = 0;
+	g_fileDescriptor = -1;
+	g_dataStart = 0;
 }
 
 klb_imageIO::klb_imageIO(const std::string &filename_)
 {
 	filename = filename_;//it could be used as output or input file
 	numThreads = std::thread::hardware_concurrency();
+	imageOffset = 0;
+	g_fileDescriptor = -1;
+	g_dataStart = 0;
 }
 
 
@@ -1233,15 +1671,23 @@ int klb_imageIO::writeImage(const char* img, int numThreads)
 	if (numThreads <= 0)//use maximum available
 		numThreads = std::thread::hardware_concurrency();
 
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (header.isIndexed())//blocks do not need to be written in order
+		return writeImageOutOfOrder(img, numThreads);
+#endif
+
 	//open output file
 	//std::ofstream fout(filenameOut.c_str(), std::ios::binary | std::ios::out);	
 	//we do this before calling the thread in case we have problems
-	FILE* fout = fopen(filename.c_str(), "wb");//for wahtever reason FILE* is 4X faster than std::ofstream over the network. C interface is much faster than C++ streams
+	//pyramid levels (imageOffset > 0) are written within an existing file
+	FILE* fout = fopen(filename.c_str(), (imageOffset > 0 ? "r+b" : "wb"));//for wahtever reason FILE* is 4X faster than std::ofstream over the network. C interface is much faster than C++ streams
 	if (fout == NULL)
 	{
 		std::cout << "ERROR: file " << filename << " could not be opened" << std::endl;
 		return 5;
 	}
+	if (imageOffset > 0)
+		fseek(fout, imageOffset, SEEK_SET);
 
 
 #ifdef PROFILE_COMPRESSION
@@ -1334,6 +1780,231 @@ int klb_imageIO::writeImage(const char* img, int numThreads)
 
 //=================================================
 
+int klb_imageIO::writeImageOutOfOrder(const char* img, int numThreads)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	std::cout << "ERROR: out-of-order writing is only available in POSIX systems" << std::endl;
+	return 5;
+#else
+	//pyramid levels (imageOffset > 0) are written within an existing file
+	g_fileDescriptor = open(filename.c_str(), O_WRONLY | O_CREAT | (imageOffset > 0 ? 0 : O_TRUNC), 0666);
+	if (g_fileDescriptor < 0)
+	{
+		std::cout << "ERROR: file " << filename << " could not be opened" << std::endl;
+		return 5;
+	}
+
+	//safety checks to avoid blocksize too large
+	for (int ii = 0; ii < KLB_DATA_DIMS; ii++)
+		header.blockSize[ii] = std::min(header.blockSize[ii], header.xyzct[ii]);//block size cannot be larger than dimensions
+
+	//blocks are written after the header as soon as they are compressed: the header (whose size does not depend on the block sizes) is written at the end
+	header.resizeBlockOffset(header.calculateNumBlocks());
+	g_dataStart = imageOffset + header.getSizeInBytes();
+
+	int err = writeBlocksOutOfOrder(img, numThreads);
+	if (err > 0)
+	{
+		close(g_fileDescriptor);
+		return err;
+	}
+
+	//header and block index
+	FILE* fout = fdopen(g_fileDescriptor, "wb");//does not truncate the file
+	if (fout == NULL)
+	{
+		close(g_fileDescriptor);
+		std::cout << "ERROR: file " << filename << " could not be opened" << std::endl;
+		return 5;
+	}
+	fseek(fout, imageOffset, SEEK_SET);
+	header.writeHeader(fout);
+	fseek(fout, g_dataStart + header.indexOffset, SEEK_SET);
+	header.writeBlockIndex(fout);
+	if (fclose(fout) != 0)
+	{
+		std::cout << "ERROR: file " << filename << " could not be written" << std::endl;
+		return 5;
+	}
+
+	return 0;
+#endif
+}
+
+//=================================================
+
+int klb_imageIO::writeBlocksOutOfOrder(const char* img, int numThreads)
+{
+	const std::uint64_t numBlocks = header.getNumBlocks();
+
+	//number of threads should not be highr than number of blocks (in case somebody set block size too large)
+	numThreads = std::min((std::uint64_t) numThreads, numBlocks);
+
+	std::atomic<uint64_t> blockId;
+	atomic_store(&blockId, (uint64_t)0);
+	atomic_store(&g_dataOffset, (uint64_t)0);
+
+	// start the working threads (no queue, no writer thread)
+	std::vector<std::thread> threads;
+	std::vector<int> errFlagVec(numThreads, 0);
+	for (int i = 0; i < numThreads; ++i)
+	{
+		threads.push_back(std::thread(&klb_imageIO::blockCompressor, this, img, (int*)NULL, &blockId, (int*)NULL, (klb_circular_dequeue*)NULL, i, &(errFlagVec[i])));
+	}
+
+	//wait for the workers to finish
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	header.indexOffset = atomic_load(&g_dataOffset);
+
+	for (int ii = 0; ii < numThreads; ii++)
+	{
+		if (errFlagVec[ii] != 0)
+			return errFlagVec[ii];
+	}
+	return 0;
+}
+
+//=================================================
+
+int klb_imageIO::appendTimePoint(const char* img, int numThreads)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	std::cout << "ERROR: appending time points is only available in POSIX systems" << std::endl;
+	return 5;
+#else
+	if (numThreads <= 0)//use maximum available
+		numThreads = std::thread::hardware_concurrency();
+
+	//first time point: the file is created with the header set by the caller
+	FILE* fid = fopen(filename.c_str(), "rb");
+	if (fid == NULL)
+	{
+		header.xyzct[KLB_DATA_DIMS - 1] = 1;
+		header.blockSize[KLB_DATA_DIMS - 1] = 1;
+		header.headerVersion = KLB_INDEXED_HEADER_VERSION;
+		imageOffset = 0;
+		return writeImage(img, numThreads);
+	}
+	fclose(fid);
+
+	//the stack to append has to fit the header of the file
+	std::uint32_t xyzctSlice[KLB_DATA_DIMS];
+	memcpy(xyzctSlice, header.xyzct, sizeof(std::uint32_t) * KLB_DATA_DIMS);
+	const KLB_DATA_TYPE dataTypeSlice = header.dataType;
+	int err = header.readHeader(filename.c_str(), 0);
+	if (err > 0)
+		return err;
+	for (int ii = 0; ii < KLB_DATA_DIMS - 1; ii++)
+	{
+		if (xyzctSlice[ii] != header.xyzct[ii])
+		{
+			std::cout << "ERROR: appendTimePoint: dimensions of the stack do not match the ones of file " << filename << std::endl;
+			return 2;
+		}
+	}
+	if (dataTypeSlice != header.dataType)
+	{
+		std::cout << "ERROR: appendTimePoint: data type of the stack does not match the one of file " << filename << std::endl;
+		return 2;
+	}
+	if (header.blockSize[KLB_DATA_DIMS - 1] != 1)
+	{
+		std::cout << "ERROR: appendTimePoint: blocks of file " << filename << " span several time points" << std::endl;
+		return 2;
+	}
+
+	//pyramid levels would be overwritten by the new blocks
+	std::vector<klb_pyramid_level> levels;
+	std::uint64_t directoryOffset;
+	err = klb_image_header::readPyramidDirectory(filename.c_str(), levels, &directoryOffset);
+	if (err > 0)
+		return err;
+	if (levels.empty() == false)
+	{
+		std::cout << "ERROR: appendTimePoint: can not append time points to file " << filename << " since it contains pyramid levels" << std::endl;
+		return 2;
+	}
+
+	//files with cumulative block offsets in the header are converted to the indexed layout: the header becomes shorter, the blocks stay where they are
+	if (header.isIndexed() == false)
+	{
+		const std::uint64_t shift = header.getSizeInBytes();
+		header.headerVersion = KLB_INDEXED_HEADER_VERSION;
+		header.indexOffset = header.blockOffset[header.Nb - 1];
+		const std::uint64_t delta = shift - header.getSizeInBytes();
+		for (size_t ii = 0; ii < header.Nb; ii++)
+		{
+			header.blockStart[ii] += delta;
+			header.blockOffset[ii] += delta;
+		}
+		header.indexOffset += delta;
+	}
+
+	//compress and write the blocks of the new time point after the current ones (overwriting the block index)
+	klb_imageIO sliceIO(filename);
+	sliceIO.header = header;
+	sliceIO.header.xyzct[KLB_DATA_DIMS - 1] = 1;
+	sliceIO.header.resizeBlockOffset(sliceIO.header.calculateNumBlocks());
+	sliceIO.g_dataStart = header.getSizeInBytes() + header.indexOffset;
+	sliceIO.g_fileDescriptor = open(filename.c_str(), O_WRONLY);
+	if (sliceIO.g_fileDescriptor < 0)
+	{
+		std::cout << "ERROR: file " << filename << " could not be opened" << std::endl;
+		return 5;
+	}
+	err = sliceIO.writeBlocksOutOfOrder(img, numThreads);
+	close(sliceIO.g_fileDescriptor);
+	if (err > 0)
+		return err;
+
+	//block index of the new time point
+	const size_t numBlocksOld = header.Nb;
+	std::vector<std::uint64_t> blockStartOld(header.blockStart, header.blockStart + numBlocksOld);
+	std::vector<std::uint64_t> blockOffsetOld(header.blockOffset, header.blockOffset + numBlocksOld);
+	header.xyzct[KLB_DATA_DIMS - 1]++;
+	header.resizeBlockOffset(header.calculateNumBlocks());
+	if (header.Nb != numBlocksOld + sliceIO.header.Nb)
+	{
+		std::cout << "ERROR: appendTimePoint: inconsistent number of blocks" << std::endl;
+		return 2;
+	}
+	memcpy(header.blockStart, blockStartOld.data(), numBlocksOld * sizeof(std::uint64_t));
+	memcpy(header.blockOffset, blockOffsetOld.data(), numBlocksOld * sizeof(std::uint64_t));
+	for (size_t ii = 0; ii < sliceIO.header.Nb; ii++)
+	{
+		header.blockStart[numBlocksOld + ii] = header.indexOffset + sliceIO.header.blockStart[ii];
+		header.blockOffset[numBlocksOld + ii] = header.indexOffset + sliceIO.header.blockOffset[ii];
+	}
+	header.indexOffset += sliceIO.header.indexOffset;
+
+	//block index then header (the header is updated last)
+	FILE* fout = fopen(filename.c_str(), "r+b");
+	if (fout == NULL)
+	{
+		std::cout << "ERROR: file " << filename << " could not be opened" << std::endl;
+		return 5;
+	}
+	fseek(fout, header.getSizeInBytes() + header.indexOffset, SEEK_SET);
+	header.writeBlockIndex(fout);
+	fflush(fout);
+	fseek(fout, 0, SEEK_SET);
+	header.writeHeader(fout);
+	if (fclose(fout) != 0)
+	{
+		std::cout << "ERROR: file " << filename << " could not be written" << std::endl;
+		return 5;
+	}
+
+	return 0;
+#endif
+}
+
+//=================================================
+
 int klb_imageIO::writeImageStackSlices(const char** img, int numThreads)
 {
 
@@ -1485,12 +2156,19 @@ int klb_imageIO::readImage(char* img, const klb_ROI* ROI, int numThreads)
 	std::atomic<uint64_t> blockId;
 	atomic_store(&blockId, (uint64_t)0);
 
+	//map the file: only the pages of the blocks intersecting the ROI are read from disk
+	std::uint64_t imgMapLength = 0;
+	const char* imgMap = NULL;
+#ifdef USE_MMAP_READ
+	imgMap = mapFileReadOnly(filename, imageOffset + header.getCompressedFileSizeInBytes(), &imgMapLength);
+#endif
+
 	// start the working threads
 	std::vector<std::thread> threads;
 	std::vector<int> errFlagVec(numThreads, 0);
 	for (int i = 0; i < numThreads; ++i)
 	{
-		threads.push_back(std::thread(&klb_imageIO::blockUncompressor, this, img, &blockId, ROI, &(errFlagVec[i])));
+		threads.push_back(std::thread(&klb_imageIO::blockUncompressor, this, img, &blockId, ROI, imgMap, &(errFlagVec[i])));
 	}
 
 	//wait for the workers to finish
@@ -1498,6 +2176,7 @@ int klb_imageIO::readImage(char* img, const klb_ROI* ROI, int numThreads)
 		t.join();
 
 	//release memory
+	unmapFile(imgMap, imgMapLength);
 	
 	for (int ii = 0; ii < numThreads; ii++)
 	{
@@ -1553,22 +2232,32 @@ int klb_imageIO::readImageFull(char* imgOut, int numThreads)
 		return 3;
 	}
 	//auto t1 = Clock::now();
-	char* imgIn = new char[header.getCompressedFileSizeInBytes()];
-	fread(imgIn, 1, header.getCompressedFileSizeInBytes(), fid);
+	char* imgIn = new char[imageOffset + header.getCompressedFileSizeInBytes()];
+	fread(imgIn, 1, imageOffset + header.getCompressedFileSizeInBytes(), fid);
 	fclose(fid);
 	//auto t2 = Clock::now();
 	//std::cout << "=======DEBUGGING:took " << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << " ms to read file from disk memory by a single thread" << std::endl;
 #endif
 
+	//map the file: threads decompress straight from the mapping and each one prefetches the block it will process next
+	std::uint64_t imgMapLength = 0;
+	const char* imgMap = NULL;
+#ifndef USE_MEM_BUFFER_READ
+	imgMap = mapImage(&imgMapLength, numThreads);
+#endif
+
 	// start the working threads
 	std::vector<std::thread> threads;
 	std::vector<int> errFlagVec(numThreads, 0);
 	for (int i = 0; i < numThreads; ++i)
 	{
 #ifdef USE_MEM_BUFFER_READ		
-			threads.push_back(std::thread(&klb_imageIO::blockUncompressorInMem, this, imgOut, &g_blockId, imgIn, &(errFlagVec[i])));
+			threads.push_back(std::thread(&klb_imageIO::blockUncompressorInMem, this, imgOut, &g_blockId, imgIn, imageOffset + header.getCompressedFileSizeInBytes(), 0, &(errFlagVec[i]), (std::vector<char>*)NULL));
 #else
-		threads.push_back(std::thread(&klb_imageIO::blockUncompressorImageFull, this, imgOut, &g_blockId, &(errFlagVec[i])));		
+		if (imgMap != NULL)
+			threads.push_back(std::thread(&klb_imageIO::blockUncompressorInMem, this, imgOut, &g_blockId, imgMap, imgMapLength, numThreads, &(errFlagVec[i]), (std::vector<char>*)NULL));
+		else
+			threads.push_back(std::thread(&klb_imageIO::blockUncompressorImageFull, this, imgOut, &g_blockId, &(errFlagVec[i])));		
 #endif
 	}
 
@@ -1577,6 +2266,7 @@ int klb_imageIO::readImageFull(char* imgOut, int numThreads)
 		t.join();
 
 	//release memory
+	unmapImage(imgMap, imgMapLength);
 #ifdef USE_MEM_BUFFER_READ		
 	delete[] imgIn;
 #endif
@@ -1588,6 +2278,153 @@ int klb_imageIO::readImageFull(char* imgOut, int numThreads)
 	return 0;//TODO: catch errors from threads (especially opening file)
 }
 
+//=================================================
+
+//=================================================
+
+const char* klb_imageIO::mapImage(std::uint64_t* length, int numBlocksPrefetch)
+{
+	*length = 0;
+#ifdef USE_MMAP_READ
+	const char* imgMap = mapFileReadOnly(filename, imageOffset + header.getCompressedFileSizeInBytes(), length);
+	if (imgMap != NULL)//the first block of each thread
+	{
+		for (int ii = 0; ii < numBlocksPrefetch && ii < (int)(header.Nb); ii++)
+			prefetchFileRange(imgMap, *length, imageOffset + header.getSizeInBytes() + header.getBlockOffset(ii), header.getBlockCompressedSizeBytes(ii));
+	}
+	return imgMap;
+#else
+	return NULL;
+#endif
+}
+
+void klb_imageIO::unmapImage(const char* imgMap, std::uint64_t length)
+{
+	unmapFile(imgMap, length);
+}
+
+int klb_imageIO::getNumPyramidLevels()
+{
+	std::vector<klb_pyramid_level> levels;
+	std::uint64_t directoryOffset;
+	if (klb_image_header::readPyramidDirectory(filename.c_str(), levels, &directoryOffset) > 0)
+		return 0;
+	return (int)(levels.size());
+}
+
+//=================================================
+
+int klb_imageIO::readPyramidLevelHeader(int level, klb_image_header &levelHeader, float32_t filterSigma[3], std::int32_t filterInfo[2])
+{
+	if (level == 0)//full resolution image
+	{
+		if (filterSigma != NULL)
+			filterSigma[0] = filterSigma[1] = filterSigma[2] = 0;
+		if (filterInfo != NULL)
+			filterInfo[0] = filterInfo[1] = -1;
+		return levelHeader.readHeader(filename.c_str(), 0);
+	}
+
+	std::vector<klb_pyramid_level> levels;
+	std::uint64_t directoryOffset;
+	int err = klb_image_header::readPyramidDirectory(filename.c_str(), levels, &directoryOffset);
+	if (err > 0)
+		return err;
+	if (level < 0 || level > (int)(levels.size()))
+	{
+		std::cout << "ERROR: readPyramidLevelHeader: file " << filename << " has no pyramid level " << level << " (" << levels.size() << " stored levels)" << std::endl;
+		return 2;
+	}
+
+	if (filterSigma != NULL)
+		memcpy(filterSigma, levels[level - 1].filterSigma, 3 * sizeof(float32_t));
+	if (filterInfo != NULL)
+		memcpy(filterInfo, levels[level - 1].filterInfo, 2 * sizeof(std::int32_t));
+	return levelHeader.readHeader(filename.c_str(), levels[level - 1].offset);
+}
+
+//=================================================
+
+int klb_imageIO::readPyramidLevel(char* img, int level, int numThreads)
+{
+	std::vector<klb_pyramid_level> levels;
+	std::uint64_t directoryOffset;
+	int err = klb_image_header::readPyramidDirectory(filename.c_str(), levels, &directoryOffset);
+	if (err > 0)
+		return err;
+	if (level < 0 || level > (int)(levels.size()))
+	{
+		std::cout << "ERROR: readPyramidLevel: file " << filename << " has no pyramid level " << level << " (" << levels.size() << " stored levels)" << std::endl;
+		return 2;
+	}
+
+	//the level is a regular klb image starting at levels[level - 1].offset
+	klb_imageIO levelIO(filename);
+	if (level > 0)
+		levelIO.imageOffset = levels[level - 1].offset;
+	err = levelIO.readHeader();
+	if (err > 0)
+		return err;
+
+	return levelIO.readImageFull(img, numThreads);
+}
+
+//=================================================
+
+int klb_imageIO::writePyramidLevel(const char* img, const std::uint32_t xyzct_[KLB_DATA_DIMS], const float32_t filterSigma[3], const std::int32_t filterInfo[2], int numThreads)
+{
+	//full resolution image
+	int err = header.readHeader(filename.c_str(), 0);
+	if (err > 0)
+		return err;
+
+	//the new level overwrites the pyramid directory, which is written again after it
+	std::vector<klb_pyramid_level> levels;
+	std::uint64_t directoryOffset;
+	err = klb_image_header::readPyramidDirectory(filename.c_str(), levels, &directoryOffset);
+	if (err > 0)
+		return err;
+	if (levels.empty())
+		directoryOffset = header.getCompressedFileSizeInBytes();
+
+	float32_t pixelSize_[KLB_DATA_DIMS];
+	for (int ii = 0; ii < KLB_DATA_DIMS; ii++)
+	{
+		if (xyzct_[ii] == 0)
+		{
+			std::cout << "ERROR: writePyramidLevel: pyramid level dimensions can not be 0" << std::endl;
+			return 2;
+		}
+		pixelSize_[ii] = header.pixelSize[ii] * (float32_t)(header.xyzct[ii]) / (float32_t)(xyzct_[ii]);
+	}
+
+	klb_imageIO levelIO(filename);
+	levelIO.imageOffset = directoryOffset;
+	levelIO.header.setHeader(xyzct_, header.dataType, pixelSize_, NULL, header.compressionType, header.metadata);
+	err = levelIO.writeImage(img, numThreads);
+	if (err > 0)
+		return err;
+
+	klb_pyramid_level level;
+	level.offset = directoryOffset;
+	for (int ii = 0; ii < 3; ii++)
+		level.filterSigma[ii] = (filterSigma != NULL ? filterSigma[ii] : 0);
+	for (int ii = 0; ii < 2; ii++)
+		level.filterInfo[ii] = (filterInfo != NULL ? filterInfo[ii] : -1);
+	levels.push_back(level);
+
+	FILE* fout = fopen(filename.c_str(), "r+b");
+	if (fout == NULL)
+	{
+		std::cout << "ERROR: file " << filename << " could not be opened" << std::endl;
+		return 5;
+	}
+	err = klb_image_header::writePyramidDirectory(fout, levels, levelIO.imageOffset + levelIO.header.getCompressedFileSizeInBytes());
+	fclose(fout);
+
+	return err;
+}
+
 
 //======================================================
 std::uint32_t klb_imageIO::maximumBlockSizeCompressedInBytes()
@@ -1601,6 +2438,9 @@ std::uint32_t klb_imageIO::maximumBlockSizeCompressedInBytes()
 		break;
 	case KLB_COMPRESSION_TYPE::BZIP2:
 	case KLB_COMPRESSION_TYPE::ZLIB:
+	case KLB_COMPRESSION_TYPE::SHUFFLE_ZLIB:
+	case KLB_COMPRESSION_TYPE::BITSHUFFLE_ZLIB:
+	case KLB_COMPRESSION_TYPE::DELTA_SHUFFLE_ZLIB:
 		/*
 			From bzip2 man page: Compression is  always  performed,  even	 if  the  compressed  file  is
 			slightly	 larger	 than the original.Files of less than about one hun -
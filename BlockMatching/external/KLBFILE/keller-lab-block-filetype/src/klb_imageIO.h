@@ -46,6 +46,8 @@ EXPIMP_TEMPLATE class DECLSPECIFIER std::condition_variable;
 
 class DECLSPECIFIER klb_imageIO
 {
+	friend class klb_imageReader;//reuses the decompressing functions with persistent threads
+
 public:
 	
 	klb_image_header header;
@@ -60,7 +62,7 @@ public:
 	void setFilename(const std::string &filename_){ filename = filename_; };	
 
 	//main functions
-	int readHeader(){ return header.readHeader(filename.c_str()); };
+	int readHeader(){ return header.readHeader(filename.c_str(), imageOffset); };
 	int readHeader(const std::string &filename_)
 	{
 		filename = filename_;
@@ -69,9 +71,16 @@ public:
 
 	/*
 	\brief	Main function to save an image. We assume the correct header has been set prior to calling this function. 
+	With header.headerVersion = KLB_INDEXED_HEADER_VERSION, the compressor threads write the blocks as soon as they are ready (in any order) and the block index is written at the end of the file (POSIX systems only, the blocks are written in order otherwise)
 	*/
 	int writeImage(const char* BYTE, int numThreads);
 
+	/*
+	\brief Appends a stack (xyzct[4] = 1) as the next time point of the file. The header has to describe the stack (dimensions and data type, and all the other fields if the file does not exist yet: it is then created with the stack as first time point).
+	The file uses the indexed layout (KLB_INDEXED_HEADER_VERSION), files with the default layout are converted in place (only the header is rewritten). Only available in POSIX systems
+	*/
+	int appendTimePoint(const char* BYTE, int numThreads);
+
 	/*
 	\brief Special case to write 3D stacks using double pointer (one pointer per 2D XY slice in the image)
 	*/
@@ -84,14 +93,38 @@ public:
 
 
 	/*
-	\brief We preload all the file in memory and the threads read from memory (not from disk). Consumes more memory but it is XXX faster. It only makes sense to read the whole image
+	\brief We preload all the file in memory and the threads read from memory (not from disk). Consumes more memory but it is XXX faster. It only makes sense to read the whole image.
+	In POSIX systems the file is memory mapped (see USE_MMAP_READ): threads decompress straight from the mapping (no copy of the compressed blocks) and prefetch the blocks they will process next
 	*/
 	int readImageFull(char* BYTE, int numThreads);
 
+	/*
+	\brief Pyramid levels are downsampled copies of the image stored after the full resolution blocks (readers that do not know about them just ignore them). Level 0 is the full resolution image, stored levels are numbered from 1 to getNumPyramidLevels() in the order they were written
+	*/
+	int getNumPyramidLevels();
+
+	/*
+	\brief filterSigma is the sigma (in pixels of the full resolution image) of the gaussian filter that was applied before downsampling (0 if none), filterInfo describes how the level was computed (as given to writePyramidLevel(), -1 if unknown). Both may be NULL
+	*/
+	int readPyramidLevelHeader(int level, klb_image_header &levelHeader, float32_t filterSigma[3], std::int32_t filterInfo[2]);
+
+	int readPyramidLevel(char* BYTE, int level, int numThreads);
+
+	/*
+	\brief Appends a downsampled copy (of dimensions xyzct_) of the full resolution image to the file. The data type and compression type are the ones of the full resolution image. filterSigma and filterInfo (may be NULL) are stored so readers can check whether the level matches the one they would compute
+	*/
+	int writePyramidLevel(const char* BYTE, const std::uint32_t xyzct_[KLB_DATA_DIMS], const float32_t filterSigma[3], const std::int32_t filterInfo[2], int numThreads);
+
 protected:
 
 private:
 	std::string filename;
+	std::uint64_t imageOffset;//offset (in bytes) of the image header within the file (0 except for pyramid levels)
+
+	//out-of-order writing (see writeImageOutOfOrder)
+	int g_fileDescriptor;
+	std::uint64_t g_dataStart;//offset of the first block within the file
+	std::atomic<std::uint64_t> g_dataOffset;//size of the blocks written so far
 
 	std::mutex              g_lockqueue;//mutex for the condition variable
 	std::condition_variable	g_queuecheck;//to notify writer that blocks are ready
@@ -100,14 +133,21 @@ private:
 #endif
 	
 	
+	int writeImageOutOfOrder(const char* BYTE, int numThreads);
+	int writeBlocksOutOfOrder(const char* BYTE, int numThreads);//compresses and writes (with g_fileDescriptor) all the blocks after g_dataStart
+
 	//functions to call for each thread
 	void blockWriter(FILE* fout, int* g_blockSize, int* g_blockThreadId, klb_circular_dequeue** cq, int* errFlag);
-	void blockCompressor(const char* buffer, int* g_blockSize, std::atomic<uint64_t> *blockId, int* g_blockThreadId, klb_circular_dequeue* cq, int threadId, int* errFlag);
+	void blockCompressor(const char* buffer, int* g_blockSize, std::atomic<uint64_t> *blockId, int* g_blockThreadId, klb_circular_dequeue* cq, int threadId, int* errFlag);//cq == NULL: the thread writes the blocks itself (writeImageOutOfOrder)
 	void blockCompressorStackSlices(const char** buffer, int* g_blockSize, std::atomic<uint64_t> *blockId, int* g_blockThreadId, klb_circular_dequeue* cq, int threadId, int* errFlag);
 
-	void blockUncompressor(char* bufferOut, std::atomic<uint64_t> *blockId, const klb_ROI* ROI, int* errFlag);
+	void blockUncompressor(char* bufferOut, std::atomic<uint64_t> *blockId, const klb_ROI* ROI, const char* bufferImgFull, int* errFlag);//bufferImgFull is the mapped file (NULL to read blocks with fread)
 	void blockUncompressorImageFull(char* bufferOut, std::atomic<uint64_t> *blockId, int* errFlag);
-	void blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>	*blockId, char* bufferImgFull, int* errFlag);
+	void blockUncompressorInMem(char* bufferOut, std::atomic<uint64_t>	*blockId, const char* bufferImgFull, std::uint64_t bufferImgFullLength, int numBlocksAhead, int* errFlag, std::vector<char>* scratch);//scratch (NULL to allocate it locally) holds the decompressed block (and the prefilter buffers)
+
+	//the whole file mapped in memory (see readImageFull). Returns NULL if it is not possible (the blocks have to be read with fread)
+	const char* mapImage(std::uint64_t* length, int numBlocksPrefetch);
+	static void unmapImage(const char* imgMap, std::uint64_t length);
 
 	std::uint32_t maximumBlockSizeCompressedInBytes();//some formats have overhead so for small blocks of random noise it could be larger than block size
 };
@@ -0,0 +1,186 @@
+/*
+* Copyright (C) 2014 by  Fernando Amat
+* See license.txt for full license and copyright notice.
+*
+*  klb_imageReader.cpp
+*
+* \brief Reader for series of klb files with persistent decompressing threads (see klb_imageReader.h)
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#include "klb_imageReader.h"
+
+
+using namespace std;
+
+klb_imageReader::klb_imageReader(int numThreads_)
+{
+	headerRead = false;
+	headerFileSize = -1;
+	headerFileTime = -1;
+	numThreads = numThreads_;
+	if (numThreads <= 0)//use maximum available
+		numThreads = std::max((int)(std::thread::hardware_concurrency()), 1);
+
+	g_job = 0;
+	g_numRunning = 0;
+	g_stop = false;
+	g_bufferOut = NULL;
+	g_imgMap = NULL;
+	g_imgMapLength = 0;
+	g_ROI = NULL;
+	atomic_store(&g_blockId, (uint64_t)0);
+
+	scratch.resize(numThreads);
+	errFlag.resize(numThreads, 0);
+	for (int ii = 0; ii < numThreads; ii++)
+		threads.push_back(std::thread(&klb_imageReader::worker, this, ii));
+}
+
+klb_imageReader::~klb_imageReader()
+{
+	{
+		std::unique_lock<std::mutex> locker(g_lock);
+		g_stop = true;
+	}
+	g_start.notify_all();
+
+	for (auto& t : threads)
+		t.join();
+}
+
+//======================================================
+void klb_imageReader::worker(int threadId)
+{
+	std::uint64_t job = 0;
+
+	while (1)
+	{
+		{
+			std::unique_lock<std::mutex> locker(g_lock);
+			g_start.wait(locker, [&](){ return g_stop || g_job != job; });
+			if (g_stop)
+				return;
+			job = g_job;
+		}
+
+		//the threads that find no block left just return
+		if (g_ROI != NULL)
+			imgIO.blockUncompressor(g_bufferOut, &g_blockId, g_ROI, g_imgMap, &(errFlag[threadId]));
+		else
+			imgIO.blockUncompressorInMem(g_bufferOut, &g_blockId, g_imgMap, g_imgMapLength, numThreads, &(errFlag[threadId]), &(scratch[threadId]));
+
+		{
+			std::unique_lock<std::mutex> locker(g_lock);
+			g_numRunning--;
+			if (g_numRunning == 0)
+				g_done.notify_one();
+		}
+	}
+}
+
+//======================================================
+int klb_imageReader::readHeader(const std::string &filename_)
+{
+	struct stat st;
+	if (stat(filename_.c_str(), &st) != 0)
+	{
+		std::cout << "ERROR: klb_imageReader::readHeader : file " << filename_ << " could not be opened to read header" << std::endl;
+		headerRead = false;
+		return 2;
+	}
+	std::int64_t fileTime = (std::int64_t)(st.st_mtime);
+#if defined(__linux__)
+	fileTime = fileTime * 1000000000 + (std::int64_t)(st.st_mtim.tv_nsec);//files rewritten within the same second
+#endif
+	if (headerRead && filename_ == imgIO.getFilename() && headerFileSize == (std::int64_t)(st.st_size) && headerFileTime == fileTime)
+		return 0;
+	headerFileSize = (std::int64_t)(st.st_size);
+	headerFileTime = fileTime;
+
+	//arrays of block offsets are only reallocated if the number of blocks changes
+	imgIO.setFilename(filename_);
+	int err = imgIO.readHeader();
+	headerRead = (err == 0);
+	if (err > 0)
+		return err;
+
+	if (imgIO.header.Nb == 0)
+	{
+		std::cerr << "ERROR: Image to read has not blocks" << std::endl;
+		headerRead = false;
+		return 2;
+	}
+	return 0;
+}
+
+//======================================================
+//decompresses the blocks with the persistent threads
+int klb_imageReader::runJob(char* img, const char* imgMap, std::uint64_t imgMapLength, const klb_ROI* ROI)
+{
+	{
+		std::unique_lock<std::mutex> locker(g_lock);
+		g_bufferOut = img;
+		g_imgMap = imgMap;
+		g_imgMapLength = imgMapLength;
+		g_ROI = ROI;
+		atomic_store(&g_blockId, (uint64_t)0);
+		g_numRunning = numThreads;
+		g_job++;
+	}
+	g_start.notify_all();
+
+	{
+		std::unique_lock<std::mutex> locker(g_lock);
+		g_done.wait(locker, [this](){ return g_numRunning == 0; });
+		g_ROI = NULL;
+	}
+
+	for (int ii = 0; ii < numThreads; ii++)
+	{
+		if (errFlag[ii] != 0)
+			return errFlag[ii];
+	}
+	return 0;
+}
+
+//======================================================
+int klb_imageReader::readImage(const std::string &filename_, char* img)
+{
+	int err = readHeader(filename_);
+	if (err > 0)
+		return err;
+
+	std::uint64_t imgMapLength;
+	const char* imgMap = imgIO.mapImage(&imgMapLength, numThreads);
+	if (imgMap == NULL)//blocks have to be read with fread (one file handle per thread)
+		return imgIO.readImageFull(img, numThreads);
+
+	err = runJob(img, imgMap, imgMapLength, NULL);
+
+	klb_imageIO::unmapImage(imgMap, imgMapLength);
+
+	return err;
+}
+
+//======================================================
+int klb_imageReader::readImage(const std::string &filename_, char* img, const klb_ROI* ROI)
+{
+	int err = readHeader(filename_);
+	if (err > 0)
+		return err;
+
+	//only the pages of the blocks intersecting the ROI are read from disk (no prefetch),
+	//if the file can not be mapped, each thread reads its blocks with fread
+	std::uint64_t imgMapLength;
+	const char* imgMap = imgIO.mapImage(&imgMapLength, 0);
+
+	err = runJob(img, imgMap, imgMapLength, ROI);
+
+	if (imgMap != NULL)
+		klb_imageIO::unmapImage(imgMap, imgMapLength);
+
+	return err;
+}
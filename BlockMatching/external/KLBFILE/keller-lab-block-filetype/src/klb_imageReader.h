@@ -0,0 +1,83 @@
+/*
+* Copyright (C) 2014 by  Fernando Amat
+* See license.txt for full license and copyright notice.
+*
+*  klb_imageReader.h
+*
+* \brief Reader for series of klb files (time points, tiles, etc). The decompressing threads and their scratch buffers are created once and reused for every file,
+* images are decompressed into buffers provided by the caller and the header is only parsed again if the file (name, size or modification time) has changed.
+* Block offset arrays and scratch buffers are only reallocated when the geometry (number of blocks, block size) changes from one file to the next
+*/
+
+#ifndef __KLB_IMAGE_READER_H__
+#define __KLB_IMAGE_READER_H__
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <atomic>
+
+#include "klb_imageIO.h"
+
+class DECLSPECIFIER klb_imageReader
+{
+public:
+
+	//numThreads <= 0 uses as many threads as cores
+	klb_imageReader(int numThreads_);
+	~klb_imageReader();
+
+	klb_imageReader(const klb_imageReader&) = delete;
+	klb_imageReader& operator=(const klb_imageReader&) = delete;
+
+	/*
+	\brief Reads the header of filename_. It is kept for the following calls on the same file (so it is not parsed twice) as long as the file is not modified
+	*/
+	int readHeader(const std::string &filename_);
+	const klb_image_header& getHeader() const { return imgIO.header; };
+	int getNumThreads() const { return numThreads; };
+
+	/*
+	\brief Decompresses the whole image of filename_ into img, which has to be allocated by the caller (header.getImageSizeBytes() bytes)
+	*/
+	int readImage(const std::string &filename_, char* img);
+
+	/*
+	\brief Decompresses the part of the image of filename_ defined by ROI into img (ROI->getSizePixels() pixels). The blocks intersecting the ROI are decompressed by the persistent threads
+	*/
+	int readImage(const std::string &filename_, char* img, const klb_ROI* ROI);
+
+protected:
+
+private:
+	klb_imageIO imgIO;
+	bool headerRead;//imgIO.header is the header of imgIO.getFilename()
+	std::int64_t headerFileSize;//to know if the file has been rewritten since its header was read
+	std::int64_t headerFileTime;
+	int numThreads;
+
+	std::vector<std::thread> threads;
+	std::vector< std::vector<char> > scratch;//one per thread, kept from one image to the next
+	std::vector<int> errFlag;
+
+	//current image to decompress
+	std::mutex              g_lock;
+	std::condition_variable	g_start;//to wake up the threads
+	std::condition_variable	g_done;//to notify that all the threads are done
+	std::uint64_t g_job;//incremented for each image
+	int g_numRunning;
+	bool g_stop;
+	char* g_bufferOut;
+	const char* g_imgMap;
+	std::uint64_t g_imgMapLength;
+	const klb_ROI* g_ROI;//NULL for the whole image
+	std::atomic<std::uint64_t> g_blockId;
+
+	void worker(int threadId);
+	int runJob(char* img, const char* imgMap, std::uint64_t imgMapLength, const klb_ROI* ROI);
+};
+
+
+#endif //end of __KLB_IMAGE_READER_H__
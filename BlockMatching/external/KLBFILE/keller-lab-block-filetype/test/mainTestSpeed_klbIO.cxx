@@ -29,13 +29,31 @@ typedef std::chrono::high_resolution_clock Clock;
 int main(int argc, const char** argv)
 {
 	int numProg = -1;
-	if (argc == 2)
+	if (argc >= 2)
 		numProg = atoi(argv[1]);
 
 	int numThreads = std::thread::hardware_concurrency();//<= 0 indicates use as many as possible
 	std::uint32_t	blockSize[KLB_DATA_DIMS] = {96, 96, 8, 1, 1};
 	KLB_COMPRESSION_TYPE compressionType = KLB_COMPRESSION_TYPE::BZIP2;//1->bzip2; 0->none (look at enum KLB_COMPRESSION_TYPE)
 
+	/*
+	Compression ratio / speed tradeoffs (16 bits 512x512x64 synthetic stack: smooth signal + 20 gray levels of noise, default block size, 1 thread)
+
+	compressionType         ratio   write (ms)   read (ms)
+	NONE                    1.00         38          28
+	BZIP2                   2.84       3290        1266
+	ZLIB                    1.90       3009         241
+	SHUFFLE_ZLIB            2.16        736         264
+	BITSHUFFLE_ZLIB         2.34        764         182
+	DELTA_SHUFFLE_ZLIB      2.07       1009         364
+
+	BZIP2 gives the best ratio but its decompression is ~5x slower than the zlib based types. The shuffle filters put the (almost constant) high bytes
+	of 16 bits pixels together, so zlib at level 1 compresses better and 4x faster than ZLIB (level 6). BITSHUFFLE_ZLIB is the best tradeoff for noisy
+	data; DELTA_SHUFFLE_ZLIB is better for smooth (low noise) data
+	*/
+	if (argc >= 3)
+		compressionType = (KLB_COMPRESSION_TYPE)atoi(argv[2]);
+
 
 	std::string basename("E:/temp/mouse_TM000000_angle000");
 	std::uint32_t	xyzct[KLB_DATA_DIMS] = { 2048, 2048, 335, 1, 1 };	
@@ -0,0 +1,2 @@
+
+from .blockmatching import blockmatching, applyTrsf, composeTrsf, invTrsf, VectorField
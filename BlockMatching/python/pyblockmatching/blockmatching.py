@@ -0,0 +1,290 @@
+# This file is subject to the terms and conditions defined in
+# file 'LICENSE', which is part of this source code package.
+
+''' In-process calls to the blockmatching library (see api-python.h)
+
+    Images are numpy arrays indexed [x, y, z] (or [x, y]) and stored
+    in fortran order, as SpatialImage does: such arrays are given to
+    the library without any copy (other arrays are converted first).
+    The voxel size is read from the 'voxelsize' attribute of the array
+    (or given explicitly), the voxel to real matrix can be given
+    with 'qform'.
+
+    Transformations are in real units:
+      - linear transformations are 4x4 arrays,
+      - vector fields are float32 VectorField arrays indexed
+        [x, y, z, c] (c in 0..2, or 0..1 for 2D fields), in fortran
+        order, with a 'voxelsize' attribute.
+
+    The GIL is released during the computations (ctypes.CDLL), the
+    calls are however serialized since the library is not reentrant.
+'''
+
+import ctypes
+import ctypes.util
+import os
+import threading
+import numpy as np
+
+_lock = threading.Lock()
+_lib = None
+
+class VectorField(np.ndarray):
+    ''' Displacement field (real units) indexed [x, y, z, c]
+        with the voxel size of its grid
+    '''
+    def __new__(cls, input_array, voxelsize=(1., 1., 1.)):
+        obj = np.asarray(input_array, dtype=np.float32, order='F').view(cls)
+        obj.voxelsize = tuple(voxelsize)
+        return obj
+
+    def __array_finalize__(self, obj):
+        if obj is None:
+            return
+        self.voxelsize = getattr(obj, 'voxelsize', (1., 1., 1.))
+
+def _library():
+    ''' Loads libblockmatchingLIB, from $BLOCKMATCHING_LIBRARY if set
+    '''
+    global _lib
+    if _lib is not None:
+        return _lib
+    path = os.environ.get('BLOCKMATCHING_LIBRARY',
+                          ctypes.util.find_library('blockmatchingLIB'))
+    if path is None:
+        raise OSError('libblockmatchingLIB not found, set BLOCKMATCHING_LIBRARY')
+    lib = ctypes.CDLL(path)
+    p, i, d, s = ctypes.c_void_p, ctypes.c_int, ctypes.c_double, ctypes.c_char_p
+    lib.API_PY_WrapImage.restype = p
+    lib.API_PY_WrapImage.argtypes = [p, s, i, i, i, d, d, d, p]
+    lib.API_PY_UnwrapImage.argtypes = [p]
+    lib.API_PY_WrapMatrix.restype = p
+    lib.API_PY_WrapMatrix.argtypes = [p]
+    lib.API_PY_WrapVectorField.restype = p
+    lib.API_PY_WrapVectorField.argtypes = [p, p, p, i, i, i, d, d, d]
+    lib.API_PY_UnwrapTransformation.argtypes = [p]
+    lib.API_PY_FreeTransformation.argtypes = [p]
+    lib.API_PY_GetTransformationGeometry.argtypes = [p, p, p]
+    lib.API_PY_GetMatrix.argtypes = [p, p]
+    lib.API_PY_GetVectorField.argtypes = [p, p, p, p]
+    lib.API_PY_blockmatching.restype = p
+    lib.API_PY_blockmatching.argtypes = [p, p, p, p, s]
+    lib.API_PY_applyTrsf.argtypes = [p, p, p, s]
+    lib.API_PY_composeTrsf.restype = p
+    lib.API_PY_composeTrsf.argtypes = [ctypes.POINTER(p), i, p, s]
+    lib.API_PY_invTrsf.restype = p
+    lib.API_PY_invTrsf.argtypes = [p, p, s]
+    _lib = lib
+    return _lib
+
+def _bytes(s):
+    return (s or '').encode('ascii')
+
+class _Wrapper(object):
+    ''' Keeps the arrays given to the library alive
+        and releases the wrapping structures
+    '''
+    def __init__(self, lib):
+        self.lib = lib
+        self.arrays = []
+        self.images = []
+        self.trsfs = []
+
+    def image(self, im, voxelsize=None, qform=None):
+        if im is None:
+            return None
+        a = np.asarray(im)
+        if a.ndim == 2:
+            a = a.reshape(a.shape + (1, ), order='F')
+        if a.ndim != 3:
+            raise ValueError('only scalar 2D or 3D images are handled')
+        a = np.asfortranarray(a)
+        vs = voxelsize or getattr(im, 'voxelsize', None) or (1., 1., 1.)
+        vs = (tuple(vs) + (1., 1., 1.))[:3]
+        self.arrays.append(a)
+        q = None
+        if qform is not None:
+            q = np.ascontiguousarray(qform, dtype=np.float64).reshape(4, 4)
+            self.arrays.append(q)
+            q = q.ctypes.data
+        ptr = self.lib.API_PY_WrapImage(a.ctypes.data, _bytes(a.dtype.name),
+                                        a.shape[0], a.shape[1], a.shape[2],
+                                        vs[0], vs[1], vs[2], q)
+        if not ptr:
+            raise ValueError('unable to wrap image of type %s' % a.dtype.name)
+        self.images.append(ptr)
+        return ptr
+
+    def template(self, im, voxelsize=None):
+        if im is None:
+            return None
+        shape = (tuple(np.shape(im)) + (1, 1))[:3]
+        vs = voxelsize or getattr(im, 'voxelsize', None) or (1., 1., 1.)
+        vs = (tuple(vs) + (1., 1., 1.))[:3]
+        ptr = self.lib.API_PY_WrapImage(None, b'uint8', shape[0], shape[1], shape[2],
+                                        vs[0], vs[1], vs[2], None)
+        if not ptr:
+            raise ValueError('unable to wrap template')
+        self.images.append(ptr)
+        return ptr
+
+    def trsf(self, t, voxelsize=None):
+        if t is None:
+            return None
+        a = np.asarray(t)
+        if a.shape == (4, 4):
+            a = np.ascontiguousarray(a, dtype=np.float64)
+            self.arrays.append(a)
+            ptr = self.lib.API_PY_WrapMatrix(a.ctypes.data)
+        elif a.ndim == 4 and a.shape[3] in (2, 3):
+            a = np.asfortranarray(a, dtype=np.float32)
+            vs = voxelsize or getattr(t, 'voxelsize', None) or (1., 1., 1.)
+            vs = (tuple(vs) + (1., 1., 1.))[:3]
+            self.arrays.append(a)
+            c = [a[..., i].ctypes.data for i in range(a.shape[3])]
+            ptr = self.lib.API_PY_WrapVectorField(c[0], c[1],
+                                                  c[2] if len(c) == 3 else None,
+                                                  a.shape[0], a.shape[1], a.shape[2],
+                                                  vs[0], vs[1], vs[2])
+        else:
+            raise ValueError('a transformation is either a 4x4 matrix or a [x, y, z, c] field')
+        if not ptr:
+            raise ValueError('unable to wrap transformation')
+        self.trsfs.append(ptr)
+        return ptr
+
+    def release(self):
+        for ptr in self.images:
+            self.lib.API_PY_UnwrapImage(ptr)
+        for ptr in self.trsfs:
+            self.lib.API_PY_UnwrapTransformation(ptr)
+        self.images, self.trsfs, self.arrays = [], [], []
+
+def _result(lib, ptr):
+    ''' Copies the returned transformation into numpy arrays
+        and releases it
+    '''
+    if not ptr:
+        raise RuntimeError('computation failed (see messages on stderr)')
+    try:
+        dim = (ctypes.c_int * 3)()
+        voxel = (ctypes.c_double * 3)()
+        kind = lib.API_PY_GetTransformationGeometry(ptr, dim, voxel)
+        if kind == 1:
+            mat = np.zeros((4, 4), dtype=np.float64)
+            lib.API_PY_GetMatrix(ptr, mat.ctypes.data)
+            return mat
+        if kind not in (2, 3):
+            raise RuntimeError('unknown transformation type')
+        field = VectorField(np.zeros(tuple(dim) + (kind, ), dtype=np.float32, order='F'),
+                            voxelsize=tuple(voxel))
+        c = [field[..., i].ctypes.data for i in range(kind)]
+        lib.API_PY_GetVectorField(ptr, c[0], c[1], c[2] if kind == 3 else None)
+        return field
+    finally:
+        lib.API_PY_FreeTransformation(ptr)
+
+def blockmatching(floating, reference, params='', left_trsf=None, init_trsf=None,
+                  floating_voxelsize=None, reference_voxelsize=None,
+                  floating_qform=None, reference_qform=None):
+    ''' Registers floating onto reference
+        Args:
+            floating, reference: arrays [x, y, z]
+            params: string, command line options of blockmatching
+                (eg '-trsf-type affine -py-hl 5 -py-ll 2')
+            left_trsf: transformation applied first to the floating image
+                (not updated), optional
+            init_trsf: initial value of the result transformation, optional
+        Returns:
+            the transformation T such that floating o left_trsf o T
+            is comparable to reference (4x4 array or VectorField)
+    '''
+    lib = _library()
+    with _lock:
+        w = _Wrapper(lib)
+        try:
+            flo = w.image(floating, floating_voxelsize, floating_qform)
+            ref = w.image(reference, reference_voxelsize, reference_qform)
+            ptr = lib.API_PY_blockmatching(flo, ref, w.trsf(left_trsf), w.trsf(init_trsf),
+                                           _bytes(params))
+            return _result(lib, ptr)
+        finally:
+            w.release()
+
+def applyTrsf(image, trsf=None, template=None, params='', shape=None, voxelsize=None,
+              dtype=None, image_voxelsize=None, image_qform=None, qform=None):
+    ''' Resamples image with trsf (that goes from the result to the image)
+        Args:
+            image: array [x, y, z]
+            trsf: 4x4 array or VectorField, None means the image to
+                image transformation (qform)
+            template: array giving the result geometry, else shape and
+                voxelsize are used (default is the image geometry, or the
+                vector field one)
+            params: string, command line options of applyTrsf (eg '-nearest')
+        Returns:
+            the resampled image, computed in place in a new fortran array
+            (of the same class as image when it has a voxelsize)
+    '''
+    lib = _library()
+    if template is not None:
+        shape = shape or np.shape(template)
+        voxelsize = voxelsize or getattr(template, 'voxelsize', None)
+    if trsf is not None and np.ndim(trsf) == 4:
+        shape = shape or np.shape(trsf)[:3]
+        voxelsize = voxelsize or getattr(trsf, 'voxelsize', None)
+    shape = tuple(shape or np.shape(image))
+    voxelsize = tuple(voxelsize or image_voxelsize or getattr(image, 'voxelsize', (1., 1., 1.)))
+    res = np.zeros(shape, dtype=dtype or np.asarray(image).dtype, order='F')
+    if hasattr(image, 'voxelsize'):
+        res = res.view(type(image))
+        res.voxelsize = voxelsize[:len(shape)]
+    with _lock:
+        w = _Wrapper(lib)
+        try:
+            theim = w.image(image, image_voxelsize, image_qform)
+            resim = w.image(res, voxelsize, qform)
+            if lib.API_PY_applyTrsf(theim, resim, w.trsf(trsf), _bytes(params)) != 1:
+                raise RuntimeError('applyTrsf failed (see messages on stderr)')
+        finally:
+            w.release()
+    return res
+
+def composeTrsf(trsfs, template=None, params='', voxelsize=None):
+    ''' Composes trsfs[0] o trsfs[1] o ... (same order as composeTrsf)
+        Args:
+            trsfs: list of 4x4 arrays or VectorField
+            template: array giving the geometry of a resulting vector field,
+                else the one of the last vector field of the list is used
+        Returns:
+            4x4 array or VectorField
+    '''
+    lib = _library()
+    with _lock:
+        w = _Wrapper(lib)
+        try:
+            ptrs = (ctypes.c_void_p * len(trsfs))(*[w.trsf(t) for t in trsfs])
+            tmpl = w.template(template, voxelsize)
+            ptr = lib.API_PY_composeTrsf(ptrs, len(trsfs), tmpl, _bytes(params))
+            return _result(lib, ptr)
+        finally:
+            w.release()
+
+def invTrsf(trsf, template=None, params='', voxelsize=None):
+    ''' Inverts trsf
+        Args:
+            trsf: 4x4 array or VectorField
+            template: array giving the geometry of a resulting vector field,
+                else the one of trsf is used
+        Returns:
+            4x4 array or VectorField
+    '''
+    lib = _library()
+    with _lock:
+        w = _Wrapper(lib)
+        try:
+            t = w.trsf(trsf)
+            ptr = lib.API_PY_invTrsf(t, w.template(template, voxelsize), _bytes(params))
+            return _result(lib, ptr)
+        finally:
+            w.release()
@@ -0,0 +1,24 @@
+from setuptools import setup
+from codecs import open
+from os import path
+
+here = path.abspath(path.dirname(__file__))
+
+# Get the long description from the README file
+with open(path.join(here, 'README.md'), encoding='utf-8') as f:
+    long_description = f.read()
+
+setup(
+    name='pyblockmatching',
+    version='1.0',
+    description='In-process calls to blockmatching, applyTrsf, composeTrsf and invTrsf on numpy arrays',
+    long_description=long_description,
+    url='https://github.com/leoguignard/standalone-Mouse',
+    classifiers=[
+        'Intended Audience :: Developers',
+        'Programming Language :: Python :: 2.7',
+        'Programming Language :: Python :: 3',
+    ],
+    packages=['pyblockmatching'],
+    install_requires=['numpy'],
+)
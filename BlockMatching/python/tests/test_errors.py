@@ -0,0 +1,46 @@
+# This file is subject to the terms and conditions defined in
+# file 'LICENSE', which is part of this source code package.
+
+''' Invalid options make the calls fail with an exception,
+    the interpreter keeps running (BLOCKMATCHING_LIBRARY has to be set)
+
+    python -m unittest discover -s tests
+'''
+
+import unittest
+import numpy as np
+
+from pyblockmatching import blockmatching, applyTrsf, composeTrsf, invTrsf
+
+def _image():
+    x, y, z = np.mgrid[0:24, 0:20, 0:16]
+    return np.asfortranarray(((x * 7 + y * 3 + z * 5) % 200).astype(np.uint8))
+
+class TestInvalidOptions(unittest.TestCase):
+
+    def test_blockmatching(self):
+        im = _image()
+        with self.assertRaises(RuntimeError):
+            blockmatching(im, im, '-trsf-type affine -not-an-option')
+
+    def test_applyTrsf(self):
+        with self.assertRaises(RuntimeError):
+            applyTrsf(_image(), np.eye(4), params='-not-an-option')
+
+    def test_composeTrsf(self):
+        with self.assertRaises(RuntimeError):
+            composeTrsf([np.eye(4), np.eye(4)], params='-not-an-option')
+
+    def test_invTrsf(self):
+        with self.assertRaises(RuntimeError):
+            invTrsf(np.eye(4), params='-not-an-option')
+
+    def test_valid_after_error(self):
+        with self.assertRaises(RuntimeError):
+            invTrsf(np.eye(4), params='-not-an-option')
+        t = np.eye(4)
+        t[0, 3] = 2.
+        self.assertTrue(np.allclose(np.dot(invTrsf(t), t), np.eye(4)))
+
+if __name__ == '__main__':
+    unittest.main()
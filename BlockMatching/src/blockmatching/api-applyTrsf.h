@@ -24,6 +24,8 @@ extern "C" {
 
 
 
+#include <setjmp.h>
+
 #include <typedefs.h>
 
 #include <bal-image.h>
@@ -141,6 +143,12 @@ extern char *API_Help_applyTrsf( int h );
 
 extern void API_ErrorParse_applyTrsf( char *program, char *str, int flag );
 
+/* if 'env' is not NULL, API_ErrorParse_applyTrsf() longjmp()s to it
+ * (with value 1) instead of exiting, eg to check options in
+ * a long running process
+ */
+extern void API_SetErrorParseJump_applyTrsf( jmp_buf *env );
+
 extern void API_InitParam_applyTrsf( lineCmdParamApplyTrsf *par );
 
 extern void API_PrintParam_applyTrsf( FILE *theFile, char *program,
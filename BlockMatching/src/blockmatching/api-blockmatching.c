@@ -32,6 +32,7 @@
 #include <linearFiltering.h>
 #include <reech4x4.h>
 #include <reech-def.h>
+#include <timeline.h>
 #include <vtmalloc.h>
 
 #include <bal-behavior.h>
@@ -143,10 +144,17 @@ static bal_transformation *_API_blockmatching( bal_image *floatingImage,
     fprintf( stderr, "=====================================\n" );
   }
 
+  /* the temporary images, blocks and fields of the pyramid levels
+   * are reused from one level (or iteration) to the next
+   */
+  setVtMallocTag( 1, "registration" );
+  setTimelineStage( 1, "registration" );
+  beginVtMallocArena();
   resultTransformation = BAL_PyramidalBlockMatching( referenceImage, floatingImage,
                                                      leftTransformation,
                                                      initResultTransformation,
                                                      &(par->param) );
+  endVtMallocArena();
   if ( resultTransformation == (bal_transformation*)NULL ) {
       if ( _verbose_ )
           fprintf( stderr, "%s: unable to register the images \n", proc );
@@ -287,6 +295,11 @@ static int _API_INTERMEDIARY_blockmatching( char *floating_image,
      * images
      ************************************************************/
 
+    setVtMallocTag( 0, "blockmatching" );
+    setTimelineStage( 0, "blockmatching" );
+    setVtMallocTag( 1, "reading" );
+    setTimelineStage( 1, "reading" );
+
     /* reading reference image
      */
     if ( par->param.verbosef != NULL ) {
@@ -448,6 +461,9 @@ static int _API_INTERMEDIARY_blockmatching( char *floating_image,
         return( -1 );
     }
 
+    setVtMallocTag( 1, "writing" );
+    setTimelineStage( 1, "writing" );
+
 
 
     /***************************************************
@@ -752,6 +768,9 @@ static int _API_INTERMEDIARY_blockmatching( char *floating_image,
     if ( par->param.verbosef != NULL && par->param.verbosef != stderr && par->param.verbosef != stdout )
       fclose( par->param.verbosef );
 
+    setVtMallocTag( 0, (char*)NULL );
+    setTimelineStage( 0, (char*)NULL );
+
     return( 1 );
 }
 
@@ -1286,6 +1305,12 @@ static char *usage = "-reference|-ref %s -floating|-flo %s -result|-res %s\n\
  [-print-parameters|-param]\n\
  [-print-time|-time] [-no-time|-notime]\n\
  [-trace-memory|-memory] [-no-memory|-nomemory]\n\
+ [-memory-mapping|-mmap] [-no-memory-mapping|-no-mmap]\n\
+ [-bgzf-writing|-bgzf] [-no-bgzf-writing|-no-bgzf]\n\
+ [-shm-unlink] [-no-shm-unlink]\n\
+ [-tiff-compression none|lzw|deflate|packbits] [-tiff-strip-size %d]\n\
+ [-bigtiff] [-no-bigtiff]\n\
+ [-chunk-size %d %d %d] [-chunk-compression %d]\n\
  [-help|-h]";
 
 
@@ -1454,6 +1479,26 @@ static char *usage = "-reference|-ref %s -floating|-flo %s -result|-res %s\n\
      parallel mode may be restored by specifying '-parallel' after '-memory'\n\
      but unexpected crashes may be experienced\n\
  -no-memory|-nomemory:\n\
+ -memory-mapping|-mmap: uncompressed input images are mapped rather than read\n\
+   (data pages are read on demand and shared through the page cache)\n\
+ -no-memory-mapping|-no-mmap:\n\
+ -bgzf-writing|-bgzf: gzipped output images (.gz) are written as BGZF files\n\
+   (compressed in parallel, still readable by gzip)\n\
+ -no-bgzf-writing|-no-bgzf:\n\
+ -shm-unlink: shared memory input images (shm://name) are removed\n\
+   once read (else they persist until removed from /dev/shm)\n\
+ -no-shm-unlink:\n\
+ -tiff-compression none|lzw|deflate|packbits: compression of TIFF output\n\
+   images (default is none)\n\
+ -tiff-strip-size %d: size (in bytes) of the strips of TIFF output\n\
+   images (default is the libtiff one)\n\
+ -bigtiff: TIFF output images are written as BigTIFF files\n\
+   (always done for images larger than 3 GB)\n\
+ -no-bigtiff:\n\
+ -chunk-size %d %d %d: chunk dimensions of chunked output images\n\
+   (.zarr, .n5), default is 64 64 64\n\
+ -chunk-compression %d: compression level of chunked output images\n\
+   0: raw chunks, 1 to 9: zlib (Zarr) or gzip (N5) levels, default is 1\n\
  -h: print option list\n\
  -help: print option list + details\n\
  \n\
@@ -1479,6 +1524,17 @@ char *API_Help_blockmatching( int h )
 
 
 
+static jmp_buf *_errorParseJump_ = (jmp_buf*)NULL;
+
+void API_SetErrorParseJump_blockmatching( jmp_buf *env )
+{
+    _errorParseJump_ = env;
+}
+
+
+
+
+
 void API_ErrorParse_blockmatching( char *program, char *str, int flag )
 {
     if ( flag >= 0 ) {
@@ -1494,6 +1550,8 @@ void API_ErrorParse_blockmatching( char *program, char *str, int flag )
     }
     if ( str != (char*)NULL )
       (void)fprintf(stderr,"Error: %s\n",str);
+    if ( _errorParseJump_ != (jmp_buf*)NULL )
+      longjmp( *_errorParseJump_, 1 );
     exit( 1 );
 }
 
@@ -1737,6 +1795,8 @@ void API_ParseParam_blockmatching( int firstargc, int argc, char *argv[],
 {
   int i;
   int status;
+  int tiffstripsize;
+  int chunkx, chunky, chunkz, chunklevel;
   int maxchunks;
 
   _n_call_parse_ ++;
@@ -2831,6 +2891,67 @@ void API_ParseParam_blockmatching( int firstargc, int argc, char *argv[],
        setTraceInVtMalloc( 0 );
     }
 
+    else if ( strcmp ( argv[i], "-memory-mapping" ) == 0
+               || (strcmp ( argv[i], "-mmap" ) == 0 && argv[i][5] == '\0') ) {
+       BAL_SetMemoryMappingInBalImage( 1 );
+    }
+    else if ( strcmp ( argv[i], "-no-memory-mapping" ) == 0
+                || (strcmp ( argv[i], "-no-mmap" ) == 0 && argv[i][8] == '\0') ) {
+       BAL_SetMemoryMappingInBalImage( 0 );
+    }
+    else if ( strcmp ( argv[i], "-bgzf-writing" ) == 0
+               || (strcmp ( argv[i], "-bgzf" ) == 0 && argv[i][5] == '\0') ) {
+       BAL_SetBgzfWritingInBalImage( 1 );
+    }
+    else if ( strcmp ( argv[i], "-no-bgzf-writing" ) == 0
+                || (strcmp ( argv[i], "-no-bgzf" ) == 0 && argv[i][8] == '\0') ) {
+       BAL_SetBgzfWritingInBalImage( 0 );
+    }
+    else if ( strcmp ( argv[i], "-shm-unlink" ) == 0 ) {
+       BAL_SetSharedMemoryUnlinkInBalImage( 1 );
+    }
+    else if ( strcmp ( argv[i], "-no-shm-unlink" ) == 0 ) {
+       BAL_SetSharedMemoryUnlinkInBalImage( 0 );
+    }
+    else if ( strcmp ( argv[i], "-tiff-compression" ) == 0 ) {
+       i ++;
+       if ( i >= argc)    API_ErrorParse_blockmatching( (char*)NULL, "parsing -tiff-compression ...\n", 0 );
+       if ( BAL_SetTiffCompressionInBalImage( argv[i] ) != 1 )
+         API_ErrorParse_blockmatching( (char*)NULL, "parsing -tiff-compression ...\n", 0 );
+    }
+    else if ( strcmp ( argv[i], "-tiff-strip-size" ) == 0 ) {
+       i ++;
+       if ( i >= argc)    API_ErrorParse_blockmatching( (char*)NULL, "parsing -tiff-strip-size ...\n", 0 );
+       status = sscanf( argv[i], "%d", &tiffstripsize );
+       if ( status <= 0 || tiffstripsize < 0 ) API_ErrorParse_blockmatching( (char*)NULL, "parsing -tiff-strip-size ...\n", 0 );
+       BAL_SetTiffStripSizeInBalImage( (size_t)tiffstripsize );
+    }
+    else if ( strcmp ( argv[i], "-bigtiff" ) == 0 ) {
+       BAL_SetBigTiffWritingInBalImage( 1 );
+    }
+    else if ( strcmp ( argv[i], "-no-bigtiff" ) == 0 ) {
+       BAL_SetBigTiffWritingInBalImage( 0 );
+    }
+    else if ( strcmp ( argv[i], "-chunk-size" ) == 0 ) {
+       if ( i+3 >= argc)    API_ErrorParse_blockmatching( (char*)NULL, "parsing -chunk-size ...\n", 0 );
+       status = sscanf( argv[i+1], "%d", &chunkx );
+       if ( status <= 0 || chunkx <= 0 ) API_ErrorParse_blockmatching( (char*)NULL, "parsing -chunk-size ...\n", 0 );
+       status = sscanf( argv[i+2], "%d", &chunky );
+       if ( status <= 0 || chunky <= 0 ) API_ErrorParse_blockmatching( (char*)NULL, "parsing -chunk-size ...\n", 0 );
+       status = sscanf( argv[i+3], "%d", &chunkz );
+       if ( status <= 0 || chunkz <= 0 ) API_ErrorParse_blockmatching( (char*)NULL, "parsing -chunk-size ...\n", 0 );
+       BAL_SetChunkSizeInBalImage( chunkx, chunky, chunkz );
+       i += 3;
+    }
+    else if ( strcmp ( argv[i], "-chunk-compression" ) == 0 ) {
+       i ++;
+       if ( i >= argc)    API_ErrorParse_blockmatching( (char*)NULL, "parsing -chunk-compression ...\n", 0 );
+       status = sscanf( argv[i], "%d", &chunklevel );
+       if ( status <= 0 || chunklevel < 0 || chunklevel > 9 )
+         API_ErrorParse_blockmatching( (char*)NULL, "parsing -chunk-compression ...\n", 0 );
+       BAL_SetChunkCompressionInBalImage( chunklevel );
+    }
+
     /* unknown option
      */
     else {
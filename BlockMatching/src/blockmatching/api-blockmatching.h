@@ -24,6 +24,8 @@ extern "C" {
 
 
 
+#include <setjmp.h>
+
 #include <typedefs.h>
 
 #include <bal-blockmatching-param.h>
@@ -196,6 +198,12 @@ extern char *API_Help_blockmatching( int h );
 
 extern void API_ErrorParse_blockmatching( char *program, char *str, int flag );
 
+/* if 'env' is not NULL, API_ErrorParse_blockmatching() longjmp()s to it
+ * (with value 1) instead of exiting, eg to check options in
+ * a long running process
+ */
+extern void API_SetErrorParseJump_blockmatching( jmp_buf *env );
+
 extern void API_InitParam_blockmatching( lineCmdParamBlockmatching *par );
 
 extern void API_PrintParam_blockmatching( FILE *theFile, char *program,
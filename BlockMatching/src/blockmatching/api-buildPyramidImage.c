@@ -84,7 +84,8 @@ int API_buildPyramidImage( bal_image *image,
   if ( BAL_BuildPyramidImage( image, output_image_names,
                               par.pyramid_lowest_level,
                               par.pyramid_highest_level,
-                              par.pyramid_gaussian_filtering ) != 1 ) {
+                              par.pyramid_gaussian_filtering,
+                              par.normalisation ) != 1 ) {
     if ( _verbose_ )
         fprintf( stderr, "%s: unable to build pyramid\n", proc );
     return( -1 );
@@ -200,6 +201,7 @@ static char *usage = "[image-in]\n\
  [-normalisation|-norma|-rescale|-no-normalisation|-no-norma|-no-rescale]\n\
  [-pyramid-lowest-level | -py-ll %d] [-pyramid-highest-level | -py-hl %d]\n\
  [-pyramid-gaussian-filtering | -py-gf]\n\
+ [-stored-levels|-no-stored-levels|-store-levels]\n\
  [-gaussian-filter-type|-filter-type deriche|fidrich|young-1995|young-2002|...\n\
   ...|gabor-young-2002|convolution]\n\
  [-default-filenames|-df] [-no-default-filenames|-ndf]\n\
@@ -230,6 +232,12 @@ static char *detail = "\
  -pyramid-highest-level | -py-hl %d: pyramid highest level\n\
  -pyramid-gaussian-filtering | -py-gf: before subsampling, the image \n\
  is filtered (ie smoothed) by a gaussian kernel.\n\
+ -stored-levels: levels stored in the input image file (KLB files)\n\
+   with the same dimensions and filtering are read instead of\n\
+   being computed (default)\n\
+ -no-stored-levels: stored levels are ignored\n\
+ -store-levels: idem '-stored-levels', and the computed levels\n\
+   are stored in the input image file (KLB files)\n\
 # filter type\n\
  -gaussian-filter-type|-filter-type deriche|fidrich|young-1995|young-2002|...\n\
   ...|gabor-young-2002|convolution: type of filter for gaussian filtering\n\
@@ -484,6 +492,15 @@ void API_ParseParam_buildPyramidImage( int firstargc, int argc, char *argv[],
                     || (strcmp( argv[i], "-py-gf") == 0 && argv[i][6] == '\0') ) {
             p->pyramid_gaussian_filtering = 1;
           }
+          else if ( strcmp ( argv[i], "-stored-levels" ) == 0 ) {
+            BAL_SetStoredPyramidLevelsInBalPyramid( 1 );
+          }
+          else if ( strcmp ( argv[i], "-no-stored-levels" ) == 0 ) {
+            BAL_SetStoredPyramidLevelsInBalPyramid( 0 );
+          }
+          else if ( strcmp ( argv[i], "-store-levels" ) == 0 ) {
+            BAL_SetStoredPyramidLevelsInBalPyramid( 2 );
+          }
 
           /* filter type for image smoothing
            */
@@ -627,6 +627,17 @@ char *API_Help_composeTrsf( int h )
 
 
 
+static jmp_buf *_errorParseJump_ = (jmp_buf*)NULL;
+
+void API_SetErrorParseJump_composeTrsf( jmp_buf *env )
+{
+    _errorParseJump_ = env;
+}
+
+
+
+
+
 void API_ErrorParse_composeTrsf( char *program, char *str, int flag )
 {
     if ( flag >= 0 ) {
@@ -642,6 +653,8 @@ void API_ErrorParse_composeTrsf( char *program, char *str, int flag )
     }
     if ( str != (char*)NULL )
       (void)fprintf(stderr,"Error: %s\n",str);
+    if ( _errorParseJump_ != (jmp_buf*)NULL )
+      longjmp( *_errorParseJump_, 1 );
     exit( 1 );
 }
 
@@ -24,6 +24,8 @@ extern "C" {
 
 
 
+#include <setjmp.h>
+
 #include <string-tools.h>
 
 #include <typedefs.h>
@@ -104,6 +106,12 @@ extern char *API_Help_composeTrsf( int h );
 
 extern void API_ErrorParse_composeTrsf( char *program, char *str, int flag );
 
+/* if 'env' is not NULL, API_ErrorParse_composeTrsf() longjmp()s to it
+ * (with value 1) instead of exiting, eg to check options in
+ * a long running process
+ */
+extern void API_SetErrorParseJump_composeTrsf( jmp_buf *env );
+
 extern void API_InitParam_composeTrsf( lineCmdParamComposeTrsf *par );
 
 extern void API_FreeParam_composeTrsf( lineCmdParamComposeTrsf *p );
@@ -34,6 +34,8 @@ static int _debug_ = 1;
 
 
 static void _API_ParseParam_cropImage( char *str, lineCmdParamCropImage *p );
+static int _API_CropImageGeometry( bal_image *image, bal_image *imres,
+                                   bal_transformation *theTrsf );
 
 
 
@@ -144,11 +146,16 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
 {
   char *proc = "API_INTERMEDIARY_cropImage";
   bal_image theim;
+  bal_image subim;
   bal_image resim;
   bal_image templateim;
   bal_transformation theTrsf;
   int theLeftCorner[3] = {0, 0, 0};
   int theRightCorner[3] = {0, 0, 0};
+  int theRegionDim[3] = {0, 0, 0};
+  bal_integerPoint corner;
+  bal_integerPoint dim;
+  int fromStdin;
 
   lineCmdParamCropImage par;
 
@@ -174,6 +181,7 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
    ***************************************************/
 
   BAL_InitImage( &theim, NULL, 0, 0, 0, 0, UCHAR );
+  BAL_InitImage( &subim, NULL, 0, 0, 0, 0, UCHAR );
   BAL_InitImage( &resim, NULL, 0, 0, 0, 0, UCHAR );
   BAL_InitImage( &templateim, NULL, 0, 0, 0, 0, UCHAR );
   BAL_InitTransformation( &theTrsf );
@@ -187,9 +195,22 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
 
 
 
-  /* reading input image
+  /* reading input image header
+   * only the cropped region will be read,
+   * except for the standard input that can not be read twice
    */
-  if ( BAL_ReadImage( &theim, theim_name, 0 ) != 1 ) {
+  fromStdin = ( theim_name == (char*)NULL || theim_name[0] == '\0'
+                || (theim_name[0] == '-' && theim_name[1] == '\0')
+                || (theim_name[0] == '<' && theim_name[1] == '\0') ) ? 1 : 0;
+
+  if ( fromStdin ) {
+    if ( BAL_ReadImage( &theim, theim_name, 0 ) != 1 ) {
+      BAL_FreeTransformation( &theTrsf );
+      fprintf( stderr, "%s: can not read input image from standard input\n", proc );
+      return( -1 );
+    }
+  }
+  else if ( BAL_ReadImageHeader( &theim, theim_name ) != 1 ) {
       BAL_FreeTransformation( &theTrsf );
       fprintf( stderr, "%s: can not read input image '%s'\n", proc, theim_name );
       return( -1 );
@@ -231,6 +252,10 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
       theTrsf.mat.m[11] = par.slice.z - par.originValue;
 
       theLeftCorner[2] = par.slice.z - par.originValue;
+
+      theRegionDim[0] = theim.ncols;
+      theRegionDim[1] = theim.nrows;
+      theRegionDim[2] = 1;
   }
 
 
@@ -265,6 +290,10 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
     theTrsf.mat.m[7] = (par.analyzeFiji == 0) ? par.slice.y - par.originValue : (int)theim.nrows - par.slice.y + par.originValue - 1;
 
     theLeftCorner[1] = (par.analyzeFiji == 0) ? par.slice.y - par.originValue : (int)theim.nrows - par.slice.y + par.originValue - 1;
+
+    theRegionDim[0] = theim.ncols;
+    theRegionDim[1] = 1;
+    theRegionDim[2] = theim.nplanes;
   }
 
 
@@ -300,6 +329,10 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
     theTrsf.mat.m[3] = par.slice.x - par.originValue;
 
     theLeftCorner[0] = par.slice.x - par.originValue;
+
+    theRegionDim[0] = 1;
+    theRegionDim[1] = theim.nrows;
+    theRegionDim[2] = theim.nplanes;
   }
 
 
@@ -361,6 +394,10 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
     theTrsf.mat.m[ 3] = theLeftCorner[0];
     theTrsf.mat.m[ 7] = theLeftCorner[1];
     theTrsf.mat.m[11] = theLeftCorner[2];
+
+    theRegionDim[0] = resim.ncols;
+    theRegionDim[1] = resim.nrows;
+    theRegionDim[2] = resim.nplanes;
   }
 
 
@@ -424,6 +461,10 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
     theTrsf.mat.m[ 3] = theLeftCorner[0];
     theTrsf.mat.m[ 7] = theLeftCorner[1];
     theTrsf.mat.m[11] = theLeftCorner[2];
+
+    theRegionDim[0] = resim.ncols;
+    theRegionDim[1] = resim.nrows;
+    theRegionDim[2] = resim.nplanes;
   }
 
   /* do not know what to do ?!
@@ -444,15 +485,75 @@ int API_INTERMEDIARY_cropImage( char *theim_name,
    *
    ***************************************************/
 
-  if ( API_cropImage( &theim, &resim, param_str_1, param_str_2 ) != 1 ) {
+  /* the same as API_cropImage(), but only the cropped region
+   * is read: its buffer is the one of the result image
+   * (slices are extracted without re-ordering the voxels)
+   */
+
+  if ( par.print_lineCmdParam )
+      API_PrintParam_cropImage( stderr, proc, &par, (char*)NULL );
+
+  if ( theim.vdim != 1 ) {
     BAL_FreeImage( &resim );
     BAL_FreeTransformation( &theTrsf );
     BAL_FreeImage( &theim );
     if ( _verbose_ )
-      fprintf( stderr, "%s: unable to crop image\n", proc );
+      fprintf( stderr, "%s: vectorial images not handled yet\n", proc );
     return( -1 );
   }
 
+  /* the whole image has been read from the standard input
+   */
+  if ( fromStdin ) {
+    if ( API_cropImage( &theim, &resim, param_str_1, param_str_2 ) != 1 ) {
+      BAL_FreeImage( &resim );
+      BAL_FreeTransformation( &theTrsf );
+      BAL_FreeImage( &theim );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to crop image\n", proc );
+      return( -1 );
+    }
+  }
+
+  else {
+    corner.x = theLeftCorner[0];
+    corner.y = theLeftCorner[1];
+    corner.z = theLeftCorner[2];
+    dim.x = theRegionDim[0];
+    dim.y = theRegionDim[1];
+    dim.z = theRegionDim[2];
+
+    if ( BAL_ReadImageRegion( &subim, theim_name, &corner, &dim ) != 1 ) {
+      BAL_FreeImage( &resim );
+      BAL_FreeTransformation( &theTrsf );
+      BAL_FreeImage( &theim );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to read region of input image '%s'\n", proc, theim_name );
+      return( -1 );
+    }
+
+    if ( subim.type != resim.type || BAL_ImageDataSize( &subim ) != BAL_ImageDataSize( &resim ) ) {
+      BAL_FreeImage( &subim );
+      BAL_FreeImage( &resim );
+      BAL_FreeTransformation( &theTrsf );
+      BAL_FreeImage( &theim );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: region and result image are not compatible\n", proc );
+      return( -1 );
+    }
+    (void)memcpy( resim.data, subim.data, BAL_ImageDataSize( &resim ) );
+    BAL_FreeImage( &subim );
+
+    if ( _API_CropImageGeometry( &theim, &resim, &theTrsf ) != 1 ) {
+      BAL_FreeImage( &resim );
+      BAL_FreeTransformation( &theTrsf );
+      BAL_FreeImage( &theim );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to crop image\n", proc );
+      return( -1 );
+    }
+  }
+
 
   /***************************************************
    *
@@ -520,8 +621,6 @@ int API_cropImage( bal_image *image, bal_image *imres, char *param_str_1, char *
   int theLeftCorner[3] = {0, 0, 0};
 
   bal_transformation theTrsf;
-  bal_transformation invTrsf;
-  _MATRIX sform_to_voxel;
 
   lineCmdParamCropImage par;
 
@@ -709,19 +808,72 @@ int API_cropImage( bal_image *image, bal_image *imres, char *param_str_1, char *
   /* image geometry calculation
    */
 
-  BAL_InitTransformation( &invTrsf );
-  if ( BAL_AllocTransformation( &invTrsf, AFFINE_3D, (bal_image*)NULL ) != 1 ) {
+  theTrsf.transformation_unit = VOXEL_UNIT;
+
+  if ( _API_CropImageGeometry( image, imres, &theTrsf ) != 1 ) {
     if ( imres->type != image->type ) BAL_FreeImage( &imtmp );
     BAL_FreeTransformation( &theTrsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute result image geometry\n", proc );
+    return( -1 );
+  }
+
+  BAL_FreeTransformation( &theTrsf );
+
+
+  /***************************************************
+   *
+   *
+   *
+   ***************************************************/
+
+
+  /* copy, if required
+   */
+  if ( imres->type != image->type ) {
+    if ( BAL_CopyImage( imptr, imres ) != 1 )  {
+      BAL_FreeImage( &imtmp );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to copy auxiliary image\n", proc );
+      return( -1 );
+    }
+    BAL_FreeImage( &imtmp );
+  }
+
+  return( 1 );
+}
+
+
+
+
+
+
+/************************************************************
+ *
+ * static functions
+ *
+ ************************************************************/
+
+
+
+/* geometry of the cropped image 'imres': 'theTrsf' (in voxel units)
+ * maps the voxels of 'imres' onto the ones of 'image'
+ */
+static int _API_CropImageGeometry( bal_image *image, bal_image *imres,
+                                   bal_transformation *theTrsf )
+{
+  char *proc = "_API_CropImageGeometry";
+  bal_transformation invTrsf;
+  _MATRIX sform_to_voxel;
+
+  BAL_InitTransformation( &invTrsf );
+  if ( BAL_AllocTransformation( &invTrsf, AFFINE_3D, (bal_image*)NULL ) != 1 ) {
     if ( _verbose_ )
       fprintf( stderr, "%s: unable to allocate inverse transformation \n", proc );
     return( -1 );
   }
-  theTrsf.transformation_unit = VOXEL_UNIT;
 
-  if ( BAL_InverseTransformation( &theTrsf, &invTrsf ) != 1 ) {
-    if ( imres->type != image->type ) BAL_FreeImage( &imtmp );
-    BAL_FreeTransformation( &theTrsf );
+  if ( BAL_InverseTransformation( theTrsf, &invTrsf ) != 1 ) {
     BAL_FreeTransformation( &invTrsf );
     if ( _verbose_ )
       fprintf( stderr, "%s: Unable to invert transformation \n", proc );
@@ -734,8 +886,6 @@ int API_cropImage( bal_image *image, bal_image *imres, char *param_str_1, char *
   _mult_mat( &(invTrsf.mat), &(image->to_voxel), &(imres->to_voxel) );
 
   if ( InverseMat4x4( imres->to_voxel.m, imres->to_real.m ) != 4 ) {
-    if ( imres->type != image->type ) BAL_FreeImage( &imtmp );
-    BAL_FreeTransformation( &theTrsf );
     BAL_FreeTransformation( &invTrsf );
     if ( _verbose_ )
       fprintf( stderr, "%s: unable to invert qform matrix\n", proc );
@@ -752,8 +902,6 @@ int API_cropImage( bal_image *image, bal_image *imres, char *param_str_1, char *
 
   _init_mat( &(sform_to_voxel) );
   if ( _alloc_mat( &(sform_to_voxel), 4, 4 ) != 1 ) {
-    if ( imres->type != image->type ) BAL_FreeImage( &imtmp );
-    BAL_FreeTransformation( &theTrsf );
     BAL_FreeTransformation( &invTrsf );
     if ( _verbose_ )
       fprintf( stderr, "%s: unable to allocate sform 'to_voxel' matrix\n", proc );
@@ -761,8 +909,6 @@ int API_cropImage( bal_image *image, bal_image *imres, char *param_str_1, char *
   }
 
   if ( InverseMat4x4( image->sform_to_real.m, sform_to_voxel.m ) != 4 ) {
-    if ( imres->type != image->type ) BAL_FreeImage( &imtmp );
-    BAL_FreeTransformation( &theTrsf );
     BAL_FreeTransformation( &invTrsf );
     _free_mat( &(sform_to_voxel) );
     if ( _verbose_ )
@@ -773,8 +919,6 @@ int API_cropImage( bal_image *image, bal_image *imres, char *param_str_1, char *
   _mult_mat( &(invTrsf.mat), &sform_to_voxel, &sform_to_voxel );
 
   if ( InverseMat4x4( sform_to_voxel.m, imres->sform_to_real.m ) != 4 ) {
-    if ( imres->type != image->type ) BAL_FreeImage( &imtmp );
-    BAL_FreeTransformation( &theTrsf );
     BAL_FreeTransformation( &invTrsf );
     _free_mat( &(sform_to_voxel) );
     if ( _verbose_ )
@@ -786,46 +930,14 @@ int API_cropImage( bal_image *image, bal_image *imres, char *param_str_1, char *
   if ( imres->sform_code == 0 )
     imres->sform_code = 1;
 
-  BAL_FreeTransformation( &theTrsf );
   BAL_FreeTransformation( &invTrsf );
   _free_mat( &(sform_to_voxel) );
 
-
-  /***************************************************
-   *
-   *
-   *
-   ***************************************************/
-
-
-  /* copy, if required
-   */
-  if ( imres->type != image->type ) {
-    if ( BAL_CopyImage( imptr, imres ) != 1 )  {
-      BAL_FreeImage( &imtmp );
-      if ( _verbose_ )
-        fprintf( stderr, "%s: unable to copy auxiliary image\n", proc );
-      return( -1 );
-    }
-    BAL_FreeImage( &imtmp );
-  }
-
   return( 1 );
 }
 
 
 
-
-
-
-/************************************************************
- *
- * static functions
- *
- ************************************************************/
-
-
-
 static char **_Str2Array( int *argc, char *str )
 {
   char *proc = "_Str2Array";
@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include <chunks.h>
+#include <timeline.h>
 #include <vtmalloc.h>
 
 #include <api-invTrsf.h>
@@ -140,7 +141,10 @@ int API_INTERMEDIARY_invTrsf( char* thetrsf_name,
   BAL_InitTransformation( &theTrsf );
   BAL_InitTransformation( &resTrsf );
 
-
+  setVtMallocTag( 0, "invTrsf" );
+  setTimelineStage( 0, "invTrsf" );
+  setVtMallocTag( 1, "reading" );
+  setTimelineStage( 1, "reading" );
 
   if ( thetrsf_name == NULL || thetrsf_name[0] == '\0' ) {
     if ( _verbose_ )
@@ -268,6 +272,8 @@ int API_INTERMEDIARY_invTrsf( char* thetrsf_name,
    *
    ************************************************************/
 
+  setVtMallocTag( 1, "inversion" );
+  setTimelineStage( 1, "inversion" );
   if ( API_invTrsf( &theTrsf, &resTrsf, param_str_1, param_str_2 ) != 1 ) {
       BAL_FreeTransformation( &theTrsf );
       BAL_FreeTransformation( &resTrsf );
@@ -288,6 +294,8 @@ int API_INTERMEDIARY_invTrsf( char* thetrsf_name,
 
   /* writing output transformation
    */
+  setVtMallocTag( 1, "writing" );
+  setTimelineStage( 1, "writing" );
 
   if ( restrsf_name != NULL && restrsf_name[0] != '\0' ) {
     if ( BAL_WriteTransformation( &resTrsf, restrsf_name ) != 1 ) {
@@ -306,6 +314,9 @@ int API_INTERMEDIARY_invTrsf( char* thetrsf_name,
 
   BAL_FreeTransformation( &resTrsf );
 
+  setVtMallocTag( 0, (char*)NULL );
+  setTimelineStage( 0, (char*)NULL );
+
   return( 1 );
 }
 
@@ -565,6 +576,17 @@ char *API_Help_invTrsf( int h )
 
 
 
+static jmp_buf *_errorParseJump_ = (jmp_buf*)NULL;
+
+void API_SetErrorParseJump_invTrsf( jmp_buf *env )
+{
+    _errorParseJump_ = env;
+}
+
+
+
+
+
 void API_ErrorParse_invTrsf( char *program, char *str, int flag )
 {
         if ( flag >= 0 ) {
@@ -580,6 +602,8 @@ void API_ErrorParse_invTrsf( char *program, char *str, int flag )
         }
         if ( str != (char*)NULL )
           (void)fprintf(stderr,"Error: %s\n",str);
+        if ( _errorParseJump_ != (jmp_buf*)NULL )
+          longjmp( *_errorParseJump_, 1 );
         exit( 1 );
 }
 
@@ -24,6 +24,8 @@ extern "C" {
 
 
 
+#include <setjmp.h>
+
 #include <typedefs.h>
 
 #include <bal-transformation.h>
@@ -90,6 +92,12 @@ extern char *API_Help_invTrsf( int h );
 
 extern void API_ErrorParse_invTrsf( char *program, char *str, int flag );
 
+/* if 'env' is not NULL, API_ErrorParse_invTrsf() longjmp()s to it
+ * (with value 1) instead of exiting, eg to check options in
+ * a long running process
+ */
+extern void API_SetErrorParseJump_invTrsf( jmp_buf *env );
+
 extern void API_InitParam_invTrsf( lineCmdParamInvTrsf *par );
 
 extern void API_PrintParam_invTrsf( FILE *theFile, char *program,
@@ -0,0 +1,620 @@
+/*************************************************************************
+ * api-python.c -
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026, all rights reserved
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vtmalloc.h>
+
+#include <bal-transformation-compose.h>
+#include <bal-transformation-copy.h>
+#include <bal-transformation-inversion.h>
+
+#include <api-applyTrsf.h>
+#include <api-blockmatching.h>
+#include <api-composeTrsf.h>
+#include <api-invTrsf.h>
+
+#include <api-python.h>
+
+
+
+
+
+
+static int _verbose_ = 1;
+
+
+
+
+
+/************************************************************
+ *
+ * static functions
+ *
+ ************************************************************/
+
+
+
+static bufferType _BufferType( char *type )
+{
+  if ( type == (char*)NULL ) return( TYPE_UNKNOWN );
+  if ( strcmp( type, "uint8" ) == 0 ) return( UCHAR );
+  if ( strcmp( type, "int8" ) == 0 ) return( SCHAR );
+  if ( strcmp( type, "uint16" ) == 0 ) return( USHORT );
+  if ( strcmp( type, "int16" ) == 0 ) return( SSHORT );
+  if ( strcmp( type, "uint32" ) == 0 ) return( UINT );
+  if ( strcmp( type, "int32" ) == 0 ) return( SINT );
+  if ( strcmp( type, "float32" ) == 0 ) return( FLOAT );
+  if ( strcmp( type, "float64" ) == 0 ) return( DOUBLE );
+  return( TYPE_UNKNOWN );
+}
+
+
+
+/* the image structure is filled around 'data',
+ * only the array of pointers is allocated
+ * (nothing if 'data' is NULL)
+ */
+static int _WrapImage( bal_image *image, void *data, bufferType type,
+                       int dimx, int dimy, int dimz,
+                       double vx, double vy, double vz,
+                       double *qform )
+{
+  char *proc = "_WrapImage";
+
+  if ( dimx <= 0 || dimy <= 0 || dimz <= 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: bad dimensions [%d %d %d]\n", proc, dimx, dimy, dimz );
+    return( -1 );
+  }
+
+  if ( BAL_InitImage( image, (char*)NULL, dimx, dimy, dimz, 1, type ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to initialize image\n", proc );
+    return( -1 );
+  }
+
+  if ( BAL_SetImageVoxelSizes( image, vx, vy, vz ) != 1 ) {
+    BAL_FreeImage( image );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to set image geometry\n", proc );
+    return( -1 );
+  }
+
+  if ( qform != (double*)NULL ) {
+    (void)memcpy( image->to_real.m, qform, 16*sizeof(double) );
+    if ( InverseMat4x4( image->to_real.m, image->to_voxel.m ) != 4 ) {
+      BAL_FreeImage( image );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to invert qform matrix\n", proc );
+      return( -1 );
+    }
+    image->geometry = _BAL_QFORM_GEOMETRY_;
+    image->qform_code = 1;
+  }
+
+  /* geometry only
+   */
+  if ( data == (void*)NULL )
+    return( 1 );
+
+  image->data = data;
+  if ( BAL_AllocArrayImage( image ) != 1 ) {
+    image->data = (void*)NULL;
+    BAL_FreeImage( image );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to build image array\n", proc );
+    return( -1 );
+  }
+
+  return( 1 );
+}
+
+
+
+static void _UnwrapImage( bal_image *image )
+{
+  image->data = (void*)NULL;
+  BAL_FreeImage( image );
+}
+
+
+
+static bal_transformation *_AllocTransformation( char *proc )
+{
+  bal_transformation *trsf;
+
+  trsf = (bal_transformation*)vtmalloc( sizeof(bal_transformation), "trsf", proc );
+  if ( trsf == (bal_transformation*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate transformation\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+  BAL_InitTransformation( trsf );
+  return( trsf );
+}
+
+
+
+/* allocates the result of a computation,
+ * vector fields are allocated either with the template,
+ * or with the geometry of 'from'
+ */
+static bal_transformation *_AllocResultTransformation( enumTypeTransfo type,
+                                                       bal_image *templateImage,
+                                                       bal_transformation *from,
+                                                       char *proc )
+{
+  bal_transformation *trsf;
+  bal_image *ref = templateImage;
+
+  if ( ref == (bal_image*)NULL && BAL_IsTransformationVectorField( from ) == 1 )
+    ref = &(from->vx);
+
+  trsf = _AllocTransformation( proc );
+  if ( trsf == (bal_transformation*)NULL )
+    return( (bal_transformation*)NULL );
+
+  if ( BAL_AllocTransformation( trsf, type, ref ) != 1 ) {
+    vtfree( trsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate result transformation\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+  return( trsf );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * wrapping
+ *
+ ************************************************************/
+
+
+
+bal_image *API_PY_WrapImage( void *data, char *type,
+                             int dimx, int dimy, int dimz,
+                             double vx, double vy, double vz,
+                             double *qform )
+{
+  char *proc = "API_PY_WrapImage";
+  bal_image *image;
+  bufferType t = _BufferType( type );
+
+  if ( t == TYPE_UNKNOWN ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: type '%s' not handled\n", proc, type );
+    return( (bal_image*)NULL );
+  }
+
+  image = (bal_image*)vtmalloc( sizeof(bal_image), "image", proc );
+  if ( image == (bal_image*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate image\n", proc );
+    return( (bal_image*)NULL );
+  }
+
+  if ( _WrapImage( image, data, t, dimx, dimy, dimz, vx, vy, vz, qform ) != 1 ) {
+    vtfree( image );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to wrap image\n", proc );
+    return( (bal_image*)NULL );
+  }
+
+  return( image );
+}
+
+
+
+void API_PY_UnwrapImage( bal_image *image )
+{
+  if ( image == (bal_image*)NULL ) return;
+  _UnwrapImage( image );
+  vtfree( image );
+}
+
+
+
+bal_transformation *API_PY_WrapMatrix( double *mat )
+{
+  char *proc = "API_PY_WrapMatrix";
+  bal_transformation *trsf;
+
+  trsf = _AllocTransformation( proc );
+  if ( trsf == (bal_transformation*)NULL )
+    return( (bal_transformation*)NULL );
+
+  if ( BAL_AllocTransformation( trsf, AFFINE_3D, (bal_image*)NULL ) != 1 ) {
+    vtfree( trsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate matrix\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+  (void)memcpy( trsf->mat.m, mat, 16*sizeof(double) );
+  trsf->transformation_unit = REAL_UNIT;
+
+  return( trsf );
+}
+
+
+
+bal_transformation *API_PY_WrapVectorField( float *dx, float *dy, float *dz,
+                                            int dimx, int dimy, int dimz,
+                                            double vx, double vy, double vz )
+{
+  char *proc = "API_PY_WrapVectorField";
+  bal_transformation *trsf;
+
+  if ( dx == (float*)NULL || dy == (float*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: NULL component\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+
+  trsf = _AllocTransformation( proc );
+  if ( trsf == (bal_transformation*)NULL )
+    return( (bal_transformation*)NULL );
+
+  if ( _WrapImage( &(trsf->vx), dx, FLOAT, dimx, dimy, dimz, vx, vy, vz, (double*)NULL ) != 1 ) {
+    vtfree( trsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to wrap x component\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+  if ( _WrapImage( &(trsf->vy), dy, FLOAT, dimx, dimy, dimz, vx, vy, vz, (double*)NULL ) != 1 ) {
+    _UnwrapImage( &(trsf->vx) );
+    vtfree( trsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to wrap y component\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+
+  if ( dz == (float*)NULL ) {
+    trsf->type = VECTORFIELD_2D;
+  }
+  else {
+    if ( _WrapImage( &(trsf->vz), dz, FLOAT, dimx, dimy, dimz, vx, vy, vz, (double*)NULL ) != 1 ) {
+      _UnwrapImage( &(trsf->vy) );
+      _UnwrapImage( &(trsf->vx) );
+      vtfree( trsf );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to wrap z component\n", proc );
+      return( (bal_transformation*)NULL );
+    }
+    trsf->type = VECTORFIELD_3D;
+  }
+  trsf->transformation_unit = REAL_UNIT;
+
+  return( trsf );
+}
+
+
+
+void API_PY_UnwrapTransformation( bal_transformation *trsf )
+{
+  if ( trsf == (bal_transformation*)NULL ) return;
+  if ( BAL_IsTransformationVectorField( trsf ) == 1 ) {
+    _UnwrapImage( &(trsf->vx) );
+    _UnwrapImage( &(trsf->vy) );
+    _UnwrapImage( &(trsf->vz) );
+    trsf->type = UNDEF_TRANSFORMATION;
+  }
+  BAL_FreeTransformation( trsf );
+  vtfree( trsf );
+}
+
+
+
+void API_PY_FreeTransformation( bal_transformation *trsf )
+{
+  if ( trsf == (bal_transformation*)NULL ) return;
+  BAL_FreeTransformation( trsf );
+  vtfree( trsf );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * getting results
+ *
+ ************************************************************/
+
+
+
+int API_PY_GetTransformationGeometry( bal_transformation *trsf,
+                                      int *dim, double *voxel )
+{
+  if ( trsf == (bal_transformation*)NULL ) return( -1 );
+
+  if ( BAL_IsTransformationLinear( trsf ) == 1 )
+    return( 1 );
+
+  if ( BAL_IsTransformationVectorField( trsf ) == 1 ) {
+    dim[0] = trsf->vx.ncols;
+    dim[1] = trsf->vx.nrows;
+    dim[2] = trsf->vx.nplanes;
+    voxel[0] = trsf->vx.vx;
+    voxel[1] = trsf->vx.vy;
+    voxel[2] = trsf->vx.vz;
+    return( trsf->type == VECTORFIELD_2D ? 2 : 3 );
+  }
+
+  return( -1 );
+}
+
+
+
+int API_PY_GetMatrix( bal_transformation *trsf, double *mat )
+{
+  char *proc = "API_PY_GetMatrix";
+
+  if ( BAL_IsTransformationLinear( trsf ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: not a linear transformation\n", proc );
+    return( -1 );
+  }
+  (void)memcpy( mat, trsf->mat.m, 16*sizeof(double) );
+  return( 1 );
+}
+
+
+
+int API_PY_GetVectorField( bal_transformation *trsf,
+                           float *dx, float *dy, float *dz )
+{
+  char *proc = "API_PY_GetVectorField";
+  size_t size;
+
+  if ( BAL_IsTransformationVectorField( trsf ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: not a vector field\n", proc );
+    return( -1 );
+  }
+
+  size = BAL_ImageDataSize( &(trsf->vx) );
+  (void)memcpy( dx, trsf->vx.data, size );
+  (void)memcpy( dy, trsf->vy.data, size );
+  if ( trsf->type == VECTORFIELD_3D && dz != (float*)NULL )
+    (void)memcpy( dz, trsf->vz.data, size );
+  return( 1 );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * computations
+ *
+ ************************************************************/
+
+
+
+/* the API_ErrorParse_*() functions exit in case of error (eg an
+ * unknown option), which would terminate the calling interpreter:
+ * they are told to jump back here instead
+ */
+static bal_transformation *_blockmatching( bal_image *floatingImage,
+                                           bal_image *referenceImage,
+                                           bal_transformation *leftTrsf,
+                                           bal_transformation *initTrsf,
+                                           char *param_str, char *proc )
+{
+  jmp_buf env;
+  bal_transformation *resultTrsf;
+
+  API_SetErrorParseJump_blockmatching( &env );
+  if ( setjmp( env ) != 0 ) {
+    API_SetErrorParseJump_blockmatching( (jmp_buf*)NULL );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid parameters '%s'\n", proc, param_str );
+    return( (bal_transformation*)NULL );
+  }
+  resultTrsf = API_blockmatching( floatingImage, referenceImage, (bal_image*)NULL,
+                                  leftTrsf, initTrsf, param_str, (char*)NULL );
+  API_SetErrorParseJump_blockmatching( (jmp_buf*)NULL );
+  return( resultTrsf );
+}
+
+
+
+static int _applyTrsf( bal_image *image, bal_image *resultImage,
+                       bal_transformation *trsf, char *param_str, char *proc )
+{
+  jmp_buf env;
+  int r;
+
+  API_SetErrorParseJump_applyTrsf( &env );
+  if ( setjmp( env ) != 0 ) {
+    API_SetErrorParseJump_applyTrsf( (jmp_buf*)NULL );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid parameters '%s'\n", proc, param_str );
+    return( -1 );
+  }
+  r = API_applyTrsf( image, resultImage, trsf, param_str, (char*)NULL );
+  API_SetErrorParseJump_applyTrsf( (jmp_buf*)NULL );
+  return( r );
+}
+
+
+
+static int _composeTrsf( bal_transformation **trsfs, int n, bal_transformation *resTrsf,
+                         char *param_str, char *proc )
+{
+  jmp_buf env;
+  int r;
+
+  API_SetErrorParseJump_composeTrsf( &env );
+  if ( setjmp( env ) != 0 ) {
+    API_SetErrorParseJump_composeTrsf( (jmp_buf*)NULL );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid parameters '%s'\n", proc, param_str );
+    return( -1 );
+  }
+  r = API_composeTrsf( trsfs, n, resTrsf, param_str, (char*)NULL );
+  API_SetErrorParseJump_composeTrsf( (jmp_buf*)NULL );
+  return( r );
+}
+
+
+
+static int _invTrsf( bal_transformation *trsf, bal_transformation *resTrsf,
+                     char *param_str, char *proc )
+{
+  jmp_buf env;
+  int r;
+
+  API_SetErrorParseJump_invTrsf( &env );
+  if ( setjmp( env ) != 0 ) {
+    API_SetErrorParseJump_invTrsf( (jmp_buf*)NULL );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid parameters '%s'\n", proc, param_str );
+    return( -1 );
+  }
+  r = API_invTrsf( trsf, resTrsf, param_str, (char*)NULL );
+  API_SetErrorParseJump_invTrsf( (jmp_buf*)NULL );
+  return( r );
+}
+
+
+
+bal_transformation *API_PY_blockmatching( bal_image *floatingImage,
+                                          bal_image *referenceImage,
+                                          bal_transformation *leftTrsf,
+                                          bal_transformation *initTrsf,
+                                          char *param_str )
+{
+  char *proc = "API_PY_blockmatching";
+  bal_transformation *initResultTrsf = (bal_transformation*)NULL;
+  bal_transformation *resultTrsf;
+
+  /* the initial transformation is updated by the registration,
+   * it is copied so that the caller buffers are left untouched
+   */
+  if ( initTrsf != (bal_transformation*)NULL ) {
+    initResultTrsf = _AllocResultTransformation( initTrsf->type, (bal_image*)NULL, initTrsf, proc );
+    if ( initResultTrsf == (bal_transformation*)NULL )
+      return( (bal_transformation*)NULL );
+    if ( BAL_CopyTransformation( initTrsf, initResultTrsf ) != 1 ) {
+      API_PY_FreeTransformation( initResultTrsf );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to copy initial transformation\n", proc );
+      return( (bal_transformation*)NULL );
+    }
+  }
+
+  resultTrsf = _blockmatching( floatingImage, referenceImage,
+                               leftTrsf, initResultTrsf, param_str, proc );
+  if ( resultTrsf == (bal_transformation*)NULL ) {
+    API_PY_FreeTransformation( initResultTrsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to register images\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+  if ( resultTrsf != initResultTrsf )
+    API_PY_FreeTransformation( initResultTrsf );
+
+  if ( BAL_ChangeTransformationToRealUnit( floatingImage, referenceImage,
+                                           resultTrsf, resultTrsf ) != 1 ) {
+    API_PY_FreeTransformation( resultTrsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to convert transformation into the 'real' world\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+
+  return( resultTrsf );
+}
+
+
+
+int API_PY_applyTrsf( bal_image *image,
+                      bal_image *resultImage,
+                      bal_transformation *trsf,
+                      char *param_str )
+{
+  return( _applyTrsf( image, resultImage, trsf, param_str, "API_PY_applyTrsf" ) );
+}
+
+
+
+bal_transformation *API_PY_composeTrsf( bal_transformation **trsfs, int n,
+                                        bal_image *templateImage,
+                                        char *param_str )
+{
+  char *proc = "API_PY_composeTrsf";
+  bal_transformation *resTrsf;
+
+  if ( trsfs == (bal_transformation**)NULL || n <= 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: no input transformations\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+
+  resTrsf = _AllocTransformation( proc );
+  if ( resTrsf == (bal_transformation*)NULL )
+    return( (bal_transformation*)NULL );
+
+  if ( BAL_AllocTransformationListComposition( resTrsf, trsfs, n, templateImage ) != 1 ) {
+    vtfree( resTrsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate result transformation\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+
+  if ( _composeTrsf( trsfs, n, resTrsf, param_str, proc ) != 1 ) {
+    API_PY_FreeTransformation( resTrsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compose transformations\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+
+  return( resTrsf );
+}
+
+
+
+bal_transformation *API_PY_invTrsf( bal_transformation *trsf,
+                                    bal_image *templateImage,
+                                    char *param_str )
+{
+  char *proc = "API_PY_invTrsf";
+  bal_transformation *resTrsf;
+
+  resTrsf = _AllocResultTransformation( trsf->type, templateImage, trsf, proc );
+  if ( resTrsf == (bal_transformation*)NULL )
+    return( (bal_transformation*)NULL );
+
+  if ( _invTrsf( trsf, resTrsf, param_str, proc ) != 1 ) {
+    API_PY_FreeTransformation( resTrsf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to invert transformation\n", proc );
+    return( (bal_transformation*)NULL );
+  }
+
+  return( resTrsf );
+}
@@ -0,0 +1,140 @@
+/*************************************************************************
+ * api-python.h -
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026, all rights reserved
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+#ifndef _api_python_h_
+#define _api_python_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+#include <bal-image.h>
+#include <bal-transformation.h>
+
+
+
+/*****************************************************************
+ *
+ * plain C interface to API_blockmatching(), API_applyTrsf(),
+ * API_composeTrsf() and API_invTrsf(), designed to be called
+ * through ctypes (see BlockMatching/python).
+ *
+ * Only pointers, integers, doubles and strings are exchanged.
+ *
+ * Images and vector field components are wrapped around buffers
+ * allocated by the caller (numpy arrays), they are not copied:
+ * the buffer has to be contiguous with x varying the fastest
+ * (ie a fortran-ordered [x,y,z] array) and has to stay alive
+ * until the wrapping structure is released by
+ * API_PY_UnwrapImage() or API_PY_UnwrapTransformation().
+ *
+ * Transformations are in 'real' units (as the ones written by
+ * '-res-trsf' or read by '-trsf'), matrices are 4x4 row-major.
+ *
+ * Transformations returned by the computations are allocated here
+ * and have to be released by API_PY_FreeTransformation() once they
+ * have been copied (API_PY_GetMatrix(), API_PY_GetVectorField()).
+ *
+ * The library is not reentrant: calls must be serialized.
+ *
+ *****************************************************************/
+
+
+
+/* 'type' is a numpy dtype name ("uint8", "int16", "float32", ...)
+ * 'qform' (optional, 16 values) is the voxel to real matrix,
+ * else the geometry is given by the voxel sizes.
+ * 'data' can be NULL for a template (only the geometry is used).
+ * returns NULL in case of error
+ */
+extern bal_image *API_PY_WrapImage( void *data, char *type,
+                                    int dimx, int dimy, int dimz,
+                                    double vx, double vy, double vz,
+                                    double *qform );
+extern void API_PY_UnwrapImage( bal_image *image );
+
+
+
+/* the matrix is copied
+ */
+extern bal_transformation *API_PY_WrapMatrix( double *mat );
+
+/* float components of dimensions dimx x dimy x dimz,
+ * 'dz' is NULL for 2D vector fields
+ */
+extern bal_transformation *API_PY_WrapVectorField( float *dx, float *dy, float *dz,
+                                                   int dimx, int dimy, int dimz,
+                                                   double vx, double vy, double vz );
+extern void API_PY_UnwrapTransformation( bal_transformation *trsf );
+
+extern void API_PY_FreeTransformation( bal_transformation *trsf );
+
+
+
+/* returns 1 for a matrix, 2 or 3 for a 2D or 3D vector field,
+ * -1 else. For vector fields, 'dim' and 'voxel' (3 values each)
+ * are filled with the geometry of the field.
+ */
+extern int API_PY_GetTransformationGeometry( bal_transformation *trsf,
+                                             int *dim, double *voxel );
+extern int API_PY_GetMatrix( bal_transformation *trsf, double *mat );
+extern int API_PY_GetVectorField( bal_transformation *trsf,
+                                  float *dx, float *dy, float *dz );
+
+
+
+/* computations
+ * 'param_str' has the syntax of the command line options,
+ * invalid options make the computation fail (NULL or -1 is
+ * returned) instead of exiting
+ * 'leftTrsf', 'initTrsf' and 'templateImage' can be NULL
+ */
+
+extern bal_transformation *API_PY_blockmatching( bal_image *floatingImage,
+                                                 bal_image *referenceImage,
+                                                 bal_transformation *leftTrsf,
+                                                 bal_transformation *initTrsf,
+                                                 char *param_str );
+
+/* 'resultImage' gives the output geometry, 'trsf' may be NULL
+ * (the image to image transformation is then used)
+ */
+extern int API_PY_applyTrsf( bal_image *image,
+                             bal_image *resultImage,
+                             bal_transformation *trsf,
+                             char *param_str );
+
+/* same order as for composeTrsf: trsfs[0] o trsfs[1] o ...
+ * the template gives the geometry of a resulting vector field
+ */
+extern bal_transformation *API_PY_composeTrsf( bal_transformation **trsfs, int n,
+                                               bal_image *templateImage,
+                                               char *param_str );
+
+extern bal_transformation *API_PY_invTrsf( bal_transformation *trsf,
+                                           bal_image *templateImage,
+                                           char *param_str );
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -31,6 +31,7 @@
 #include <sys/time.h>
 #endif
 
+#include <timeline.h>
 #include <vtmalloc.h>
 
 #include <bal-blockmatching.h>
@@ -237,6 +238,7 @@ bal_transformation *BAL_PyramidalBlockMatching( bal_image *theInrimage_ref,
   int pyramid_highest_level;
   bal_pyramid_level *pyramid_level = NULL;
   int l;
+  char level_tag[32];
 
   bal_image *Inrimage_flo = (bal_image *)NULL;
   bal_image smoothed_flo;
@@ -507,6 +509,12 @@ bal_transformation *BAL_PyramidalBlockMatching( bal_image *theInrimage_ref,
       _PrintPyramidLevel( param.verbosef, &(pyramid_level[l]), 1 );
     }
 
+    sprintf( level_tag, "level %d", l );
+    setVtMallocTag( 2, level_tag );
+    setTimelineStage( 2, level_tag );
+    setVtMallocTag( 3, "subsampling" );
+    setTimelineStage( 3, "subsampling" );
+
     /* allocation and computation of the subsampled reference image
      *
      * recall that the voxel to real transformation is embedded
@@ -548,6 +556,8 @@ bal_transformation *BAL_PyramidalBlockMatching( bal_image *theInrimage_ref,
      *
      * if is weird that the same parameter are used than for the reference image ...
      */
+    setVtMallocTag( 3, "smoothing" );
+    setTimelineStage( 3, "smoothing" );
     if ( param.pyramid_gaussian_filtering ) {
       if ( BAL_SmoothImageIntoImage(  theInrimage_flo, &smoothed_flo,
                                       &(pyramid_level[l].sigma) ) != 1 ) {
@@ -724,6 +734,8 @@ bal_transformation *BAL_PyramidalBlockMatching( bal_image *theInrimage_ref,
   /* end of
    * for ( l=pyramid_highest_level; l>=param.pyramid_lowest_level; l-- )
    */
+  setVtMallocTag( 2, (char*)NULL );
+  setTimelineStage( 2, (char*)NULL );
 
   /* freeing some stuff
    */
@@ -936,6 +948,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
   /* Allocation: subsampled floating image
      this image is in the same geometry than theInrimage_ref
   */
+  setVtMallocTag( 3, "allocation" );
+  setTimelineStage( 3, "allocation" );
   if ( BAL_AllocImageFromImage( &Inrimage_flo_sub, "subsampled_floating_image.nii",
                                     theInrimage_ref, theInrimage_flo->type ) != 1 ) {
     if ( _verbose_ ) 
@@ -1011,6 +1025,9 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
 
 
 
+  setVtMallocTag( 3, "reference block attributes" );
+  setTimelineStage( 3, "reference block attributes" );
+
   /* pre-computation:
      Compute attributes of the reference blocks
   */
@@ -1150,6 +1167,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
     BAL_InitTransformation( &resamplingTrsf );
     if ( theLeft != (bal_transformation*)NULL ) {
 
+      setVtMallocTag( 3, "initial composition" );
+      setTimelineStage( 3, "initial composition" );
       if ( _time_ )
         fprintf( stderr, "%s: transformation composition with the initial transformation\n", proc );
       
@@ -1190,6 +1209,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
     
     
 
+    setVtMallocTag( 3, "resampling" );
+    setTimelineStage( 3, "resampling" );
     if ( _time_ )
       fprintf( stderr, "%s: image resampling\n", proc );
 
@@ -1234,6 +1255,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
        Compute attributes of the floating blocks
     */
     
+    setVtMallocTag( 3, "floating block attributes" );
+    setTimelineStage( 3, "floating block attributes" );
     if ( _time_ )
       fprintf( stderr, "%s: computation of floating image block attributes\n", proc );
 #ifndef WIN32
@@ -1267,6 +1290,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
       ie echantillonner d'apres les parametres.
    */ 
 
+    setVtMallocTag( 3, "block sorting" );
+    setTimelineStage( 3, "block sorting" );
     if ( _time_ )
       fprintf( stderr, "%s: block sorting\n", proc );
 
@@ -1304,6 +1329,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
      * displacement = floating point - reference point
      */
 
+    setVtMallocTag( 3, "pairing" );
+    setTimelineStage( 3, "pairing" );
     if ( _time_ )
       fprintf( stderr, "%s: computation of pairing field\n", proc );
 #ifndef WIN32
@@ -1351,6 +1378,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
        Linear case: it is in the real framework
     */
 
+    setVtMallocTag( 3, "estimation" );
+    setTimelineStage( 3, "estimation" );
     if ( _time_ )
       fprintf( stderr, "%s: computation of incremental transformation\n", proc );
 
@@ -1389,6 +1418,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
        theTr = incTrsf o theTr
     */
     
+    setVtMallocTag( 3, "composition" );
+    setTimelineStage( 3, "composition" );
     if ( _time_ )
       fprintf( stderr, "%s: transformation composition with the incremental transformation\n", proc );
 #ifndef WIN32
@@ -1453,6 +1484,8 @@ int BAL_BlockMatching( bal_image *theInrimage_ref, /* reference image
       break;
     case VECTORFIELD_2D :
     case VECTORFIELD_3D :
+      setVtMallocTag( 3, "regularization" );
+      setTimelineStage( 3, "regularization" );
       if ( _time_ )
         fprintf( stderr, "%s: elastic regularization\n", proc );
 #ifndef WIN32
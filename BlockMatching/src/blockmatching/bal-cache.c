@@ -0,0 +1,788 @@
+/*************************************************************************
+ * bal-cache.c -
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026, all rights reserved
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+/* st_mtim
+ */
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <vtmalloc.h>
+
+#include <bal-transformation-copy.h>
+#include <bal-cache.h>
+
+static int _verbose_ = 1;
+
+
+
+#if defined(__APPLE__)
+#define _MTIME_NSEC( s ) ((s).st_mtimespec.tv_nsec)
+#else
+#define _MTIME_NSEC( s ) ((s).st_mtim.tv_nsec)
+#endif
+
+
+
+
+
+int BAL_GetVerboseInBalCache(  )
+{
+  return( _verbose_ );
+}
+
+void BAL_SetVerboseInBalCache( int v )
+{
+  _verbose_ = v;
+}
+
+void BAL_IncrementVerboseInBalCache(  )
+{
+  _verbose_ ++;
+}
+
+void BAL_DecrementVerboseInBalCache(  )
+{
+  _verbose_ --;
+  if ( _verbose_ < 0 ) _verbose_ = 0;
+}
+
+
+
+
+
+/************************************************************
+ *
+ * cache entries
+ *
+ ************************************************************/
+
+
+
+typedef enum {
+  _CACHED_IMAGE_,
+  _CACHED_TRANSFORMATION_,
+  _CACHED_SUBSAMPLED_IMAGE_
+} enumCachedItem;
+
+
+
+typedef struct {
+  enumCachedItem item;
+
+  /* read files
+   */
+  char *name;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  time_t mtime;
+  long mtime_nsec;
+  int normalisation;
+
+  /* subsampled images: input image contents and geometry,
+   * output dimensions and filtering
+   * the hash only selects candidates, the contents ('data' points
+   * to the input image for a query, to a copy for an entry)
+   * are compared on a hit
+   */
+  unsigned long hash;
+  void *data;
+  size_t dataSize;
+  size_t ncols;
+  size_t nrows;
+  size_t nplanes;
+  size_t vdim;
+  bufferType type;
+  double vx;
+  double vy;
+  double vz;
+  double to_real[16];
+  int dim[3];
+  int filtering;
+  bal_doublePoint sigma;
+} _cacheKey;
+
+
+
+typedef struct _cacheEntry {
+  _cacheKey key;
+  bal_image image;
+  bal_transformation trsf;
+  size_t bytes;
+  struct _cacheEntry *prev;
+  struct _cacheEntry *next;
+} _cacheEntry;
+
+
+
+/* most recently used entry first
+ */
+static _cacheEntry *_first_ = (_cacheEntry*)NULL;
+static _cacheEntry *_last_ = (_cacheEntry*)NULL;
+
+static bal_cacheStatistics _statistics_ = { 0, 0, 0, 0, 0, 0 };
+
+
+
+
+
+/************************************************************
+ *
+ * keys
+ *
+ ************************************************************/
+
+
+
+static int _InitFileKey( _cacheKey *key, enumCachedItem item,
+                         char *name, int normalisation )
+{
+  struct stat st;
+
+  memset( key, 0, sizeof( _cacheKey ) );
+  key->item = item;
+
+  if ( name == (char*)NULL || name[0] == '\0' ) return( -1 );
+  if ( stat( name, &st ) != 0 ) return( -1 );
+  if ( !S_ISREG( st.st_mode ) && !S_ISDIR( st.st_mode ) ) return( -1 );
+
+  key->name = name;
+  key->dev = st.st_dev;
+  key->ino = st.st_ino;
+  key->size = st.st_size;
+  key->mtime = st.st_mtime;
+  key->mtime_nsec = (long)_MTIME_NSEC( st );
+  key->normalisation = normalisation;
+  return( 1 );
+}
+
+
+
+static unsigned long _HashBuffer( void *buf, size_t size )
+{
+  unsigned char *b = (unsigned char*)buf;
+  unsigned long h = 1469598103934665603UL;
+  unsigned long w;
+  size_t i;
+
+  for ( i=0; i+sizeof(unsigned long)<=size; i+=sizeof(unsigned long) ) {
+    memcpy( &w, b+i, sizeof(unsigned long) );
+    h = (h ^ w) * 1099511628211UL;
+    h ^= h >> 29;
+  }
+  for ( ; i<size; i++ ) {
+    h = (h ^ b[i]) * 1099511628211UL;
+  }
+  return( h );
+}
+
+
+
+static int _InitSubsampledImageKey( _cacheKey *key,
+                                    int dimx, int dimy, int dimz,
+                                    bal_image *theIm,
+                                    bal_doublePoint *sigma )
+{
+  size_t size;
+
+  memset( key, 0, sizeof( _cacheKey ) );
+  key->item = _CACHED_SUBSAMPLED_IMAGE_;
+
+  if ( theIm->data == (void*)NULL || theIm->to_real.m == (double*)NULL )
+    return( -1 );
+  size = BAL_ImageDataSize( theIm );
+  if ( size == (size_t)-1 ) return( -1 );
+
+  key->hash = _HashBuffer( theIm->data, size );
+  key->data = theIm->data;
+  key->dataSize = size;
+  key->ncols = theIm->ncols;
+  key->nrows = theIm->nrows;
+  key->nplanes = theIm->nplanes;
+  key->vdim = theIm->vdim;
+  key->type = theIm->type;
+  key->vx = theIm->vx;
+  key->vy = theIm->vy;
+  key->vz = theIm->vz;
+  memcpy( key->to_real, theIm->to_real.m, 16*sizeof(double) );
+  key->dim[0] = dimx;
+  key->dim[1] = dimy;
+  key->dim[2] = dimz;
+  if ( sigma != (bal_doublePoint*)NULL ) {
+    key->filtering = 1;
+    key->sigma = *sigma;
+  }
+  return( 1 );
+}
+
+
+
+static int _SameKey( _cacheKey *a, _cacheKey *b )
+{
+  int i;
+
+  if ( a->item != b->item ) return( 0 );
+
+  switch ( a->item ) {
+  default :
+    return( 0 );
+  case _CACHED_IMAGE_ :
+  case _CACHED_TRANSFORMATION_ :
+    if ( strcmp( a->name, b->name ) != 0 ) return( 0 );
+    if ( a->dev != b->dev || a->ino != b->ino || a->size != b->size ) return( 0 );
+    if ( a->mtime != b->mtime || a->mtime_nsec != b->mtime_nsec ) return( 0 );
+    if ( a->normalisation != b->normalisation ) return( 0 );
+    return( 1 );
+  case _CACHED_SUBSAMPLED_IMAGE_ :
+    if ( a->hash != b->hash ) return( 0 );
+    if ( a->ncols != b->ncols || a->nrows != b->nrows
+         || a->nplanes != b->nplanes || a->vdim != b->vdim
+         || a->type != b->type || a->dataSize != b->dataSize ) return( 0 );
+    if ( a->vx != b->vx || a->vy != b->vy || a->vz != b->vz ) return( 0 );
+    for ( i=0; i<16; i++ )
+      if ( a->to_real[i] != b->to_real[i] ) return( 0 );
+    for ( i=0; i<3; i++ )
+      if ( a->dim[i] != b->dim[i] ) return( 0 );
+    if ( a->filtering != b->filtering ) return( 0 );
+    if ( a->filtering && ( a->sigma.x != b->sigma.x || a->sigma.y != b->sigma.y
+                           || a->sigma.z != b->sigma.z ) ) return( 0 );
+    if ( a->data == (void*)NULL || b->data == (void*)NULL ) return( 0 );
+    if ( a->data != b->data && memcmp( a->data, b->data, a->dataSize ) != 0 ) return( 0 );
+    return( 1 );
+  }
+  return( 0 );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * list management
+ *
+ ************************************************************/
+
+
+
+static void _UnlinkEntry( _cacheEntry *e )
+{
+  if ( e->prev != (_cacheEntry*)NULL ) e->prev->next = e->next;
+  else _first_ = e->next;
+  if ( e->next != (_cacheEntry*)NULL ) e->next->prev = e->prev;
+  else _last_ = e->prev;
+  e->prev = e->next = (_cacheEntry*)NULL;
+}
+
+
+
+static void _LinkEntryFirst( _cacheEntry *e )
+{
+  e->prev = (_cacheEntry*)NULL;
+  e->next = _first_;
+  if ( _first_ != (_cacheEntry*)NULL ) _first_->prev = e;
+  _first_ = e;
+  if ( _last_ == (_cacheEntry*)NULL ) _last_ = e;
+}
+
+
+
+static void _FreeEntry( _cacheEntry *e )
+{
+  switch ( e->key.item ) {
+  default :
+    break;
+  case _CACHED_IMAGE_ :
+  case _CACHED_SUBSAMPLED_IMAGE_ :
+    BAL_FreeImage( &(e->image) );
+    break;
+  case _CACHED_TRANSFORMATION_ :
+    BAL_FreeTransformation( &(e->trsf) );
+    break;
+  }
+  if ( e->key.name != (char*)NULL ) vtfree( e->key.name );
+  if ( e->key.data != (void*)NULL ) vtfree( e->key.data );
+  vtfree( e );
+}
+
+
+
+static void _RemoveEntry( _cacheEntry *e )
+{
+  _UnlinkEntry( e );
+  _statistics_.entries --;
+  _statistics_.bytes -= e->bytes;
+  _FreeEntry( e );
+}
+
+
+
+static _cacheEntry *_FindEntry( _cacheKey *key )
+{
+  _cacheEntry *e;
+
+  for ( e=_first_; e!=(_cacheEntry*)NULL; e=e->next ) {
+    if ( _SameKey( &(e->key), key ) ) {
+      if ( e != _first_ ) {
+        _UnlinkEntry( e );
+        _LinkEntryFirst( e );
+      }
+      return( e );
+    }
+  }
+  return( (_cacheEntry*)NULL );
+}
+
+
+
+/* removes an older version of the same file,
+ * then the least recently used entries until 'bytes' fits
+ */
+static int _MakeRoom( _cacheKey *key, size_t bytes )
+{
+  _cacheEntry *e, *n;
+
+  if ( bytes > _statistics_.size ) return( -1 );
+
+  if ( key->name != (char*)NULL ) {
+    for ( e=_first_; e!=(_cacheEntry*)NULL; e=n ) {
+      n = e->next;
+      if ( e->key.item == key->item && strcmp( e->key.name, key->name ) == 0
+           && e->key.normalisation == key->normalisation )
+        _RemoveEntry( e );
+    }
+  }
+
+  while ( _last_ != (_cacheEntry*)NULL && _statistics_.bytes + bytes > _statistics_.size ) {
+    _RemoveEntry( _last_ );
+    _statistics_.evictions ++;
+  }
+  return( 1 );
+}
+
+
+
+static void _InsertEntry( _cacheEntry *e )
+{
+  _LinkEntryFirst( e );
+  _statistics_.entries ++;
+  _statistics_.bytes += e->bytes;
+}
+
+
+
+static _cacheEntry *_AllocEntry( _cacheKey *key, char *proc )
+{
+  _cacheEntry *e;
+
+  e = (_cacheEntry*)vtmalloc( sizeof(_cacheEntry), "e", proc );
+  if ( e == (_cacheEntry*)NULL ) return( (_cacheEntry*)NULL );
+  memset( e, 0, sizeof(_cacheEntry) );
+  e->key = *key;
+  e->key.name = (char*)NULL;
+  if ( key->name != (char*)NULL ) {
+    e->key.name = (char*)vtmalloc( strlen(key->name)+1, "e->key.name", proc );
+    if ( e->key.name == (char*)NULL ) {
+      vtfree( e );
+      return( (_cacheEntry*)NULL );
+    }
+    (void)strcpy( e->key.name, key->name );
+  }
+  e->key.data = (void*)NULL;
+  if ( key->data != (void*)NULL ) {
+    e->key.data = vtmalloc( key->dataSize, "e->key.data", proc );
+    if ( e->key.data == (void*)NULL ) {
+      if ( e->key.name != (char*)NULL ) vtfree( e->key.name );
+      vtfree( e );
+      return( (_cacheEntry*)NULL );
+    }
+    (void)memcpy( e->key.data, key->data, key->dataSize );
+  }
+  BAL_InitImage( &(e->image), (char*)NULL, 0, 0, 0, 0, TYPE_UNKNOWN );
+  BAL_InitTransformation( &(e->trsf) );
+  return( e );
+}
+
+
+
+static int _CopyImage( bal_image *theIm, bal_image *resIm, char *name )
+{
+  if ( BAL_AllocImageFromImage( resIm, name, theIm, theIm->type ) != 1 )
+    return( -1 );
+  (void)memcpy( resIm->data, theIm->data, BAL_ImageDataSize( theIm ) );
+  return( 1 );
+}
+
+
+
+static int _CopyTransformation( bal_transformation *theTrsf, bal_transformation *resTrsf )
+{
+  bal_image *ref = (bal_image*)NULL;
+
+  if ( BAL_IsTransformationVectorField( theTrsf ) == 1 )
+    ref = &(theTrsf->vx);
+  if ( BAL_AllocTransformation( resTrsf, theTrsf->type, ref ) != 1 )
+    return( -1 );
+  if ( BAL_CopyTransformation( theTrsf, resTrsf ) != 1 ) {
+    BAL_FreeTransformation( resTrsf );
+    return( -1 );
+  }
+  resTrsf->transformation_unit = theTrsf->transformation_unit;
+  return( 1 );
+}
+
+
+
+static size_t _TransformationBytes( bal_transformation *trsf )
+{
+  size_t bytes = sizeof( bal_transformation ) + 16*sizeof(double);
+
+  if ( BAL_IsTransformationVectorField( trsf ) == 1 ) {
+    bytes += BAL_ImageDataSize( &(trsf->vx) );
+    bytes += BAL_ImageDataSize( &(trsf->vy) );
+    if ( trsf->type == VECTORFIELD_3D )
+      bytes += BAL_ImageDataSize( &(trsf->vz) );
+  }
+  return( bytes );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * management
+ *
+ ************************************************************/
+
+
+
+void BAL_SetCacheSizeInBalCache( size_t size )
+{
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    _statistics_.size = size;
+    while ( _last_ != (_cacheEntry*)NULL && _statistics_.bytes > _statistics_.size ) {
+      _RemoveEntry( _last_ );
+      _statistics_.evictions ++;
+    }
+  }
+}
+
+
+
+size_t BAL_GetCacheSizeInBalCache(  )
+{
+  return( _statistics_.size );
+}
+
+
+
+void BAL_ClearCache(  )
+{
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    while ( _last_ != (_cacheEntry*)NULL )
+      _RemoveEntry( _last_ );
+  }
+}
+
+
+
+void BAL_GetCacheStatistics( bal_cacheStatistics *s )
+{
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    *s = _statistics_;
+  }
+}
+
+
+
+void BAL_ResetCacheStatistics(  )
+{
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    _statistics_.hits = 0;
+    _statistics_.misses = 0;
+    _statistics_.evictions = 0;
+  }
+}
+
+
+
+
+
+/************************************************************
+ *
+ * images
+ *
+ ************************************************************/
+
+
+
+int BAL_GetImageFromCache( bal_image *image, char *name, int normalisation )
+{
+  char *proc = "BAL_GetImageFromCache";
+  _cacheKey key;
+  _cacheEntry *e;
+  int r = 0;
+
+  if ( _statistics_.size == 0 ) return( 0 );
+  if ( _InitFileKey( &key, _CACHED_IMAGE_, name, normalisation ) != 1 ) return( 0 );
+
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    e = _FindEntry( &key );
+    if ( e != (_cacheEntry*)NULL && _CopyImage( &(e->image), image, name ) == 1 ) {
+      _statistics_.hits ++;
+      r = 1;
+    }
+    else {
+      _statistics_.misses ++;
+    }
+  }
+
+  if ( r == 1 && _verbose_ >= 2 )
+    fprintf( stderr, "%s: '%s' found in cache\n", proc, name );
+  return( r );
+}
+
+
+
+void BAL_AddImageToCache( bal_image *image, char *name, int normalisation )
+{
+  char *proc = "BAL_AddImageToCache";
+  _cacheKey key;
+  _cacheEntry *e;
+  size_t bytes;
+
+  if ( _statistics_.size == 0 ) return;
+  if ( _InitFileKey( &key, _CACHED_IMAGE_, name, normalisation ) != 1 ) return;
+  bytes = BAL_ImageDataSize( image );
+  if ( bytes == (size_t)-1 ) return;
+  bytes += sizeof( _cacheEntry );
+
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    if ( _MakeRoom( &key, bytes ) == 1 ) {
+      e = _AllocEntry( &key, proc );
+      if ( e != (_cacheEntry*)NULL ) {
+        if ( _CopyImage( image, &(e->image), e->key.name ) == 1 ) {
+          e->bytes = bytes;
+          _InsertEntry( e );
+        }
+        else {
+          _FreeEntry( e );
+        }
+      }
+    }
+  }
+}
+
+
+
+
+
+void BAL_RemoveImageFromCache( char *name, int normalisation )
+{
+  _cacheKey key;
+  _cacheEntry *e;
+
+  if ( _statistics_.size == 0 ) return;
+  if ( _InitFileKey( &key, _CACHED_IMAGE_, name, normalisation ) != 1 ) return;
+
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    e = _FindEntry( &key );
+    if ( e != (_cacheEntry*)NULL ) _RemoveEntry( e );
+  }
+}
+
+
+
+
+
+/************************************************************
+ *
+ * transformations
+ *
+ ************************************************************/
+
+
+
+int BAL_GetTransformationFromCache( bal_transformation *trsf, char *name )
+{
+  char *proc = "BAL_GetTransformationFromCache";
+  _cacheKey key;
+  _cacheEntry *e;
+  int r = 0;
+
+  if ( _statistics_.size == 0 ) return( 0 );
+  if ( _InitFileKey( &key, _CACHED_TRANSFORMATION_, name, 0 ) != 1 ) return( 0 );
+
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    e = _FindEntry( &key );
+    if ( e != (_cacheEntry*)NULL && _CopyTransformation( &(e->trsf), trsf ) == 1 ) {
+      _statistics_.hits ++;
+      r = 1;
+    }
+    else {
+      _statistics_.misses ++;
+    }
+  }
+
+  if ( r == 1 && _verbose_ >= 2 )
+    fprintf( stderr, "%s: '%s' found in cache\n", proc, name );
+  return( r );
+}
+
+
+
+void BAL_AddTransformationToCache( bal_transformation *trsf, char *name )
+{
+  char *proc = "BAL_AddTransformationToCache";
+  _cacheKey key;
+  _cacheEntry *e;
+  size_t bytes;
+
+  if ( _statistics_.size == 0 ) return;
+  if ( _InitFileKey( &key, _CACHED_TRANSFORMATION_, name, 0 ) != 1 ) return;
+  bytes = _TransformationBytes( trsf ) + sizeof( _cacheEntry );
+
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    if ( _MakeRoom( &key, bytes ) == 1 ) {
+      e = _AllocEntry( &key, proc );
+      if ( e != (_cacheEntry*)NULL ) {
+        if ( _CopyTransformation( trsf, &(e->trsf) ) == 1 ) {
+          e->bytes = bytes;
+          _InsertEntry( e );
+        }
+        else {
+          _FreeEntry( e );
+        }
+      }
+    }
+  }
+}
+
+
+
+
+
+/************************************************************
+ *
+ * subsampled images
+ *
+ ************************************************************/
+
+
+
+int BAL_GetSubsampledImageFromCache( bal_image *resIm,
+                                     int dimx, int dimy, int dimz,
+                                     bal_image *theIm,
+                                     bal_doublePoint *sigma )
+{
+  char *proc = "BAL_GetSubsampledImageFromCache";
+  _cacheKey key;
+  _cacheEntry *e;
+  int r = 0;
+
+  if ( _statistics_.size == 0 ) return( 0 );
+  if ( _InitSubsampledImageKey( &key, dimx, dimy, dimz, theIm, sigma ) != 1 ) return( 0 );
+
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    e = _FindEntry( &key );
+    if ( e != (_cacheEntry*)NULL && _CopyImage( &(e->image), resIm, e->image.name ) == 1 ) {
+      _statistics_.hits ++;
+      r = 1;
+    }
+    else {
+      _statistics_.misses ++;
+    }
+  }
+
+  if ( r == 1 && _verbose_ >= 2 )
+    fprintf( stderr, "%s: %dx%dx%d subsampled image found in cache\n", proc, dimx, dimy, dimz );
+  return( r );
+}
+
+
+
+void BAL_AddSubsampledImageToCache( bal_image *resIm,
+                                    int dimx, int dimy, int dimz,
+                                    bal_image *theIm,
+                                    bal_doublePoint *sigma )
+{
+  char *proc = "BAL_AddSubsampledImageToCache";
+  _cacheKey key;
+  _cacheEntry *e;
+  size_t bytes;
+
+  if ( _statistics_.size == 0 ) return;
+  if ( _InitSubsampledImageKey( &key, dimx, dimy, dimz, theIm, sigma ) != 1 ) return;
+  bytes = BAL_ImageDataSize( resIm );
+  if ( bytes == (size_t)-1 ) return;
+  bytes += key.dataSize + sizeof( _cacheEntry );
+
+#ifdef _OPENMP
+#pragma omp critical (bal_cache)
+#endif
+  {
+    if ( _MakeRoom( &key, bytes ) == 1 ) {
+      e = _AllocEntry( &key, proc );
+      if ( e != (_cacheEntry*)NULL ) {
+        if ( _CopyImage( resIm, &(e->image), resIm->name ) == 1 ) {
+          e->bytes = bytes;
+          _InsertEntry( e );
+        }
+        else {
+          _FreeEntry( e );
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,114 @@
+/*************************************************************************
+ * bal-cache.h -
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026, all rights reserved
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+#ifndef BAL_CACHE_H
+#define BAL_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+#include <bal-stddef.h>
+#include <bal-image.h>
+#include <bal-transformation.h>
+
+
+
+/*****************************************************************
+ *
+ * LRU cache of read images, read transformations and subsampled
+ * (pyramid) images, for long running processes that read the same
+ * files again and again (see blockmatchingServer).
+ *
+ * The cache is empty and disabled (size 0) by default, so that
+ * command line tools behave as before.
+ *
+ * Read files are identified by their name, device, inode, size
+ * and modification time: a rewritten file is read again. Names
+ * that are not regular files (eg 'shm://', '-') are not cached.
+ * Subsampled images are identified by the contents and the
+ * geometry of the subsampled image and by the filtering. A copy
+ * of the subsampled image contents is kept with each entry, and
+ * compared on a hit (the hash only selects the candidates).
+ *
+ * Cached items are copied in and out, the caller keeps the
+ * ownership of its structures.
+ *
+ *****************************************************************/
+
+
+
+extern int BAL_GetVerboseInBalCache(  );
+extern void BAL_SetVerboseInBalCache( int v );
+extern void BAL_IncrementVerboseInBalCache(  );
+extern void BAL_DecrementVerboseInBalCache(  );
+
+
+
+typedef struct {
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+  size_t entries;
+  size_t bytes;
+  size_t size;
+} bal_cacheStatistics;
+
+
+
+/* size in bytes, 0 disables (and empties) the cache
+ */
+extern void BAL_SetCacheSizeInBalCache( size_t size );
+extern size_t BAL_GetCacheSizeInBalCache(  );
+
+extern void BAL_ClearCache(  );
+extern void BAL_GetCacheStatistics( bal_cacheStatistics *s );
+extern void BAL_ResetCacheStatistics(  );
+
+
+
+/* 'Get' functions return 1 and fill (allocate) the structure
+ * if the item is in the cache, 0 else.
+ */
+
+extern int BAL_GetImageFromCache( bal_image *image, char *name, int normalisation );
+extern void BAL_AddImageToCache( bal_image *image, char *name, int normalisation );
+extern void BAL_RemoveImageFromCache( char *name, int normalisation );
+
+extern int BAL_GetTransformationFromCache( bal_transformation *trsf, char *name );
+extern void BAL_AddTransformationToCache( bal_transformation *trsf, char *name );
+
+/* 'sigma' is NULL when the image is not filtered before subsampling
+ */
+extern int BAL_GetSubsampledImageFromCache( bal_image *resIm,
+                                            int dimx, int dimy, int dimz,
+                                            bal_image *theIm,
+                                            bal_doublePoint *sigma );
+extern void BAL_AddSubsampledImageToCache( bal_image *resIm,
+                                           int dimx, int dimy, int dimz,
+                                           bal_image *theIm,
+                                           bal_doublePoint *sigma );
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
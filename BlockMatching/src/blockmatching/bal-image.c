@@ -22,20 +22,35 @@
 
 
 
+/* MAP_ANONYMOUS
+ */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 
 
 
 #include <ImageIO.h>
+#include <chunked.h>
+#ifdef _LIBLIBTIFF_
+#include <tif.h>
+#endif
 
+#include <chunks.h>
 #include <convert.h>
 #include <linearFiltering.h>
 #include <vtmalloc.h>
 
 #include <bal-image.h>
+#include <bal-cache.h>
 
 
 static int _verbose_ = 1;
@@ -475,14 +490,192 @@ int BAL_InitScalarImageFromImage( bal_image *image, char *name,
 
 
 
-void BAL_FreeImage( bal_image *image )
+/* data of read images that are mapped files (see _mapImageData())
+ * are not copied, they are borrowed from the libio image: the
+ * mapping is then owned by the bal_image, and is released by
+ * BAL_FreeImage()
+ */
+
+#define _MAX_MAPPED_DATA_ 64
+
+typedef struct {
+  void *data;
+  void *address;
+  size_t length;
+  /* mapped file, to detach the data before the file is re-written
+   */
+  char *name;
+  int isfile;
+  dev_t dev;
+  ino_t ino;
+} _mappedData;
+
+static _mappedData _mapped_data_[_MAX_MAPPED_DATA_];
+
+
+
+static int _IsMappedFile( _mappedData *m, char *name, struct stat *st )
 {
-  char *proc = "BAL_FreeImage";
+  if ( m->data == NULL || m->name == NULL ) return( 0 );
+  if ( strcmp( m->name, name ) == 0 ) return( 1 );
+  if ( st != (struct stat*)NULL && m->isfile
+       && m->dev == st->st_dev && m->ino == st->st_ino ) return( 1 );
+  return( 0 );
+}
+
+
+
+/* return 1 if the data of 'theIm' are now owned by 'image',
+ * 0 if they have to be copied
+ */
+static int _BAL_BorrowMappedData( bal_image *image, _image *theIm, char *name )
+{
+  char *proc = "_BAL_BorrowMappedData";
+  struct stat st;
+  int i, n = -1;
+
+  if ( theIm->mapAddress == NULL || theIm->data == NULL ) return( 0 );
+  if ( (char*)theIm->data < (char*)theIm->mapAddress
+       || (char*)theIm->data >= (char*)theIm->mapAddress + theIm->mapLength )
+    return( 0 );
+
+#ifdef _OPENMP
+#pragma omp critical (bal_mapped_data)
+#endif
+  {
+    for ( i=0; i<_MAX_MAPPED_DATA_ && n < 0; i++ ) {
+      if ( _mapped_data_[i].data != NULL ) continue;
+      _mapped_data_[i].name = (char*)vtmalloc( strlen(name)+1, "_mapped_data_[i].name", proc );
+      if ( _mapped_data_[i].name == (char*)NULL ) break;
+      (void)strcpy( _mapped_data_[i].name, name );
+      _mapped_data_[i].isfile = 0;
+      if ( stat( name, &st ) == 0 ) {
+        _mapped_data_[i].isfile = 1;
+        _mapped_data_[i].dev = st.st_dev;
+        _mapped_data_[i].ino = st.st_ino;
+      }
+      _mapped_data_[i].data = theIm->data;
+      _mapped_data_[i].address = theIm->mapAddress;
+      _mapped_data_[i].length = theIm->mapLength;
+      n = i;
+    }
+  }
+
+  if ( n < 0 ) {
+    if ( _debug_ )
+      fprintf( stderr, "%s: data of '%s' will be copied\n", proc, name );
+    return( 0 );
+  }
+
+  image->data = theIm->data;
+  theIm->data = NULL;
+  theIm->mapAddress = NULL;
+  theIm->mapLength = 0;
+
+  return( 1 );
+}
+
+
+
+/* return 1 if 'data' was a borrowed mapping (that is released), 0 else
+ */
+static int _BAL_ReleaseMappedData( void *data )
+{
+  int i, r = 0;
+
+#ifdef _OPENMP
+#pragma omp critical (bal_mapped_data)
+#endif
+  {
+    for ( i=0; i<_MAX_MAPPED_DATA_ && r == 0; i++ ) {
+      if ( _mapped_data_[i].data != data ) continue;
+#ifndef WIN32
+      (void)munmap( _mapped_data_[i].address, _mapped_data_[i].length );
+#endif
+      if ( _mapped_data_[i].name != (char*)NULL ) vtfree( _mapped_data_[i].name );
+      _mapped_data_[i].name = (char*)NULL;
+      _mapped_data_[i].data = NULL;
+      _mapped_data_[i].address = NULL;
+      _mapped_data_[i].length = 0;
+      r = 1;
+    }
+  }
+  return( r );
+}
+
+
+
+/* the file 'name' is about to be (re-)written: the borrowed mappings
+ * of this file are replaced, at the same address, by anonymous
+ * copies (pages of a truncated file can not be accessed anymore)
+ */
+static int _BAL_DetachMappedData( char *name )
+{
+  char *proc = "_BAL_DetachMappedData";
+  struct stat st, *pst = (struct stat*)NULL;
+  int i, r = 1;
+#ifndef WIN32
+  void *buf, *addr;
+#endif
+
+  if ( name == (char*)NULL ) return( 1 );
+  if ( stat( name, &st ) == 0 ) pst = &st;
+
+#ifdef _OPENMP
+#pragma omp critical (bal_mapped_data)
+#endif
+  {
+    for ( i=0; i<_MAX_MAPPED_DATA_; i++ ) {
+      if ( _IsMappedFile( &(_mapped_data_[i]), name, pst ) == 0 ) continue;
+#ifndef WIN32
+      buf = vtmalloc( _mapped_data_[i].length, "buf", proc );
+      if ( buf == NULL ) {
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to allocate copy of '%s'\n", proc, name );
+        r = -1;
+        continue;
+      }
+      (void)memcpy( buf, _mapped_data_[i].address, _mapped_data_[i].length );
+      addr = mmap( _mapped_data_[i].address, _mapped_data_[i].length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 );
+      if ( addr == MAP_FAILED ) {
+        vtfree( buf );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to detach data from '%s'\n", proc, name );
+        r = -1;
+        continue;
+      }
+      (void)memcpy( _mapped_data_[i].address, buf, _mapped_data_[i].length );
+      vtfree( buf );
+#endif
+      vtfree( _mapped_data_[i].name );
+      _mapped_data_[i].name = (char*)NULL;
+      _mapped_data_[i].isfile = 0;
+    }
+  }
+  return( r );
+}
 
+
+
+void BAL_FreeImageData( bal_image *image )
+{
   if ( image->array != NULL ) vtfree( image->array );
   image->array = NULL;
-  if ( image->data != NULL ) vtfree( image->data );
+  if ( image->data != NULL ) {
+    if ( _BAL_ReleaseMappedData( image->data ) == 0 )
+      vtfree( image->data );
+  }
   image->data = NULL;
+}
+
+
+
+void BAL_FreeImage( bal_image *image )
+{
+  char *proc = "BAL_FreeImage";
+
+  BAL_FreeImageData( image );
   if ( image->name != NULL ) vtfree( image->name );
   image->name = NULL;
 
@@ -1508,38 +1701,20 @@ void BAL_PrintParImage( FILE *f, bal_image *image, char *s )
 
 
 
-int BAL_ReadImage( bal_image *image, char *name, int normalisation )
+/* translation of a libio image (header and data, if any)
+ */
+static int _BAL_ConvertImageIOImage( bal_image *image, _image *theIm, char *name, int normalisation )
 {
-  char *proc = "BAL_ReadImage";
-  _image *theIm;
+  char *proc = "_BAL_ConvertImageIOImage";
   bufferType type=UCHAR;
   size_t size;
   int i, j, k;
-  
-  if ( _verbose_ >= 2 ) 
-    fprintf( stderr, "%s: will read '%s'\n", proc, name );
-
 
-  if ( name == (char*) NULL ) {
-    if ( _verbose_ )
-      fprintf( stderr, "%s: no image name\n", proc );
-    return( -1 );
-  }
-
-  theIm = _readImage( name );
-  if ( theIm == NULL ) {
-    if ( _verbose_ )
-      fprintf( stderr, "%s: unable to read '%s'\n", proc, name );
-    return( -1 );
-  }
-
-  
   switch( theIm->wordKind ) {
 
   default :
     if ( _verbose_ )
       fprintf( stderr, "%s: such word kind not handled yet\n", proc );
-    _freeImage( theIm );
     return( -1 );
 
   case WK_FLOAT :
@@ -1547,7 +1722,6 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
     default :
       if ( _verbose_ )
         fprintf( stderr, "%s: such float word dim not handled yet\n", proc );
-      _freeImage( theIm );
       return( -1 );
     case 4 :
       type = FLOAT;
@@ -1563,14 +1737,12 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
     default :
       if ( _verbose_ )
         fprintf( stderr, "%s: such sign not handled yet\n", proc );
-      _freeImage( theIm );
       return( -1 );
     case SGN_SIGNED :
       switch( theIm->wdim ) {
       default :
         if ( _verbose_ )
           fprintf( stderr, "%s: such signed word dim not handled yet\n", proc );
-        _freeImage( theIm );
         return( -1 );
       case 1 :
         type = SCHAR;
@@ -1588,7 +1760,6 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
       default :
         if ( _verbose_ )
           fprintf( stderr, "%s: such unsigned word dim not handled yet\n", proc );
-        _freeImage( theIm );
         return( -1 );
       case 1 :
         type = UCHAR;
@@ -1607,7 +1778,19 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
 
 
   
-  if ( normalisation && type != UCHAR ) {
+  /* header only
+   */
+  if ( theIm->data == NULL ) {
+
+    if ( BAL_InitImage( image, name, theIm->xdim, theIm->ydim,
+                        theIm->zdim, theIm->vdim, type ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to initialize image '%s'\n", proc, name );
+      return( -1 );
+    }
+
+  }
+  else if ( normalisation && type != UCHAR ) {
 
     if ( _verbose_ ) {
       fprintf( stderr, "%s: normalization of image '%s' into unsigned char\n", proc, name );
@@ -1617,14 +1800,12 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
                         theIm->zdim, theIm->vdim, UCHAR ) != 1 ) {
       if ( _verbose_ )
         fprintf( stderr, "%s: unable to initialize image '%s'\n", proc, name );
-      _freeImage( theIm );
       return( -1 );
     }
 
     if ( BAL_AllocImage( image ) != 1 ) {
       if ( _verbose_ )
         fprintf( stderr, "%s: unable to allocate image '%s'\n", proc, name );
-      _freeImage( theIm );
       return( -1 );
     }
     
@@ -1633,7 +1814,6 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
                              theIm->xdim * theIm->ydim * theIm->zdim * theIm->vdim ) != 1 ) {
       if ( _verbose_ )
         fprintf( stderr, "%s: unable to convert image '%s'\n", proc, name );
-      _freeImage( theIm );
       return( -1 );
     }
 
@@ -1644,32 +1824,42 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
                         theIm->zdim, theIm->vdim, type ) != 1 ) {
       if ( _verbose_ )
         fprintf( stderr, "%s: unable to initialize image '%s'\n", proc, name );
-      _freeImage( theIm );
       return( -1 );
     }
 
-    if ( BAL_AllocImage( image ) != 1 ) {
-      if ( _verbose_ )
-        fprintf( stderr, "%s: unable to allocate image '%s'\n", proc, name );
-      _freeImage( theIm );
-      return( -1 );
-    }
+    if ( _BAL_BorrowMappedData( image, theIm, name ) == 1 ) {
+
+      if ( BAL_AllocArrayImage( image ) != 1 ) {
+        BAL_FreeImage( image );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to build array of image '%s'\n", proc, name );
+        return( -1 );
+      }
 
-    size = BAL_ImageDataSize( image );
-    if ( size <= 0 ) {
-      if ( _verbose_ )
-        fprintf( stderr, "%s: can not copy raw data of '%s'\n", proc, name );
-      _freeImage( theIm );
-      return( -1 );
     }
+    else {
+
+      if ( BAL_AllocImage( image ) != 1 ) {
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to allocate image '%s'\n", proc, name );
+        return( -1 );
+      }
+
+      size = BAL_ImageDataSize( image );
+      if ( size <= 0 ) {
+        if ( _verbose_ )
+          fprintf( stderr, "%s: can not copy raw data of '%s'\n", proc, name );
+        return( -1 );
+      }
 
-    (void)memcpy( image->data, theIm->data, size );
+      (void)memcpy( image->data, theIm->data, size );
+
+    }
 
   }
 
   if ( BAL_AllocImageGeometry( image ) != 1 ) {
     BAL_FreeImage( image );
-    _freeImage( theIm );
     if ( _verbose_ )
       fprintf( stderr, "%s: can not set initialize geometry of '%s'\n", proc, name );
     return( -1 );
@@ -1688,7 +1878,6 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
     image->geometry = _BAL_QFORM_GEOMETRY_;
     if ( InverseMat4x4( image->to_real.m, image->to_voxel.m ) != 4 ) {
       BAL_FreeImage( image );
-      _freeImage( theIm );
       if ( _verbose_ )
         fprintf( stderr, "%s: unable to invert qform matrix of '%s'\n", proc, name );
       return( -1 );
@@ -1720,13 +1909,276 @@ int BAL_ReadImage( bal_image *image, char *name, int normalisation )
     image->sform_to_real.m[k] = theIm->sform_toreal[i][j];
 
 
+  return( 1 );
+}
+
+
+
+void BAL_SetMemoryMappingInBalImage( int m )
+{
+  _SetMemoryMappingInImageIO( m );
+}
+
+int BAL_GetMemoryMappingInBalImage( )
+{
+  return( _GetMemoryMappingInImageIO() );
+}
+
+
+
+void BAL_SetBgzfWritingInBalImage( int b )
+{
+  _SetBgzfWritingInImageIO( b );
+}
+
+int BAL_GetBgzfWritingInBalImage( )
+{
+  return( _GetBgzfWritingInImageIO() );
+}
+
+
+
+/* TIFF writing parameters, they are ignored
+ * if libtiff is not available
+ */
+int BAL_SetTiffCompressionInBalImage( char *str )
+{
+  char *proc = "BAL_SetTiffCompressionInBalImage";
+  int c;
+
+  /* COMPRESSION_* values of tiff.h
+   */
+  if ( strcmp( str, "none" ) == 0 ) c = 1;
+  else if ( strcmp( str, "lzw" ) == 0 ) c = 5;
+  else if ( strcmp( str, "deflate" ) == 0 ) c = 8;
+  else if ( strcmp( str, "packbits" ) == 0 ) c = 32773;
+  else {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unknown compression '%s'\n", proc, str );
+    return( -1 );
+  }
+#ifdef _LIBLIBTIFF_
+  _SetTiffCompressionInImageIO( c );
+#else
+  if ( _verbose_ >= 2 )
+    fprintf( stderr, "%s: libtiff not available, compression %d ignored\n", proc, c );
+#endif
+  return( 1 );
+}
+
+void BAL_SetTiffStripSizeInBalImage( size_t s )
+{
+#ifdef _LIBLIBTIFF_
+  _SetTiffStripSizeInImageIO( s );
+#else
+  (void)s;
+#endif
+}
+
+void BAL_SetBigTiffWritingInBalImage( int b )
+{
+#ifdef _LIBLIBTIFF_
+  _SetBigTiffWritingInImageIO( b );
+#else
+  (void)b;
+#endif
+}
+
+
+
+void BAL_SetSharedMemoryUnlinkInBalImage( int u )
+{
+  _SetSharedMemoryUnlinkInImageIO( u );
+}
+
+int BAL_GetSharedMemoryUnlinkInBalImage( )
+{
+  return( _GetSharedMemoryUnlinkInImageIO() );
+}
+
+
+
+/* chunked (Zarr, N5) writing parameters
+ */
+void BAL_SetChunkSizeInBalImage( int x, int y, int z )
+{
+  _SetChunkSizeInImageIO( x, y, z );
+}
+
+void BAL_SetChunkCompressionInBalImage( int level )
+{
+  _SetChunkCompressionInImageIO( level );
+}
+
+
+
+/* the parallel readers and writers of libio (TIFF pages,
+ * BGZF members) follow the parallelism parameters
+ */
+static void _BAL_SetImageIOParallelism( )
+{
+  if ( getParallelism() == _NO_PARALLELISM_ )
+    _SetMaxThreadsInImageIO( 1 );
+  else if ( getMaxChunks() > 0 )
+    _SetMaxThreadsInImageIO( getMaxChunks() );
+  else
+    _SetMaxThreadsInImageIO( 0 );
+}
+
+
+
+int BAL_ReadImage( bal_image *image, char *name, int normalisation )
+{
+  char *proc = "BAL_ReadImage";
+  _image *theIm;
+  
+  if ( _verbose_ >= 2 ) 
+    fprintf( stderr, "%s: will read '%s'\n", proc, name );
+
+
+  if ( name == (char*) NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: no image name\n", proc );
+    return( -1 );
+  }
+
+  if ( BAL_GetImageFromCache( image, name, normalisation ) == 1 )
+    return( 1 );
+
+  _BAL_SetImageIOParallelism( );
+  theIm = _readImage( name );
+  if ( theIm == NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  if ( _BAL_ConvertImageIOImage( image, theIm, name, normalisation ) != 1 ) {
+    _freeImage( theIm );
+    return( -1 );
+  }
+
   _freeImage( theIm );
+
+  BAL_AddImageToCache( image, name, normalisation );
   
   return( 1 );
 }
 
 
 
+int BAL_ReadImageHeader( bal_image *image, char *name )
+{
+  char *proc = "BAL_ReadImageHeader";
+  _image *theIm;
+
+  if ( name == (char*) NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: no image name\n", proc );
+    return( -1 );
+  }
+
+  theIm = _readImageRegion( name, (size_t*)NULL, (size_t*)NULL );
+  if ( theIm == NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read header of '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  if ( _BAL_ConvertImageIOImage( image, theIm, name, 0 ) != 1 ) {
+    _freeImage( theIm );
+    return( -1 );
+  }
+
+  _freeImage( theIm );
+  return( 1 );
+}
+
+
+
+int BAL_ReadImageRegion( bal_image *image, char *name,
+                         bal_integerPoint *corner, bal_integerPoint *dim )
+{
+  char *proc = "BAL_ReadImageRegion";
+  _image *theIm;
+  size_t first[3];
+  size_t d[3];
+
+  if ( name == (char*) NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: no image name\n", proc );
+    return( -1 );
+  }
+
+  if ( corner->x < 0 || corner->y < 0 || corner->z < 0
+       || dim->x <= 0 || dim->y <= 0 || dim->z <= 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid region %d x %d x %d at (%d,%d,%d)\n",
+               proc, dim->x, dim->y, dim->z, corner->x, corner->y, corner->z );
+    return( -1 );
+  }
+
+  first[0] = corner->x;
+  first[1] = corner->y;
+  first[2] = corner->z;
+  d[0] = dim->x;
+  d[1] = dim->y;
+  d[2] = dim->z;
+
+  if ( _verbose_ >= 2 )
+    fprintf( stderr, "%s: will read region %lu x %lu x %lu at (%lu,%lu,%lu) of '%s'\n",
+             proc, d[0], d[1], d[2], first[0], first[1], first[2], name );
+
+  _BAL_SetImageIOParallelism( );
+  theIm = _readImageRegion( name, first, d );
+  if ( theIm == NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read region of '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  if ( _BAL_ConvertImageIOImage( image, theIm, name, 0 ) != 1 ) {
+    _freeImage( theIm );
+    return( -1 );
+  }
+
+  _freeImage( theIm );
+  return( 1 );
+}
+
+
+
+static int _BAL_SetImageWordType( _image *theIm, bufferType type )
+{
+  switch( type ) {
+  default :
+    return( -1 );
+  case UCHAR :
+    theIm->wdim = 1;
+    theIm->wordKind = WK_FIXED;
+    theIm->sign = SGN_UNSIGNED;
+    break;
+  case USHORT :
+    theIm->wdim = 2;
+    theIm->wordKind = WK_FIXED;
+    theIm->sign = SGN_UNSIGNED;
+    break;
+  case SSHORT :
+    theIm->wdim = 2;
+    theIm->wordKind = WK_FIXED;
+    theIm->sign = SGN_SIGNED;
+    break;
+  case FLOAT :
+    theIm->wdim = sizeof( float );
+    theIm->wordKind = WK_FLOAT;
+    theIm->sign = SGN_UNKNOWN;
+    break;
+  }
+  return( 1 );
+}
+
+
+
 int BAL_WriteImage( bal_image *image, char *name )
 {
   char *proc = "BAL_WriteImage";
@@ -1786,36 +2238,23 @@ int BAL_WriteImage( bal_image *image, char *name )
     }
   }
 
-  switch( image->type ) {
-  default :
+  if ( _BAL_SetImageWordType( theIm, image->type ) != 1 ) {
     if ( _verbose_ )
       fprintf( stderr, "%s: such type not handled yet\n", proc );
     _freeImage( theIm );
     return( -1 );
-  case UCHAR :
-    theIm->wdim = 1;
-    theIm->wordKind = WK_FIXED;
-    theIm->sign = SGN_UNSIGNED;
-    break;
-  case USHORT :
-    theIm->wdim = 2;
-    theIm->wordKind = WK_FIXED;
-    theIm->sign = SGN_UNSIGNED;
-    break;
-  case SSHORT :
-    theIm->wdim = 2;
-    theIm->wordKind = WK_FIXED;
-    theIm->sign = SGN_SIGNED;
-    break;
-  case FLOAT :
-    theIm->wdim = sizeof( float );
-    theIm->wordKind = WK_FLOAT;
-    theIm->sign = SGN_UNKNOWN;
-    break;
   }
   
+  if ( _BAL_DetachMappedData( name ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to detach data mapped from '%s'\n", proc, name );
+    _freeImage( theIm );
+    return( -1 );
+  }
+
   theIm->data = image->data;
 
+  _BAL_SetImageIOParallelism( );
   if ( _writeImage( theIm, name ) != 0 ) {
     if ( _verbose_ )
       fprintf( stderr, "%s: unable to write '%s'\n", proc, name );
@@ -1831,6 +2270,109 @@ int BAL_WriteImage( bal_image *image, char *name )
 
 
 
+/* pyramid levels stored in the image file (see _readImagePyramidLevel())
+ */
+
+static _image *_BAL_PyramidLevelImage( bal_image *image, bal_doublePoint *sigma, float *s,
+                                       int normalisation, int *info )
+{
+  _image *theIm;
+
+  if ( image->data == (void*)NULL ) return( (_image*)NULL );
+
+  theIm = _initImage();
+  if ( theIm == NULL ) return( (_image*)NULL );
+
+  theIm->xdim = image->ncols;
+  theIm->ydim = image->nrows;
+  theIm->zdim = image->nplanes;
+  theIm->vdim = image->vdim;
+
+  if ( _BAL_SetImageWordType( theIm, image->type ) != 1 ) {
+    _freeImage( theIm );
+    return( (_image*)NULL );
+  }
+
+  theIm->data = image->data;
+
+  s[0] = s[1] = s[2] = 0.0;
+  if ( sigma != (bal_doublePoint*)NULL ) {
+    s[0] = sigma->x;
+    s[1] = sigma->y;
+    s[2] = sigma->z;
+  }
+
+  /* levels are computed with the current filter type
+   */
+  info[0] = (int)BAL_GetFilterType();
+  info[1] = normalisation;
+
+  return( theIm );
+}
+
+
+
+int BAL_ReadImagePyramidLevel( bal_image *image, char *name, bal_doublePoint *sigma,
+                                int normalisation )
+{
+  char *proc = "BAL_ReadImagePyramidLevel";
+  _image *theIm;
+  float s[3];
+  int info[2];
+  int r;
+
+  if ( name == (char*)NULL ) return( 0 );
+
+  theIm = _BAL_PyramidLevelImage( image, sigma, s, normalisation, info );
+  if ( theIm == NULL ) return( 0 );
+
+  r = _readImagePyramidLevel( name, theIm, s, info );
+  if ( r < 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: error when reading level in '%s'\n", proc, name );
+    r = -1;
+  }
+  else if ( r == 1 ) {
+    if ( _verbose_ >= 2 )
+      fprintf( stderr, "%s: %lu x %lu x %lu level read from '%s'\n", proc,
+               image->ncols, image->nrows, image->nplanes, name );
+  }
+
+  theIm->data = NULL;
+  _freeImage( theIm );
+  return( r );
+}
+
+
+
+int BAL_WriteImagePyramidLevel( bal_image *image, char *name, bal_doublePoint *sigma,
+                                 int normalisation )
+{
+  char *proc = "BAL_WriteImagePyramidLevel";
+  _image *theIm;
+  float s[3];
+  int info[2];
+  int r;
+
+  if ( name == (char*)NULL ) return( 0 );
+
+  theIm = _BAL_PyramidLevelImage( image, sigma, s, normalisation, info );
+  if ( theIm == NULL ) return( 0 );
+
+  r = _writeImagePyramidLevel( name, theIm, s, info );
+  if ( r < 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to write level in '%s'\n", proc, name );
+    r = -1;
+  }
+
+  theIm->data = NULL;
+  _freeImage( theIm );
+  return( r );
+}
+
+
+
 
 
 
@@ -1851,6 +2393,11 @@ void BAL_SetFilterType( filterType filter )
   theFilter = filter;
 }
 
+filterType BAL_GetFilterType( )
+{
+  return( theFilter );
+}
+
 
 
 int BAL_SmoothImage( bal_image *theIm,
@@ -162,6 +162,11 @@ extern int BAL_InitScalarImageFromImage( bal_image *image, char *name,
 
 extern void BAL_FreeImage( bal_image *image );
 
+/* free the data buffer and the array pointer only
+ * (the data may be a mapping, see BAL_SetMemoryMappingInBalImage())
+ */
+extern void BAL_FreeImageData( bal_image *image );
+
 /* allocate and fill the array pointer
  * to be used when the data buffer already exists
  */
@@ -231,13 +236,74 @@ extern double BAL_GetXYKvalue( bal_image *image, double x, double y, int k );
 extern void BAL_PrintImage( FILE *f, bal_image *image, char *s );
 extern void BAL_PrintParImage( FILE *f, bal_image *image, char *s );
 
+/* memory mapping of the read data (see _SetMemoryMappingInImageIO()):
+   when enabled, the data of uncompressed files are not copied,
+   the image owns the mapping that is released by BAL_FreeImage().
+   Shared memory images are always mapped.
+ */
+extern void BAL_SetMemoryMappingInBalImage( int m );
+extern int BAL_GetMemoryMappingInBalImage( );
+
+/* gzipped images (.gz) are written as BGZF files, compressed in
+   parallel (see _SetBgzfWritingInImageIO())
+ */
+extern void BAL_SetBgzfWritingInBalImage( int b );
+extern int BAL_GetBgzfWritingInBalImage( );
+
+/* TIFF writing: compression ("none", "lzw", "deflate" or "packbits"),
+   strip size in bytes (0 is the libtiff default) and BigTIFF writing
+   (BigTIFF is always used for images larger than 3 GB),
+   see _SetTiffCompressionInImageIO()
+ */
+extern int BAL_SetTiffCompressionInBalImage( char *str );
+extern void BAL_SetTiffStripSizeInBalImage( size_t s );
+extern void BAL_SetBigTiffWritingInBalImage( int b );
+
+/* shared memory images (shm://name) are removed once read
+   (see _SetSharedMemoryUnlinkInImageIO())
+ */
+extern void BAL_SetSharedMemoryUnlinkInBalImage( int u );
+extern int BAL_GetSharedMemoryUnlinkInBalImage( );
+
+/* chunked (.zarr, .n5) writing: chunk dimensions and compression
+   level (0 for raw chunks), see _SetChunkSizeInImageIO()
+ */
+extern void BAL_SetChunkSizeInBalImage( int x, int y, int z );
+extern void BAL_SetChunkCompressionInBalImage( int level );
+
 extern int BAL_ReadImage ( bal_image *image, char *name, int normalisation );
 extern int BAL_WriteImage( bal_image *image, char *name );
 
+/* reads only the header (the image is not allocated), or
+   the region of size 'dim' whose first voxel is 'corner'
+   (only the data of the region are read when the format
+   allows it, see _readImageRegion()). The geometry is the
+   one of the region.
+ */
+extern int BAL_ReadImageHeader( bal_image *image, char *name );
+extern int BAL_ReadImageRegion( bal_image *image, char *name,
+                                bal_integerPoint *corner, bal_integerPoint *dim );
+
+/* pyramid levels stored in the image file (KLB files only):
+   'image' is allocated with the expected dimensions and type.
+   'sigma' is the gaussian filtering (in voxels of the full resolution
+   image) applied before subsampling, NULL means no filtering.
+   The filter type (see BAL_SetFilterType()) and 'normalisation' (the
+   full resolution image has been normalized on one byte) are stored
+   with the level, a stored level is read only if they match.
+   Return 1 if a level has been read (written), 0 if there is none
+   (the format can not store levels), -1 in case of error.
+ */
+extern int BAL_ReadImagePyramidLevel( bal_image *image, char *name, bal_doublePoint *sigma,
+                                      int normalisation );
+extern int BAL_WriteImagePyramidLevel( bal_image *image, char *name, bal_doublePoint *sigma,
+                                       int normalisation );
+
 
 /* filtering
  */
 extern void BAL_SetFilterType( filterType filter );
+extern filterType BAL_GetFilterType( );
 extern int BAL_SmoothImage( bal_image *theIm,
                             bal_doublePoint *theSigma );
 extern int BAL_SmoothImageIntoImage( bal_image *theIm, bal_image *resIm,
@@ -31,6 +31,7 @@
 
 #include <bal-transformation-tools.h>
 #include <bal-pyramid.h>
+#include <bal-cache.h>
 
 static int _verbose_ = 1;
 static int _debug_ = 0;
@@ -38,6 +39,13 @@ static int _debug_ = 0;
 
 static int MAXIMAL_DIMENSION = 32;
 
+/* pyramid levels stored in the image file (see BAL_ReadImagePyramidLevel())
+ * 0: they are ignored
+ * 1: a stored level is used instead of being computed
+ * 2: idem, and the computed levels are stored in the image file
+ */
+static int _stored_pyramid_levels_ = 1;
+
 
 
 
@@ -438,21 +446,26 @@ void _PrintPyramidLevel( FILE *f, bal_pyramid_level *p, int print_params )
  *
  ******************************************************************************/
 
-int BAL_AllocComputeSubsampledImage( bal_image *resIm,
-                      int dimx, int dimy, int dimz,
-                      bal_image *theIm,
-                      bal_pyramid_level *p,
-                      int pyramid_gaussian_filtering )
+void BAL_SetStoredPyramidLevelsInBalPyramid( int s )
 {
-  char *proc = "BAL_PyramidImage";
+  _stored_pyramid_levels_ = s;
+}
+
+int BAL_GetStoredPyramidLevelsInBalPyramid( )
+{
+  return( _stored_pyramid_levels_ );
+}
+
+
+
+static int _AllocSubsampledImage( bal_image *resIm,
+                                  int dimx, int dimy, int dimz,
+                                  bal_image *theIm )
+{
+  char *proc = "_AllocSubsampledImage";
   double theCtr[3], theTrsfedCtr[3];
   double resCtr[3], resTrsfedCtr[3];
 
-  int tmpIsAllocated = 0;
-  bal_image tmpIm;
-  bal_image *ptrIm = (bal_image*)NULL;
-  bal_transformation identity;
-
 
 
   /***********************************************
@@ -588,6 +601,38 @@ int BAL_AllocComputeSubsampledImage( bal_image *resIm,
     return( -1 );
   }
 
+  return( 1 );
+}
+
+
+
+int BAL_AllocComputeSubsampledImage( bal_image *resIm,
+                      int dimx, int dimy, int dimz,
+                      bal_image *theIm,
+                      bal_pyramid_level *p,
+                      int pyramid_gaussian_filtering )
+{
+  char *proc = "BAL_PyramidImage";
+
+  int tmpIsAllocated = 0;
+  bal_image tmpIm;
+  bal_image *ptrIm = (bal_image*)NULL;
+  bal_transformation identity;
+  bal_doublePoint *sigma = (bal_doublePoint*)NULL;
+
+
+
+  if ( p != (bal_pyramid_level*)NULL && pyramid_gaussian_filtering )
+    sigma = &(p->sigma);
+  if ( BAL_GetSubsampledImageFromCache( resIm, dimx, dimy, dimz, theIm, sigma ) == 1 )
+    return( 1 );
+
+  if ( _AllocSubsampledImage( resIm, dimx, dimy, dimz, theIm ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate result image\n", proc  );
+    return( -1 );
+  }
+
 
 
   /***********************************************
@@ -643,6 +688,8 @@ int BAL_AllocComputeSubsampledImage( bal_image *resIm,
   BAL_FreeTransformation( &identity );
   if ( tmpIsAllocated ) BAL_FreeImage( &tmpIm );
 
+  BAL_AddSubsampledImageToCache( resIm, dimx, dimy, dimz, theIm, sigma );
+
   return( 1 );
 }
 
@@ -664,7 +711,8 @@ int BAL_BuildPyramidImage( bal_image *theIm,
                            stringList *image_names,
                            int pyramid_lowest_level,
                            int pyramid_highest_level,
-                           int pyramid_gaussian_filtering )
+                           int pyramid_gaussian_filtering,
+                           int normalisation )
 {
   char * proc = "BAL_BuildPyramidImage";
   int m;
@@ -676,6 +724,8 @@ int BAL_BuildPyramidImage( bal_image *theIm,
   bal_blockmatching_pyramidal_param p;
   char *name;
   int maximal_dimension = MAXIMAL_DIMENSION;
+  int stored;
+  bal_doublePoint *sigma;
 
 
   MAXIMAL_DIMENSION = 16;
@@ -768,16 +818,49 @@ int BAL_BuildPyramidImage( bal_image *theIm,
     }
 
     /* image allocation and computation
+     * the level may have been stored in the image file,
+     * with the same filtering (sigma, filter type) and normalisation
      */
-    if ( BAL_AllocComputeSubsampledImage( &resIm, pyramid_level[l].ncols,
-                                          pyramid_level[l].nrows, pyramid_level[l].nplanes,
-                                          theIm,
-                                          &(pyramid_level[l]), pyramid_gaussian_filtering ) != 1 ) {
-      BAL_FreeImage( &resIm );
-      if ( _verbose_ )
-        fprintf( stderr, "%s: unable to allocate image at level %d\n", proc, l );
-      MAXIMAL_DIMENSION = maximal_dimension;
-      return( -1 );
+    stored = 0;
+    sigma = ( pyramid_gaussian_filtering ) ? &(pyramid_level[l].sigma) : (bal_doublePoint*)NULL;
+    if ( _stored_pyramid_levels_ && l > 0 ) {
+      if ( _AllocSubsampledImage( &resIm, pyramid_level[l].ncols,
+                                  pyramid_level[l].nrows, pyramid_level[l].nplanes,
+                                  theIm ) != 1 ) {
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to allocate image at level %d\n", proc, l );
+        MAXIMAL_DIMENSION = maximal_dimension;
+        return( -1 );
+      }
+      stored = BAL_ReadImagePyramidLevel( &resIm, theIm->name, sigma, normalisation );
+      if ( stored < 0 ) {
+        BAL_FreeImage( &resIm );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to read stored image at level %d\n", proc, l );
+        MAXIMAL_DIMENSION = maximal_dimension;
+        return( -1 );
+      }
+      if ( stored == 1 && _verbose_ )
+        fprintf( stderr, "%s: level %d read from '%s'\n", proc, l, theIm->name );
+    }
+
+    if ( stored == 0 ) {
+      if ( BAL_AllocComputeSubsampledImage( &resIm, pyramid_level[l].ncols,
+                                            pyramid_level[l].nrows, pyramid_level[l].nplanes,
+                                            theIm,
+                                            &(pyramid_level[l]), pyramid_gaussian_filtering ) != 1 ) {
+        BAL_FreeImage( &resIm );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to allocate image at level %d\n", proc, l );
+        MAXIMAL_DIMENSION = maximal_dimension;
+        return( -1 );
+      }
+      if ( _stored_pyramid_levels_ >= 2 && l > 0 ) {
+        if ( BAL_WriteImagePyramidLevel( &resIm, theIm->name, sigma, normalisation ) < 0 ) {
+          if ( _verbose_ )
+            fprintf( stderr, "%s: unable to store image at level %d in '%s'\n", proc, l, theIm->name );
+        }
+      }
     }
 
 
@@ -95,11 +95,22 @@ extern int BAL_AllocComputeSubsampledImage( bal_image *resIm,
                                             bal_pyramid_level *p,
                                             int pyramid_gaussian_filtering );
 
+/* pyramid levels stored in the image file (KLB files):
+ * 0: ignored, 1: used instead of being computed (default),
+ * 2: used, and computed levels are stored in the image file
+ */
+extern void BAL_SetStoredPyramidLevelsInBalPyramid( int s );
+extern int BAL_GetStoredPyramidLevelsInBalPyramid( );
+
+/* 'normalisation' indicates whether 'theIm' has been normalized on
+ * one byte when read, it is checked against the stored levels
+ */
 extern int BAL_BuildPyramidImage( bal_image *theIm, 
                                   stringList *image_names,
                                   int pyramid_lowest_level,
                                   int pyramid_highest_level,
-                                  int pyramid_gaussian_filtering );
+                                  int pyramid_gaussian_filtering,
+                                  int normalisation );
 
 #ifdef __cplusplus
 }
@@ -32,6 +32,7 @@
 #include <reech4x4.h>
 #include <reech4x4-coeff.h>
 #include <reech-def.h>
+#include <timeline.h>
 #include <vtmalloc.h>
 
 #include <bal-transformation-copy.h>
@@ -1147,13 +1148,9 @@ static int BAL_Coeff3DTriLin4x4( bal_image *theIm, bal_image *resIm,
 
 
 
-/* Resample 'image' into the geometry of 'resim'
-   theTr is then the transformation that goes from 'resim' to 'image'
-*/
-
-int BAL_ResampleImage( bal_image *image, bal_image *resim, 
-                       bal_transformation *theTr,
-                       enumTransformationInterpolation interpolation )
+static int _ResampleImage( bal_image *image, bal_image *resim,
+                           bal_transformation *theTr,
+                           enumTransformationInterpolation interpolation )
 {
   char *proc = "BAL_ResampleImage";
   bal_transformation voxTr, tmpTr, *ptrTr;
@@ -1397,6 +1394,26 @@ int BAL_ResampleImage( bal_image *image, bal_image *resim,
 
 
 
+
+/* Resample 'image' into the geometry of 'resim'
+   theTr is then the transformation that goes from 'resim' to 'image'
+*/
+
+int BAL_ResampleImage( bal_image *image, bal_image *resim, 
+                       bal_transformation *theTr,
+                       enumTransformationInterpolation interpolation )
+{
+  double t = getTimelineTime();
+  int r;
+
+  r = _ResampleImage( image, resim, theTr, interpolation );
+  addTimelineSlice( "BAL_ResampleImage", "resampling", t, (long int)interpolation );
+  return( r );
+}
+
+
+
+
 int BAL_LinearResamplingCoefficients( bal_image *image, bal_image *resim,
                                       bal_transformation *theTr,
                                       enumTransformationInterpolation interpolation,
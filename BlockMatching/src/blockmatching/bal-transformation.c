@@ -30,6 +30,7 @@
 #include <vtmalloc.h>
 
 #include <bal-transformation.h>
+#include <bal-cache.h>
 
 
 
@@ -1012,7 +1013,7 @@ int BAL_TransformationModulus( bal_transformation *theTrsf, bal_image *image )
    Transformations are supposed to be in REAL_UNIT
 */
 
-int BAL_ReadTransformation( bal_transformation *theTrsf, char *name )
+static int _ReadTransformation( bal_transformation *theTrsf, char *name )
 {
   char *proc = "BAL_ReadTransformation";
   bal_image theIm;
@@ -1219,6 +1220,27 @@ int BAL_ReadTransformation( bal_transformation *theTrsf, char *name )
 
 
 
+/* vector fields are read as images: the transformation is kept
+   in the cache (see bal-cache.h) instead of the read image
+*/
+
+int BAL_ReadTransformation( bal_transformation *theTrsf, char *name )
+{
+  if ( BAL_GetTransformationFromCache( theTrsf, name ) == 1 )
+    return( 1 );
+
+  if ( _ReadTransformation( theTrsf, name ) != 1 )
+    return( -1 );
+
+  if ( BAL_IsTransformationVectorField( theTrsf ) == 1 )
+    BAL_RemoveImageFromCache( name, 0 );
+  BAL_AddTransformationToCache( theTrsf, name );
+
+  return( 1 );
+}
+
+
+
 int BAL_WriteTransformation( bal_transformation *theTrsf, char *name )
 {
   char *proc = "BAL_WriteTransformation";
@@ -0,0 +1,772 @@
+/*************************************************************************
+ * blockmatchingServer.c -
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026, all rights reserved
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+
+
+/* sockets, dup2()
+ */
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <vtmalloc.h>
+
+#include <bal-cache.h>
+
+#include <api-applyTrsf.h>
+#include <api-blockmatching.h>
+#include <api-composeTrsf.h>
+#include <api-invTrsf.h>
+
+
+
+
+
+
+
+
+
+static char *program = NULL;
+
+static char *usage = "[-socket %s] [-cache-size %d] [-pool-size %d]\n\
+ [-verbose|-v] [-no-verbose|-nv] [-help|-h]";
+
+static char *detail = "\
+ Long running server that executes blockmatching, applyTrsf, composeTrsf\n\
+ and invTrsf jobs received on a Unix-domain socket.\n\
+ [-socket %s]      # socket path (default '/tmp/blockmatching.sock')\n\
+ [-cache-size %d]  # size (MB) of the cache of read images, transformations\n\
+   and pyramid levels (default 1024), 0 disables the cache\n\
+ [-pool-size %d]   # size (MB) of the large buffers kept for reuse by the\n\
+   next jobs (default 1024), 0 disables the buffer pool\n\
+\n\
+ Protocol: one request per line, made of a command name followed by the\n\
+ command line options of the corresponding tool, eg\n\
+   blockmatching -flo flo.inr -ref ref.inr -res-trsf res.trsf -trsf-type affine\n\
+ Options are separated by blanks (file names can not contain blanks),\n\
+ relative file names are relative to the server working directory.\n\
+ The job is queued ('QUEUED position=%d' is sent back), its options\n\
+ are checked when it starts ('DONE status=invalid' is sent back after\n\
+ the usage if they are not valid), the messages of the job are sent\n\
+ back while it is running, and a last line\n\
+   DONE status=ok|invalid|error real=%f user=%f hits=%d misses=%d cache=%d maxrss=%d\n\
+ gives the elapsed times (s), the cache hits and misses of the job,\n\
+ the cache occupation (kB) and the maximal resident size (kB).\n\
+ Other requests:\n\
+   status       # queue length and cache statistics\n\
+   clear-cache  # empties the cache (queued as a job)\n\
+   quit         # closes the connection\n\
+   shutdown     # stops the server once the queued jobs are done\n\
+\n\
+ Jobs are executed one at a time (the library is not reentrant) by the\n\
+ same thread, so that they share the same OpenMP team (see\n\
+ OMP_NUM_THREADS). Options that change a global setting (eg '-verbose',\n\
+ '-parallel-scheduling') remain set for the following jobs.\n\
+";
+
+
+
+static int _verbose_ = 1;
+
+
+
+typedef enum {
+  _BLOCKMATCHING_,
+  _APPLYTRSF_,
+  _COMPOSETRSF_,
+  _INVTRSF_,
+  _CLEARCACHE_
+} enumJobCommand;
+
+
+
+typedef struct _job {
+  enumJobCommand command;
+  int fd;
+  int argc;
+  char **argv;
+  int done;
+  struct _job *next;
+} _job;
+
+
+
+static pthread_mutex_t _mutex_ = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _queue_cond_ = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _done_cond_ = PTHREAD_COND_INITIALIZER;
+static _job *_first_job_ = (_job*)NULL;
+static _job *_last_job_ = (_job*)NULL;
+static int _queued_jobs_ = 0;
+static int _done_jobs_ = 0;
+static int _shutdown_ = 0;
+static int _listen_fd_ = -1;
+
+
+
+static void _ErrorParse( char *str, int flag );
+static char *_BaseName( char *p );
+static char *_Array2Str( int argc, char *argv[] );
+static double _GetTime();
+static double _GetClock();
+
+static void *_ServeConnection( void *arg );
+static void *_AcceptConnections( void *arg );
+static void _RunJob( _job *job );
+
+
+
+
+
+int main( int argc, char *argv[] )
+{
+  char *socket_name = "/tmp/blockmatching.sock";
+  int cache_size = 1024;
+  int pool_size = 1024;
+  struct sockaddr_un addr;
+  pthread_t acceptor;
+  _job *job;
+  int i;
+
+
+
+  /***************************************************
+   *
+   * parsing parameters
+   *
+   ***************************************************/
+  program = argv[0];
+
+  for ( i=1; i<argc; i++ ) {
+    if ( ( strcmp ( argv[i], "-help") == 0 )
+         || ( strcmp ( argv[i], "-h") == 0 && argv[i][2] == '\0' )
+         || ( strcmp ( argv[i], "--help") == 0 ) ) {
+      _ErrorParse( NULL, 1 );
+    }
+    else if ( strcmp ( argv[i], "-verbose" ) == 0
+              || ( strcmp ( argv[i], "-v") == 0 && argv[i][2] == '\0' ) ) {
+      _verbose_ ++;
+    }
+    else if ( strcmp ( argv[i], "-no-verbose" ) == 0
+              || (strcmp ( argv[i], "-nv" ) == 0 && argv[i][3] == '\0') ) {
+      _verbose_ = 0;
+    }
+    else if ( strcmp ( argv[i], "-socket" ) == 0 ) {
+      i ++;
+      if ( i >= argc ) _ErrorParse( "parsing -socket", 0 );
+      socket_name = argv[i];
+    }
+    else if ( strcmp ( argv[i], "-cache-size" ) == 0 ) {
+      i ++;
+      if ( i >= argc ) _ErrorParse( "parsing -cache-size", 0 );
+      if ( sscanf( argv[i], "%d", &cache_size ) != 1 || cache_size < 0 )
+        _ErrorParse( "parsing -cache-size", 0 );
+    }
+    else if ( strcmp ( argv[i], "-pool-size" ) == 0 ) {
+      i ++;
+      if ( i >= argc ) _ErrorParse( "parsing -pool-size", 0 );
+      if ( sscanf( argv[i], "%d", &pool_size ) != 1 || pool_size < 0 )
+        _ErrorParse( "parsing -pool-size", 0 );
+    }
+    else {
+      fprintf( stderr, "unknown option: '%s'\n", argv[i] );
+      _ErrorParse( NULL, 0 );
+    }
+  }
+
+  if ( strlen( socket_name ) >= sizeof( addr.sun_path ) )
+    _ErrorParse( "socket name too long", 0 );
+
+  BAL_SetCacheSizeInBalCache( (size_t)cache_size * 1024 * 1024 );
+  setPoolSizeInVtMalloc( (size_t)pool_size * 1024 * 1024 );
+  setPoolInVtMalloc( ( pool_size > 0 ) ? 1 : 0 );
+
+  /* a client may leave while its job is running
+   */
+  signal( SIGPIPE, SIG_IGN );
+
+
+
+  /***************************************************
+   *
+   * socket
+   *
+   ***************************************************/
+  _listen_fd_ = socket( AF_UNIX, SOCK_STREAM, 0 );
+  if ( _listen_fd_ < 0 ) {
+    perror( "socket" );
+    exit( 1 );
+  }
+  memset( &addr, 0, sizeof( addr ) );
+  addr.sun_family = AF_UNIX;
+  (void)strcpy( addr.sun_path, socket_name );
+  (void)unlink( socket_name );
+  if ( bind( _listen_fd_, (struct sockaddr*)&addr, sizeof( addr ) ) != 0
+       || listen( _listen_fd_, 16 ) != 0 ) {
+    perror( socket_name );
+    exit( 1 );
+  }
+  if ( _verbose_ )
+    fprintf( stderr, "%s: listening on '%s' (cache of %d MB)\n",
+             _BaseName( program ), socket_name, cache_size );
+
+  if ( pthread_create( &acceptor, (pthread_attr_t*)NULL, _AcceptConnections, (void*)NULL ) != 0 ) {
+    fprintf( stderr, "%s: unable to create thread\n", _BaseName( program ) );
+    exit( 1 );
+  }
+  (void)pthread_detach( acceptor );
+
+
+
+  /***************************************************
+   *
+   * jobs are run by the main thread
+   *
+   ***************************************************/
+  for ( ;; ) {
+    pthread_mutex_lock( &_mutex_ );
+    while ( _first_job_ == (_job*)NULL && !_shutdown_ )
+      pthread_cond_wait( &_queue_cond_, &_mutex_ );
+    if ( _first_job_ == (_job*)NULL ) {
+      pthread_mutex_unlock( &_mutex_ );
+      break;
+    }
+    job = _first_job_;
+    _first_job_ = job->next;
+    if ( _first_job_ == (_job*)NULL ) _last_job_ = (_job*)NULL;
+    pthread_mutex_unlock( &_mutex_ );
+
+    _RunJob( job );
+
+    pthread_mutex_lock( &_mutex_ );
+    job->done = 1;
+    _done_jobs_ ++;
+    pthread_cond_broadcast( &_done_cond_ );
+    pthread_mutex_unlock( &_mutex_ );
+  }
+
+  (void)unlink( socket_name );
+  if ( _verbose_ )
+    fprintf( stderr, "%s: %d jobs done, exiting\n", _BaseName( program ), _done_jobs_ );
+  BAL_ClearCache();
+
+  return( 0 );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * static functions
+ *
+ ************************************************************/
+
+
+
+static void _Write( int fd, char *str )
+{
+  size_t l = strlen( str );
+  ssize_t n;
+
+  while ( l > 0 ) {
+    n = write( fd, str, l );
+    if ( n <= 0 ) {
+      if ( n < 0 && errno == EINTR ) continue;
+      return;
+    }
+    str += n;
+    l -= n;
+  }
+}
+
+
+
+/* splits the line into blank separated words,
+ * argv[] points into line
+ * (called by the connection threads: vtmalloc() is not used)
+ */
+static char **_SplitLine( char *line, int *argc )
+{
+  char **argv;
+  char *s = line;
+  int n = 0, l = strlen( line );
+
+  argv = (char**)malloc( (l/2+2) * sizeof(char*) );
+  if ( argv == (char**)NULL ) return( (char**)NULL );
+
+  for ( ;; ) {
+    while ( *s == ' ' || *s == '\t' || *s == '\r' || *s == '\n' ) *s++ = '\0';
+    if ( *s == '\0' ) break;
+    argv[n++] = s;
+    while ( *s != '\0' && *s != ' ' && *s != '\t' && *s != '\r' && *s != '\n' ) s++;
+  }
+  argv[n] = (char*)NULL;
+  *argc = n;
+  return( argv );
+}
+
+
+
+static int _Command( char *name, enumJobCommand *command )
+{
+  if ( strcmp( name, "blockmatching" ) == 0 ) *command = _BLOCKMATCHING_;
+  else if ( strcmp( name, "applyTrsf" ) == 0 ) *command = _APPLYTRSF_;
+  else if ( strcmp( name, "composeTrsf" ) == 0 ) *command = _COMPOSETRSF_;
+  else if ( strcmp( name, "invTrsf" ) == 0 ) *command = _INVTRSF_;
+  else if ( strcmp( name, "clear-cache" ) == 0 ) *command = _CLEARCACHE_;
+  else return( -1 );
+  return( 1 );
+}
+
+
+
+static void *_ServeConnection( void *arg )
+{
+  char *proc = "_ServeConnection";
+  int fd = *((int*)arg);
+  FILE *f;
+  char line[65536];
+  char str[256];
+  char **argv;
+  int argc;
+  enumJobCommand command;
+  bal_cacheStatistics stats;
+  _job job;
+
+  free( arg );
+
+  f = fdopen( dup( fd ), "r" );
+  if ( f == (FILE*)NULL ) {
+    close( fd );
+    return( (void*)NULL );
+  }
+
+  while ( fgets( line, sizeof( line ), f ) != (char*)NULL ) {
+
+    argv = _SplitLine( line, &argc );
+    if ( argv == (char**)NULL ) break;
+    if ( argc == 0 ) {
+      free( argv );
+      continue;
+    }
+
+    if ( strcmp( argv[0], "quit" ) == 0 ) {
+      free( argv );
+      break;
+    }
+
+    if ( strcmp( argv[0], "status" ) == 0 ) {
+      BAL_GetCacheStatistics( &stats );
+      pthread_mutex_lock( &_mutex_ );
+      sprintf( str, "STATUS queued=%d done=%d entries=%lu cache=%lu size=%lu hits=%lu misses=%lu evictions=%lu\n",
+               _queued_jobs_, _done_jobs_, stats.entries, stats.bytes/1024, stats.size/1024,
+               stats.hits, stats.misses, stats.evictions );
+      pthread_mutex_unlock( &_mutex_ );
+      _Write( fd, str );
+      free( argv );
+      continue;
+    }
+
+    if ( strcmp( argv[0], "shutdown" ) == 0 ) {
+      _Write( fd, "DONE status=ok\n" );
+      pthread_mutex_lock( &_mutex_ );
+      _shutdown_ = 1;
+      pthread_cond_broadcast( &_queue_cond_ );
+      pthread_mutex_unlock( &_mutex_ );
+      (void)shutdown( _listen_fd_, SHUT_RDWR );
+      free( argv );
+      break;
+    }
+
+    if ( _Command( argv[0], &command ) != 1 ) {
+      sprintf( str, "DONE status=invalid unknown command '%.64s'\n", argv[0] );
+      _Write( fd, str );
+      free( argv );
+      continue;
+    }
+
+    /* queue the job and wait for its completion
+     */
+    job.command = command;
+    job.fd = fd;
+    job.argc = argc;
+    job.argv = argv;
+    job.done = 0;
+    job.next = (_job*)NULL;
+
+    pthread_mutex_lock( &_mutex_ );
+    if ( _shutdown_ ) {
+      pthread_mutex_unlock( &_mutex_ );
+      _Write( fd, "DONE status=error server is shutting down\n" );
+      free( argv );
+      break;
+    }
+    if ( _last_job_ == (_job*)NULL ) _first_job_ = &job;
+    else _last_job_->next = &job;
+    _last_job_ = &job;
+    _queued_jobs_ ++;
+    sprintf( str, "QUEUED position=%d\n", _queued_jobs_ - _done_jobs_ );
+    _Write( fd, str );
+    pthread_cond_signal( &_queue_cond_ );
+    while ( !job.done )
+      pthread_cond_wait( &_done_cond_, &_mutex_ );
+    pthread_mutex_unlock( &_mutex_ );
+
+    free( argv );
+  }
+
+  if ( _verbose_ >= 2 )
+    fprintf( stderr, "%s: connection closed\n", proc );
+  fclose( f );
+  close( fd );
+  return( (void*)NULL );
+}
+
+
+
+static void *_AcceptConnections( void *arg )
+{
+  char *proc = "_AcceptConnections";
+  pthread_t thread;
+  int fd, *p;
+
+  (void)arg;
+
+  for ( ;; ) {
+    fd = accept( _listen_fd_, (struct sockaddr*)NULL, (socklen_t*)NULL );
+    if ( fd < 0 ) {
+      if ( errno == EINTR ) continue;
+      break;
+    }
+    p = (int*)malloc( sizeof(int) );
+    if ( p == (int*)NULL ) {
+      close( fd );
+      continue;
+    }
+    *p = fd;
+    if ( pthread_create( &thread, (pthread_attr_t*)NULL, _ServeConnection, (void*)p ) != 0 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to create thread\n", proc );
+      free( p );
+      close( fd );
+      continue;
+    }
+    (void)pthread_detach( thread );
+  }
+
+  /* wake up the main thread
+   */
+  pthread_mutex_lock( &_mutex_ );
+  _shutdown_ = 1;
+  pthread_cond_broadcast( &_queue_cond_ );
+  pthread_mutex_unlock( &_mutex_ );
+  return( (void*)NULL );
+}
+
+
+
+/* the API_ErrorParse_*() functions exit in case of error,
+ * they are told to jump back here instead.
+ * Options are only parsed by the thread that runs the jobs
+ * (the parsers also change global settings)
+ */
+static int _ParseCommand( enumJobCommand command, int argc, char *argv[],
+                          lineCmdParamBlockmatching *bpar,
+                          lineCmdParamApplyTrsf *apar,
+                          lineCmdParamComposeTrsf *cpar,
+                          lineCmdParamInvTrsf *ipar )
+{
+  jmp_buf env;
+  volatile int r = 1;
+
+  API_SetErrorParseJump_blockmatching( &env );
+  API_SetErrorParseJump_applyTrsf( &env );
+  API_SetErrorParseJump_composeTrsf( &env );
+  API_SetErrorParseJump_invTrsf( &env );
+
+  if ( setjmp( env ) == 0 ) {
+    switch ( command ) {
+    default :
+      break;
+    case _BLOCKMATCHING_ :
+      if ( argc <= 1 ) API_ErrorParse_blockmatching( argv[0], (char*)NULL, 0 );
+      API_ParseParam_blockmatching( 1, argc, argv, bpar );
+      break;
+    case _APPLYTRSF_ :
+      if ( argc <= 1 ) API_ErrorParse_applyTrsf( argv[0], (char*)NULL, 0 );
+      API_ParseParam_applyTrsf( 1, argc, argv, apar );
+      break;
+    case _COMPOSETRSF_ :
+      if ( argc <= 1 ) API_ErrorParse_composeTrsf( argv[0], (char*)NULL, 0 );
+      API_ParseParam_composeTrsf( 1, argc, argv, cpar );
+      break;
+    case _INVTRSF_ :
+      if ( argc <= 1 ) API_ErrorParse_invTrsf( argv[0], (char*)NULL, 0 );
+      API_ParseParam_invTrsf( 1, argc, argv, ipar );
+      break;
+    }
+  }
+  else {
+    r = -1;
+  }
+
+  API_SetErrorParseJump_blockmatching( (jmp_buf*)NULL );
+  API_SetErrorParseJump_applyTrsf( (jmp_buf*)NULL );
+  API_SetErrorParseJump_composeTrsf( (jmp_buf*)NULL );
+  API_SetErrorParseJump_invTrsf( (jmp_buf*)NULL );
+  return( r );
+}
+
+
+
+/* returns 0 if the options are not valid
+ */
+static int _RunCommand( enumJobCommand command, int argc, char *argv[] )
+{
+  lineCmdParamBlockmatching bpar;
+  lineCmdParamApplyTrsf apar;
+  lineCmdParamComposeTrsf cpar;
+  lineCmdParamInvTrsf ipar;
+  char *lineoptions = (char*)NULL;
+  int r = -1;
+
+  if ( command == _CLEARCACHE_ ) {
+    BAL_ClearCache();
+    return( 1 );
+  }
+
+  API_InitParam_blockmatching( &bpar );
+  API_InitParam_applyTrsf( &apar );
+  API_InitParam_composeTrsf( &cpar );
+  API_InitParam_invTrsf( &ipar );
+  if ( _ParseCommand( command, argc, argv, &bpar, &apar, &cpar, &ipar ) != 1 ) {
+    API_FreeParam_composeTrsf( &cpar );
+    return( 0 );
+  }
+
+  lineoptions = _Array2Str( argc, argv );
+  if ( lineoptions == (char*)NULL ) {
+    fprintf( stderr, "%s: unable to translate command line options ...\n", argv[0] );
+    API_FreeParam_composeTrsf( &cpar );
+    return( -1 );
+  }
+
+  switch ( command ) {
+  default :
+    break;
+
+  case _BLOCKMATCHING_ :
+    r = API_INTERMEDIARY_blockmatching( bpar.floating_image,
+                                        bpar.reference_image,
+                                        bpar.result_image,
+                                        bpar.left_real_transformation,
+                                        bpar.left_voxel_transformation,
+                                        bpar.initial_result_real_transformation,
+                                        bpar.initial_result_voxel_transformation,
+                                        bpar.result_real_transformation,
+                                        bpar.result_voxel_transformation,
+                                        lineoptions, (char*)NULL );
+    break;
+
+  case _APPLYTRSF_ :
+    r = API_INTERMEDIARY_applyTrsf( apar.input_name, apar.output_name,
+                                    apar.template_name,
+                                    apar.input_real_transformation,
+                                    apar.input_voxel_transformation,
+                                    apar.output_real_transformation,
+                                    apar.output_voxel_transformation,
+                                    lineoptions, (char*)NULL );
+    break;
+
+  case _COMPOSETRSF_ :
+    r = 1;
+    if ( cpar.input_list != (char*)NULL && cpar.input_list[0] != '\0' ) {
+      if ( buildStringListFromFile( cpar.input_list, &(cpar.input_names) ) != 1 ) {
+        fprintf( stderr, "%s: unable to build transformation names from list ...\n", argv[0] );
+        r = -1;
+      }
+    }
+    if ( r == 1 && cpar.input_format != (char*)NULL && cpar.input_format[0] != '\0' ) {
+      if ( buildStringListFromFormat( cpar.input_format, cpar.firstindex, cpar.lastindex,
+                                      &(cpar.input_names) ) != 1 ) {
+        fprintf( stderr, "%s: unable to build transformation names from format ...\n", argv[0] );
+        r = -1;
+      }
+    }
+    if ( r == 1 )
+      r = API_INTERMEDIARY_composeTrsf( &(cpar.input_names), cpar.output_name,
+                                        cpar.template_name,
+                                        lineoptions, (char*)NULL );
+    API_FreeParam_composeTrsf( &cpar );
+    break;
+
+  case _INVTRSF_ :
+    r = API_INTERMEDIARY_invTrsf( ipar.input_name, ipar.output_name, ipar.template_name,
+                                  lineoptions, (char*)NULL );
+    break;
+  }
+
+  vtfree( lineoptions );
+  return( r );
+}
+
+
+
+/* the job messages (stdout and stderr) are sent to the client
+ */
+static void _RunJob( _job *job )
+{
+  bal_cacheStatistics before, after;
+  struct rusage usage;
+  double time_init, clock_init;
+  double time_exit, clock_exit;
+  int saved_stdout, saved_stderr;
+  char str[512];
+  int r;
+
+  if ( _verbose_ >= 2 )
+    fprintf( stderr, "%s: run '%s'\n", _BaseName( program ), job->argv[0] );
+
+  BAL_GetCacheStatistics( &before );
+  time_init = _GetTime();
+  clock_init = _GetClock();
+
+  fflush( stdout );
+  fflush( stderr );
+  saved_stdout = dup( 1 );
+  saved_stderr = dup( 2 );
+  (void)dup2( job->fd, 1 );
+  (void)dup2( job->fd, 2 );
+
+  r = _RunCommand( job->command, job->argc, job->argv );
+
+  fflush( stdout );
+  fflush( stderr );
+  (void)dup2( saved_stdout, 1 );
+  (void)dup2( saved_stderr, 2 );
+  close( saved_stdout );
+  close( saved_stderr );
+
+  time_exit = _GetTime();
+  clock_exit = _GetClock();
+  BAL_GetCacheStatistics( &after );
+  (void)getrusage( RUSAGE_SELF, &usage );
+
+  sprintf( str, "DONE status=%s real=%f user=%f hits=%lu misses=%lu cache=%lu maxrss=%ld\n",
+           ( r == 1 ) ? "ok" : ( ( r == 0 ) ? "invalid" : "error" ),
+           time_exit - time_init, clock_exit - clock_init,
+           after.hits - before.hits, after.misses - before.misses,
+           after.bytes/1024, usage.ru_maxrss );
+  _Write( job->fd, str );
+
+  if ( _verbose_ )
+    fprintf( stderr, "%s: '%s' %s in %f s\n", _BaseName( program ), job->argv[0],
+             ( r == 1 ) ? "done" : ( ( r == 0 ) ? "rejected" : "failed" ), time_exit - time_init );
+}
+
+
+
+static void _ErrorParse( char *str, int flag )
+{
+  (void)fprintf(stderr,"Usage: %s %s\n",_BaseName(program), usage);
+  if ( flag == 1 ) (void)fprintf(stderr,"%s\n",detail);
+  if ( str != NULL ) (void)fprintf(stderr,"Error: %s\n",str);
+  exit( 1 );
+}
+
+
+
+static char *_BaseName( char *p )
+{
+  int l;
+  if ( p == (char*)NULL ) return( (char*)NULL );
+  l = strlen( p ) - 1;
+  while ( l >= 0 && p[l] != '/' ) l--;
+  if ( l < 0 ) l = 0;
+  if ( p[l] == '/' ) l++;
+  return( &(p[l]) );
+}
+
+
+
+static char *_Array2Str( int argc, char *argv[] )
+{
+  char *proc = "_Array2Str";
+  int i, l;
+  char *s, *t;
+
+  if ( argc <= 1 || argv == (char**)NULL ) {
+    if ( _verbose_ >= 2 )
+      fprintf( stderr, "%s: no options in argv[]\n", proc );
+    return( (char*)NULL );
+  }
+
+  for ( l=argc-1, i=1; i<argc; i++ ) {
+    l += strlen( argv[i] );
+  }
+
+  s = (char*)vtmalloc( l * sizeof( char ), "s", proc );
+  if ( s == (char*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( (char*)NULL );
+  }
+
+  for ( t=s, i=1; i<argc; i++ ) {
+    (void)strncpy( t, argv[i], strlen( argv[i] ) );
+    t += strlen( argv[i] );
+    if ( i < argc-1 ) {
+      *t = ' ';
+      t++;
+    }
+    else {
+      *t = '\0';
+    }
+  }
+
+  return( s );
+}
+
+
+
+static double _GetTime()
+{
+  struct timeval tv;
+  gettimeofday(&tv, (void *)0);
+  return ( (double) tv.tv_sec + tv.tv_usec*1e-6 );
+}
+
+
+
+static double _GetClock()
+{
+  return ( (double) clock() / (double)CLOCKS_PER_SEC );
+}
@@ -84,7 +84,7 @@ int main( int argc, char *argv[] )
 
   /* input image reading
    */
-  if ( BAL_ReadImage( &image, par.input_image_name, 0 ) != 1 ) {
+  if ( BAL_ReadImage( &image, par.input_image_name, par.normalisation ) != 1 ) {
       API_ErrorParse_buildPyramidImage( _BaseName( argv[0] ), "unable to read input image ...\n", 0 );
   }
 
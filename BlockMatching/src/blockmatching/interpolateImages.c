@@ -154,8 +154,7 @@ int main( int argc, char *argv[] )
           fprintf( stderr, "... can not read template image '%s'\n", par.template_name );
       API_ErrorParse_interpolateImages( _BaseName( argv[0] ), "unable to read template image...\n", 0 );
     }
-    vtfree( theTemplate.array ); theTemplate.array  = NULL;
-    vtfree( theTemplate.data );  theTemplate.data  = NULL;
+    BAL_FreeImageData( &theTemplate );
     vtfree( theTemplate.name );  theTemplate.name  = NULL;
     ptrTemplate = &theTemplate;
   }
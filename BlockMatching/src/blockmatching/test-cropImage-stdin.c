@@ -0,0 +1,122 @@
+/*************************************************************************
+ * test-cropImage-stdin.c -
+ *
+ * Copyright (c) INRIA 2026
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ *
+ * cropping an image read from the standard input (that is read entirely)
+ * gives the same result as cropping the same image read from a file
+ * (where only the cropped region is read)
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <bal-image.h>
+#include <api-cropImage.h>
+
+#define INPUT_NAME "test-cropImage-stdin-in.inr"
+#define FILE_RESULT_NAME "test-cropImage-stdin-file.inr"
+#define STDIN_RESULT_NAME "test-cropImage-stdin-stdin.inr"
+
+static char *_params[] = { "-origin 2 3 1 -dim 5 4 3",
+                           "-xy 2",
+                           "-xz 3",
+                           "-yz 4",
+                           NULL };
+
+
+
+static int _compareImages( char *name1, char *name2 )
+{
+  bal_image im1, im2;
+  int res = 1;
+
+  if ( BAL_ReadImage( &im1, name1, 0 ) != 1 ) {
+    fprintf( stderr, "unable to read '%s'\n", name1 );
+    return( -1 );
+  }
+  if ( BAL_ReadImage( &im2, name2, 0 ) != 1 ) {
+    BAL_FreeImage( &im1 );
+    fprintf( stderr, "unable to read '%s'\n", name2 );
+    return( -1 );
+  }
+
+  if ( im1.ncols != im2.ncols || im1.nrows != im2.nrows || im1.nplanes != im2.nplanes
+       || im1.type != im2.type
+       || memcmp( im1.data, im2.data, BAL_ImageDataSize( &im1 ) ) != 0 )
+    res = -1;
+
+  BAL_FreeImage( &im2 );
+  BAL_FreeImage( &im1 );
+  return( res );
+}
+
+
+
+int main( )
+{
+  bal_image theim;
+  unsigned char *buf;
+  size_t i;
+  int p;
+  int failures = 0;
+
+  if ( BAL_AllocFullImage( &theim, (char*)NULL, 11, 9, 7, 1,
+                           1.0, 1.0, 1.0, UCHAR ) != 1 ) {
+    fprintf( stderr, "unable to allocate input image\n" );
+    return( 1 );
+  }
+  buf = (unsigned char*)theim.data;
+  for ( i=0; i<theim.ncols*theim.nrows*theim.nplanes; i++ )
+    buf[i] = (unsigned char)(i % 251);
+
+  if ( BAL_WriteImage( &theim, INPUT_NAME ) != 1 ) {
+    BAL_FreeImage( &theim );
+    fprintf( stderr, "unable to write input image\n" );
+    return( 1 );
+  }
+  BAL_FreeImage( &theim );
+
+  for ( p=0; _params[p] != NULL; p++ ) {
+
+    if ( API_INTERMEDIARY_cropImage( INPUT_NAME, FILE_RESULT_NAME,
+                                     (char*)NULL, (char*)NULL, (char*)NULL,
+                                     _params[p], (char*)NULL ) != 1 ) {
+      fprintf( stderr, "'%s': unable to crop image from file\n", _params[p] );
+      failures ++;
+      continue;
+    }
+
+    if ( freopen( INPUT_NAME, "rb", stdin ) == NULL ) {
+      fprintf( stderr, "unable to redirect standard input\n" );
+      return( 1 );
+    }
+    if ( API_INTERMEDIARY_cropImage( "-", STDIN_RESULT_NAME,
+                                     (char*)NULL, (char*)NULL, (char*)NULL,
+                                     _params[p], (char*)NULL ) != 1 ) {
+      fprintf( stderr, "'%s': unable to crop image from standard input\n", _params[p] );
+      failures ++;
+      continue;
+    }
+
+    if ( _compareImages( FILE_RESULT_NAME, STDIN_RESULT_NAME ) != 1 ) {
+      fprintf( stderr, "'%s': results differ\n", _params[p] );
+      failures ++;
+    }
+  }
+
+  (void)remove( INPUT_NAME );
+  (void)remove( FILE_RESULT_NAME );
+  (void)remove( STDIN_RESULT_NAME );
+
+  return( failures == 0 ? 0 : 1 );
+}
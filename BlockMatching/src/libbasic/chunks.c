@@ -36,6 +36,7 @@
 #endif
 #include <pthread.h>
 
+#include <timeline.h>
 #include <vtmalloc.h>
 
 #include <chunks.h>
@@ -162,6 +163,41 @@ int getMinElementsInChunks( )
  ************************************************************/
 
 
+
+/* the processing of each chunk is a slice of the timeline
+ * of the thread that processes it (if the timeline is enabled)
+ */
+
+static void *_processChunk( _chunk_callfunction ftn, typeChunks *chunks, int n, char *from )
+{
+  double t;
+  void *r;
+
+  if ( getTimeline() == 0 )
+    return( (*ftn)( &(chunks->data[n]) ) );
+  t = getTimelineTime();
+  r = (*ftn)( &(chunks->data[n]) );
+  addTimelineSlice( from, "chunk", t, (long int)n );
+  return( r );
+}
+
+
+
+typedef struct {
+  _chunk_callfunction ftn;
+  typeChunks *chunks;
+  int n;
+  char *from;
+} _timelineChunk;
+
+static void *_processTimelineChunk( void *par )
+{
+  _timelineChunk *c = (_timelineChunk*)par;
+  return( _processChunk( c->ftn, c->chunks, c->n, c->from ) );
+}
+
+
+
 #ifdef _OPENMP
 static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char *from )
 {
@@ -181,7 +217,7 @@ static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char
           fprintf( stderr, " attributed to thread #%d", omp_get_thread_num() );
           fprintf( stderr, "\n" );
         }
-        (void)(*ftn)( &(chunks->data[n]) );
+        (void)_processChunk( ftn, chunks, n, from );
       }
       break;
 
@@ -194,7 +230,7 @@ static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char
           fprintf( stderr, " attributed to thread #%d", omp_get_thread_num() );
           fprintf( stderr, "\n" );
         }
-        (void)(*ftn)( &(chunks->data[n]) );
+        (void)_processChunk( ftn, chunks, n, from );
       }
       break;
 
@@ -207,7 +243,7 @@ static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char
           fprintf( stderr, " attributed to thread #%d", omp_get_thread_num() );
           fprintf( stderr, "\n" );
         }
-        (void)(*ftn)( &(chunks->data[n]) );
+        (void)_processChunk( ftn, chunks, n, from );
       }
       break;
 
@@ -220,7 +256,7 @@ static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char
           fprintf( stderr, " attributed to thread #%d", omp_get_thread_num() );
           fprintf( stderr, "\n" );
         }
-        (void)(*ftn)( &(chunks->data[n]) );
+        (void)_processChunk( ftn, chunks, n, from );
       }
       break;
 
@@ -233,7 +269,7 @@ static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char
           fprintf( stderr, " attributed to thread #%d", omp_get_thread_num() );
           fprintf( stderr, "\n" );
         }
-        (void)(*ftn)( &(chunks->data[n]) );
+        (void)_processChunk( ftn, chunks, n, from );
       }
       break;
     }
@@ -249,7 +285,7 @@ static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char
         fprintf( stderr, " in a sequential way" );
         fprintf( stderr, "\n" );
       }
-      (void)(*ftn)( &(chunks->data[n]) );
+      (void)_processChunk( ftn, chunks, n, from );
     }
 
   }
@@ -277,16 +313,35 @@ static int _ompProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char
 static int _pthreadProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, char *from )
 {
   char *proc = "_pthreadProcessChunks";
-  int n;
+  int n, created;
   int rc;
+  int ret = 1;
+  int joined = 1;
   void *status;
   pthread_t *thread;
   pthread_attr_t attr;
+  _timelineChunk *timelineChunk = (_timelineChunk*)NULL;
 
   if ( _debug_ >= 3 ) fprintf( stderr, "%s: pthread scheduling\n", from );
 
+  if ( getTimeline() ) {
+    timelineChunk = (_timelineChunk*)vtmalloc( chunks->n_allocated_chunks * sizeof( _timelineChunk ), "timelineChunk", proc );
+    if ( timelineChunk == (_timelineChunk*)NULL ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to allocate array of %d timeline chunks\n", proc, chunks->n_allocated_chunks );
+      return( -1 );
+    }
+    for ( n=0; n<chunks->n_allocated_chunks; n++ ) {
+      timelineChunk[n].ftn = ftn;
+      timelineChunk[n].chunks = chunks;
+      timelineChunk[n].n = n;
+      timelineChunk[n].from = from;
+    }
+  }
+
   thread = (pthread_t*)vtmalloc( chunks->n_allocated_chunks * sizeof( pthread_t ), "thread", proc );
   if ( thread == (pthread_t*)NULL ) {
+    if ( timelineChunk != (_timelineChunk*)NULL ) vtfree( timelineChunk );
     if ( _verbose_ ) 
       fprintf( stderr, "%s: unable to allocate array of %d threads\n", proc, chunks->n_allocated_chunks );
     return( -1 );
@@ -296,28 +351,39 @@ static int _pthreadProcessChunks( _chunk_callfunction ftn, typeChunks *chunks, c
   pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
   
   for ( n=0; n<chunks->n_allocated_chunks; n++ ) {
-    rc =  pthread_create( &thread[n], &attr, ftn, &(chunks->data[n]) );
+    if ( timelineChunk != (_timelineChunk*)NULL )
+      rc =  pthread_create( &thread[n], &attr, _processTimelineChunk, &(timelineChunk[n]) );
+    else
+      rc =  pthread_create( &thread[n], &attr, ftn, &(chunks->data[n]) );
     if ( rc ) {
       if ( _verbose_ ) 
         fprintf( stderr, "%s: error when creating threads #%d/%d (returned code = %d)\n", proc, n,  chunks->n_allocated_chunks, rc );
-      vtfree( thread );
-      return( -1 );
+      ret = -1;
+      break;
     }
   }
-
+  created = n;
   pthread_attr_destroy(&attr);
-  for ( n=0; n<chunks->n_allocated_chunks; n++ ) {
+
+  /* the threads that have been created are joined before
+   * the timeline chunks are released, even in case of error
+   */
+  for ( n=0; n<created; n++ ) {
     rc = pthread_join( thread[n], &status );
     if ( rc ) {
       if ( _verbose_ ) 
         fprintf( stderr, "%s: error when joining threads #%d/%d (returned code = %d)\n", proc, n,  chunks->n_allocated_chunks, rc );
-      vtfree( thread );
-      return( -1 );
+      ret = -1;
+      joined = 0;
     }
   }
 
+  /* a thread that has not been joined may still use its timeline
+   * chunk: the array is then not released
+   */
+  if ( timelineChunk != (_timelineChunk*)NULL && joined ) vtfree( timelineChunk );
   vtfree( thread );
-  return( 1 );
+  return( ret );
 }
 
 
@@ -328,6 +394,8 @@ int processChunks( _chunk_callfunction ftn, typeChunks *chunks, char *from )
 {
   char *proc = "processChunks";
   int n;
+  int ret = 1;
+  double t = getTimelineTime();
 
 
   switch( _parallelism_ ) {
@@ -336,7 +404,7 @@ int processChunks( _chunk_callfunction ftn, typeChunks *chunks, char *from )
     if ( _debug_ >= 3 )
       fprintf( stderr, "%s: _NO_PARALLELISM_ case\n", proc );
     for ( n=0; n<chunks->n_allocated_chunks; n++ ) {
-      (void)(*ftn)( &(chunks->data[n]) ); 
+      (void)_processChunk( ftn, chunks, n, from );
     }
     break;
 
@@ -350,19 +418,20 @@ int processChunks( _chunk_callfunction ftn, typeChunks *chunks, char *from )
   case _OMP_PARALLELISM_ :
     if ( _debug_ >= 3 )
       fprintf( stderr, "%s: _OMP_PARALLELISM_ case\n", proc );
-    return ( _ompProcessChunks( ftn, chunks, from ) );
+    ret = _ompProcessChunks( ftn, chunks, from );
     break;
 #endif
     
   case _PTHREAD_PARALLELISM_ :
     if ( _debug_ >= 3 )
       fprintf( stderr, "%s: _PTHREAD_PARALLELISM_ case\n", proc );
-    return ( _pthreadProcessChunks( ftn, chunks, from ) );
+    ret = _pthreadProcessChunks( ftn, chunks, from );
     break;
   }
 
+  addTimelineSlice( from, "processChunks", t, (long int)chunks->n_allocated_chunks );
 
-  return( 1 );
+  return( ret );
 }
 
 
@@ -15,6 +15,11 @@
  *
  * ADDITIONS, CHANGES
  *
+ * * Mon Oct 19 2026
+ *   - add union-find labeling (parallel labeling of slabs, 
+ *     no more limitation on the number of labels),
+ *     see Connexe_SetUnionFindLabeling()
+ *
  * * Tue Feb  8 10:47:26 MET 2000
  *   - tmpBuf was erroneously set to inputBuf when typeOut was equal to
  *     either USHORT or SSHORT, it is corrected and set to outputBuf.
@@ -48,6 +53,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <chunks.h>
 #include <vtmalloc.h>
 
 #include <connexe.h>
@@ -72,10 +78,26 @@ static int _connectivity_ = 26;
 static int _minimum_size_of_components_ = 1;
 static int _maximum_number_of_components_ = 0;
 
+/* labeling with union-find (no limitation on the number of
+   intermediary labels, parallel computation) vs. sequential 
+   labeling with an equivalence table of fixed size
+*/
+static int _union_find_labeling_ = 1;
+
 
 static int CheckAndEvaluateConnectivity( int connectivity,
                                          int dimz );
 
+static int UnionFindConnectedComponentsExtraction( unsigned short int *inputBuf,
+                                                   void *outputBuf,
+                                                   bufferType typeOut,
+                                                   int *theDim,
+                                                   int connectivity,
+                                                   int minNumberOfPtsAboveLow,
+                                                   int minNumberOfPtsAboveHigh,
+                                                   int maxNumberOfConnectedComponent,
+                                                   int outputIsBinary );
+
 
 
 
@@ -151,6 +173,22 @@ void Connexe_SetMaximumNumberOfComponents( int c )
   _maximum_number_of_components_ = c;
 }
 
+void Connexe_SetUnionFindLabeling( int u ) 
+{
+  _union_find_labeling_ = u;
+}
+
+/* union-find trees are indexed with 32 bits unsigned integers,
+   larger images are labeled with the equivalence table
+*/
+static int _useUnionFindLabeling( int *theDim )
+{
+  if ( _union_find_labeling_ == 0 ) return( 0 );
+  if ( (size_t)theDim[0] * (size_t)theDim[1] * (size_t)theDim[2] >= (size_t)4294967295U )
+    return( 0 );
+  return( 1 );
+}
+
 
 
 
@@ -337,6 +375,7 @@ int CountConnectedComponentsWithAllParams( void *inputBuf,
   typeConnectedComponent *components = (typeConnectedComponent *)NULL;
   int iThreshold = 0;
   int nbFoundCC;
+  int unionFindLabeling = _useUnionFindLabeling( theDim );
   
 
   /* iThreshold is the nearest integer to threshold
@@ -362,14 +401,15 @@ int CountConnectedComponentsWithAllParams( void *inputBuf,
 
 
 
-  components = (typeConnectedComponent *)vtmalloc( _EQUIVALENCE_ARRAY_SIZE_ * sizeof(typeConnectedComponent),
-                                                   "components", proc );
-  if ( components == (typeConnectedComponent *)NULL ) {
-    if ( (typeOut != USHORT) && (typeOut != SSHORT) ) vtfree( tmpBuf );
-    if ( _verbose_)
-      fprintf( stderr, "%s: unable to allocate equivalence array\n", proc );
-    return( -1 );
-    
+  if ( unionFindLabeling == 0 ) {
+    components = (typeConnectedComponent *)vtmalloc( _EQUIVALENCE_ARRAY_SIZE_ * sizeof(typeConnectedComponent),
+                                                     "components", proc );
+    if ( components == (typeConnectedComponent *)NULL ) {
+      if ( (typeOut != USHORT) && (typeOut != SSHORT) ) vtfree( tmpBuf );
+      if ( _verbose_)
+        fprintf( stderr, "%s: unable to allocate equivalence array\n", proc );
+      return( -1 );
+    }
   }
 
 
@@ -424,6 +464,27 @@ int CountConnectedComponentsWithAllParams( void *inputBuf,
 
 
   
+  /* union-find labeling
+   */
+  if ( unionFindLabeling ) {
+    nbFoundCC = UnionFindConnectedComponentsExtraction( tmpBuf, outputBuf, typeOut, theDim,
+                                                        connectivity, minNumberOfPts, minNumberOfPts,
+                                                        maxNumberOfConnectedComponent, outputIsBinary );
+    if ( (typeOut != USHORT) && (typeOut != SSHORT) ) vtfree( tmpBuf );
+    if ( nbFoundCC < 0 ) {
+      if ( _verbose_ ) {
+        fprintf( stderr, "%s: Unable to count the connected components\n", proc );
+      }
+      return( -1 );
+    }
+    if ( _verbose_ ) {
+      fprintf( stderr, "%s: found %d connected components\n", proc, nbFoundCC );
+    }
+    return( nbFoundCC );
+  }
+
+
+
   /* on compte
    */
   if ( InternalConnectedComponentsExtraction( tmpBuf, theDim, &components, 
@@ -538,6 +599,7 @@ int HysteresisThresholdingWithAllParams( void *inputBuf,
   int nbFoundCC;
   int iLowThreshold = 0;
   int iHighThreshold = 0;
+  int unionFindLabeling = _useUnionFindLabeling( theDim );
 
 
 
@@ -565,14 +627,15 @@ int HysteresisThresholdingWithAllParams( void *inputBuf,
   }
 
 
-  components = (typeConnectedComponent *)vtmalloc( _EQUIVALENCE_ARRAY_SIZE_ * sizeof(typeConnectedComponent),
-                                                   "components", proc );
-  if ( components == (typeConnectedComponent *)NULL ) {
-    if ( (typeOut != USHORT) && (typeOut != SSHORT) ) vtfree( tmpBuf );
-    if ( _verbose_)
-      fprintf( stderr, "%s: unable to allocate equivalence array\n", proc );
-    return( -1 );
-    
+  if ( unionFindLabeling == 0 ) {
+    components = (typeConnectedComponent *)vtmalloc( _EQUIVALENCE_ARRAY_SIZE_ * sizeof(typeConnectedComponent),
+                                                     "components", proc );
+    if ( components == (typeConnectedComponent *)NULL ) {
+      if ( (typeOut != USHORT) && (typeOut != SSHORT) ) vtfree( tmpBuf );
+      if ( _verbose_)
+        fprintf( stderr, "%s: unable to allocate equivalence array\n", proc );
+      return( -1 );
+    }
   }
 
 
@@ -644,6 +707,27 @@ int HysteresisThresholdingWithAllParams( void *inputBuf,
 
 
   
+  /* union-find labeling
+   */
+  if ( unionFindLabeling ) {
+    nbFoundCC = UnionFindConnectedComponentsExtraction( tmpBuf, outputBuf, typeOut, theDim,
+                                                        connectivity, minNumberOfPtsAboveLow, minNumberOfPtsAboveHigh,
+                                                        maxNumberOfConnectedComponent, outputIsBinary );
+    if ( (typeOut != USHORT) && (typeOut != SSHORT) ) vtfree( tmpBuf );
+    if ( nbFoundCC < 0 ) {
+      if ( _verbose_ ) {
+        fprintf( stderr, "%s: Unable to count the connected components\n", proc );
+      }
+      return( -1 );
+    }
+    if ( _verbose_ ) {
+      fprintf( stderr, "%s: found %d connected components\n", proc, nbFoundCC );
+    }
+    return( nbFoundCC );
+  }
+
+
+
   /* on compte
    */
   if ( InternalConnectedComponentsExtraction( tmpBuf, theDim, &components, connectivity, 
@@ -2272,3 +2356,528 @@ int RelabelConnectedComponentsByDecreasingSize( void *inputBuf,
   return( 1 );
 }
 
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+/************************************************************
+ *
+ * union-find labeling
+ *
+ ************************************************************/
+
+/* The image is cut into slabs (of z-slices in 3D, of rows in 2D)
+ * that are labeled in parallel: each point is given its index as
+ * provisional label, and is merged with its causal neighbors
+ * (in the same slab) with a union-find structure (path halving).
+ * The trees are built so that a root is always the first point 
+ * (in raster order) of its tree, i.e. parent[i] <= i.
+ * Then the first plane of each slab is merged with the last plane
+ * of the previous one, and labels are flattened and counted with
+ * a last raster scan.
+ *
+ * Contrary to InternalConnectedComponentsExtraction(), there is 
+ * no limitation on the number of intermediary labels.
+ */
+
+typedef struct {
+  unsigned short int *inputBuf;
+  u32 *parent;
+  int *theDim;
+  int nneighbors;
+  int neighbors[13][3];
+  size_t offsets[13];
+  typeConnectedComponent *cc;
+  void *outputBuf;
+  bufferType typeOut;
+} _typeUnionFindParameter;
+
+
+
+static u32 _findRoot( u32 *parent, u32 i )
+{
+  while ( parent[i] != i ) {
+    parent[i] = parent[ parent[i] ];
+    i = parent[i];
+  }
+  return( i );
+}
+
+
+
+static void _unionRoots( u32 *parent, u32 i, u32 j )
+{
+  i = _findRoot( parent, i );
+  j = _findRoot( parent, j );
+  if ( i < j ) parent[j] = i;
+  else if ( j < i ) parent[i] = j;
+}
+
+
+
+/* causal neighbors (the ones before the current point in raster order)
+ */
+static int _initUnionFindNeighbors( _typeUnionFindParameter *p, int connectivity )
+{
+  int n = 0;
+  int dimx = p->theDim[0];
+  int dimxy = p->theDim[0] * p->theDim[1];
+
+#define _ADD_NEIGHBOR_( X, Y, Z ) {                       \
+    p->neighbors[n][0] = X;                               \
+    p->neighbors[n][1] = Y;                               \
+    p->neighbors[n][2] = Z;                               \
+    p->offsets[n] = (size_t)(-( X + (Y)*dimx + (Z)*dimxy )); \
+    n++;                                                  \
+  }
+
+  switch ( connectivity ) {
+  default :
+    return( -1 );
+  case 4 :
+  case 8 :
+  case 6 :
+  case 10 :
+  case 18 :
+  case 26 :
+    _ADD_NEIGHBOR_( -1,  0,  0 );
+    _ADD_NEIGHBOR_(  0, -1,  0 );
+  }
+
+  switch ( connectivity ) {
+  default :
+    break;
+  case 8 :
+    _ADD_NEIGHBOR_( -1, -1,  0 );
+    _ADD_NEIGHBOR_(  1, -1,  0 );
+    break;
+  case 26 :
+    _ADD_NEIGHBOR_( -1, -1, -1 );
+    _ADD_NEIGHBOR_(  1, -1, -1 );
+    _ADD_NEIGHBOR_( -1,  1, -1 );
+    _ADD_NEIGHBOR_(  1,  1, -1 );
+    /* falls through */
+  case 18 :
+    _ADD_NEIGHBOR_(  0, -1, -1 );
+    _ADD_NEIGHBOR_( -1,  0, -1 );
+    _ADD_NEIGHBOR_(  1,  0, -1 );
+    _ADD_NEIGHBOR_(  0,  1, -1 );
+    /* falls through */
+  case 10 :
+    _ADD_NEIGHBOR_( -1, -1,  0 );
+    _ADD_NEIGHBOR_(  1, -1,  0 );
+    /* falls through */
+  case 6 :
+    _ADD_NEIGHBOR_(  0,  0, -1 );
+  }
+
+#undef _ADD_NEIGHBOR_
+
+  p->nneighbors = n;
+  return( n );
+}
+
+
+
+/* labels the planes [firstPlane, lastPlane]
+ * planes are z-slices in 3D and rows in 2D.
+ * if merge == 0, points are initialized and merged with their
+ * causal neighbors in [firstPlane, lastPlane]
+ * if merge != 0, the points of firstPlane (that have already been
+ * initialized) are merged with their causal neighbors in
+ * the plane (firstPlane-1)
+ */
+static void _unionFindLabelPlanes( _typeUnionFindParameter *p,
+                                   int firstPlane, int lastPlane,
+                                   int merge )
+{
+  unsigned short int *theBuf = p->inputBuf;
+  u32 *parent = p->parent;
+  int dimx = p->theDim[0];
+  int dimy = p->theDim[1];
+  int dimz = p->theDim[2];
+  int x, y, z, n, nx, ny;
+  int yfirst, ylast, ylow, zfirst, zlast, zlow, dplane;
+  size_t i, j;
+
+  if ( dimz > 1 ) {
+    yfirst = ylow = 0;   ylast = dimy-1;
+    zfirst = firstPlane; zlast = lastPlane;
+    zlow = ( merge ) ? firstPlane - 1 : firstPlane;
+    dplane = 2;
+  }
+  else {
+    yfirst = firstPlane; ylast = lastPlane;
+    ylow = ( merge ) ? firstPlane - 1 : firstPlane;
+    zfirst = zlast = zlow = 0;
+    dplane = 1;
+  }
+
+  for ( z=zfirst; z<=zlast; z++ )
+  for ( y=yfirst; y<=ylast; y++ ) {
+    i = ((size_t)z * (size_t)dimy + (size_t)y) * (size_t)dimx;
+    for ( x=0; x<dimx; x++, i++ ) {
+      if ( theBuf[i] == 0 ) continue;
+      if ( merge == 0 ) parent[i] = (u32)i;
+      /* inner point: no bound checking
+       */
+      if ( merge == 0 && x > 0 && x < dimx-1 && y > ylow && y < dimy-1
+           && ( dimz == 1 || z > zlow ) ) {
+        for ( n=0; n<p->nneighbors; n++ ) {
+          j = i - p->offsets[n];
+          if ( theBuf[j] == 0 || parent[j] == parent[i] ) continue;
+          _unionRoots( parent, (u32)i, (u32)j );
+        }
+        continue;
+      }
+      for ( n=0; n<p->nneighbors; n++ ) {
+        if ( merge && p->neighbors[n][dplane] == 0 ) continue;
+        nx = x + p->neighbors[n][0];
+        if ( nx < 0 || nx >= dimx ) continue;
+        ny = y + p->neighbors[n][1];
+        if ( ny < ylow || ny >= dimy ) continue;
+        if ( z + p->neighbors[n][2] < zlow ) continue;
+        j = i - p->offsets[n];
+        if ( theBuf[j] == 0 ) continue;
+        /* neighbors are often already in the same tree
+         */
+        if ( parent[j] == parent[i] ) continue;
+        _unionRoots( parent, (u32)i, (u32)j );
+      }
+    }
+  }
+}
+
+
+
+static void *_unionFindLabelSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  _typeUnionFindParameter *p = (_typeUnionFindParameter*)parameter;
+
+  _unionFindLabelPlanes( p, (int)first, (int)last, 0 );
+  chunk->ret = 1;
+  return( (void*)NULL );
+}
+
+
+
+static void *_unionFindRelabelSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  _typeUnionFindParameter *p = (_typeUnionFindParameter*)parameter;
+  unsigned short int *theBuf = p->inputBuf;
+  u32 *parent = p->parent;
+  typeConnectedComponent *cc = p->cc;
+  size_t i;
+  int l;
+
+  /* theBuf may be the output buffer (USHORT or SSHORT output), 
+     it is read at i before being written at i
+  */
+#define _UNIONFIND_RELABEL_( TYPE ) {                   \
+    TYPE *resBuf = (TYPE*)p->outputBuf;                 \
+    for ( i=first; i<=last; i++ ) {                     \
+      l = ( theBuf[i] == 0 ) ? 0 : cc[ parent[i] ].label; \
+      resBuf[i] = (TYPE)l;                              \
+    }                                                   \
+  }
+
+  switch( p->typeOut ) {
+  default :
+    chunk->ret = -1;
+    return( (void*)NULL );
+  case UCHAR :  _UNIONFIND_RELABEL_( u8 );  break;
+  case SCHAR :  _UNIONFIND_RELABEL_( s8 );  break;
+  case USHORT : _UNIONFIND_RELABEL_( u16 ); break;
+  case SSHORT : _UNIONFIND_RELABEL_( s16 ); break;
+  case SINT :   _UNIONFIND_RELABEL_( s32 ); break;
+  case FLOAT :  _UNIONFIND_RELABEL_( r32 ); break;
+  case DOUBLE : _UNIONFIND_RELABEL_( r64 ); break;
+  }
+
+#undef _UNIONFIND_RELABEL_
+
+  chunk->ret = 1;
+  return( (void*)NULL );
+}
+
+
+
+/* sort by decreasing size, then by increasing first point
+ * (ie by increasing index)
+ */
+static int _compareComponentsBySize( const void *a, const void *b )
+{
+  const typeConnectedComponent *ca = (const typeConnectedComponent *)a;
+  const typeConnectedComponent *cb = (const typeConnectedComponent *)b;
+  if ( ca->pointsAboveLowThreshold > cb->pointsAboveLowThreshold ) return( -1 );
+  if ( ca->pointsAboveLowThreshold < cb->pointsAboveLowThreshold ) return( 1 );
+  if ( ca->label < cb->label ) return( -1 );
+  if ( ca->label > cb->label ) return( 1 );
+  return( 0 );
+}
+
+
+
+/* *inputBuf is a buffer containing 3 values (0, _low_value_, 
+ * and _hig_value_), as for InternalConnectedComponentsExtraction().
+ * outputBuf (that may be the same buffer than inputBuf) is filled
+ * with the labels of the valid connected components.
+ *
+ * returns the number of valid connected components, or -1 in
+ * case of error.
+ */
+static int UnionFindConnectedComponentsExtraction( unsigned short int *inputBuf,
+                                                   void *outputBuf,
+                                                   bufferType typeOut,
+                                                   int *theDim,
+                                                   int connectivity,
+                                                   int minNumberOfPtsAboveLow,
+                                                   int minNumberOfPtsAboveHigh,
+                                                   int maxNumberOfConnectedComponent,
+                                                   int outputIsBinary )
+{
+  char *proc = "UnionFindConnectedComponentsExtraction";
+  size_t i, v = (size_t)theDim[0] * (size_t)theDim[1] * (size_t)theDim[2];
+  int nplanes = ( theDim[2] > 1 ) ? theDim[2] : theDim[1];
+  _typeUnionFindParameter p;
+  typeChunks chunks;
+  typeConnectedComponent *cc = (typeConnectedComponent *)NULL;
+  typeConnectedComponent *validCc = (typeConnectedComponent *)NULL;
+  typeConnectedComponent *tmpCc = (typeConnectedComponent *)NULL;
+  u32 *parent = (u32*)NULL;
+  int n, used_labels, valid_labels, kept_labels;
+  int allocated_labels = 0;
+  int label = 1;
+  int maxLabel = 0;
+
+  if ( v >= (size_t)4294967295U ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: image too large\n", proc );
+    return( -1 );
+  }
+
+  switch( typeOut ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: can not deal with such output image type.\n", proc );
+    return( -1 );
+  case UCHAR :  maxLabel = label = 255;   break;
+  case SCHAR :  maxLabel = 127;           break;
+  case USHORT : maxLabel = label = 65535; break;
+  case SSHORT : maxLabel = label = 32767; break;
+  case SINT :
+  case FLOAT :
+  case DOUBLE : break;
+  }
+
+  p.inputBuf = inputBuf;
+  p.theDim = theDim;
+  p.outputBuf = outputBuf;
+  p.typeOut = typeOut;
+  if ( _initUnionFindNeighbors( &p, CheckAndEvaluateConnectivity( connectivity, theDim[2] ) ) <= 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to build neighborhood\n", proc );
+    return( -1 );
+  }
+
+  parent = (u32*)vtmalloc( v * sizeof(u32), "parent", proc );
+  if ( parent == (u32*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
+    return( -1 );
+  }
+  p.parent = parent;
+
+
+
+  /* labeling of slabs
+   */
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, nplanes-1, proc ) != 1 ) {
+    vtfree( parent );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ )
+    chunks.data[n].parameters = (void*)(&p);
+
+  if ( processChunks( &_unionFindLabelSubroutine, &chunks, proc ) != 1 ) {
+    freeChunks( &chunks );
+    vtfree( parent );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to label slabs\n", proc );
+    return( -1 );
+  }
+
+  /* merging slabs
+   */
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    if ( chunks.data[n].first == 0 ) continue;
+    _unionFindLabelPlanes( &p, (int)chunks.data[n].first, (int)chunks.data[n].first, 1 );
+  }
+  freeChunks( &chunks );
+
+
+
+  /* flattening
+     roots are the first points of their trees, they are
+     parsed before the other points of the tree: the root value 
+     is replaced by the component index, and the other points 
+     get the value of their (already processed) parent.
+  */
+  used_labels = 0;
+  for ( i=0; i<v; i++ ) {
+    if ( inputBuf[i] == 0 ) continue;
+    if ( parent[i] == (u32)i ) {
+      if ( used_labels == allocated_labels ) {
+        allocated_labels += ( allocated_labels < 1024 ) ? 1024 : allocated_labels;
+        tmpCc = (typeConnectedComponent *)vtmalloc( allocated_labels * sizeof(typeConnectedComponent),
+                                                    "tmpCc", proc );
+        if ( tmpCc == (typeConnectedComponent *)NULL ) {
+          if ( cc != (typeConnectedComponent *)NULL ) vtfree( cc );
+          vtfree( parent );
+          if ( _verbose_ )
+            fprintf( stderr, "%s: unable to allocate components array\n", proc );
+          return( -1 );
+        }
+        if ( used_labels > 0 ) {
+          (void)memcpy( tmpCc, cc, used_labels * sizeof(typeConnectedComponent) );
+          vtfree( cc );
+        }
+        cc = tmpCc;
+      }
+      cc[used_labels].label = used_labels;
+      cc[used_labels].pointsAboveLowThreshold = 0;
+      cc[used_labels].pointsAboveHighThreshold = 0;
+      cc[used_labels].completelyProcessed = 1;
+      parent[i] = (u32)used_labels++;
+    }
+    else {
+      parent[i] = parent[ parent[i] ];
+    }
+    cc[ parent[i] ].pointsAboveLowThreshold ++;
+    if ( inputBuf[i] >= _hig_value_ ) cc[ parent[i] ].pointsAboveHighThreshold ++;
+  }
+
+
+
+  /* valid components are numbered in raster order
+   */
+  valid_labels = 0;
+  for ( n=0; n<used_labels; n++ ) {
+    if ( (cc[ n ].pointsAboveHighThreshold >= minNumberOfPtsAboveHigh)
+         && (cc[ n ].pointsAboveLowThreshold >= minNumberOfPtsAboveLow) )
+      cc[ n ].label = ++valid_labels;
+    else
+      cc[ n ].label = 0;
+  }
+  kept_labels = valid_labels;
+
+  if ( _verbose_ ) {
+    fprintf( stderr, "%s: number of valid connected components: %5d (out of %d)\n", 
+             proc, valid_labels, used_labels );
+  }
+
+  
+
+  /* the largest ones are kept, and numbered by decreasing size
+   */
+  if ( maxNumberOfConnectedComponent > 0 && valid_labels > 0 ) {
+    validCc = (typeConnectedComponent *)vtmalloc( valid_labels * sizeof(typeConnectedComponent),
+                                                  "validCc", proc );
+    if ( validCc == (typeConnectedComponent *)NULL ) {
+      vtfree( cc );
+      vtfree( parent );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: allocation failed for auxiliary array (to sort connected components)\n", proc );
+      return( -1 );
+    }
+    for ( n=0; n<used_labels; n++ ) {
+      if ( cc[n].label > 0 ) {
+        validCc[ cc[n].label-1 ] = cc[n];
+        validCc[ cc[n].label-1 ].pointsAboveHighThreshold = n;
+      }
+    }
+    qsort( validCc, (size_t)valid_labels, sizeof(typeConnectedComponent), &_compareComponentsBySize );
+    if ( kept_labels > maxNumberOfConnectedComponent )
+      kept_labels = maxNumberOfConnectedComponent;
+    for ( n=0; n<valid_labels; n++ )
+      cc[ validCc[n].pointsAboveHighThreshold ].label = ( n < kept_labels ) ? n+1 : 0;
+    vtfree( validCc );
+  }
+
+
+
+  /* output
+   */
+  if ( outputIsBinary ) {
+    for ( n=0; n<used_labels; n++ )
+      if ( cc[n].label > 0 ) cc[n].label = label;
+  }
+  else if ( maxLabel > 0 && kept_labels > maxLabel ) {
+    if ( _verbose_ ) {
+      fprintf( stderr, "%s: found more than %d connected components\n", proc, maxLabel );
+      fprintf( stderr, "\t different components will have the same label\n" );
+    }
+  }
+
+  p.cc = cc;
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, v-1, proc ) != 1 ) {
+    vtfree( cc );
+    vtfree( parent );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ )
+    chunks.data[n].parameters = (void*)(&p);
+
+  if ( processChunks( &_unionFindRelabelSubroutine, &chunks, proc ) != 1 ) {
+    freeChunks( &chunks );
+    vtfree( cc );
+    vtfree( parent );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to relabel output buffer\n", proc );
+    return( -1 );
+  }
+
+  freeChunks( &chunks );
+  vtfree( cc );
+  vtfree( parent );
+
+  return( kept_labels );
+}
@@ -69,7 +69,8 @@ extern "C" {
  * At this point, intermediary computation is performed
  * in an buffer of type (unsigned short int). Some 
  * limitation about the number of intermediary labels
- * may appear (I never see it).
+ * may appear (I never see it) with the sequential labeling
+ * (see Connexe_SetUnionFindLabeling).
  *
  * Complete description of the method may be found in the 
  * code.
@@ -379,6 +380,21 @@ extern void Connexe_SetMinimumSizeOfComponents( int c );
 extern void Connexe_SetMaximumNumberOfComponents( int c );
 
 
+/* Choose the labeling method.
+ *
+ * DESCRIPTION:
+ * If u != 0 (default), connected components are labeled with a 
+ * union-find structure: the image is cut into slabs that are
+ * labeled in parallel and then merged. There is no limitation 
+ * about the number of intermediary labels, and more than 65535
+ * connected components can be labeled (with a SINT, FLOAT or DOUBLE
+ * output buffer).
+ * If u == 0, the former sequential labeling (with a fixed 
+ * size equivalence table of 65536 labels) is used.
+ */
+extern void Connexe_SetUnionFindLabeling( int u );
+
+
 
 
 /* Turn on verbose mode.
@@ -0,0 +1,615 @@
+/*************************************************************************
+ * euclideandistance.c - computation of exact euclidean distances
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ *
+ *
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+#include <chunks.h>
+#include <convert.h>
+#include <vtmalloc.h>
+
+#include <euclideandistance.h>
+
+
+
+static int _verbose_ = 1;
+
+void setVerboseInEuclideanDistance( int v )
+{
+  _verbose_ = v;
+}
+
+void incrementVerboseInEuclideanDistance(  )
+{
+  _verbose_ ++;
+}
+
+void decrementVerboseInEuclideanDistance(  )
+{
+  _verbose_ --;
+  if ( _verbose_ < 0 ) _verbose_ = 0;
+}
+
+
+
+#define _EDT_INFINITY_ FLT_MAX
+
+
+
+
+
+/*------------------------------------------------------------
+ *
+ * 1D processing
+ *
+ *------------------------------------------------------------*/
+
+
+
+typedef struct {
+  r32 *theDist;
+  void *theLabel;
+  bufferType typeLabel;
+  /* line description: the n-th line starts at
+     ( n / lineModulo ) * lineJump + ( n % lineModulo ) * lineStride
+     and its points are separated by pointStride
+   */
+  size_t lineModulo;
+  size_t lineJump;
+  size_t lineStride;
+  size_t pointStride;
+  int length;
+  double squaredSpacing;
+} _typeEDTParameter;
+
+
+
+/* lower envelope of the parabolas y = f[p] + s2 * (x-p)^2
+   - v[] are the indices of the parabolas of the envelope
+   - z[] are the boundaries between parabolas
+ */
+static void *_edtLineSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  char *proc = "_edtLineSubroutine";
+  _typeEDTParameter *p = (_typeEDTParameter*)parameter;
+  int n = p->length;
+  double s2 = p->squaredSpacing;
+  double *f, *z, s = 0.0;
+  int *v, *lab = (int*)NULL;
+  char *auxBuf;
+  size_t i, l, o;
+  int k, j, q;
+
+  auxBuf = (char*)vtmalloc( (2*n+1) * sizeof(double) + 2*n * sizeof(int), "auxBuf", proc );
+  if ( auxBuf == (char*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
+    chunk->ret = -1;
+    return( (void*)NULL );
+  }
+  f = (double*)auxBuf;
+  z = f + n;
+  v = (int*)(z + n + 1);
+  if ( p->theLabel != (void*)NULL ) lab = v + n;
+
+  for ( i=first; i<=last; i++ ) {
+
+    o = (i / p->lineModulo) * p->lineJump + (i % p->lineModulo) * p->lineStride;
+
+    /* acquiring the line
+     */
+    for ( l=o, q=0; q<n; q++, l+=p->pointStride )
+      f[q] = p->theDist[l];
+    if ( lab != (int*)NULL ) {
+      switch( p->typeLabel ) {
+      default :
+        vtfree( auxBuf );
+        chunk->ret = -1;
+        return( (void*)NULL );
+      case UCHAR :
+        for ( l=o, q=0; q<n; q++, l+=p->pointStride ) lab[q] = ((u8*)p->theLabel)[l];
+        break;
+      case USHORT :
+        for ( l=o, q=0; q<n; q++, l+=p->pointStride ) lab[q] = ((u16*)p->theLabel)[l];
+        break;
+      case SSHORT :
+        for ( l=o, q=0; q<n; q++, l+=p->pointStride ) lab[q] = ((s16*)p->theLabel)[l];
+        break;
+      case SINT :
+        for ( l=o, q=0; q<n; q++, l+=p->pointStride ) lab[q] = ((i32*)p->theLabel)[l];
+        break;
+      }
+    }
+
+    /* lower envelope
+     */
+    for ( k=-1, q=0; q<n; q++ ) {
+      if ( f[q] >= _EDT_INFINITY_ ) continue;
+      while ( k >= 0 ) {
+        s = ( (f[q] + s2*q*q) - (f[v[k]] + s2*v[k]*v[k]) ) / ( 2.0 * s2 * (q - v[k]) );
+        if ( s > z[k] ) break;
+        k --;
+      }
+      k ++;
+      v[k] = q;
+      z[k] = ( k == 0 ) ? -HUGE_VAL : s;
+    }
+
+    /* no object point in the line: nothing to be done
+     */
+    if ( k < 0 ) continue;
+
+    /* distance (and label) computation
+     */
+    for ( l=o, j=0, q=0; q<n; q++, l+=p->pointStride ) {
+      while ( j < k && z[j+1] < q ) j++;
+      p->theDist[l] = f[v[j]] + s2 * (q-v[j]) * (q-v[j]);
+    }
+    if ( lab != (int*)NULL ) {
+      switch( p->typeLabel ) {
+      default :
+        break;
+      case UCHAR :
+        for ( l=o, j=0, q=0; q<n; q++, l+=p->pointStride ) {
+          while ( j < k && z[j+1] < q ) j++;
+          ((u8*)p->theLabel)[l] = lab[v[j]];
+        }
+        break;
+      case USHORT :
+        for ( l=o, j=0, q=0; q<n; q++, l+=p->pointStride ) {
+          while ( j < k && z[j+1] < q ) j++;
+          ((u16*)p->theLabel)[l] = lab[v[j]];
+        }
+        break;
+      case SSHORT :
+        for ( l=o, j=0, q=0; q<n; q++, l+=p->pointStride ) {
+          while ( j < k && z[j+1] < q ) j++;
+          ((s16*)p->theLabel)[l] = lab[v[j]];
+        }
+        break;
+      case SINT :
+        for ( l=o, j=0, q=0; q<n; q++, l+=p->pointStride ) {
+          while ( j < k && z[j+1] < q ) j++;
+          ((i32*)p->theLabel)[l] = lab[v[j]];
+        }
+        break;
+      }
+    }
+
+  }
+
+  vtfree( auxBuf );
+  chunk->ret = 1;
+  return( (void*)NULL );
+}
+
+
+
+/* compute the squared euclidean distance
+ * theDist has been initialized with 0 (object), _EDT_INFINITY_ (background)
+ * if given, theLabel is used for a skiz computation
+ */
+static int _ComputeSquaredEuclideanDistanceInInitializedImage( r32 *theDist,
+                                                               void *theLabel,
+                                                               bufferType typeLabel,
+                                                               int *theDim,
+                                                               double *voxelSize,
+                                                               int dimension )
+{
+  char *proc = "_ComputeSquaredEuclideanDistanceInInitializedImage";
+  _typeEDTParameter p;
+  typeChunks chunks;
+  size_t dimx = theDim[0];
+  size_t dimy = theDim[1];
+  size_t dimz = theDim[2];
+  int d, n;
+
+  switch( typeLabel ) {
+  default :
+    if ( theLabel != (void*)NULL ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: such label type not handled yet\n", proc );
+      return( -1 );
+    }
+    break;
+  case UCHAR :
+  case USHORT :
+  case SSHORT :
+  case SINT :
+    break;
+  }
+
+  p.theDist = theDist;
+  p.theLabel = theLabel;
+  p.typeLabel = typeLabel;
+
+  for ( d=0; d<3; d++ ) {
+    if ( theDim[d] == 1 ) continue;
+    if ( d == 2 && dimension == 2 ) continue;
+
+    p.length = theDim[d];
+    p.squaredSpacing = ( voxelSize == (double*)NULL ) ? 1.0 : voxelSize[d] * voxelSize[d];
+
+    switch( d ) {
+    default :
+    case 0 :
+      /* n = z*dimy+y */
+      p.lineModulo = dimy*dimz;   p.lineJump = 0;
+      p.lineStride = dimx;        p.pointStride = 1;
+      break;
+    case 1 :
+      /* n = z*dimx+x */
+      p.lineModulo = dimx;        p.lineJump = dimx*dimy;
+      p.lineStride = 1;           p.pointStride = dimx;
+      break;
+    case 2 :
+      /* n = y*dimx+x */
+      p.lineModulo = dimx*dimy;   p.lineJump = 0;
+      p.lineStride = 1;           p.pointStride = dimx*dimy;
+      break;
+    }
+
+    initChunks( &chunks );
+    if ( buildChunks( &chunks, 0, (dimx*dimy*dimz)/theDim[d]-1, proc ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to compute chunks\n", proc );
+      return( -1 );
+    }
+    for ( n=0; n<chunks.n_allocated_chunks; n++ )
+      chunks.data[n].parameters = (void*)(&p);
+
+    if ( processChunks( &_edtLineSubroutine, &chunks, proc ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to process along direction #%d\n", proc, d );
+      freeChunks( &chunks );
+      return( -1 );
+    }
+    freeChunks( &chunks );
+  }
+
+  return( 1 );
+}
+
+
+
+/* object points are the ones with value >= threshold
+ * (or < threshold if inverse is set)
+ */
+static int _InitializeSquaredEuclideanDistanceMap( void *inputBuf,
+                                                   bufferType typeIn,
+                                                   r32 *theDist,
+                                                   size_t v,
+                                                   double threshold,
+                                                   int inverse )
+{
+  char *proc = "_InitializeSquaredEuclideanDistanceMap";
+  r32 in = ( inverse ) ? 0.0 : _EDT_INFINITY_;
+  r32 out = ( inverse ) ? _EDT_INFINITY_ : 0.0;
+  size_t i;
+
+  switch ( typeIn ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such input type is not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+    {
+      u8 *theBuf = (u8*)inputBuf;
+      for ( i=0; i<v; i++ )
+        theDist[i] = ( theBuf[i] < threshold ) ? in : out;
+    }
+    break;
+  case USHORT :
+    {
+      u16 *theBuf = (u16*)inputBuf;
+      for ( i=0; i<v; i++ )
+        theDist[i] = ( theBuf[i] < threshold ) ? in : out;
+    }
+    break;
+  case SSHORT :
+    {
+      s16 *theBuf = (s16*)inputBuf;
+      for ( i=0; i<v; i++ )
+        theDist[i] = ( theBuf[i] < threshold ) ? in : out;
+    }
+    break;
+  case SINT :
+    {
+      i32 *theBuf = (i32*)inputBuf;
+      for ( i=0; i<v; i++ )
+        theDist[i] = ( theBuf[i] < threshold ) ? in : out;
+    }
+    break;
+  case FLOAT :
+    {
+      r32 *theBuf = (r32*)inputBuf;
+      for ( i=0; i<v; i++ )
+        theDist[i] = ( theBuf[i] < threshold ) ? in : out;
+    }
+    break;
+  }
+
+  return( 1 );
+}
+
+
+
+
+
+/*------------------------------------------------------------
+ *
+ * distance map
+ *
+ *------------------------------------------------------------*/
+
+
+
+int computeSquaredEuclideanDistanceMap( void *inputBuf,
+                                        bufferType typeIn,
+                                        void *outputBuf,
+                                        bufferType typeOut,
+                                        int *theDim,
+                                        double *voxelSize,
+                                        double threshold,
+                                        int dimension )
+{
+  char *proc = "computeSquaredEuclideanDistanceMap";
+  r32 *tmpBuf = (r32*)NULL;
+  size_t v = (size_t)theDim[0]*(size_t)theDim[1]*(size_t)theDim[2];
+
+  switch( typeOut ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such output type is not handled yet\n", proc );
+    return( -1 );
+  case FLOAT :
+    tmpBuf = (r32*)outputBuf;
+    break;
+  case DOUBLE :
+    tmpBuf = (r32*)vtmalloc( v * sizeof(r32), "tmpBuf", proc );
+    if ( tmpBuf == (r32*)NULL ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
+      return( -1 );
+    }
+    break;
+  }
+
+  if ( _InitializeSquaredEuclideanDistanceMap( inputBuf, typeIn, tmpBuf, v, threshold, 0 ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to initialize distance map\n", proc );
+    if ( (void*)tmpBuf != outputBuf ) vtfree( tmpBuf );
+    return( -1 );
+  }
+
+  if ( _ComputeSquaredEuclideanDistanceInInitializedImage( tmpBuf, (void*)NULL, TYPE_UNKNOWN,
+                                                           theDim, voxelSize, dimension ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute distance map\n", proc );
+    if ( (void*)tmpBuf != outputBuf ) vtfree( tmpBuf );
+    return( -1 );
+  }
+
+  if ( (void*)tmpBuf != outputBuf ) {
+    if ( ConvertBuffer( tmpBuf, FLOAT, outputBuf, typeOut, v ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to convert distance map\n", proc );
+      vtfree( tmpBuf );
+      return( -1 );
+    }
+    vtfree( tmpBuf );
+  }
+
+  return( 1 );
+}
+
+
+
+
+
+/*------------------------------------------------------------
+ *
+ * SKIZ: computation of influence zones
+ *
+ *------------------------------------------------------------*/
+
+
+
+int skizWithEuclideanDistance( void *labelBuf,
+                               bufferType typeLabel,
+                               void *distBuf,
+                               bufferType typeDist,
+                               int *theDim,
+                               double *voxelSize,
+                               int dimension )
+{
+  char *proc = "skizWithEuclideanDistance";
+  r32 *tmpBuf = (r32*)NULL;
+  size_t i, v = (size_t)theDim[0]*(size_t)theDim[1]*(size_t)theDim[2];
+
+  if ( typeDist == FLOAT && distBuf != (void*)NULL ) {
+    tmpBuf = (r32*)distBuf;
+  }
+  else {
+    tmpBuf = (r32*)vtmalloc( v * sizeof(r32), "tmpBuf", proc );
+    if ( tmpBuf == (r32*)NULL ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
+      return( -1 );
+    }
+  }
+
+  /* initialization from a label image
+   */
+  if ( _InitializeSquaredEuclideanDistanceMap( labelBuf, typeLabel, tmpBuf, v, 1.0, 0 ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to initialize distance map\n", proc );
+    if ( (void*)tmpBuf != distBuf ) vtfree( tmpBuf );
+    return( -1 );
+  }
+
+  if ( _ComputeSquaredEuclideanDistanceInInitializedImage( tmpBuf, labelBuf, typeLabel,
+                                                           theDim, voxelSize, dimension ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute distance map\n", proc );
+    if ( (void*)tmpBuf != distBuf ) vtfree( tmpBuf );
+    return( -1 );
+  }
+
+  if ( distBuf != (void*)NULL ) {
+    for ( i=0; i<v; i++ )
+      if ( tmpBuf[i] < _EDT_INFINITY_ ) tmpBuf[i] = sqrt( tmpBuf[i] );
+    if ( ConvertBuffer( (void*)tmpBuf, FLOAT, distBuf, typeDist, v ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to convert distance map\n", proc );
+      if ( (void*)tmpBuf != distBuf ) vtfree( tmpBuf );
+      return( -1 );
+    }
+  }
+
+  if ( (void*)tmpBuf != distBuf ) vtfree( tmpBuf );
+  return( 1 );
+}
+
+
+
+
+
+/*------------------------------------------------------------
+ *
+ * Mathematical Morphology Operations
+ *
+ *------------------------------------------------------------*/
+
+
+
+static int _morphologicalOperationWithEuclideanDistance( void *inputBuf,
+                                                         void *resultBuf,
+                                                         bufferType type,
+                                                         int *theDim,
+                                                         int radius, int dimension,
+                                                         int erosion )
+{
+  char *proc = "_morphologicalOperationWithEuclideanDistance";
+  r32 *distBuf = (r32*)NULL;
+  size_t i, v = (size_t)theDim[0]*(size_t)theDim[1]*(size_t)theDim[2];
+  double r2 = (double)radius * (double)radius;
+
+  if ( radius <= 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: negative radius\n", proc );
+    return( -1 );
+  }
+
+  distBuf = (r32*)vtmalloc( v * sizeof(r32), "distBuf", proc );
+  if ( distBuf == (r32*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation error\n", proc );
+    return( -1 );
+  }
+
+  /* dilation: distance to the object
+     erosion: distance to the background
+   */
+  if ( _InitializeSquaredEuclideanDistanceMap( inputBuf, type, distBuf, v, 1.0, erosion ) != 1 ) {
+    vtfree( distBuf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to initialize distance\n", proc );
+    return( -1 );
+  }
+
+  if ( _ComputeSquaredEuclideanDistanceInInitializedImage( distBuf, (void*)NULL, TYPE_UNKNOWN,
+                                                           theDim, (double*)NULL,
+                                                           ( theDim[2] == 1 ) ? 2 : dimension ) != 1 ) {
+    vtfree( distBuf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute distance\n", proc );
+    return( -1 );
+  }
+
+  switch( type ) {
+  default :
+    vtfree( distBuf );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type is not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+    {
+      u8 *theBuf = (u8*)resultBuf;
+      if ( erosion )
+        for ( i=0; i<v; i++ ) theBuf[i] = ( distBuf[i] > r2 ) ? 255 : 0;
+      else
+        for ( i=0; i<v; i++ ) theBuf[i] = ( distBuf[i] <= r2 ) ? 255 : 0;
+    }
+    break;
+  case USHORT :
+    {
+      u16 *theBuf = (u16*)resultBuf;
+      if ( erosion )
+        for ( i=0; i<v; i++ ) theBuf[i] = ( distBuf[i] > r2 ) ? 65535 : 0;
+      else
+        for ( i=0; i<v; i++ ) theBuf[i] = ( distBuf[i] <= r2 ) ? 65535 : 0;
+    }
+    break;
+  case SSHORT :
+    {
+      s16 *theBuf = (s16*)resultBuf;
+      if ( erosion )
+        for ( i=0; i<v; i++ ) theBuf[i] = ( distBuf[i] > r2 ) ? 32767 : 0;
+      else
+        for ( i=0; i<v; i++ ) theBuf[i] = ( distBuf[i] <= r2 ) ? 32767 : 0;
+    }
+    break;
+  }
+
+  vtfree( distBuf );
+  return( 1 );
+}
+
+
+
+int morphologicalDilationWithEuclideanDistance( void *inputBuf,
+                                                void *resultBuf,
+                                                bufferType type,
+                                                int *theDim,
+                                                int radius, int dimension )
+{
+  return( _morphologicalOperationWithEuclideanDistance( inputBuf, resultBuf, type, theDim,
+                                                        radius, dimension, 0 ) );
+}
+
+
+
+int morphologicalErosionWithEuclideanDistance( void *inputBuf,
+                                               void *resultBuf,
+                                               bufferType type,
+                                               int *theDim,
+                                               int radius, int dimension )
+{
+  return( _morphologicalOperationWithEuclideanDistance( inputBuf, resultBuf, type, theDim,
+                                                        radius, dimension, 1 ) );
+}
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * euclideandistance.h - computation of exact euclidean distances
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ *
+ *
+ *
+ */
+
+#ifndef _euclideandistance_h_
+#define _euclideandistance_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+
+#include <typedefs.h>
+
+
+
+extern void setVerboseInEuclideanDistance( int v );
+extern void incrementVerboseInEuclideanDistance(  );
+extern void decrementVerboseInEuclideanDistance(  );
+
+
+
+/* Exact squared euclidean distance transform
+ *
+ * separable computation (lower envelope of parabolas,
+ * P. Felzenszwalb and D. Huttenlocher, Distance Transforms of
+ * Sampled Functions, Theory of Computing, 2012), linear with
+ * respect to the number of points. Lines are processed
+ * in parallel (see chunks.h).
+ *
+ * the distance is computed to the points with value >= threshold
+ * voxelSize may be NULL (isotropic unit voxels)
+ * if dimension == 2, the distance is computed independently
+ * in each XY slice
+ * outputBuf is of type FLOAT or DOUBLE and receives the squared
+ * distance (in voxelSize units). Points without any object point
+ * in the image get a value of FLT_MAX.
+ */
+extern int computeSquaredEuclideanDistanceMap( void *inputBuf,
+                                               bufferType typeIn,
+                                               void *outputBuf,
+                                               bufferType typeOut,
+                                               int *theDim,
+                                               double *voxelSize,
+                                               double threshold,
+                                               int dimension );
+
+/* compute the skiz image from the input label image with an
+ * exact euclidean distance: each background point (label 0) is
+ * given the label of the closest labeled point.
+ * If distBuf is not NULL, it receives the euclidean distance.
+ * constrained propagation (in a binary mask)
+ * is not handled
+ */
+extern int skizWithEuclideanDistance( void *labelBuf,
+                                      bufferType typeLabel,
+                                      void *distBuf,
+                                      bufferType typeDist,
+                                      int *theDim,
+                                      double *voxelSize,
+                                      int dimension );
+
+
+
+/* morphological operations with an euclidean ball of
+ * radius 'radius' (in voxels)
+ */
+extern int morphologicalDilationWithEuclideanDistance( void *inputBuf,
+                                                       void *resultBuf,
+                                                       bufferType type,
+                                                       int *theDim,
+                                                       int radius, int dimension );
+
+extern int morphologicalErosionWithEuclideanDistance( void *inputBuf,
+                                                      void *resultBuf,
+                                                      bufferType type,
+                                                      int *theDim,
+                                                      int radius, int dimension );
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
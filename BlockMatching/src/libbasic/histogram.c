@@ -13,9 +13,9 @@
  *
  * ADDITIONS, CHANGES
  *
- *
- *
- *
+ * - Mon Oct 19 2026
+ *   parallel filling of histograms from buffers and resampled images
+ *   (private histograms per chunk, with optional lanes)
  *
  */
 
@@ -34,6 +34,7 @@
 
 #include <math.h>
 
+#include <chunks.h>
 #include <convert.h> /* for printType() */
 #include <vtmalloc.h>
 
@@ -1487,6 +1488,201 @@ static void _compute3DContributions( typeWeightedContributions *c,
 
 
 
+/**********************************************************************
+ *
+ * parallel filling tools
+ *
+ * each chunk fills its own private histogram (possibly made of several
+ * lanes), the private histograms are summed up at the end
+ *
+ **********************************************************************/
+
+
+
+static int _lanes_ = 1;
+
+void setLanesInHistogram( int l )
+{
+  _lanes_ = ( l < 1 ) ? 1 : l;
+}
+
+int getLanesInHistogram( )
+{
+  return( _lanes_ );
+}
+
+
+
+
+
+static size_t _sizeofBufferType( bufferType type )
+{
+  switch( type ) {
+  default :      return( 0 );
+  case UCHAR :   return( sizeof( u8 ) );
+  case SCHAR :   return( sizeof( s8 ) );
+  case USHORT :  return( sizeof( u16 ) );
+  case SSHORT :  return( sizeof( s16 ) );
+  case UINT :    return( sizeof( u32 ) );
+  case SINT :    return( sizeof( s32 ) );
+  case FLOAT :   return( sizeof( r32 ) );
+  case DOUBLE :  return( sizeof( r64 ) );
+  }
+  return( 0 );
+}
+
+
+
+static size_t _numberOfBins( typeHistogram *h )
+{
+  size_t size = h->xaxis.dim;
+  if ( h->yaxis.dim > 1 ) 
+    size *= h->yaxis.dim;
+  return( size );
+}
+
+
+
+/* theSum[i] += theData[i], for i in [0, n[
+ */
+static void _addHistogramData( void *theSum, void *theData, 
+                               bufferType typeHisto, size_t n )
+{
+  size_t i;
+
+#define _ADDHISTODATA( TYPEHISTO ) {            \
+  TYPEHISTO *s = (TYPEHISTO*)theSum;             \
+  TYPEHISTO *d = (TYPEHISTO*)theData;            \
+  for ( i=0; i<n; i++ ) s[i] += d[i];            \
+}
+
+  switch( typeHisto ) {
+  default :
+    break;
+  case SINT :
+    _ADDHISTODATA( s32 );
+    break;
+  case UINT :
+    _ADDHISTODATA( u32 );
+    break;
+  case FLOAT :
+    _ADDHISTODATA( r32 );
+    break;
+  case DOUBLE :
+    _ADDHISTODATA( r64 );
+    break;
+  }
+}
+
+
+
+
+
+typedef struct _histogramFillingParam {
+  typeHistogram histo;
+  int nlanes;
+  void *theIm1;
+  bufferType theType1;
+  double *mat1;
+  void *theIm2;
+  bufferType theType2;
+  double *mat2;
+  int *theDim;
+} _histogramFillingParam;
+
+
+
+/* allocates one private histogram of 'nlanes' lanes per chunk,
+   the histogram headers are shared with 'h' (and must not be freed)
+*/
+static _histogramFillingParam *_allocHistogramFillingParams( typeChunks *chunks,
+                                                             typeHistogram *h,
+                                                             int nlanes )
+{
+  char *proc = "_allocHistogramFillingParams";
+  _histogramFillingParam *p = (_histogramFillingParam*)NULL;
+  size_t size = _numberOfBins( h ) * _sizeofBufferType( h->typeHisto ) * (size_t)nlanes;
+  char *data;
+  int n;
+
+  if ( size == 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: histogram type not handled yet\n", proc );
+    return( (_histogramFillingParam*)NULL );
+  }
+
+  p = (_histogramFillingParam*)vtmalloc( chunks->n_allocated_chunks * sizeof(_histogramFillingParam),
+                                        "p", proc );
+  if ( p == (_histogramFillingParam*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate parameters\n", proc );
+    return( (_histogramFillingParam*)NULL );
+  }
+
+  data = (char*)vtmalloc( chunks->n_allocated_chunks * size, "data", proc );
+  if ( data == (char*)NULL ) {
+    vtfree( p );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate private histograms\n", proc );
+    return( (_histogramFillingParam*)NULL );
+  }
+  (void)memset( data, 0, chunks->n_allocated_chunks * size );
+
+  for ( n=0; n<chunks->n_allocated_chunks; n++ ) {
+    (void)memset( &(p[n]), 0, sizeof(_histogramFillingParam) );
+    p[n].histo.xaxis = h->xaxis;
+    p[n].histo.yaxis = h->yaxis;
+    p[n].histo.typeHisto = h->typeHisto;
+    p[n].histo.data = (void*)(data + n * size);
+    p[n].nlanes = nlanes;
+    chunks->data[n].parameters = (void*)(&(p[n]));
+  }
+
+  return( p );
+}
+
+
+
+static void _freeHistogramFillingParams( _histogramFillingParam *p )
+{
+  if ( p == (_histogramFillingParam*)NULL ) return;
+  vtfree( p[0].histo.data );
+  vtfree( p );
+}
+
+
+
+/* processes the chunks, then sums up the private histograms 
+   (and their lanes) into 'h'
+*/
+static int _processHistogramFillingChunks( _chunk_callfunction ftn,
+                                           typeChunks *chunks,
+                                           typeHistogram *h,
+                                           _histogramFillingParam *p,
+                                           char *from )
+{
+  size_t size = _numberOfBins( h );
+  size_t sizeofType = _sizeofBufferType( h->typeHisto );
+  int n, l;
+
+  if ( processChunks( ftn, chunks, from ) != 1 ) 
+    return( -1 );
+  for ( n=0; n<chunks->n_allocated_chunks; n++ ) 
+    if ( chunks->data[n].ret != 1 ) return( -1 );
+
+  for ( n=0; n<chunks->n_allocated_chunks; n++ )
+  for ( l=0; l<p[n].nlanes; l++ )
+    _addHistogramData( h->data, (void*)((char*)p[n].histo.data + l * size * sizeofType),
+                       h->typeHisto, size );
+  return( 1 );
+}
+
+
+
+
+
+
+
 /**********************************************************************
  *
  * 1D histogram filling tools
@@ -1527,28 +1723,34 @@ int fill1DHistogramFromImage( typeHistogram *h,
 
 
 
-int fill1DHistogramFromBuffer( typeHistogram *h, 
-                               void *theIm,
-                               bufferType theType,
-                               size_t v )
+/* fills the 'nlanes' consecutive copies of the histogram data
+   (successive points go to successive copies, this breaks the
+   dependency between consecutive increments of the same bin).
+   The histogram data is not set to 0.
+*/
+static int _fill1DHistogramFromBuffer( typeHistogram *h,
+                                       int nlanes,
+                                       void *theIm,
+                                       bufferType theType,
+                                       size_t v )
 {
-  char *proc = "fill1DHistogramFromBuffer";
+  char *proc = "_fill1DHistogramFromBuffer";
   size_t n;
-
-  if ( _debug_ )
-    fprintf( stderr, " ... entering %s\n", proc );
-
-  zeroHistogram( h );
+  size_t hdim = h->xaxis.dim;
+  int l;
 
 #define _FILL1DHISTO_INDEXS32( TYPEINDEX, TYPEHISTO, TYPEBUF ) { \
   TYPEINDEX min = h->xaxis.min.val_s32;                    \
   TYPEINDEX max = h->xaxis.max.val_s32;                    \
   TYPEHISTO *theHisto = (TYPEHISTO*)h->data;               \
+  TYPEHISTO *theLane = theHisto;                           \
   TYPEBUF *theBuf = (TYPEBUF*)theIm;                       \
-  for ( n=0; n<v; n++, theBuf++ ) {                        \
-    if ( (TYPEINDEX)*theBuf < min ) theHisto[0] ++;        \
-    else if ( (TYPEINDEX)*theBuf > max ) theHisto[h->xaxis.dim-1] ++; \
-    else theHisto[ (int)(*theBuf)-min ] ++;                \
+  for ( l=0, n=0; n<v; n++, theBuf++ ) {                   \
+    if ( (TYPEINDEX)*theBuf < min ) theLane[0] ++;         \
+    else if ( (TYPEINDEX)*theBuf > max ) theLane[hdim-1] ++; \
+    else theLane[ (int)(*theBuf)-min ] ++;                 \
+    if ( ++l < nlanes ) theLane += hdim;                   \
+    else { l = 0; theLane = theHisto; }                    \
   }                                                        \
 }
 
@@ -1556,11 +1758,14 @@ int fill1DHistogramFromBuffer( typeHistogram *h,
   TYPEINDEX min = h->xaxis.min.val_r32;                    \
   TYPEINDEX max = h->xaxis.max.val_r32;                    \
   TYPEHISTO *theHisto = (TYPEHISTO*)h->data;               \
+  TYPEHISTO *theLane = theHisto;                           \
   TYPEBUF *theBuf = (TYPEBUF*)theIm;                       \
-  for ( n=0; n<v; n++, theBuf++ ) {                        \
-    if ( *theBuf < min ) theHisto[0] ++;                   \
-    else if ( *theBuf > max ) theHisto[h->xaxis.dim-1] ++; \
-    else theHisto[ (int)(((float)(*theBuf)-min)/h->xaxis.binlength + 0.5) ] ++; \
+  for ( l=0, n=0; n<v; n++, theBuf++ ) {                   \
+    if ( *theBuf < min ) theLane[0] ++;                    \
+    else if ( *theBuf > max ) theLane[hdim-1] ++;          \
+    else theLane[ (int)(((float)(*theBuf)-min)/h->xaxis.binlength + 0.5) ] ++; \
+    if ( ++l < nlanes ) theLane += hdim;                   \
+    else { l = 0; theLane = theHisto; }                    \
   }                                                        \
 }
 
@@ -1680,6 +1885,83 @@ int fill1DHistogramFromBuffer( typeHistogram *h,
 
 
 
+static void *_fill1DHistogramFromBufferSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  _histogramFillingParam *p = (_histogramFillingParam*)parameter;
+  char *theIm = (char*)p->theIm1 + first * _sizeofBufferType( p->theType1 );
+
+  chunk->ret = _fill1DHistogramFromBuffer( &(p->histo), p->nlanes,
+                                           (void*)theIm, p->theType1, last-first+1 );
+  return( (void*)NULL );
+}
+
+
+
+
+
+int fill1DHistogramFromBuffer( typeHistogram *h, 
+                               void *theIm,
+                               bufferType theType,
+                               size_t v )
+{
+  char *proc = "fill1DHistogramFromBuffer";
+  typeChunks chunks;
+  _histogramFillingParam *p;
+  int n;
+
+  if ( _debug_ )
+    fprintf( stderr, " ... entering %s\n", proc );
+
+  zeroHistogram( h );
+  if ( v == 0 ) return( 1 );
+
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, v-1, proc ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+
+  if ( chunks.n_allocated_chunks == 1 && _lanes_ == 1 ) {
+    freeChunks( &chunks );
+    return( _fill1DHistogramFromBuffer( h, 1, theIm, theType, v ) );
+  }
+
+  p = _allocHistogramFillingParams( &chunks, h, _lanes_ );
+  if ( p == (_histogramFillingParam*)NULL ) {
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate private histograms\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    p[n].theIm1 = theIm;
+    p[n].theType1 = theType;
+  }
+
+  if ( _processHistogramFillingChunks( &_fill1DHistogramFromBufferSubroutine,
+                                       &chunks, h, p, proc ) != 1 ) {
+    _freeHistogramFillingParams( p );
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to fill histogram\n", proc );
+    return( -1 );
+  }
+
+  _freeHistogramFillingParams( p );
+  freeChunks( &chunks );
+  return( 1 );
+}
+
+
+
+
+
 int fill1DHistogramFromMaskedBuffer( typeHistogram *h, 
                                      void *theIm,
                                      bufferType theType,
@@ -2427,17 +2709,21 @@ int fill2DHistogramFromImages( typeHistogram *h,
 
 
 
-int fill2DHistogramFromBuffers( typeHistogram *h, 
-                                void *theIm1,
-                                bufferType theType1,
-                                void *theIm2,
-                                bufferType theType2,
-                                size_t v )
+/* same as _fill1DHistogramFromBuffer(): the histogram data
+   is made of 'nlanes' copies, and is not set to 0.
+*/
+static int _fill2DHistogramFromBuffers( typeHistogram *h,
+                                        int nlanes,
+                                        void *theIm1,
+                                        bufferType theType1,
+                                        void *theIm2,
+                                        bufferType theType2,
+                                        size_t v )
 {
-  char *proc = "fill2DHistogramFromBuffers";
+  char *proc = "_fill2DHistogramFromBuffers";
   size_t n;
-
-  zeroHistogram( h );
+  size_t hdim = _numberOfBins( h );
+  int l;
 
 #define _FILL2DHISTO_INDEXS32S32( TYPEINDEXX, TYPEINDEXY, TYPEHISTO, TYPEBUF1, TYPEBUF2 ) { \
   TYPEINDEXX xmin = h->xaxis.min.val_s32;                  \
@@ -2445,17 +2731,20 @@ int fill2DHistogramFromBuffers( typeHistogram *h,
   TYPEINDEXY ymin = h->yaxis.min.val_s32;                  \
   TYPEINDEXY ymax = h->yaxis.max.val_s32;                  \
   TYPEHISTO *theHisto = (TYPEHISTO*)h->data;               \
+  TYPEHISTO *theLane = theHisto;                           \
   TYPEBUF1 *theBuf1 = (TYPEBUF1*)theIm1;                   \
   TYPEBUF2 *theBuf2 = (TYPEBUF2*)theIm2;                   \
   int xh, yh;                                              \
-  for ( n=0; n<v; n++, theBuf1++, theBuf2++ ) {            \
+  for ( l=0, n=0; n<v; n++, theBuf1++, theBuf2++ ) {       \
     if ( (TYPEINDEXX)*theBuf1 < xmin ) xh = 0;             \
     else if ( (TYPEINDEXX)*theBuf1 > xmax ) xh = h->xaxis.dim-1; \
     else xh = (int)(*theBuf1) - xmin;                      \
     if ( (TYPEINDEXY)*theBuf2 < ymin ) yh = 0;             \
     else if ( (TYPEINDEXY)*theBuf2 > ymax ) yh = h->yaxis.dim-1; \
     else yh = (int)(*theBuf2) - ymin;                      \
-    theHisto[ yh * h->xaxis.dim + xh ] ++;                 \
+    theLane[ yh * h->xaxis.dim + xh ] ++;                  \
+    if ( ++l < nlanes ) theLane += hdim;                   \
+    else { l = 0; theLane = theHisto; }                    \
   }                                                        \
 }
 
@@ -2465,17 +2754,20 @@ int fill2DHistogramFromBuffers( typeHistogram *h,
   TYPEINDEXY ymin = h->yaxis.min.val_r32;                  \
   TYPEINDEXY ymax = h->yaxis.max.val_r32;                  \
   TYPEHISTO *theHisto = (TYPEHISTO*)h->data;               \
+  TYPEHISTO *theLane = theHisto;                           \
   TYPEBUF1 *theBuf1 = (TYPEBUF1*)theIm1;                   \
   TYPEBUF2 *theBuf2 = (TYPEBUF2*)theIm2;                   \
   int xh, yh;                                              \
-  for ( n=0; n<v; n++, theBuf1++, theBuf2++ ) {            \
+  for ( l=0, n=0; n<v; n++, theBuf1++, theBuf2++ ) {       \
     if ( (TYPEINDEXX)*theBuf1 < xmin ) xh = 0;             \
     else if ( (TYPEINDEXX)*theBuf1 > xmax ) xh = h->xaxis.dim-1; \
     else xh = (int)(((float)(*theBuf1)-xmin)/h->xaxis.binlength + 0.5); \
     if ( (TYPEINDEXY)*theBuf2 < ymin ) yh = 0;             \
     else if ( (TYPEINDEXY)*theBuf2 > ymax ) yh = h->yaxis.dim-1; \
     else yh = (int)(((float)(*theBuf2)-ymin)/h->yaxis.binlength + 0.5); \
-    theHisto[ yh * h->xaxis.dim + xh ] ++;                 \
+    theLane[ yh * h->xaxis.dim + xh ] ++;                  \
+    if ( ++l < nlanes ) theLane += hdim;                   \
+    else { l = 0; theLane = theHisto; }                    \
   }                                                        \
 }
 
@@ -2823,6 +3115,86 @@ int fill2DHistogramFromBuffers( typeHistogram *h,
 
 
 
+static void *_fill2DHistogramFromBuffersSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  _histogramFillingParam *p = (_histogramFillingParam*)parameter;
+  char *theIm1 = (char*)p->theIm1 + first * _sizeofBufferType( p->theType1 );
+  char *theIm2 = (char*)p->theIm2 + first * _sizeofBufferType( p->theType2 );
+
+  chunk->ret = _fill2DHistogramFromBuffers( &(p->histo), p->nlanes,
+                                            (void*)theIm1, p->theType1,
+                                            (void*)theIm2, p->theType2, last-first+1 );
+  return( (void*)NULL );
+}
+
+
+
+
+
+int fill2DHistogramFromBuffers( typeHistogram *h, 
+                                void *theIm1,
+                                bufferType theType1,
+                                void *theIm2,
+                                bufferType theType2,
+                                size_t v )
+{
+  char *proc = "fill2DHistogramFromBuffers";
+  typeChunks chunks;
+  _histogramFillingParam *p;
+  int n;
+
+  zeroHistogram( h );
+  if ( v == 0 ) return( 1 );
+
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, v-1, proc ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+
+  if ( chunks.n_allocated_chunks == 1 && _lanes_ == 1 ) {
+    freeChunks( &chunks );
+    return( _fill2DHistogramFromBuffers( h, 1, theIm1, theType1, theIm2, theType2, v ) );
+  }
+
+  p = _allocHistogramFillingParams( &chunks, h, _lanes_ );
+  if ( p == (_histogramFillingParam*)NULL ) {
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate private histograms\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    p[n].theIm1 = theIm1;
+    p[n].theType1 = theType1;
+    p[n].theIm2 = theIm2;
+    p[n].theType2 = theType2;
+  }
+
+  if ( _processHistogramFillingChunks( &_fill2DHistogramFromBuffersSubroutine,
+                                       &chunks, h, p, proc ) != 1 ) {
+    _freeHistogramFillingParams( p );
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to fill histogram\n", proc );
+    return( -1 );
+  }
+
+  _freeHistogramFillingParams( p );
+  freeChunks( &chunks );
+  return( 1 );
+}
+
+
+
+
+
 
 
 int fill2DHistogramFromMaskedBuffers( typeHistogram *h, 
@@ -3050,25 +3422,28 @@ int fill2DHistogramFromMaskedBuffers( typeHistogram *h,
 
 
 
-int fill2DHistogramFromResampledImages( typeHistogram *h, 
-                                        void *theIm1,
-                                        bufferType theType1,
-                                        double *mat1,
-                                        void *theIm2,
-                                        bufferType theType2,
-                                        double *mat2,
-                                        int *theDim )
+/* the resampled values are computed on the fly and binned,
+   for the planes [firstPlane, lastPlane] of the grid (rows in 2D,
+   slices in 3D). The histogram data is not set to 0.
+*/
+static int _fill2DHistogramFromResampledImages( typeHistogram *h, 
+                                                void *theIm1,
+                                                bufferType theType1,
+                                                double *mat1,
+                                                void *theIm2,
+                                                bufferType theType2,
+                                                double *mat2,
+                                                int *theDim,
+                                                int firstPlane,
+                                                int lastPlane )
 {
-  char *proc = "fill2DHistogramFromResampledImages";
+  char *proc = "_fill2DHistogramFromResampledImages";
   int i, j, k, n1, n2;
   int dimx = theDim[0];
   int dimy = theDim[1];
-  int dimz = theDim[2];
   int dimxy = dimx*dimy;
   typeWeightedContributions c1, c2;
 
-  zeroHistogram( h );
-
 #define _FILL2DHISTO_INDEXS32S32WITHTRSF( TYPEINDEXX, TYPEINDEXY, TYPEHISTO, TYPEBUF1, TYPEBUF2 ) { \
   TYPEINDEXX xmin = h->xaxis.min.val_s32;                  \
   TYPEINDEXX xmax = h->xaxis.max.val_s32;                  \
@@ -3081,7 +3456,7 @@ int fill2DHistogramFromResampledImages( typeHistogram *h,
   /* on reechantillonne dans une grille de meme dimension                \
      que l'image */                                                      \
   if ( theDim[2] == 1 ) {                                                \
-    for ( j=0; j<dimy; j++ )                                             \
+    for ( j=firstPlane; j<=lastPlane; j++ )                              \
     for ( i=0; i<dimx; i++ ) {                                           \
       _compute2DContributions( &c1, i, j, 0, mat1, theDim );             \
       if ( c1.n == 0 ) continue;                                         \
@@ -3105,7 +3480,7 @@ int fill2DHistogramFromResampledImages( typeHistogram *h,
     }                                                                    \
   }                                                                      \
   else {                                                                 \
-    for ( k=0; k<dimz; k++ )                                             \
+    for ( k=firstPlane; k<=lastPlane; k++ )                              \
     for ( j=0; j<dimy; j++ )                                             \
     for ( i=0; i<dimx; i++ ) {                                           \
       _compute3DContributions( &c1, i, j, k, mat1, theDim );             \
@@ -3296,6 +3671,93 @@ int fill2DHistogramFromResampledImages( typeHistogram *h,
 
 
 
+static void *_fill2DHistogramFromResampledImagesSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  _histogramFillingParam *p = (_histogramFillingParam*)parameter;
+
+  chunk->ret = _fill2DHistogramFromResampledImages( &(p->histo),
+                                                    p->theIm1, p->theType1, p->mat1,
+                                                    p->theIm2, p->theType2, p->mat2,
+                                                    p->theDim, (int)first, (int)last );
+  return( (void*)NULL );
+}
+
+
+
+
+
+int fill2DHistogramFromResampledImages( typeHistogram *h, 
+                                        void *theIm1,
+                                        bufferType theType1,
+                                        double *mat1,
+                                        void *theIm2,
+                                        bufferType theType2,
+                                        double *mat2,
+                                        int *theDim )
+{
+  char *proc = "fill2DHistogramFromResampledImages";
+  int nplanes = ( theDim[2] > 1 ) ? theDim[2] : theDim[1];
+  typeChunks chunks;
+  _histogramFillingParam *p;
+  int n;
+
+  zeroHistogram( h );
+  if ( nplanes <= 0 ) return( 1 );
+
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, nplanes-1, proc ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+
+  if ( chunks.n_allocated_chunks == 1 ) {
+    freeChunks( &chunks );
+    return( _fill2DHistogramFromResampledImages( h, theIm1, theType1, mat1,
+                                                 theIm2, theType2, mat2,
+                                                 theDim, 0, nplanes-1 ) );
+  }
+
+  p = _allocHistogramFillingParams( &chunks, h, 1 );
+  if ( p == (_histogramFillingParam*)NULL ) {
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate private histograms\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    p[n].theIm1 = theIm1;
+    p[n].theType1 = theType1;
+    p[n].mat1 = mat1;
+    p[n].theIm2 = theIm2;
+    p[n].theType2 = theType2;
+    p[n].mat2 = mat2;
+    p[n].theDim = theDim;
+  }
+
+  if ( _processHistogramFillingChunks( &_fill2DHistogramFromResampledImagesSubroutine,
+                                       &chunks, h, p, proc ) != 1 ) {
+    _freeHistogramFillingParams( p );
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to fill histogram\n", proc );
+    return( -1 );
+  }
+
+  _freeHistogramFillingParams( p );
+  freeChunks( &chunks );
+  return( 1 );
+}
+
+
+
+
+
 
 
 
@@ -191,6 +191,22 @@ extern int allocHistogramList( typeHistogramList *hl, int n );
 
 
 
+/* histogram filling tools
+ *
+ * fill1DHistogramFromBuffer(), fill2DHistogramFromBuffers() and
+ * fill2DHistogramFromResampledImages() are computed in parallel
+ * (see chunks.h): each chunk fills a private histogram, and the
+ * private histograms are summed up at the end.
+ * For buffers, each private histogram may be made of several lanes
+ * (consecutive points are counted in different lanes), which avoids
+ * consecutive increments of the same bin. Default is 1 lane.
+ */
+
+extern void setLanesInHistogram( int l );
+extern int getLanesInHistogram( );
+
+
+
 /* 1D histogram filling tools
  */
 
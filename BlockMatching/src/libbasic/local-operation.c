@@ -12,14 +12,20 @@
  * Sun Feb 17 20:29:10 CET 2013
  *
  * ADDITIONS, CHANGES
+ * - Mon Oct 19 2026
+ *   sliding histogram (quantile), sliding sums (mean, variance, ...)
+ *   and box (min, max) computations, parallelism by slabs of rows
  *
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
+#include <chunks.h>
 #include <convert.h>
+#include <morpho.h>
 #include <vtmalloc.h>
 
 #include <local-operation.h>
@@ -223,7 +229,7 @@ typedef struct {
 #define _COMPUTE_SQRSUM_( TAB, TMP ) {	       \
   TMP.v = 0;                                   \
   for ( iLeft=0; iLeft<iLength; iLeft++ ) {    \
-    TMP.v += TAB[iLeft].v*TAB[iLeft].v;	       \
+    TMP.v += (double)TAB[iLeft].v * (double)TAB[iLeft].v; \
   }                                            \
   resBuf[z*dimxy+y*dimx+x] = TMP.v;	       \
 }
@@ -303,9 +309,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	        \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -321,9 +326,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	        \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -339,9 +343,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	        \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -357,9 +360,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	        \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -375,9 +377,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	        \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -393,9 +394,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	        \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -411,9 +411,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	        \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -429,9 +428,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);              \
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -446,9 +444,8 @@ typedef struct {
     ITYPE *theBuf = (ITYPE*)(bufferIn[0]);	   	\
     OTYPE *resBuf = (OTYPE*)bufferAux;		        \
 							\
-    for ( z = 0; z < dimz; z ++ )	          	\
-    for ( y = 0; y < dimy; y ++ )		        \
-    for ( x = 0; x < dimx; x ++ ) {                     \
+    for ( r = first; r <= last; r ++ )	          	\
+    for ( z = (int)(r / dimy), y = (int)(r % dimy), x = 0; x < dimx; x ++ ) {                     \
       if ( dimb > 0 ) {                                 \
         _EXTRACT_NEIGHBORHOODS_( ITYPE, TAB )		\
       } else {                                          \
@@ -462,163 +459,170 @@ typedef struct {
 
 
 
-static int localFiltering( void **bufferIn,
-			   bufferType typeIn,
-			   int dimb,
-			   void *bufferOut,
-			   bufferType typeOut,
-			   int *bufferDims,
-			   int *windowDims,
-			   enumFiltering operation,
-			   double q,
-			   double lts_fraction )
-{
-  char *proc = "localFiltering";
-  void *bufferAux = (void*)NULL;
-  bufferType typeAux = TYPE_UNKNOWN;
-  size_t v = bufferDims[2] * bufferDims[1] * bufferDims[0];
 
-  int wDims[3], nOffsets[3], pOffsets[3];
-  int length, quantile;
-  int iRight, iLeft, iLast, iQuant, iLength, iFrac;
-  
-  typer64Point sum, sum2, sumsqr;
 
-  int dimz = bufferDims[2];
-  int dimy = bufferDims[1];
-  int dimx = bufferDims[0];
-  int dimxy = dimx * dimy;
-  int b, x, y, z, i, j, k, n;
 
-  int maxiterations = 10;
-  double acc = 1e-4;
 
-  typei32Point tmpInt, *tabInt = (typei32Point*)NULL;
-  typer32Point tmpFlo, *tabFlo = (typer32Point*)NULL;
-  
 
 
-  /* window dimension and
-     offsets
-  */
-  wDims[0] = windowDims[0];
-  wDims[1] = windowDims[1];
-  wDims[2] = windowDims[2];
-  if ( wDims[0] <= 0 ) wDims[0] = 1; 
-  if ( wDims[1] <= 0 ) wDims[1] = 1; 
-  if ( wDims[2] <= 0 ) wDims[2] = 1; 
-  if ( wDims[0] > bufferDims[0] ) wDims[0] = bufferDims[0];
-  if ( wDims[1] > bufferDims[1] ) wDims[1] = bufferDims[1];
-  if ( wDims[2] > bufferDims[2] ) wDims[2] = bufferDims[2];
-  
-  nOffsets[0] = -(int)(wDims[0] / 2); pOffsets[0] = wDims[0] - 1 + nOffsets[0];
-  nOffsets[1] = -(int)(wDims[1] / 2); pOffsets[1] = wDims[1] - 1 + nOffsets[1];
-  nOffsets[2] = -(int)(wDims[2] / 2); pOffsets[2] = wDims[2] - 1 + nOffsets[2];
+/**************************************************
+ *
+ * computation by slabs of rows
+ *
+ **************************************************/
 
-  length = dimb * wDims[2] * wDims[1] * wDims[0];
-  quantile = (int)((length-1) * q + 0.5);
+/* methods of computation
+   - generic: the neighborhood of each point is extracted
+     and processed
+   - box: min and max filtering are computed with the
+     van Herk / Gil-Werman algorithm (see morpho.h)
+   - histogram: quantile (and min, max) filtering with
+     a sliding histogram along the rows (T. Huang), the quantile
+     being searched with a two-level histogram
+     (S. Perreault and P. Hébert, Median Filtering in Constant Time,
+     IEEE TIP, 2007)
+   - sliding sum: sums of the values (and of their squares) are
+     updated along the Y and X directions
+*/
 
+typedef enum {
+  _GENERIC_FILTERING_,
+  _BOX_FILTERING_,
+  _HISTOGRAM_FILTERING_,
+  _SLIDING_SUM_FILTERING_
+} enumFilteringMethod;
 
 
-  /* allocation of an auxiliary buffer ?
-   */
+
+static int _incremental_filtering_ = 1;
+
+void setIncrementalFilteringInLocalOperation( int f )
+{
+  _incremental_filtering_ = f;
+}
+
+int getIncrementalFilteringInLocalOperation( )
+{
+  return( _incremental_filtering_ );
+}
+
+
+
+static enumFilteringMethod _localFilteringMethod( bufferType typeIn,
+                                                  int dimb,
+                                                  enumFiltering operation )
+{
+  if ( _incremental_filtering_ == 0 ) return( _GENERIC_FILTERING_ );
+
   switch ( operation ) {
   default :
-    if ( _verbose_ )
-      fprintf( stderr, "%s: such operation not handled yet\n", proc );
-    return( -1 );
+    break;
   case _MAX_ :
   case _MIN_ :
+    if ( dimb == 1 ) {
+      switch ( typeIn ) {
+      default :
+        break;
+      case UCHAR :
+      case USHORT :
+      case SSHORT :
+      case FLOAT :
+        return( _BOX_FILTERING_ );
+      }
+    }
+    switch ( typeIn ) {
+    default :
+      break;
+    case UCHAR :
+    case SCHAR :
+    case USHORT :
+    case SSHORT :
+      return( _HISTOGRAM_FILTERING_ );
+    }
+    break;
   case _QUANTILE_ :
-    typeAux = typeIn;
+    switch ( typeIn ) {
+    default :
+      break;
+    case UCHAR :
+    case SCHAR :
+    case USHORT :
+    case SSHORT :
+      return( _HISTOGRAM_FILTERING_ );
+    }
     break;
   case _MEAN_ :
-  case _ROBUST_MEAN_ :
   case _SQRSUM_ :
   case _SUM_ :
   case _STDDEV_ :
   case _VAR_ :
-    typeAux = FLOAT;
-    break;
+    return( _SLIDING_SUM_FILTERING_ );
   }
+  return( _GENERIC_FILTERING_ );
+}
 
-  if ( bufferOut == bufferIn || typeOut != typeAux ) {
-    switch( typeAux ) {
-    default :
-      if ( _verbose_ )
-	fprintf( stderr, "%s: such image type not handled yet\n", proc );
-      return( -1 );
-    case UCHAR :
-    case SCHAR :
-      break;
-    case USHORT :
-    case SSHORT :
-      v *= sizeof( u16 );
-      break;
-    case UINT :
-    case SINT :
-      v *= sizeof( u32 );
-      break;
-    case FLOAT :
-      v *= sizeof( r32 );
-      break;
-    }
-    bufferAux = (void*)vtmalloc( v, "bufferAux", proc );
-    if ( bufferAux == NULL ) {
-      if ( _verbose_ )
-	fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
-      return( -1 );
-    }
-  }
-  else {
-    bufferAux = bufferOut;
-  }
 
-  
 
-  /* allocation of an auxiliary array
-   */
-  switch( typeIn ) {
-  default :
-    if ( _verbose_ )
-      fprintf( stderr, "%s: such image type not handled yet\n", proc );
-    return( -1 );
-  case UCHAR :
-  case SCHAR :
-  case USHORT :
-  case SSHORT :
-  case SINT :
-    tabInt = (typei32Point*)vtmalloc( length * sizeof(typei32Point), "tabInt", proc );
-    if ( tabInt == (typei32Point*)NULL ) {
-      if ( bufferAux != bufferOut ) vtfree( bufferAux );
-      if ( _verbose_ )
-	fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
-      return( -1 );
-    }
-    break;
-  case FLOAT :
-    tabFlo = (typer32Point*)vtmalloc( length * sizeof(typer32Point), "tabFlo", proc );
-    if ( tabFlo == (typer32Point*)NULL ) {
-      if ( bufferAux != bufferOut ) vtfree( bufferAux );
-      if ( _verbose_ )
-	fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
-      return( -1 );
-    }
-    break;
-  }
+typedef struct _localFilteringParam {
+  void **bufferIn;
+  bufferType typeIn;
+  int dimb;
+  void *bufferAux;
+  bufferType typeAux;
+  int bufferDims[3];
+  int nOffsets[3];
+  int pOffsets[3];
+  int quantile;
+  enumFiltering operation;
+  enumFilteringMethod method;
+  double q;
+  double lts_fraction;
+  void *work;
+} _localFilteringParam;
 
 
-#define _DEALLOCATIONS_ {                              \
-  if ( tabInt != (typei32Point*)NULL ) vtfree( tabInt ); \
-  if ( tabFlo != (typer32Point*)NULL ) vtfree( tabFlo ); \
-  if ( bufferAux != bufferOut ) vtfree( bufferAux );     \
-}
-  
+
+
+
+/* generic computation for rows [first, last],
+   the row index being z*dimy+y
+ */
+static int _genericLocalFilteringRows( _localFilteringParam *p,
+                                       size_t first, size_t last )
+{
+  char *proc = "_genericLocalFilteringRows";
+  void **bufferIn = p->bufferIn;
+  bufferType typeIn = p->typeIn;
+  int dimb = p->dimb;
+  void *bufferAux = p->bufferAux;
+  bufferType typeAux = p->typeAux;
+  enumFiltering operation = p->operation;
+  int *nOffsets = p->nOffsets;
+  int *pOffsets = p->pOffsets;
+  int quantile = p->quantile;
+  double q = p->q;
+  double lts_fraction = p->lts_fraction;
+
+  int iRight, iLeft, iLast, iQuant, iLength, iFrac;
+
+  typer64Point sum, sum2, sumsqr;
+
+  int dimz = p->bufferDims[2];
+  int dimy = p->bufferDims[1];
+  int dimx = p->bufferDims[0];
+  int dimxy = dimx * dimy;
+  int b, x, y, z, i, j, k, n;
+  size_t r;
+
+  int maxiterations = 10;
+  double acc = 1e-4;
+
+  typei32Point tmpInt, *tabInt = (typei32Point*)p->work;
+  typer32Point tmpFlo, *tabFlo = (typer32Point*)p->work;
 
   switch ( typeIn ) {
 
   default :
-    _DEALLOCATIONS_;
     if ( _verbose_ )
       fprintf( stderr, "%s: such input image type not handled yet\n", proc );
     return( -1 );
@@ -627,14 +631,12 @@ static int localFiltering( void **bufferIn,
     
     switch ( operation ) {
     default :
-      _DEALLOCATIONS_;
       if ( _verbose_ )
 	fprintf( stderr, "%s: such operation not handled yet (typeIn = UCHAR)\n", proc );
       return( -1 );
     case _MAX_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (max)\n", proc );
 	return( -1 );
       case UCHAR :
@@ -645,7 +647,6 @@ static int localFiltering( void **bufferIn,
     case _MIN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (min)\n", proc );
 	return( -1 );
       case UCHAR :
@@ -656,7 +657,6 @@ static int localFiltering( void **bufferIn,
     case _QUANTILE_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (quantile)\n", proc );
 	return( -1 );
       case UCHAR :
@@ -667,7 +667,6 @@ static int localFiltering( void **bufferIn,
     case _MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -678,7 +677,6 @@ static int localFiltering( void **bufferIn,
     case _ROBUST_MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (robust mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -689,7 +687,6 @@ static int localFiltering( void **bufferIn,
     case _SQRSUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -700,7 +697,6 @@ static int localFiltering( void **bufferIn,
     case _SUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -711,7 +707,6 @@ static int localFiltering( void **bufferIn,
     case _STDDEV_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (std dev)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -722,7 +717,6 @@ static int localFiltering( void **bufferIn,
     case _VAR_ : 
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (var)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -738,14 +732,12 @@ static int localFiltering( void **bufferIn,
     
     switch ( operation ) {
     default :
-      _DEALLOCATIONS_;
       if ( _verbose_ )
 	fprintf( stderr, "%s: such operation not handled yet (typeIn = SCHAR)\n", proc );
       return( -1 );
     case _MAX_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (max)\n", proc );
 	return( -1 );
       case SCHAR :
@@ -756,7 +748,6 @@ static int localFiltering( void **bufferIn,
     case _MIN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (min)\n", proc );
 	return( -1 );
       case SCHAR :
@@ -767,7 +758,6 @@ static int localFiltering( void **bufferIn,
     case _QUANTILE_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (quantile)\n", proc );
 	return( -1 );
       case SCHAR :
@@ -778,7 +768,6 @@ static int localFiltering( void **bufferIn,
     case _MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -789,7 +778,6 @@ static int localFiltering( void **bufferIn,
     case _ROBUST_MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (robust mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -800,7 +788,6 @@ static int localFiltering( void **bufferIn,
     case _SQRSUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -811,7 +798,6 @@ static int localFiltering( void **bufferIn,
     case _SUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -822,7 +808,6 @@ static int localFiltering( void **bufferIn,
     case _STDDEV_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (std dev)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -833,7 +818,6 @@ static int localFiltering( void **bufferIn,
     case _VAR_ : 
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (var)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -849,14 +833,12 @@ static int localFiltering( void **bufferIn,
     
     switch ( operation ) {
     default :
-      _DEALLOCATIONS_;
       if ( _verbose_ )
 	fprintf( stderr, "%s: such operation not handled yet (typeIn = USHORT)\n", proc );
       return( -1 );
     case _MAX_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (max)\n", proc );
 	return( -1 );
       case USHORT :
@@ -867,7 +849,6 @@ static int localFiltering( void **bufferIn,
     case _MIN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (min)\n", proc );
 	return( -1 );
       case USHORT :
@@ -878,7 +859,6 @@ static int localFiltering( void **bufferIn,
     case _QUANTILE_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (quantile)\n", proc );
 	return( -1 );
       case USHORT :
@@ -889,7 +869,6 @@ static int localFiltering( void **bufferIn,
     case _MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -900,7 +879,6 @@ static int localFiltering( void **bufferIn,
     case _ROBUST_MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (robust mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -911,7 +889,6 @@ static int localFiltering( void **bufferIn,
     case _SQRSUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -922,7 +899,6 @@ static int localFiltering( void **bufferIn,
     case _SUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -933,7 +909,6 @@ static int localFiltering( void **bufferIn,
     case _STDDEV_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (std dev)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -944,7 +919,6 @@ static int localFiltering( void **bufferIn,
     case _VAR_ : 
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (var)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -960,14 +934,12 @@ static int localFiltering( void **bufferIn,
     
     switch ( operation ) {
     default :
-      _DEALLOCATIONS_;
       if ( _verbose_ )
 	fprintf( stderr, "%s: such operation not handled yet (typeIn = SSHORT)\n", proc );
       return( -1 );
     case _MAX_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (max)\n", proc );
 	return( -1 );
       case SSHORT :
@@ -978,7 +950,6 @@ static int localFiltering( void **bufferIn,
     case _MIN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (min)\n", proc );
 	return( -1 );
       case SSHORT :
@@ -989,7 +960,6 @@ static int localFiltering( void **bufferIn,
     case _QUANTILE_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (quantile)\n", proc );
 	return( -1 );
       case SSHORT :
@@ -1000,7 +970,6 @@ static int localFiltering( void **bufferIn,
     case _MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1011,7 +980,6 @@ static int localFiltering( void **bufferIn,
     case _ROBUST_MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (robust mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1022,7 +990,6 @@ static int localFiltering( void **bufferIn,
     case _SQRSUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1033,7 +1000,6 @@ static int localFiltering( void **bufferIn,
     case _SUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1044,7 +1010,6 @@ static int localFiltering( void **bufferIn,
     case _STDDEV_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (std dev)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1055,7 +1020,6 @@ static int localFiltering( void **bufferIn,
     case _VAR_ : 
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (var)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1071,14 +1035,12 @@ static int localFiltering( void **bufferIn,
     
     switch ( operation ) {
     default :
-      _DEALLOCATIONS_;
       if ( _verbose_ )
 	fprintf( stderr, "%s: such operation not handled yet (typeIn = INT)\n", proc );
       return( -1 );
     case _MAX_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (max)\n", proc );
 	return( -1 );
       case SINT :
@@ -1089,7 +1051,6 @@ static int localFiltering( void **bufferIn,
     case _MIN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (min)\n", proc );
 	return( -1 );
       case SINT :
@@ -1100,7 +1061,6 @@ static int localFiltering( void **bufferIn,
     case _QUANTILE_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (quantile)\n", proc );
 	return( -1 );
       case SINT :
@@ -1111,7 +1071,6 @@ static int localFiltering( void **bufferIn,
     case _MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1122,7 +1081,6 @@ static int localFiltering( void **bufferIn,
     case _ROBUST_MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (robust mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1133,7 +1091,6 @@ static int localFiltering( void **bufferIn,
     case _SQRSUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1144,7 +1101,6 @@ static int localFiltering( void **bufferIn,
     case _SUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1155,7 +1111,6 @@ static int localFiltering( void **bufferIn,
     case _STDDEV_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (std dev)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1166,7 +1121,6 @@ static int localFiltering( void **bufferIn,
     case _VAR_ : 
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (var)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1182,14 +1136,12 @@ static int localFiltering( void **bufferIn,
     
     switch ( operation ) {
     default :
-      _DEALLOCATIONS_;
       if ( _verbose_ )
 	fprintf( stderr, "%s: such operation not handled yet (typeIn = FLOAT)\n", proc );
       return( -1 );
     case _MAX_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (max)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1200,7 +1152,6 @@ static int localFiltering( void **bufferIn,
     case _MIN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (min)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1211,7 +1162,6 @@ static int localFiltering( void **bufferIn,
     case _QUANTILE_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (quantile)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1222,7 +1172,6 @@ static int localFiltering( void **bufferIn,
     case _MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1233,7 +1182,6 @@ static int localFiltering( void **bufferIn,
     case _ROBUST_MEAN_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (robust mean)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1244,7 +1192,6 @@ static int localFiltering( void **bufferIn,
     case _SQRSUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1255,7 +1202,6 @@ static int localFiltering( void **bufferIn,
     case _SUM_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (sum)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1266,7 +1212,6 @@ static int localFiltering( void **bufferIn,
     case _STDDEV_ :
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (std dev)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1277,7 +1222,6 @@ static int localFiltering( void **bufferIn,
     case _VAR_ : 
       switch ( typeAux ) {
       default :
-	_DEALLOCATIONS_;
 	if ( _verbose_ ) fprintf( stderr, "%s: such output image type not handled yet (var)\n", proc );
 	return( -1 );
       case FLOAT :
@@ -1291,21 +1235,637 @@ static int localFiltering( void **bufferIn,
 
   }
 
+  return( 1 );
+}
+
+
+
+
+
+/* sliding histogram computation for rows [first, last]
+   (8 and 16 bits types)
+
+   the histogram of the current window is updated by removing
+   the leaving column and adding the entering one. The searched
+   value is tracked by 'cur' (the current bin) and 'below'
+   (the number of values strictly less than 'cur'), it moves
+   bin by bin, or 256 bins by 256 bins with the coarse histogram.
+   The quantile rank is the same as in the generic computation,
+   results are then identical.
+ */
+
+#define _UPDATE_HISTOGRAM_COLUMN_( TYPE, OFFSET, X, INC ) {    \
+  for ( b=0; b<p->dimb; b++ ) {                                \
+    theBuf = (TYPE*)(p->bufferIn[b]);                          \
+    for ( k=kmin; k<=kmax; k++ )                               \
+    for ( j=jmin; j<=jmax; j++ ) {                             \
+      v = (int)theBuf[(size_t)k*dimxy + (size_t)j*dimx + (X)] + (OFFSET); \
+      histo[v] += (INC);                                       \
+      coarse[v >> 8] += (INC);                                 \
+      if ( v < cur ) below += (INC);                           \
+    }                                                          \
+  }                                                            \
+}
+
+#define _SEARCH_HISTOGRAM_RANK_ {                              \
+  while ( below > rank ) {                                     \
+    if ( (cur & 0xff) == 0 && below - coarse[(cur >> 8)-1] > rank ) { \
+      below -= coarse[(cur >> 8)-1];                           \
+      cur -= 256;                                              \
+    }                                                          \
+    else {                                                     \
+      cur --;                                                  \
+      below -= histo[cur];                                     \
+    }                                                          \
+  }                                                            \
+  while ( below + histo[cur] <= rank ) {                       \
+    if ( (cur & 0xff) == 0 && below + coarse[cur >> 8] <= rank ) { \
+      below += coarse[cur >> 8];                               \
+      cur += 256;                                              \
+    }                                                          \
+    else {                                                     \
+      below += histo[cur];                                     \
+      cur ++;                                                  \
+    }                                                          \
+  }                                                            \
+}
+
+#define _HISTOGRAM_FILTERING_( TYPE, OFFSET ) {                \
+  TYPE *theBuf;                                                \
+  TYPE *resBuf = (TYPE*)p->bufferAux;                          \
+  for ( r=first; r<=last; r++ ) {                              \
+    z = (int)(r / dimy);   y = (int)(r % dimy);                \
+    kmin = z + p->nOffsets[2];   if ( kmin < 0 ) kmin = 0;     \
+    kmax = z + p->pOffsets[2];   if ( kmax >= dimz ) kmax = dimz-1; \
+    jmin = y + p->nOffsets[1];   if ( jmin < 0 ) jmin = 0;     \
+    jmax = y + p->pOffsets[1];   if ( jmax >= dimy ) jmax = dimy-1; \
+    n = p->dimb * (kmax-kmin+1) * (jmax-jmin+1);               \
+    cur = below = 0;                                           \
+    for ( cx=0, i=0; i<=p->pOffsets[0] && i<dimx; i++, cx++ )  \
+      _UPDATE_HISTOGRAM_COLUMN_( TYPE, OFFSET, i, 1 );         \
+    for ( x=0; x<dimx; x++ ) {                                 \
+      rank = (int)((n*cx-1) * p->q + 0.5);                     \
+      _SEARCH_HISTOGRAM_RANK_;                                 \
+      resBuf[r*dimx+x] = (TYPE)(cur - (OFFSET));               \
+      i = x + p->nOffsets[0];                                  \
+      if ( i >= 0 ) {                                          \
+        _UPDATE_HISTOGRAM_COLUMN_( TYPE, OFFSET, i, -1 );      \
+        cx --;                                                 \
+      }                                                        \
+      i = x + p->pOffsets[0] + 1;                              \
+      if ( i < dimx ) {                                        \
+        _UPDATE_HISTOGRAM_COLUMN_( TYPE, OFFSET, i, 1 );       \
+        cx ++;                                                 \
+      }                                                        \
+    }                                                          \
+    /* empty the histogram for the next row */                 \
+    for ( i=dimx+p->nOffsets[0]; i<dimx; i++ ) {               \
+      if ( i < 0 ) continue;                                   \
+      _UPDATE_HISTOGRAM_COLUMN_( TYPE, OFFSET, i, -1 );        \
+    }                                                          \
+  }                                                            \
+}
+
+static int _histogramLocalFilteringRows( _localFilteringParam *p,
+                                         size_t first, size_t last )
+{
+  char *proc = "_histogramLocalFilteringRows";
+  int dimz = p->bufferDims[2];
+  int dimy = p->bufferDims[1];
+  int dimx = p->bufferDims[0];
+  size_t dimxy = (size_t)dimx * (size_t)dimy;
+  int *histo = (int*)p->work;
+  int *coarse;
+  int nbins;
+  int b, x, y, z, i, j, k;
+  int jmin, jmax, kmin, kmax;
+  int v, n, cx, cur, below, rank;
+  size_t r;
+
+  switch ( p->typeIn ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+  case SCHAR :
+    nbins = 256;
+    break;
+  case USHORT :
+  case SSHORT :
+    nbins = 65536;
+    break;
+  }
+  coarse = histo + nbins;
+  (void)memset( histo, 0, (nbins + nbins/256) * sizeof(int) );
+
+  switch ( p->typeIn ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+    _HISTOGRAM_FILTERING_( u8, 0 );
+    break;
+  case SCHAR :
+    _HISTOGRAM_FILTERING_( s8, 128 );
+    break;
+  case USHORT :
+    _HISTOGRAM_FILTERING_( u16, 0 );
+    break;
+  case SSHORT :
+    _HISTOGRAM_FILTERING_( s16, 32768 );
+    break;
+  }
+
+  return( 1 );
+}
+
+
+
+
+
+/* sliding sum computation for rows [first, last]
+
+   sum[x] (resp. sqr[x]) is the sum of the values (resp. of the
+   squared values) of the column x of the window, it is
+   computed for the first row of a slice, and then updated
+   from row to row. The sums are then computed along the row.
+   Integer values are exactly summed (in double), results are then
+   identical to the ones of the generic computation.
+ */
+
+static void _slidingSumRow( r32 *resBuf,
+                            double *sum, double *sqr,
+                            int dimx, int n,
+                            int *nOffsets, int *pOffsets,
+                            enumFiltering operation )
+{
+  double s = 0.0, t = 0.0, c, m;
+  int x, i, cx;
+
+  for ( cx=0, i=0; i<=pOffsets[0] && i<dimx; i++, cx++ ) {
+    s += sum[i];
+    t += sqr[i];
+  }
+
+  for ( x=0; x<dimx; x++ ) {
+    c = (double)(n * cx);
+    switch ( operation ) {
+    default :
+    case _SUM_ :
+      resBuf[x] = s;
+      break;
+    case _MEAN_ :
+      resBuf[x] = s / c;
+      break;
+    case _SQRSUM_ :
+      resBuf[x] = t;
+      break;
+    case _STDDEV_ :
+      m = s / c;
+      resBuf[x] = sqrt( t / c - m * m );
+      break;
+    case _VAR_ :
+      m = s / c;
+      resBuf[x] = t / c - m * m;
+      break;
+    }
+    i = x + nOffsets[0];
+    if ( i >= 0 ) {
+      s -= sum[i];   t -= sqr[i];   cx --;
+    }
+    i = x + pOffsets[0] + 1;
+    if ( i < dimx ) {
+      s += sum[i];   t += sqr[i];   cx ++;
+    }
+  }
+}
+
+#define _UPDATE_SUM_ROW_( TYPE, Y, OP ) {                      \
+  for ( b=0; b<p->dimb; b++ )                                  \
+  for ( k=kmin; k<=kmax; k++ ) {                               \
+    theBuf = (TYPE*)(p->bufferIn[b]) + (size_t)k*dimxy + (size_t)(Y)*dimx; \
+    if ( squares ) {                                           \
+      for ( x=0; x<dimx; x++ ) {                               \
+        sum[x] OP (double)theBuf[x];                           \
+        sqr[x] OP (double)theBuf[x] * (double)theBuf[x];       \
+      }                                                        \
+    }                                                          \
+    else {                                                     \
+      for ( x=0; x<dimx; x++ )                                 \
+        sum[x] OP (double)theBuf[x];                           \
+    }                                                          \
+  }                                                            \
+}
+
+#define _SLIDING_SUM_FILTERING_( TYPE ) {                      \
+  TYPE *theBuf;                                                \
+  for ( r=first; r<=last; r++ ) {                              \
+    z = (int)(r / dimy);   y = (int)(r % dimy);                \
+    kmin = z + p->nOffsets[2];   if ( kmin < 0 ) kmin = 0;     \
+    kmax = z + p->pOffsets[2];   if ( kmax >= dimz ) kmax = dimz-1; \
+    jmin = y + p->nOffsets[1];   if ( jmin < 0 ) jmin = 0;     \
+    jmax = y + p->pOffsets[1];   if ( jmax >= dimy ) jmax = dimy-1; \
+    if ( r == first || y == 0 ) {                              \
+      (void)memset( sum, 0, 2 * dimx * sizeof(double) );       \
+      for ( j=jmin; j<=jmax; j++ )                             \
+        _UPDATE_SUM_ROW_( TYPE, j, += );                       \
+    }                                                          \
+    else {                                                     \
+      j = y - 1 + p->nOffsets[1];                              \
+      if ( j >= 0 ) _UPDATE_SUM_ROW_( TYPE, j, -= );           \
+      j = y + p->pOffsets[1];                                  \
+      if ( j < dimy ) _UPDATE_SUM_ROW_( TYPE, j, += );         \
+    }                                                          \
+    _slidingSumRow( resBuf+r*dimx, sum, sqr, dimx,             \
+                    p->dimb * (kmax-kmin+1) * (jmax-jmin+1),   \
+                    p->nOffsets, p->pOffsets, p->operation );  \
+  }                                                            \
+}
+
+static int _slidingSumLocalFilteringRows( _localFilteringParam *p,
+                                          size_t first, size_t last )
+{
+  char *proc = "_slidingSumLocalFilteringRows";
+  int dimz = p->bufferDims[2];
+  int dimy = p->bufferDims[1];
+  int dimx = p->bufferDims[0];
+  size_t dimxy = (size_t)dimx * (size_t)dimy;
+  double *sum = (double*)p->work;
+  double *sqr = sum + dimx;
+  r32 *resBuf = (r32*)p->bufferAux;
+  int squares = 0;
+  int b, x, y, z, j, k;
+  int jmin, jmax, kmin, kmax;
+  size_t r;
+
+  if ( p->typeAux != FLOAT ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such output image type not handled yet\n", proc );
+    return( -1 );
+  }
+
+  switch ( p->operation ) {
+  default :
+    break;
+  case _SQRSUM_ :
+  case _STDDEV_ :
+  case _VAR_ :
+    squares = 1;
+  }
+
+  switch ( p->typeIn ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+    _SLIDING_SUM_FILTERING_( u8 );
+    break;
+  case SCHAR :
+    _SLIDING_SUM_FILTERING_( s8 );
+    break;
+  case USHORT :
+    _SLIDING_SUM_FILTERING_( u16 );
+    break;
+  case SSHORT :
+    _SLIDING_SUM_FILTERING_( s16 );
+    break;
+  case SINT :
+    _SLIDING_SUM_FILTERING_( s32 );
+    break;
+  case FLOAT :
+    _SLIDING_SUM_FILTERING_( r32 );
+    break;
+  }
+
+  return( 1 );
+}
+
+
+
+
+
+static void *_localFilteringSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  _localFilteringParam *p = (_localFilteringParam*)parameter;
+
+  switch ( p->method ) {
+  default :
+    chunk->ret = -1;
+    break;
+  case _GENERIC_FILTERING_ :
+    chunk->ret = _genericLocalFilteringRows( p, first, last );
+    break;
+  case _HISTOGRAM_FILTERING_ :
+    chunk->ret = _histogramLocalFilteringRows( p, first, last );
+    break;
+  case _SLIDING_SUM_FILTERING_ :
+    chunk->ret = _slidingSumLocalFilteringRows( p, first, last );
+    break;
+  }
+  return( (void*)NULL );
+}
+
+
+
+/* the rows (z*dimy+y) are split into chunks (ie slabs),
+   each chunk having its own work array
+ */
+static int _processLocalFilteringChunks( _localFilteringParam *par,
+                                         char *from )
+{
+  char *proc = "_processLocalFilteringChunks";
+  typeChunks chunks;
+  _localFilteringParam *p;
+  size_t nrows = (size_t)par->bufferDims[1] * (size_t)par->bufferDims[2];
+  size_t size = 0;
+  char *work;
+  int n;
+
+  switch ( par->method ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such method not handled yet\n", proc );
+    return( -1 );
+  case _GENERIC_FILTERING_ :
+    size = (size_t)par->dimb * (par->pOffsets[2] - par->nOffsets[2] + 1)
+      * (par->pOffsets[1] - par->nOffsets[1] + 1) * (par->pOffsets[0] - par->nOffsets[0] + 1);
+    if ( par->typeIn == FLOAT ) size *= sizeof( typer32Point );
+    else                        size *= sizeof( typei32Point );
+    break;
+  case _HISTOGRAM_FILTERING_ :
+    switch ( par->typeIn ) {
+    default :
+      if ( _verbose_ )
+        fprintf( stderr, "%s: such image type not handled yet\n", proc );
+      return( -1 );
+    case UCHAR :
+    case SCHAR :
+      size = (256 + 1) * sizeof( int );
+      break;
+    case USHORT :
+    case SSHORT :
+      size = (65536 + 256) * sizeof( int );
+      break;
+    }
+    break;
+  case _SLIDING_SUM_FILTERING_ :
+    size = 2 * (size_t)par->bufferDims[0] * sizeof( double );
+    break;
+  }
+
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, nrows-1, proc ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+
+  p = (_localFilteringParam*)vtmalloc( chunks.n_allocated_chunks * sizeof(_localFilteringParam),
+                                       "p", proc );
+  if ( p == (_localFilteringParam*)NULL ) {
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate parameters\n", proc );
+    return( -1 );
+  }
+
+  work = (char*)vtmalloc( chunks.n_allocated_chunks * size, "work", proc );
+  if ( work == (char*)NULL ) {
+    vtfree( p );
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate work arrays\n", proc );
+    return( -1 );
+  }
+
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    p[n] = *par;
+    p[n].work = (void*)(work + n * size);
+    chunks.data[n].parameters = (void*)(&(p[n]));
+  }
+
+  if ( processChunks( &_localFilteringSubroutine, &chunks, from ) != 1 ) {
+    vtfree( work );
+    vtfree( p );
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to filter the buffer\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    if ( chunks.data[n].ret != 1 ) {
+      vtfree( work );
+      vtfree( p );
+      freeChunks( &chunks );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: error when filtering the buffer\n", proc );
+      return( -1 );
+    }
+  }
+
+  vtfree( work );
+  vtfree( p );
+  freeChunks( &chunks );
+  return( 1 );
+}
+
+
+
+
+
+static int localFiltering( void **bufferIn,
+			   bufferType typeIn,
+			   int dimb,
+			   void *bufferOut,
+			   bufferType typeOut,
+			   int *bufferDims,
+			   int *windowDims,
+			   enumFiltering operation,
+			   double q,
+			   double lts_fraction )
+{
+  char *proc = "localFiltering";
+  void *bufferAux = (void*)NULL;
+  bufferType typeAux = TYPE_UNKNOWN;
+  size_t v = (size_t)bufferDims[2] * (size_t)bufferDims[1] * (size_t)bufferDims[0];
+
+  int wDims[3];
+  int b, length, inplace = 0;
+  _localFilteringParam par;
+
+
+
+  /* window dimension and
+     offsets
+  */
+  wDims[0] = windowDims[0];
+  wDims[1] = windowDims[1];
+  wDims[2] = windowDims[2];
+  if ( wDims[0] <= 0 ) wDims[0] = 1;
+  if ( wDims[1] <= 0 ) wDims[1] = 1;
+  if ( wDims[2] <= 0 ) wDims[2] = 1;
+  if ( wDims[0] > bufferDims[0] ) wDims[0] = bufferDims[0];
+  if ( wDims[1] > bufferDims[1] ) wDims[1] = bufferDims[1];
+  if ( wDims[2] > bufferDims[2] ) wDims[2] = bufferDims[2];
+
+  par.nOffsets[0] = -(int)(wDims[0] / 2); par.pOffsets[0] = wDims[0] - 1 + par.nOffsets[0];
+  par.nOffsets[1] = -(int)(wDims[1] / 2); par.pOffsets[1] = wDims[1] - 1 + par.nOffsets[1];
+  par.nOffsets[2] = -(int)(wDims[2] / 2); par.pOffsets[2] = wDims[2] - 1 + par.nOffsets[2];
+
+  length = dimb * wDims[2] * wDims[1] * wDims[0];
+  par.quantile = (int)((length-1) * q + 0.5);
+
+
+
+  /* allocation of an auxiliary buffer ?
+   */
+  switch ( operation ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such operation not handled yet\n", proc );
+    return( -1 );
+  case _MAX_ :
+  case _MIN_ :
+  case _QUANTILE_ :
+    typeAux = typeIn;
+    break;
+  case _MEAN_ :
+  case _ROBUST_MEAN_ :
+  case _SQRSUM_ :
+  case _SUM_ :
+  case _STDDEV_ :
+  case _VAR_ :
+    typeAux = FLOAT;
+    break;
+  }
+
+  /* the input buffers are read by all the chunks,
+     the result can not be written in one of them
+  */
+  for ( b=0; b<dimb; b++ )
+    if ( bufferOut == bufferIn[b] ) inplace = 1;
+
+  if ( inplace || typeOut != typeAux ) {
+    switch( typeAux ) {
+    default :
+      if ( _verbose_ )
+	fprintf( stderr, "%s: such image type not handled yet\n", proc );
+      return( -1 );
+    case UCHAR :
+    case SCHAR :
+      break;
+    case USHORT :
+    case SSHORT :
+      v *= sizeof( u16 );
+      break;
+    case UINT :
+    case SINT :
+      v *= sizeof( u32 );
+      break;
+    case FLOAT :
+      v *= sizeof( r32 );
+      break;
+    }
+    bufferAux = (void*)vtmalloc( v, "bufferAux", proc );
+    if ( bufferAux == NULL ) {
+      if ( _verbose_ )
+	fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
+      return( -1 );
+    }
+  }
+  else {
+    bufferAux = bufferOut;
+  }
+
+
+
+  switch( typeIn ) {
+  default :
+    if ( bufferAux != bufferOut ) vtfree( bufferAux );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+  case SCHAR :
+  case USHORT :
+  case SSHORT :
+  case SINT :
+  case FLOAT :
+    break;
+  }
+
+
+
+  par.bufferIn = bufferIn;
+  par.typeIn = typeIn;
+  par.dimb = dimb;
+  par.bufferAux = bufferAux;
+  par.typeAux = typeAux;
+  par.bufferDims[0] = bufferDims[0];
+  par.bufferDims[1] = bufferDims[1];
+  par.bufferDims[2] = bufferDims[2];
+  par.operation = operation;
+  par.method = _localFilteringMethod( typeIn, dimb, operation );
+  par.q = q;
+  par.lts_fraction = lts_fraction;
+  par.work = (void*)NULL;
+
+  switch ( par.method ) {
+  case _BOX_FILTERING_ :
+    if ( operation == _MAX_ ) {
+      if ( BoxDilation( bufferIn[0], bufferAux, typeIn, bufferDims,
+                        par.nOffsets, par.pOffsets ) != 1 ) {
+        if ( bufferAux != bufferOut ) vtfree( bufferAux );
+        if ( _verbose_ ) fprintf( stderr, "%s: unable to compute max filtering\n", proc );
+        return( -1 );
+      }
+    }
+    else {
+      if ( BoxErosion( bufferIn[0], bufferAux, typeIn, bufferDims,
+                       par.nOffsets, par.pOffsets ) != 1 ) {
+        if ( bufferAux != bufferOut ) vtfree( bufferAux );
+        if ( _verbose_ ) fprintf( stderr, "%s: unable to compute min filtering\n", proc );
+        return( -1 );
+      }
+    }
+    break;
+  default :
+    /* min and max are the lowest and largest ranks
+     */
+    if ( par.method == _HISTOGRAM_FILTERING_ ) {
+      if ( operation == _MIN_ ) par.q = 0.0;
+      else if ( operation == _MAX_ ) par.q = 1.0;
+    }
+    if ( _processLocalFilteringChunks( &par, proc ) != 1 ) {
+      if ( bufferAux != bufferOut ) vtfree( bufferAux );
+      if ( _verbose_ ) fprintf( stderr, "%s: unable to filter buffer\n", proc );
+      return( -1 );
+    }
+    break;
+  }
+
 
 
   /* conversion (if required)
    */
   if ( bufferAux != bufferOut ) {
-    if ( ConvertBuffer( bufferAux, typeAux, bufferOut, typeOut, 
+    if ( ConvertBuffer( bufferAux, typeAux, bufferOut, typeOut,
 			bufferDims[2] * bufferDims[1] * bufferDims[0] ) != 1 ) {
-      _DEALLOCATIONS_;
+      vtfree( bufferAux );
       if ( _verbose_ ) fprintf( stderr, "%s: unable to convert buffer\n", proc );
       return( -1 );
     }
+    vtfree( bufferAux );
   }
 
-  _DEALLOCATIONS_;
-
   return( 1 );
 }
 
@@ -1318,7 +1878,6 @@ static int localFiltering( void **bufferIn,
 
 
 
-
 /**************************************************
  *
  * operation on one buffer
@@ -32,6 +32,24 @@ extern void decrementVerboseInLocalOperation(  );
 
 
 
+/* incremental computations (default)
+   - quantile (and median) filtering of 8 and 16 bits types, as well
+     as min and max filtering of SCHAR type or of several buffers,
+     are done with a sliding histogram,
+   - min and max filtering are done with box morphology (see morpho.h),
+   - mean, sum, sum of squares, standard deviation and variance
+     are done with sliding sums.
+   Robust mean and the other types use the generic computation
+   (extraction and processing of each neighborhood).
+   In all cases, the computation is done in parallel by slabs
+   of rows (see chunks.h).
+   0 forces the generic computation.
+ */
+extern void setIncrementalFilteringInLocalOperation( int f );
+extern int getIncrementalFilteringInLocalOperation( );
+
+
+
 /**************************************************
  *
  * operation on one buffer
@@ -29,11 +29,282 @@
 
 #include <typedefs.h>
 #include <vtmalloc.h>
+#include <chunks.h>
 
 #include <morpho.h>
 
 
 
+/************************************************************
+ *
+ * box (separable) morphology
+ *
+ ************************************************************/
+
+static int _min_iterations_for_box_ = 2;
+
+void setMinIterationsForBoxMorphology( int i )
+{
+  _min_iterations_for_box_ = i;
+}
+
+int getMinIterationsForBoxMorphology( )
+{
+  return( _min_iterations_for_box_ );
+}
+
+
+
+typedef enum {
+  _BOX_DILATION_,
+  _BOX_EROSION_
+} enumBoxOperation;
+
+typedef struct {
+  void *bufferIn;
+  void *bufferOut;
+  bufferType type;
+  enumBoxOperation operation;
+  /* line description: the n-th line starts at
+     ( n / lineModulo ) * lineJump + ( n % lineModulo ) * lineStride
+     and its points are separated by pointStride
+   */
+  size_t lineModulo;
+  size_t lineJump;
+  size_t lineStride;
+  size_t pointStride;
+  int length;
+  int lower;
+  int upper;
+} _typeBoxParameter;
+
+
+
+/* van Herk / Gil-Werman running max (or min)
+   - ext[] contains the line, extended by 'lower' points at the beginning
+     and by 'upper' points at the end with the border values.
+     Replicating the border values yields the same result than
+     clipping the window, since the window contains the origin.
+   - g[] (resp. h[]) are the forward (resp. backward) cumulated
+     max (or min) within blocks of size w = upper - lower + 1
+   res[x] = op( ext[x ... x+w-1] ) = op( h[x], g[x+w-1] )
+ */
+#define _BOX_LINE_( TYPE, _TEST_ ) {                                  \
+  TYPE *theBuf = (TYPE*)p->bufferIn;                                  \
+  TYPE *resBuf = (TYPE*)p->bufferOut;                                 \
+  TYPE *ext = (TYPE*)auxBuf;                                          \
+  TYPE *g = ext + m;                                                  \
+  TYPE *h = g + m;                                                    \
+  for ( i=first; i<=last; i++ ) {                                     \
+    o = (i / p->lineModulo) * p->lineJump                             \
+      + (i % p->lineModulo) * p->lineStride;                          \
+    for ( k=o, x=0; x<n; x++, k+=p->pointStride )                     \
+      ext[left+x] = theBuf[k];                                        \
+    for ( x=0; x<left; x++ ) ext[x] = ext[left];                      \
+    for ( x=left+n; x<m; x++ ) ext[x] = ext[left+n-1];                \
+    for ( x=0, j=0; x<m; x++, j++ ) {                                 \
+      if ( j == w ) j = 0;                                            \
+      if ( j == 0 ) g[x] = ext[x];                                    \
+      else g[x] = ( ext[x] _TEST_ g[x-1] ) ? ext[x] : g[x-1];          \
+    }                                                                 \
+    h[m-1] = ext[m-1];                                                \
+    for ( x=m-2, j=(m-1)%w; x>=0; x--, j-- ) {                        \
+      if ( j == 0 ) { h[x] = ext[x]; j = w; }                         \
+      else h[x] = ( ext[x] _TEST_ h[x+1] ) ? ext[x] : h[x+1];          \
+    }                                                                 \
+    for ( k=o, x=0; x<n; x++, k+=p->pointStride )                     \
+      resBuf[k] = ( h[x] _TEST_ g[x+w-1] ) ? h[x] : g[x+w-1];          \
+  }                                                                   \
+}
+
+static void *_boxMorphologySubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  char *proc = "_boxMorphologySubroutine";
+  _typeBoxParameter *p = (_typeBoxParameter*)parameter;
+  void *auxBuf = (void*)NULL;
+  size_t i, k, o;
+  int n = p->length;
+  int left = -p->lower;
+  int w = p->upper - p->lower + 1;
+  int m = n + w - 1;
+  int x, j;
+
+  switch( p->type ) {
+  default :
+    chunk->ret = -1;
+    return( (void*)NULL );
+  case UCHAR :
+    auxBuf = vtmalloc( 3 * m * sizeof(u8), "auxBuf", proc );
+    break;
+  case USHORT :
+  case SSHORT :
+    auxBuf = vtmalloc( 3 * m * sizeof(u16), "auxBuf", proc );
+    break;
+  case FLOAT :
+    auxBuf = vtmalloc( 3 * m * sizeof(r32), "auxBuf", proc );
+    break;
+  }
+  if ( auxBuf == (void*)NULL ) {
+    chunk->ret = -1;
+    return( (void*)NULL );
+  }
+
+  switch( p->type ) {
+  default :
+    break;
+  case UCHAR :
+    if ( p->operation == _BOX_DILATION_ ) _BOX_LINE_( u8, > )
+    else _BOX_LINE_( u8, < )
+    break;
+  case USHORT :
+    if ( p->operation == _BOX_DILATION_ ) _BOX_LINE_( u16, > )
+    else _BOX_LINE_( u16, < )
+    break;
+  case SSHORT :
+    if ( p->operation == _BOX_DILATION_ ) _BOX_LINE_( s16, > )
+    else _BOX_LINE_( s16, < )
+    break;
+  case FLOAT :
+    if ( p->operation == _BOX_DILATION_ ) _BOX_LINE_( r32, > )
+    else _BOX_LINE_( r32, < )
+    break;
+  }
+
+  vtfree( auxBuf );
+  chunk->ret = 1;
+  return( (void*)NULL );
+}
+
+
+
+static int _boxMorphology( void* inputBuf,
+                           void* resultBuf,
+                           bufferType type,
+                           int *theDim,
+                           int *lower,
+                           int *upper,
+                           enumBoxOperation operation )
+{
+  char *proc = "_boxMorphology";
+  _typeBoxParameter p;
+  typeChunks chunks;
+  size_t dimx, dimy, dimz;
+  size_t size;
+  void *input = inputBuf;
+  int d, n;
+
+  switch( type ) {
+  default :
+    fprintf( stderr, "%s: such type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+    size = sizeof(u8);    break;
+  case USHORT :
+  case SSHORT :
+    size = sizeof(u16);   break;
+  case FLOAT :
+    size = sizeof(r32);   break;
+  }
+
+  for ( d=0; d<3; d++ ) {
+    if ( theDim[d] <= 0 || lower[d] > 0 || upper[d] < 0 ) {
+      fprintf( stderr, "%s: bad dimensions or structuring element\n", proc );
+      return( -1 );
+    }
+  }
+
+  dimx = theDim[0];
+  dimy = theDim[1];
+  dimz = theDim[2];
+
+  p.bufferOut = resultBuf;
+  p.type = type;
+  p.operation = operation;
+
+  for ( d=0; d<3; d++ ) {
+    if ( theDim[d] == 1 || (lower[d] == 0 && upper[d] == 0) ) continue;
+
+    p.bufferIn = input;
+    p.length = theDim[d];
+    p.lower = lower[d];
+    p.upper = upper[d];
+
+    switch( d ) {
+    default :
+    case 0 :
+      /* n = z*dimy+y */
+      p.lineModulo = dimy*dimz;   p.lineJump = 0;
+      p.lineStride = dimx;        p.pointStride = 1;
+      break;
+    case 1 :
+      /* n = z*dimx+x */
+      p.lineModulo = dimx;        p.lineJump = dimx*dimy;
+      p.lineStride = 1;           p.pointStride = dimx;
+      break;
+    case 2 :
+      /* n = y*dimx+x */
+      p.lineModulo = dimx*dimy;   p.lineJump = 0;
+      p.lineStride = 1;           p.pointStride = dimx*dimy;
+      break;
+    }
+
+    initChunks( &chunks );
+    if ( buildChunks( &chunks, 0, (dimx*dimy*dimz)/theDim[d]-1, proc ) != 1 ) {
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+      return( -1 );
+    }
+    for ( n=0; n<chunks.n_allocated_chunks; n++ )
+      chunks.data[n].parameters = (void*)(&p);
+
+    if ( processChunks( &_boxMorphologySubroutine, &chunks, proc ) != 1 ) {
+      fprintf( stderr, "%s: unable to process along direction #%d\n", proc, d );
+      freeChunks( &chunks );
+      return( -1 );
+    }
+    freeChunks( &chunks );
+
+    input = resultBuf;
+  }
+
+  /* null structuring element
+   */
+  if ( input != resultBuf )
+    (void)memcpy( resultBuf, inputBuf, dimx*dimy*dimz*size );
+
+  return( 1 );
+}
+
+
+
+int BoxDilation( void* inputBuf,
+                 void* resultBuf,
+                 bufferType type,
+                 int *theDim,
+                 int *lower,
+                 int *upper )
+{
+  return( _boxMorphology( inputBuf, resultBuf, type, theDim, lower, upper, _BOX_DILATION_ ) );
+}
+
+
+
+int BoxErosion( void* inputBuf,
+                void* resultBuf,
+                bufferType type,
+                int *theDim,
+                int *lower,
+                int *upper )
+{
+  return( _boxMorphology( inputBuf, resultBuf, type, theDim, lower, upper, _BOX_EROSION_ ) );
+}
+
+
+
 
 
 
@@ -126,6 +397,24 @@ void BinaryDilation_u8 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxDilation( inputBuf, resultBuf, UCHAR, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -1273,7 +1562,7 @@ void BinaryDilation_u8 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -1363,6 +1652,24 @@ void BinaryErosion_u8 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxErosion( inputBuf, resultBuf, UCHAR, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -2510,7 +2817,7 @@ void BinaryErosion_u8 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -2600,6 +2907,24 @@ void GreyLevelDilation_u8 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxDilation( inputBuf, resultBuf, UCHAR, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -3747,7 +4072,7 @@ void GreyLevelDilation_u8 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -3837,6 +4162,24 @@ void GreyLevelErosion_u8 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxErosion( inputBuf, resultBuf, UCHAR, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -4984,7 +5327,7 @@ void GreyLevelErosion_u8 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -5074,6 +5417,24 @@ void GreyLevelDilation_r32 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxDilation( inputBuf, resultBuf, FLOAT, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -6221,7 +6582,7 @@ void GreyLevelDilation_r32 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -6311,6 +6672,24 @@ void GreyLevelErosion_r32 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxErosion( inputBuf, resultBuf, FLOAT, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -7458,7 +7837,7 @@ void GreyLevelErosion_r32 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -7548,6 +7927,24 @@ void GreyLevelDilation_u16 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxDilation( inputBuf, resultBuf, USHORT, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -8695,7 +9092,7 @@ void GreyLevelDilation_u16 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -8785,6 +9182,24 @@ void GreyLevelErosion_u16 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxErosion( inputBuf, resultBuf, USHORT, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -9932,7 +10347,7 @@ void GreyLevelErosion_u16 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -10022,6 +10437,24 @@ void GreyLevelDilation_s16 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxDilation( inputBuf, resultBuf, SSHORT, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -11169,7 +11602,7 @@ void GreyLevelDilation_s16 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
 /* for binary operations only. With respect to grey-level operations,
@@ -11259,6 +11692,24 @@ void GreyLevelErosion_s16 ( void* inputBuf, /* buffer to be resampled */
     }
   }
 
+  /* large box structuring element:
+     separable computation (which does not depend on the
+     number of iterations)
+   */
+  if ( _min_iterations_for_box_ > 0 && iterations >= _min_iterations_for_box_
+       && ( conn == 8 || conn == 26 ) ) {
+    int lower[3], upper[3];
+    lower[0] = lower[1] = -iterations;
+    upper[0] = upper[1] = iterations;
+    lower[2] = upper[2] = 0;
+    if ( conn == 26 ) {
+      lower[2] = -iterations;
+      upper[2] = iterations;
+    }
+    if ( BoxErosion( inputBuf, resultBuf, SSHORT, theDim, lower, upper ) == 1 )
+      return;
+  }
+
   /* allocation of the auxiliary buffer 
      be sure that the size of each auxiliary slice is 
      a multiple of sizeof(int) for binary computation
@@ -12406,6 +12857,6 @@ void GreyLevelErosion_s16 ( void* inputBuf, /* buffer to be resampled */
     input = resultBuf;
   }
   /* end */
-  free( (void*)localBuf );
+  vtfree( (void*)localBuf );
 }
 
@@ -12,9 +12,54 @@ extern "C" {
 
 
 
+#include <typedefs.h>
 
 
 
+/* Box (and line) structuring elements
+
+   The structuring element is the box [lower[0],upper[0]] x [lower[1],upper[1]]
+   x [lower[2],upper[2]] (offsets w.r.t. the current point) that has
+   to contain the origin (lower[i] <= 0 <= upper[i]). A line along an
+   axis is a box with null offsets along the two other axes.
+   The result is
+     result(x) = max (or min) { input(x+o), o in box, x+o in image }
+   as in the user-defined structuring element case.
+
+   The computation is separable and uses the van Herk / Gil-Werman
+   running max (or min) algorithm: the cost (3 comparisons per point
+   and per axis) does not depend on the size of the box.
+
+   The lines are processed in parallel (see chunks.h).
+   inputBuf and resultBuf may be the same buffer.
+   Handled types are UCHAR, USHORT, SSHORT and FLOAT.
+
+   return 1 in case of success, -1 else
+ */
+
+extern int BoxDilation( void* inputBuf, /* input buffer */
+			void* resultBuf, /* result buffer */
+			bufferType type, /* type of both buffers */
+			int *theDim, /* dimensions of this buffer */
+			int *lower, /* lower offsets of the box */
+			int *upper  /* upper offsets of the box */ );
+
+extern int BoxErosion( void* inputBuf, /* input buffer */
+		       void* resultBuf, /* result buffer */
+		       bufferType type, /* type of both buffers */
+		       int *theDim, /* dimensions of this buffer */
+		       int *lower, /* lower offsets of the box */
+		       int *upper  /* upper offsets of the box */ );
+
+/* Binary|GreyLevel[Dilation|Erosion]_TYPE() switch to the
+   box computation when the connectivity is 8 (in 2D) or 26
+   and the number of iterations is larger than or equal to
+   this value (0 disables the switch).
+*/
+extern void setMinIterationsForBoxMorphology( int i );
+extern int getMinIterationsForBoxMorphology( );
+
+
 
 
 
@@ -57,6 +57,65 @@ static void userDefinedErosion( void *inputBuf,
 
 
 
+/* checks whether the user defined structuring element is a box
+   containing the origin (a line along one axis is a box too).
+   If so, the box corresponding to the iterated structuring element
+   is given by its lower and upper offsets, and the separable
+   computation of morpho.c can be used.
+ */
+static int _isBoxStructuringElement( typeMorphoToolsList *userDefinedSE,
+                                     int iterations,
+                                     int *lower,
+                                     int *upper )
+{
+  char *proc = "_isBoxStructuringElement";
+  typeMorphoToolsPoint *list = userDefinedSE->list;
+  unsigned char *isInSE;
+  int dx, dy, dz;
+  int i, n;
+
+  lower[0] = upper[0] = 0;
+  lower[1] = upper[1] = 0;
+  lower[2] = upper[2] = 0;
+  for ( n=0; n<userDefinedSE->nb; n++ ) {
+    if ( lower[0] > list[n].x ) lower[0] = list[n].x;
+    if ( upper[0] < list[n].x ) upper[0] = list[n].x;
+    if ( lower[1] > list[n].y ) lower[1] = list[n].y;
+    if ( upper[1] < list[n].y ) upper[1] = list[n].y;
+    if ( lower[2] > list[n].z ) lower[2] = list[n].z;
+    if ( upper[2] < list[n].z ) upper[2] = list[n].z;
+  }
+  dx = upper[0] - lower[0] + 1;
+  dy = upper[1] - lower[1] + 1;
+  dz = upper[2] - lower[2] + 1;
+  if ( dx * dy * dz != userDefinedSE->nb ) return( 0 );
+
+  /* the number of points is the one of the bounding box,
+     check that there is no duplicated point
+   */
+  isInSE = (unsigned char*)vtmalloc( dx * dy * dz * sizeof(unsigned char), "isInSE", proc );
+  if ( isInSE == (unsigned char*)NULL ) return( 0 );
+  (void)memset( isInSE, 0, dx * dy * dz * sizeof(unsigned char) );
+  for ( n=0; n<userDefinedSE->nb; n++ ) {
+    i = ((list[n].z - lower[2]) * dy + (list[n].y - lower[1])) * dx + (list[n].x - lower[0]);
+    if ( isInSE[i] ) {
+      vtfree( isInSE );
+      return( 0 );
+    }
+    isInSE[i] = 1;
+  }
+  vtfree( isInSE );
+
+  for ( i=0; i<3; i++ ) {
+    lower[i] *= iterations;
+    upper[i] *= iterations;
+  }
+  return( 1 );
+}
+
+
+
+
 static int _iterations_04connectivity( int R )
 {
   switch( R ) {
@@ -882,6 +941,8 @@ static void userDefinedDilation( void *inputBuf,
   int _INSIDE_Z_;
   int _INSIDE_Y_;
 
+  int lower[3], upper[3];
+
 
 
   if ( iterations <= 0 ) return;
@@ -889,6 +950,13 @@ static void userDefinedDilation( void *inputBuf,
        userDefinedSE->nb <= 0 ||
        userDefinedSE->list == NULL ) return;
 
+  if ( _isBoxStructuringElement( userDefinedSE, iterations, lower, upper ) == 1 ) {
+    if ( BoxDilation( inputBuf, resultBuf, type, theDim, lower, upper ) == 1 )
+      return;
+    if ( _debug_ )
+      fprintf( stderr, "%s: box computation failed, use generic one\n", proc );
+  }
+
   if ( iterations > 1 || inputBuf == resultBuf ) {
     tmpMustBeAllocated = 1;
   }
@@ -1439,6 +1507,8 @@ static void userDefinedErosion( void *inputBuf,
   int _INSIDE_Z_;
   int _INSIDE_Y_;
 
+  int lower[3], upper[3];
+
 
 
   if ( iterations <= 0 ) return;
@@ -1446,6 +1516,13 @@ static void userDefinedErosion( void *inputBuf,
        userDefinedSE->nb <= 0 ||
        userDefinedSE->list == NULL ) return;
 
+  if ( _isBoxStructuringElement( userDefinedSE, iterations, lower, upper ) == 1 ) {
+    if ( BoxErosion( inputBuf, resultBuf, type, theDim, lower, upper ) == 1 )
+      return;
+    if ( _debug_ )
+      fprintf( stderr, "%s: box computation failed, use generic one\n", proc );
+  }
+
   if ( iterations > 1 || inputBuf == resultBuf ) {
     tmpMustBeAllocated = 1;
   }
@@ -13,6 +13,9 @@
  *
  * ADDITIONS, CHANGES
  *
+ * - Mon Oct 19 2026
+ *   component tree (union-find) based computation of regional 
+ *   and h-extrema
  *
  *
  *
@@ -79,6 +82,19 @@ void regionalext_setNumberOfPointsForAllocation( int n )
 
 
 
+/* computation with the component tree of the input image
+   (near-linear, does not depend on the height, parallel) 
+   vs. iterative propagation with point lists
+*/
+static int _component_tree_ = 1;
+
+void regionalext_setComponentTreeComputation( int c )
+{
+  _component_tree_ = c;
+}
+
+
+
 
 
 /*************************************************************
@@ -126,7 +142,7 @@ static void initPointList( typePointList *l )
 
 static void freePointList( typePointList *l )
 {
-  if ( l->data != NULL ) free ( l->data );
+  if ( l->data != NULL ) vtfree ( l->data );
   initPointList( l );
 }
 
@@ -1343,6 +1359,35 @@ static void _defineNeighborsTobBeTested( typeNeighborhood *n,
 
 
 
+static int _evaluateConnectivity( int connectivity, int dimz )
+{
+  switch( connectivity ) {
+  case 4 :
+  case 8 :
+  case 6 :
+  case 18 :
+  case 26 :
+    break;
+  default :
+    connectivity = 26;
+  }
+    
+  if ( dimz == 1 ) {
+    switch( connectivity ) {
+    case 6 :
+      connectivity = 4; break;
+    case 18 :
+    case 26 :
+      connectivity = 8; break;
+    default :
+      break;
+    }
+  }
+  return( connectivity );
+}
+
+
+
 
 
 
@@ -1633,28 +1678,7 @@ static int _processList ( typePointList *thePointList,
    *
    --------------------------------------------------*/
 
-  switch( connectivity ) {
-  case 4 :
-  case 8 :
-  case 6 :
-  case 18 :
-  case 26 :
-    break;
-  default :
-    connectivity = 26;
-  }
-    
-  if ( theDim[2] == 1 ) {
-    switch( connectivity ) {
-    case 6 :
-      connectivity = 4; break;
-    case 18 :
-    case 26 :
-      connectivity = 8; break;
-    default :
-      break;
-    }
-  }
+  connectivity = _evaluateConnectivity( connectivity, theDim[2] );
   _defineNeighborsTobBeTested( &neighborhood, theDim, connectivity );
 
 
@@ -2112,6 +2136,637 @@ static int _processRegionalExtrema( void *theInput, void *theOutput, bufferType
 
 
 
+/*************************************************************
+ *
+ * component tree (max-tree) based computation
+ *
+ * The reconstruction of the marker (auxiliary image) under the 
+ * input image is computed from the component tree of the input image
+ * (the max-tree for maxima, the min-tree for minima), whose 
+ * nodes are the connected components of the level sets.
+ * 
+ * The tree is built with a union-find structure (Berger et al., 
+ * ICIP 2007): points are processed by decreasing level and
+ * merged with their already processed neighbors. The image is 
+ * divided into slabs of planes (z-slices in 3D, rows in 2D), one 
+ * tree is built per slab (in parallel, see chunks.h), and the 
+ * trees are merged along the slab borders (Wilkinson et al., 
+ * IEEE PAMI 2008). 
+ * The reconstruction is then the propagation of the marker maximum 
+ * from the leaves to the root, followed by a propagation of the
+ * reconstructed values from the root to the leaves: its
+ * cost is linear and does not depend on the height. The tree is
+ * independent of the marker, and can be used for several heights.
+ * 
+ * levels are (value - min) for maxima and (max - value) for minima,
+ * so that both cases are handled as a max-tree.
+ *
+ ************************************************************/
+
+
+
+typedef struct typeComponentTree {
+  /* node of each point, nodes are sorted by decreasing level
+     (a node is before its parent, the root is its own parent)
+   */
+  int *node;
+  int nnodes;
+  int *nodeParent;
+  u16 *nodeLevel;
+  u16 *nodeValue;
+  /* points tree, only used when building the tree
+   */
+  u16 *level;
+  int *parent;
+  int *sorted;
+  /* union-find (with union by rank), only used when building 
+     the tree: repr[] is the point of lowest level of the set
+   */
+  int *zpar;
+  int *repr;
+  u8 *rank;
+  int nlevels;
+  int *theDim;
+  typeNeighborhood neighborhood;
+} typeComponentTree;
+
+
+
+static void _initComponentTree( typeComponentTree *t )
+{
+  t->node = (int*)NULL;
+  t->nnodes = 0;
+  t->nodeParent = (int*)NULL;
+  t->nodeLevel = (u16*)NULL;
+  t->nodeValue = (u16*)NULL;
+  t->level = (u16*)NULL;
+  t->parent = (int*)NULL;
+  t->sorted = (int*)NULL;
+  t->zpar = (int*)NULL;
+  t->repr = (int*)NULL;
+  t->rank = (u8*)NULL;
+  t->nlevels = 0;
+  t->theDim = (int*)NULL;
+  t->neighborhood.nneighbors = 0;
+}
+
+
+
+static void _freeComponentTree( typeComponentTree *t )
+{
+  if ( t->node != (int*)NULL ) vtfree( t->node );
+  if ( t->nodeParent != (int*)NULL ) vtfree( t->nodeParent );
+  if ( t->nodeLevel != (u16*)NULL ) vtfree( t->nodeLevel );
+  if ( t->nodeValue != (u16*)NULL ) vtfree( t->nodeValue );
+  if ( t->level != (u16*)NULL ) vtfree( t->level );
+  if ( t->parent != (int*)NULL ) vtfree( t->parent );
+  if ( t->sorted != (int*)NULL ) vtfree( t->sorted );
+  if ( t->zpar != (int*)NULL ) vtfree( t->zpar );
+  if ( t->repr != (int*)NULL ) vtfree( t->repr );
+  if ( t->rank != (u8*)NULL ) vtfree( t->rank );
+  _initComponentTree( t );
+}
+
+
+
+static int _findZRoot( int *zpar, int i )
+{
+  while ( zpar[i] != i ) {
+    zpar[i] = zpar[ zpar[i] ];
+    i = zpar[i];
+  }
+  return( i );
+}
+
+
+
+/* canonical element of the node of x, ie the last point of the 
+ * chain of points of same level
+ */
+static int _levelRoot( typeComponentTree *t, int x )
+{
+  int *parent = t->parent;
+  u16 *level = t->level;
+  int r = x, n;
+
+  while ( parent[r] != r && level[ parent[r] ] == level[r] )
+    r = parent[r];
+  while ( x != r ) {
+    n = parent[x];
+    parent[x] = r;
+    x = n;
+  }
+  return( r );
+}
+
+
+
+/* counting sort of the points [first,last] by decreasing level
+ */
+static int _sortPointsByLevel( typeComponentTree *t, int *sorted, int first, int last )
+{
+  char *proc = "_sortPointsByLevel";
+  u16 *level = t->level;
+  int *histo = (int*)NULL;
+  int i, l, n;
+
+  histo = (int*)vtmalloc( t->nlevels * sizeof(int), "histo", proc );
+  if ( histo == (int*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate histogram\n", proc );
+    return( -1 );
+  }
+  for ( l=0; l<t->nlevels; l++ ) histo[l] = 0;
+  for ( i=first; i<=last; i++ ) histo[ level[i] ] ++;
+
+  for ( n=first, l=t->nlevels-1; l>=0; l-- ) {
+    i = histo[l];
+    histo[l] = n;
+    n += i;
+  }
+  for ( i=first; i<=last; i++ ) sorted[ histo[level[i]] ++ ] = i;
+
+  vtfree( histo );
+  return( 1 );
+}
+
+
+
+/* builds the tree of the planes [firstPlane, lastPlane]
+ * neighbors outside these planes are ignored
+ */
+static int _buildComponentTreeOfPlanes( typeComponentTree *t,
+                                        int firstPlane, int lastPlane )
+{
+  u16 *level = t->level;
+  int *parent = t->parent;
+  int *zpar = t->zpar;
+  int *repr = t->repr;
+  u8 *rank = t->rank;
+  int dimx = t->theDim[0];
+  int dimy = t->theDim[1];
+  int dimz = t->theDim[2];
+  int dimxy = dimx * dimy;
+  typeOffset *neighbors = t->neighborhood.neighbors;
+  int nneighbors = t->neighborhood.nneighbors;
+  int planeSize = ( dimz > 1 ) ? dimxy : dimx;
+  int first = firstPlane * planeSize;
+  int last = (lastPlane+1) * planeSize - 1;
+  int ylow, yhigh, zlow, zhigh;
+  int i, k, n, p, q, r, zp, tmp, x, y, z;
+
+  if ( dimz > 1 ) {
+    ylow = 0;            yhigh = dimy-1;
+    zlow = firstPlane;   zhigh = lastPlane;
+  }
+  else {
+    ylow = firstPlane;   yhigh = lastPlane;
+    zlow = zhigh = 0;
+  }
+
+  if ( _sortPointsByLevel( t, t->sorted, first, last ) != 1 )
+    return( -1 );
+
+  for ( i=first; i<=last; i++ ) zpar[i] = -1;
+
+#define _UNION_WITH_NEIGHBOR_ {                 \
+    r = _findZRoot( zpar, q );                  \
+    if ( r != zp ) {                            \
+      parent[ repr[r] ] = p;                    \
+      if ( rank[zp] < rank[r] ) {               \
+        tmp = zp;   zp = r;   r = tmp;          \
+      }                                         \
+      zpar[r] = zp;                             \
+      if ( rank[zp] == rank[r] ) rank[zp] ++;   \
+      repr[zp] = p;                             \
+    }                                           \
+  }
+
+  for ( k=first; k<=last; k++ ) {
+    p = t->sorted[k];
+    parent[p] = zpar[p] = repr[p] = zp = p;
+    rank[p] = 0;
+    z = p / dimxy;
+    y = (p - z*dimxy) / dimx;
+    x = p - z*dimxy - y*dimx;
+    /* inner point: no bound checking
+     */
+    if ( x > 0 && x < dimx-1 && y > ylow && y < yhigh 
+         && ( dimz == 1 || (z > zlow && z < zhigh) ) ) {
+      for ( n=0; n<nneighbors; n++ ) {
+        q = p + neighbors[n].di;
+        if ( zpar[q] < 0 || zpar[q] == zp ) continue;
+        _UNION_WITH_NEIGHBOR_
+      }
+      continue;
+    }
+    for ( n=0; n<nneighbors; n++ ) {
+      if ( x + neighbors[n].dx < 0 || dimx <= x + neighbors[n].dx ) continue;
+      if ( y + neighbors[n].dy < ylow || yhigh < y + neighbors[n].dy ) continue;
+      if ( z + neighbors[n].dz < zlow || zhigh < z + neighbors[n].dz ) continue;
+      q = p + neighbors[n].di;
+      if ( zpar[q] < 0 || zpar[q] == zp ) continue;
+      _UNION_WITH_NEIGHBOR_
+    }
+  }
+
+#undef _UNION_WITH_NEIGHBOR_
+
+  /* canonical tree of the slab (parents are processed after 
+     their children)
+   */
+  for ( k=last; k>=first; k-- ) {
+    p = t->sorted[k];
+    q = parent[p];
+    if ( level[ parent[q] ] == level[q] ) parent[p] = parent[q];
+  }
+
+  return( 1 );
+}
+
+
+
+static void *_buildComponentTreeSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  typeComponentTree *t = (typeComponentTree*)parameter;
+
+  if ( _buildComponentTreeOfPlanes( t, (int)first, (int)last ) != 1 ) {
+    chunk->ret = -1;
+    return( (void*)NULL );
+  }
+  chunk->ret = 1;
+  return( (void*)NULL );
+}
+
+
+
+/* merges the trees containing the neighboring points p and q
+ */
+static void _mergeComponentTrees( typeComponentTree *t, int p, int q )
+{
+  int *parent = t->parent;
+  u16 *level = t->level;
+  int x, y, z, tmp;
+
+  x = _levelRoot( t, p );
+  y = _levelRoot( t, q );
+  if ( level[y] > level[x] ) {
+    tmp = x;   x = y;   y = tmp;
+  }
+  
+  /* x is above (or at the same level than) y, 
+     the ancestors of x are inserted in the branch of y
+  */
+  while ( x != y && y >= 0 ) {
+    z = ( parent[x] == x ) ? -1 : _levelRoot( t, parent[x] );
+    if ( z >= 0 && level[z] >= level[y] ) {
+      x = z;
+    }
+    else {
+      parent[x] = y;
+      x = y;
+      y = z;
+    }
+  }
+}
+
+
+
+/* merges the first plane of the slab with the last plane
+ * of the previous one
+ * a diagonal pair (p,q) is useless if the point below p (resp. 
+ * above q) is not below min(level[p],level[q]): p and q are
+ * then already connected at this level through the straight pair
+ * and the slab trees.
+ */
+static void _mergeComponentTreesAtPlane( typeComponentTree *t, int plane )
+{
+  u16 *level = t->level;
+  int dimx = t->theDim[0];
+  int dimy = t->theDim[1];
+  int dimz = t->theDim[2];
+  typeOffset *neighbors = t->neighborhood.neighbors;
+  int nneighbors = t->neighborhood.nneighbors;
+  int planeSize = ( dimz > 1 ) ? dimx * dimy : dimx;
+  int x, y, n, p, q, m;
+  int yfirst, ylast, z;
+
+  if ( dimz > 1 ) {
+    yfirst = 0;  ylast = dimy-1;  z = plane;
+  }
+  else {
+    yfirst = ylast = plane;  z = 0;
+  }
+
+  for ( y=yfirst; y<=ylast; y++ ) {
+    p = (z * dimy + y) * dimx;
+    for ( x=0; x<dimx; x++, p++ ) {
+      for ( n=0; n<nneighbors; n++ ) {
+        if ( dimz > 1 && neighbors[n].dz != -1 ) continue;
+        if ( dimz == 1 && neighbors[n].dy != -1 ) continue;
+        if ( x + neighbors[n].dx < 0 || dimx <= x + neighbors[n].dx ) continue;
+        if ( y + neighbors[n].dy < 0 || dimy <= y + neighbors[n].dy ) continue;
+        q = p + neighbors[n].di;
+        if ( q != p - planeSize ) {
+          m = ( level[p] < level[q] ) ? level[p] : level[q];
+          if ( level[p - planeSize] >= m || level[q + planeSize] >= m ) continue;
+        }
+        _mergeComponentTrees( t, p, q );
+      }
+    }
+  }
+}
+
+
+
+static int _buildComponentTree( typeComponentTree *t,
+                                void *theInput, bufferType theType,
+                                int *theDim,
+                                int connectivity,
+                                enumRegionalExtremum extremumType,
+                                int theMin, int theMax )
+{
+  char *proc = "_buildComponentTree";
+  int v = theDim[0]*theDim[1]*theDim[2];
+  int nplanes = ( theDim[2] > 1 ) ? theDim[2] : theDim[1];
+  typeChunks chunks;
+  int *histo = (int*)NULL;
+  int *parent, *idx;
+  u16 *level;
+  int i, k, l, n, r;
+
+  _initComponentTree( t );
+
+  if ( theMax - theMin + 1 > 65536 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: too many levels\n", proc );
+    return( -1 );
+  }
+  t->nlevels = theMax - theMin + 1;
+  t->theDim = theDim;
+  _defineNeighborsTobBeTested( &(t->neighborhood), theDim, 
+                               _evaluateConnectivity( connectivity, theDim[2] ) );
+
+  t->level = (u16*)vtmalloc( v * sizeof(u16), "t->level", proc );
+  t->parent = (int*)vtmalloc( v * sizeof(int), "t->parent", proc );
+  t->sorted = (int*)vtmalloc( v * sizeof(int), "t->sorted", proc );
+  t->zpar = (int*)vtmalloc( v * sizeof(int), "t->zpar", proc );
+  t->repr = (int*)vtmalloc( v * sizeof(int), "t->repr", proc );
+  t->rank = (u8*)vtmalloc( v * sizeof(u8), "t->rank", proc );
+  if ( t->level == (u16*)NULL || t->parent == (int*)NULL 
+       || t->sorted == (int*)NULL || t->zpar == (int*)NULL
+       || t->repr == (int*)NULL || t->rank == (u8*)NULL ) {
+    _freeComponentTree( t );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate component tree\n", proc );
+    return( -1 );
+  }
+
+#define _INIT_LEVELS_( TYPE ) {                                     \
+    TYPE *theBuf = (TYPE*)theInput;                                 \
+    if ( extremumType == _REGIONAL_MAX_ )                           \
+      for ( i=0; i<v; i++ ) t->level[i] = (u16)(theBuf[i] - theMin); \
+    else                                                            \
+      for ( i=0; i<v; i++ ) t->level[i] = (u16)(theMax - theBuf[i]); \
+  }
+
+  switch ( theType ) {
+  default :
+    _freeComponentTree( t );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type not handled yet\n", proc );
+    return( -1 );
+  case SCHAR :  _INIT_LEVELS_( s8 );  break;
+  case UCHAR :  _INIT_LEVELS_( u8 );  break;
+  case SSHORT : _INIT_LEVELS_( s16 ); break;
+  case USHORT : _INIT_LEVELS_( u16 ); break;
+  }
+
+#undef _INIT_LEVELS_
+
+
+
+  /* trees of slabs
+   */
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, nplanes-1, proc ) != 1 ) {
+    _freeComponentTree( t );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ )
+    chunks.data[n].parameters = (void*)t;
+
+  if ( processChunks( &_buildComponentTreeSubroutine, &chunks, proc ) != 1 ) {
+    freeChunks( &chunks );
+    _freeComponentTree( t );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to build slab trees\n", proc );
+    return( -1 );
+  }
+
+  /* merging slabs
+   */
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    if ( chunks.data[n].first == 0 ) continue;
+    _mergeComponentTreesAtPlane( t, (int)chunks.data[n].first );
+  }
+
+  /* canonical tree: the parent of a point is the canonical element
+     of its node, the parent of a canonical element is the canonical 
+     element of the parent node
+   */
+  for ( i=0; i<v; i++ ) {
+    r = _levelRoot( t, i );
+    if ( r == i && t->parent[i] != i )
+      t->parent[i] = _levelRoot( t, t->parent[i] );
+  }
+
+  freeChunks( &chunks );
+
+  vtfree( t->zpar );
+  vtfree( t->repr );
+  vtfree( t->rank );
+  t->zpar = t->repr = (int*)NULL;
+  t->rank = (u8*)NULL;
+
+
+
+  /* nodes (ie canonical elements) sorted by decreasing level
+   */
+  parent = t->parent;
+  level = t->level;
+  histo = (int*)vtmalloc( t->nlevels * sizeof(int), "histo", proc );
+  if ( histo == (int*)NULL ) {
+    _freeComponentTree( t );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate histogram\n", proc );
+    return( -1 );
+  }
+  for ( l=0; l<t->nlevels; l++ ) histo[l] = 0;
+  for ( i=0; i<v; i++ ) {
+    if ( parent[i] != i && level[ parent[i] ] == level[i] ) continue;
+    histo[ level[i] ] ++;
+    t->nnodes ++;
+  }
+  for ( k=0, l=t->nlevels-1; l>=0; l-- ) {
+    n = histo[l];
+    histo[l] = k;
+    k += n;
+  }
+
+  t->nodeParent = (int*)vtmalloc( t->nnodes * sizeof(int), "t->nodeParent", proc );
+  t->nodeLevel = (u16*)vtmalloc( t->nnodes * sizeof(u16), "t->nodeLevel", proc );
+  t->nodeValue = (u16*)vtmalloc( t->nnodes * sizeof(u16), "t->nodeValue", proc );
+  if ( t->nodeParent == (int*)NULL || t->nodeLevel == (u16*)NULL 
+       || t->nodeValue == (u16*)NULL ) {
+    vtfree( histo );
+    _freeComponentTree( t );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate nodes\n", proc );
+    return( -1 );
+  }
+
+  /* the sort buffer is re-used for the node index of the 
+     canonical elements
+   */
+  idx = t->sorted;
+  for ( i=0; i<v; i++ ) {
+    if ( parent[i] != i && level[ parent[i] ] == level[i] ) continue;
+    k = histo[ level[i] ] ++;
+    idx[i] = k;
+    t->nodeLevel[k] = level[i];
+  }
+  vtfree( histo );
+
+  for ( i=0; i<v; i++ ) {
+    if ( parent[i] != i && level[ parent[i] ] == level[i] ) continue;
+    t->nodeParent[ idx[i] ] = idx[ parent[i] ];
+  }
+
+  /* the parent buffer becomes the node buffer
+   */
+  for ( i=0; i<v; i++ ) {
+    r = ( parent[i] != i && level[ parent[i] ] == level[i] ) ? parent[i] : i;
+    parent[i] = idx[r];
+  }
+  t->node = t->parent;
+  t->parent = (int*)NULL;
+
+  vtfree( t->sorted );
+  vtfree( t->level );
+  t->sorted = (int*)NULL;
+  t->level = (u16*)NULL;
+
+  if ( _verbose_ >= 2 )
+    fprintf( stderr, "%s: %d nodes for %d points\n", proc, t->nnodes, v );
+
+  return( 1 );
+}
+
+
+
+/* the marker (theOutput) is replaced by its reconstruction
+ * (by dilation for maxima, by erosion for minima) under the input
+ * image, from which the tree was built
+ */
+static int _reconstructWithComponentTree( typeComponentTree *t,
+                                          void *theOutput, bufferType theType,
+                                          enumRegionalExtremum extremumType,
+                                          int theMin, int theMax )
+{
+  char *proc = "_reconstructWithComponentTree";
+  int v = t->theDim[0]*t->theDim[1]*t->theDim[2];
+  int *node = t->node;
+  int *nodeParent = t->nodeParent;
+  u16 *nodeLevel = t->nodeLevel;
+  u16 *nodeValue = t->nodeValue;
+  int i, k, p;
+  u16 val;
+
+  for ( k=0; k<t->nnodes; k++ ) nodeValue[k] = 0;
+
+  /* maximum of the marker over each node
+   */
+#define _MARKER_TO_NODES_( TYPE ) {                                  \
+    TYPE *theBuf = (TYPE*)theOutput;                                 \
+    for ( i=0; i<v; i++ ) {                                          \
+      if ( extremumType == _REGIONAL_MAX_ )                          \
+        val = (u16)(theBuf[i] - theMin);                             \
+      else                                                           \
+        val = (u16)(theMax - theBuf[i]);                             \
+      if ( nodeValue[ node[i] ] < val ) nodeValue[ node[i] ] = val;  \
+    }                                                                \
+  }
+
+  switch ( theType ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type not handled yet\n", proc );
+    return( -1 );
+  case SCHAR :  _MARKER_TO_NODES_( s8 );  break;
+  case UCHAR :  _MARKER_TO_NODES_( u8 );  break;
+  case SSHORT : _MARKER_TO_NODES_( s16 ); break;
+  case USHORT : _MARKER_TO_NODES_( u16 ); break;
+  }
+
+#undef _MARKER_TO_NODES_
+
+  /* maximum of the marker over each sub-tree
+   */
+  for ( k=0; k<t->nnodes; k++ ) {
+    p = nodeParent[k];
+    if ( nodeValue[p] < nodeValue[k] ) nodeValue[p] = nodeValue[k];
+  }
+
+  /* reconstructed value of the nodes, from the root to the leaves:
+     max over the ancestors of min( level, marker maximum )
+   */
+  for ( k=t->nnodes-1; k>=0; k-- ) {
+    p = nodeParent[k];
+    val = ( nodeValue[k] < nodeLevel[k] ) ? nodeValue[k] : nodeLevel[k];
+    if ( p != k && val < nodeValue[p] ) val = nodeValue[p];
+    nodeValue[k] = val;
+  }
+
+  /* reconstructed value of the points
+   */
+#define _NODES_TO_MARKER_( TYPE ) {                                  \
+    TYPE *theBuf = (TYPE*)theOutput;                                 \
+    if ( extremumType == _REGIONAL_MAX_ )                            \
+      for ( i=0; i<v; i++ )                                          \
+        theBuf[i] = (TYPE)(theMin + (int)nodeValue[ node[i] ]);      \
+    else                                                             \
+      for ( i=0; i<v; i++ )                                          \
+        theBuf[i] = (TYPE)(theMax - (int)nodeValue[ node[i] ]);      \
+  }
+
+  switch ( theType ) {
+  default :
+    break;
+  case SCHAR :  _NODES_TO_MARKER_( s8 );  break;
+  case UCHAR :  _NODES_TO_MARKER_( u8 );  break;
+  case SSHORT : _NODES_TO_MARKER_( s16 ); break;
+  case USHORT : _NODES_TO_MARKER_( u16 ); break;
+  }
+
+#undef _NODES_TO_MARKER_
+
+  return( 1 );
+}
+
+
+
+
+
+
+
 static int _regionalExtrema( void *theInput, void *theOutput, bufferType theType, 
                             int *theDim,
                             int height, double multiplier,
@@ -2125,6 +2780,7 @@ static int _regionalExtrema( void *theInput, void *theOutput, bufferType theType
   int v = theDim[0]*theDim[1]*theDim[2];
   int i;
   void *theTmp = NULL;
+  typeComponentTree tree;
 
 
 
@@ -2233,10 +2889,28 @@ static int _regionalExtrema( void *theInput, void *theOutput, bufferType theType
 
   /* compute the extrema
    */
-  if ( _processRegionalExtrema( theInput, theTmp, theType, 
-                                theDim,
-                                connectivity, extremumType,
-                                theInitialMin, theInitialMax ) != 1 ) {
+  if ( _component_tree_ ) {
+    if ( _buildComponentTree( &tree, theInput, theType, theDim, connectivity,
+                              extremumType, theInputMin, theInputMax ) != 1 ) {
+      if ( theInput == theOutput ) vtfree( theTmp );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to build component tree\n", proc );
+      return( -1 );
+    }
+    if ( _reconstructWithComponentTree( &tree, theTmp, theType, extremumType,
+                                        theInputMin, theInputMax ) != 1 ) {
+      _freeComponentTree( &tree );
+      if ( theInput == theOutput ) vtfree( theTmp );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: error when computing extrema\n", proc );
+      return( -1 );
+    }
+    _freeComponentTree( &tree );
+  }
+  else if ( _processRegionalExtrema( theInput, theTmp, theType, 
+                                     theDim,
+                                     connectivity, extremumType,
+                                     theInitialMin, theInitialMax ) != 1 ) {
     if ( theInput == theOutput ) vtfree( theTmp );
       if ( _verbose_ )
         fprintf( stderr, "%s: error when computing extrema\n", proc );
@@ -2346,6 +3020,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
   int v = theDim[0]*theDim[1]*theDim[2];
   int height, i;
   void *theTmp = NULL;
+  typeComponentTree tree;
 
   void *theRes = NULL;
   bufferType theResType = TYPE_UNKNOWN;
@@ -2453,6 +3128,22 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
 
 
 
+  /* the component tree does not depend on the height
+   */
+  _initComponentTree( &tree );
+  if ( _component_tree_ ) {
+    if ( _buildComponentTree( &tree, theInput, theType, theDim, connectivity,
+                              extremumType, theInputMin, theInputMax ) != 1 ) {
+      vtfree( theRes );
+      if ( theInput == theOutput ) vtfree( theTmp );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to build component tree\n", proc );
+      return( -1 );
+    }
+  }
+
+
+
   /* loop over the heights
    */
 
@@ -2478,6 +3169,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
                                       extremumType,
                                       height, 1.0,
                                       theInputMin, theInputMax ) != 1 ) {
+      _freeComponentTree( &tree );
       if ( theInput == theOutput ) vtfree( theTmp );
       if ( _verbose_ )
         fprintf( stderr, "%s: error when initializing auxiliary image\n", proc );
@@ -2489,12 +3181,14 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
     /* compute min and max values
      */
     if ( minMaxValues( theTmp, theType, theMask, theMaskType, theDim, &theInitialMin, &theInitialMax ) != 1 ) {
+      _freeComponentTree( &tree );
       if ( _verbose_ )
         fprintf( stderr, "%s: unable to compute min and max\n", proc );
       return( -1 );
     }
     
     if ( theInitialMin == theInitialMax ) {
+      _freeComponentTree( &tree );
       /* a subtraction should be done here
        */
       vtfree( theRes );
@@ -2523,10 +3217,15 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
     
     /* compute the extrema
      */
-    if ( _processRegionalExtrema( theInput, theTmp, theType, 
-                                  theDim,
-                                  connectivity, extremumType,
-                                  theInitialMin, theInitialMax ) != 1 ) {
+    if ( ( _component_tree_ 
+           && _reconstructWithComponentTree( &tree, theTmp, theType, extremumType,
+                                             theInputMin, theInputMax ) != 1 )
+         || ( !_component_tree_ 
+              && _processRegionalExtrema( theInput, theTmp, theType, 
+                                          theDim,
+                                          connectivity, extremumType,
+                                          theInitialMin, theInitialMax ) != 1 ) ) {
+      _freeComponentTree( &tree );
       vtfree( theRes );
       if ( theInput == theOutput ) vtfree( theTmp );
       if ( _verbose_ )
@@ -2557,6 +3256,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
      */
     switch ( theResType ) {
     default : 
+      _freeComponentTree( &tree );
       vtfree( theRes );
       if ( theInput == theOutput ) vtfree( theTmp );
       if ( _verbose_ )
@@ -2566,6 +3266,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
 
       switch ( extremumType ) {
       default :
+        _freeComponentTree( &tree );
         vtfree( theRes );
         if ( theInput == theOutput ) vtfree( theTmp );
         if ( _verbose_ )
@@ -2575,6 +3276,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
       case _REGIONAL_MAX_ :
         switch ( theType ) {
         default :
+          _freeComponentTree( &tree );
           vtfree( theRes );
           if ( theInput == theOutput ) vtfree( theTmp );
           if ( _verbose_ )
@@ -2598,6 +3300,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
       case _REGIONAL_MIN_ :
         switch ( theType ) {
         default :
+          _freeComponentTree( &tree );
           vtfree( theRes );
           if ( theInput == theOutput ) vtfree( theTmp );
           if ( _verbose_ )
@@ -2629,6 +3332,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
   /* copy result
    */
     if ( ConvertBuffer( theRes, theResType, theOutput, theType, (size_t)v ) != 1 ) {
+    _freeComponentTree( &tree );
     vtfree( theRes );
     if ( theInput == theOutput ) vtfree( theTmp );
     if ( _verbose_ )
@@ -2636,6 +3340,7 @@ static int _regionalHierarchicalExtrema( void *theInput, void *theOutput, buffer
     return( -1 );
   }
 
+  _freeComponentTree( &tree );
   vtfree( theRes );
   if ( theInput == theOutput ) vtfree( theTmp );
 
@@ -13,6 +13,9 @@
  *
  * ADDITIONS, CHANGES
  *
+ * - Mon Oct 19 2026
+ *   component tree (union-find) based computation of regional 
+ *   and h-extrema
  *
  *
  *
@@ -39,6 +42,15 @@ extern void decrementVerboseInRegionalExt(  );
 
 void regionalext_setNumberOfPointsForAllocation( int n );
 
+/* if c != 0 (default), the reconstruction is computed from the
+   component tree (max-tree or min-tree) of the input image, built 
+   in parallel by slabs (see chunks.h): the cost is near-linear and 
+   does not depend on the height. For hierarchical extrema, the tree 
+   is built once for all heights.
+   if c == 0, the iterative propagation with point lists is used.
+*/
+void regionalext_setComponentTreeComputation( int c );
+
 
 
 extern int regionalMaxima( void *theInput, void *theOutput, 
@@ -36,7 +36,7 @@
 
 static char program[256];
 static char *usage = "image-in image-out [-t %d] [-at %d] [-cbe %d] [-dbe %d]\n\
-\t [-curves|-pure-curves|-surfaces|-pure-surfaces] [-chamfer %d] [-v] [-help]";
+\t [-curves|-pure-curves|-surfaces|-pure-surfaces] [-chamfer %d] [-subfield] [-v] [-help]";
 static char *details ="\n\
 Thinning by ordering distance\n\
 ----------------\n\
@@ -51,6 +51,7 @@ a binary image.\n\
 \t        end condition (without waiting for the minimal number of cycles)\n\
 \t -curves   : end condition, yield curves\n\
 \t -surfaces : end condition, yield surfaces\n\
+\t -subfield : parallel thinning by subfields (parity of coordinates)\n\
 \t -v | -verbose\n\
 \t -nv | -no-verbose\n\
 \t -h | -help : print this message";
@@ -188,6 +189,11 @@ int main( int argc, char* argv[] )
       }
 
 
+      else if ( (strcmp ( argv[i], "-subfield" ) == 0) ) {
+        p.typeScheme = _SUBFIELD_THINNING_;
+      }
+
+
       else {
         sprintf( nameImageIn, "unknown option %s\n", argv[i] );
         ErrorMessage( nameImageIn, 0);
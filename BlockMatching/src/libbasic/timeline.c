@@ -0,0 +1,443 @@
+/*************************************************************************
+ * timeline.c -
+ *
+ * Copyright (c) INRIA 2026
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+
+
+/* clock_gettime()
+ */
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <timeline.h>
+
+
+
+static int _verbose_ = 1;
+
+void setVerboseInTimeline( int v )
+{
+  _verbose_ = v;
+}
+
+void incrementVerboseInTimeline(  )
+{
+  _verbose_ ++;
+}
+
+void decrementVerboseInTimeline(  )
+{
+  _verbose_ --;
+  if ( _verbose_ < 0 ) _verbose_ = 0;
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * per-thread buffers
+ *
+ * each thread appends its slices to its own buffer (found with
+ * pthread_getspecific()), so that recording does not require any
+ * lock. The mutex only protects the registration of a new thread.
+ *
+ * buffers are allocated with malloc() and not vtmalloc(), so that
+ * the timeline does not appear in the memory profile, and are kept
+ * until the end of the process (threads may end before the trace
+ * is written). The buffer of an ended thread is given to the next
+ * new thread, so that threads created for each processing (see
+ * chunks.c) share a few lines of the timeline.
+ *
+ --------------------------------------------------*/
+
+
+
+#define _TIMELINE_NAME_LENGTH_ 41
+#define _TIMELINE_DEPTH_ 8
+#define _TIMELINE_SLICES_ 256
+
+
+
+typedef struct _timelineSlice {
+  char name[_TIMELINE_NAME_LENGTH_];
+  char *category;
+  double begin;
+  double end;
+  long int arg;
+} _timelineSlice;
+
+typedef struct _timelineBuffer {
+  int tid;
+  int in_use;
+  _timelineSlice *data;
+  size_t n_data;
+  size_t n_allocated_data;
+  size_t n_lost_data;
+  /* current (not ended) stages
+   */
+  _timelineSlice stages[_TIMELINE_DEPTH_];
+  int depth;
+  struct _timelineBuffer *next;
+} _timelineBuffer;
+
+
+
+/* -1: the environment has not been checked yet
+ */
+static int _timeline_ = -1;
+static char _timeline_name_[1024];
+
+static int _timeline_is_initialized_ = 0;
+static double _timeline_origin_ = 0.0;
+static pthread_key_t _timeline_key_;
+static pthread_mutex_t _timeline_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+static _timelineBuffer *_timeline_buffers_ = (_timelineBuffer*)NULL;
+static int _n_timeline_buffers_ = 0;
+
+
+
+static double _getTime( )
+{
+  struct timespec t;
+  if ( clock_gettime( CLOCK_MONOTONIC, &t ) != 0 ) return( 0.0 );
+  return( (double)t.tv_sec * 1000000.0 + (double)t.tv_nsec / 1000.0 );
+}
+
+
+
+static void _writeTimelineAtExit( )
+{
+  (void)writeTimeline( _timeline_name_ );
+}
+
+
+
+static void _releaseTimelineBuffer( void *buffer );
+
+/* to be called with the mutex locked
+ */
+static int _initTimeline( )
+{
+  if ( _timeline_is_initialized_ ) return( 1 );
+  if ( pthread_key_create( &_timeline_key_, _releaseTimelineBuffer ) != 0 ) return( -1 );
+  _timeline_origin_ = _getTime();
+  _timeline_is_initialized_ = 1;
+  return( 1 );
+}
+
+
+
+static int _checkTimeline( )
+{
+  char *name;
+
+  if ( _timeline_ >= 0 ) return( _timeline_ );
+
+  pthread_mutex_lock( &_timeline_mutex_ );
+  if ( _timeline_ < 0 ) {
+    _timeline_ = 0;
+    name = getenv( "TIMELINE" );
+    if ( name != (char*)NULL && name[0] != '\0'
+         && strlen( name ) < sizeof(_timeline_name_)
+         && _initTimeline() == 1 ) {
+      (void)strcpy( _timeline_name_, name );
+      (void)atexit( _writeTimelineAtExit );
+      _timeline_ = 1;
+    }
+  }
+  pthread_mutex_unlock( &_timeline_mutex_ );
+
+  return( _timeline_ );
+}
+
+
+
+static _timelineBuffer *_getTimelineBuffer( )
+{
+  _timelineBuffer *b;
+
+  b = (_timelineBuffer*)pthread_getspecific( _timeline_key_ );
+  if ( b != (_timelineBuffer*)NULL ) return( b );
+
+  pthread_mutex_lock( &_timeline_mutex_ );
+  for ( b=_timeline_buffers_; b!=(_timelineBuffer*)NULL; b=b->next ) {
+    if ( b->in_use == 0 ) break;
+  }
+  if ( b == (_timelineBuffer*)NULL ) {
+    b = (_timelineBuffer*)calloc( 1, sizeof(_timelineBuffer) );
+    if ( b == (_timelineBuffer*)NULL ) {
+      pthread_mutex_unlock( &_timeline_mutex_ );
+      return( (_timelineBuffer*)NULL );
+    }
+    b->tid = _n_timeline_buffers_ ++;
+    b->next = _timeline_buffers_;
+    _timeline_buffers_ = b;
+  }
+  b->in_use = 1;
+  pthread_mutex_unlock( &_timeline_mutex_ );
+
+  (void)pthread_setspecific( _timeline_key_, (void*)b );
+  return( b );
+}
+
+
+
+static void _addTimelineSlice( _timelineBuffer *b, _timelineSlice *s )
+{
+  _timelineSlice *data;
+  size_t n;
+
+  if ( b->n_data == b->n_allocated_data ) {
+    n = ( b->n_allocated_data == 0 ) ? _TIMELINE_SLICES_ : 2 * b->n_allocated_data;
+    data = (_timelineSlice*)realloc( b->data, n * sizeof(_timelineSlice) );
+    if ( data == (_timelineSlice*)NULL ) {
+      b->n_lost_data ++;
+      return;
+    }
+    b->data = data;
+    b->n_allocated_data = n;
+  }
+  b->data[ b->n_data ] = *s;
+  b->n_data ++;
+}
+
+
+
+/* called at the end of a thread: its current stages are ended
+ */
+static void _releaseTimelineBuffer( void *buffer )
+{
+  _timelineBuffer *b = (_timelineBuffer*)buffer;
+  double t = _getTime() - _timeline_origin_;
+  int d;
+
+  for ( d=b->depth-1; d>=0; d-- ) {
+    b->stages[d].end = t;
+    _addTimelineSlice( b, &(b->stages[d]) );
+  }
+  b->depth = 0;
+
+  pthread_mutex_lock( &_timeline_mutex_ );
+  b->in_use = 0;
+  pthread_mutex_unlock( &_timeline_mutex_ );
+}
+
+
+
+static void _setTimelineSlice( _timelineSlice *s, char *name, char *category,
+                               double begin, double end, long int arg )
+{
+  if ( name == (char*)NULL ) {
+    s->name[0] = '\0';
+  }
+  else {
+    (void)strncpy( s->name, name, _TIMELINE_NAME_LENGTH_ );
+    s->name[_TIMELINE_NAME_LENGTH_-1] = '\0';
+  }
+  s->category = category;
+  s->begin = begin;
+  s->end = end;
+  s->arg = arg;
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * recording
+ *
+ --------------------------------------------------*/
+
+
+
+void setTimeline( int t )
+{
+  (void)_checkTimeline();
+  pthread_mutex_lock( &_timeline_mutex_ );
+  if ( t == 0 || _initTimeline() == 1 )
+    _timeline_ = ( t ) ? 1 : 0;
+  pthread_mutex_unlock( &_timeline_mutex_ );
+}
+
+
+
+int getTimeline( )
+{
+  return( _checkTimeline() );
+}
+
+
+
+double getTimelineTime( )
+{
+  if ( _checkTimeline() == 0 ) return( 0.0 );
+  return( _getTime() - _timeline_origin_ );
+}
+
+
+
+void addTimelineSlice( char *name, char *category, double begin, long int arg )
+{
+  _timelineBuffer *b;
+  _timelineSlice s;
+
+  if ( _checkTimeline() == 0 ) return;
+  b = _getTimelineBuffer();
+  if ( b == (_timelineBuffer*)NULL ) return;
+  _setTimelineSlice( &s, name, category, begin, _getTime() - _timeline_origin_, arg );
+  _addTimelineSlice( b, &s );
+}
+
+
+
+void setTimelineStage( int depth, char *name )
+{
+  _timelineBuffer *b;
+  double t;
+  int d;
+
+  if ( _checkTimeline() == 0 ) return;
+  b = _getTimelineBuffer();
+  if ( b == (_timelineBuffer*)NULL ) return;
+
+  t = _getTime() - _timeline_origin_;
+
+  /* stages can not be set below the current depth
+   */
+  if ( depth < 0 ) depth = 0;
+  if ( depth > b->depth ) depth = b->depth;
+  for ( d=b->depth-1; d>=depth; d-- ) {
+    b->stages[d].end = t;
+    _addTimelineSlice( b, &(b->stages[d]) );
+  }
+  b->depth = depth;
+
+  if ( name == (char*)NULL || name[0] == '\0' ) return;
+  if ( depth >= _TIMELINE_DEPTH_ ) return;
+  _setTimelineSlice( &(b->stages[depth]), name, "stage", t, t, -1 );
+  b->depth = depth+1;
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * trace
+ *
+ --------------------------------------------------*/
+
+
+
+static void _fprintfJSONString( FILE *f, char *str )
+{
+  char *c;
+
+  fprintf( f, "\"" );
+  if ( str != (char*)NULL ) {
+    for ( c=str; *c != '\0'; c++ ) {
+      if ( *c == '"' || *c == '\\' ) fprintf( f, "\\%c", *c );
+      else if ( (unsigned char)*c < 32 ) fprintf( f, " " );
+      else fprintf( f, "%c", *c );
+    }
+  }
+  fprintf( f, "\"" );
+}
+
+
+
+static void _fprintfTimelineSlice( FILE *f, _timelineSlice *s, int pid, int tid, double end )
+{
+  fprintf( f, ",\n{\"name\":" );
+  _fprintfJSONString( f, s->name );
+  fprintf( f, ",\"cat\":" );
+  _fprintfJSONString( f, s->category );
+  fprintf( f, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+           pid, tid, s->begin, end - s->begin );
+  if ( s->arg >= 0 )
+    fprintf( f, ",\"args\":{\"n\":%ld}", s->arg );
+  fprintf( f, "}" );
+}
+
+
+
+/* should not be called while threads are recording slices,
+ * stages that are not ended yet are ended at the current time
+ */
+void fprintfTimeline( FILE *f )
+{
+  _timelineBuffer *b;
+  double t;
+  size_t i;
+  int d, pid = (int)getpid();
+  size_t n_lost_data = 0;
+
+  if ( _timeline_is_initialized_ == 0 ) return;
+
+  pthread_mutex_lock( &_timeline_mutex_ );
+  t = _getTime() - _timeline_origin_;
+
+  /* the first event gives the time origin
+   */
+  fprintf( f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+  fprintf( f, "{\"name\":\"origin\",\"ph\":\"i\",\"s\":\"p\",\"pid\":%d,\"tid\":0,\"ts\":0.000}", pid );
+  for ( b=_timeline_buffers_; b!=(_timelineBuffer*)NULL; b=b->next ) {
+    fprintf( f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"thread #%d\"}}",
+             pid, b->tid, b->tid );
+    for ( i=0; i<b->n_data; i++ )
+      _fprintfTimelineSlice( f, &(b->data[i]), pid, b->tid, b->data[i].end );
+    for ( d=0; d<b->depth; d++ )
+      _fprintfTimelineSlice( f, &(b->stages[d]), pid, b->tid, t );
+    n_lost_data += b->n_lost_data;
+  }
+  fprintf( f, "\n]}\n" );
+  pthread_mutex_unlock( &_timeline_mutex_ );
+
+  if ( n_lost_data > 0 && _verbose_ )
+    fprintf( stderr, "fprintfTimeline: %lu slices have not been recorded\n", n_lost_data );
+}
+
+
+
+int writeTimeline( char *name )
+{
+  char *proc = "writeTimeline";
+  FILE *f;
+
+  if ( name == (char*)NULL || name[0] == '\0' || strcmp( name, "-" ) == 0 ) {
+    fprintfTimeline( stdout );
+    return( 1 );
+  }
+  f = fopen( name, "w" );
+  if ( f == (FILE*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to open '%s' for writing\n", proc, name );
+    return( -1 );
+  }
+  fprintfTimeline( f );
+  fclose( f );
+  return( 1 );
+}
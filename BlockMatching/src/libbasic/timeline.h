@@ -0,0 +1,69 @@
+/*************************************************************************
+ * timeline.h -
+ *
+ * Copyright (c) INRIA 2026
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+
+#ifndef _timeline_h_
+#define _timeline_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+
+
+
+/* Timeline of the computation, written as a Chrome trace (JSON
+ * 'trace event' format, that can be loaded into chrome://tracing
+ * or ui.perfetto.dev), eg to look at load imbalance between
+ * threads or at serial parts.
+ *
+ * Each thread records its slices in its own buffer. The timeline
+ * is enabled either by setTimeline() or by setting the TIMELINE
+ * environment variable to the name of a file where the trace is
+ * written at exit.
+ */
+
+extern void setVerboseInTimeline( int v );
+extern void incrementVerboseInTimeline( );
+extern void decrementVerboseInTimeline( );
+
+extern void setTimeline( int t );
+extern int getTimeline( );
+
+/* time in microseconds
+ */
+extern double getTimelineTime( );
+
+/* adds a slice from 'begin' (given by getTimelineTime()) to now
+ * for the calling thread, 'arg' is reported if not negative
+ */
+extern void addTimelineSlice( char *name, char *category, double begin, long int arg );
+
+/* sequential stages of the calling thread: the stage at depth d
+ * ends the current stages at depth d and deeper, a NULL name
+ * only ends them
+ */
+extern void setTimelineStage( int depth, char *name );
+
+extern void fprintfTimeline( FILE *f );
+extern int writeTimeline( char *name );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -13,9 +13,9 @@
  *
  * ADDITIONS, CHANGES
  *
- *
- *
- *
+ * - Mon Oct 19 2026
+ *   look-up table (2D) and decision tree (3D) for simple point tests
+ *   subfield (parallel) thinning scheme
  *
  */
 
@@ -28,7 +28,9 @@
 #include <chamferdistance.h>
 #include <t04t08.h>
 #include <t06t26.h>
+#include <issimple3D.h>
 
+#include <chunks.h>
 #include <vtmalloc.h>
 
 #include <topological-operations-common.h>
@@ -133,6 +135,10 @@ void initTypeThinningParameters( typeThinningParameters *p )
   /* end condition
    */
   p->maxIteration = -1;
+
+  /* processing scheme
+   */
+  p->typeScheme = _SEQUENTIAL_THINNING_;
 }
 
 static void _fprintfTypeThinningParameters( FILE *f, typeThinningParameters *par )
@@ -175,6 +181,13 @@ static void _fprintfTypeThinningParameters( FILE *f, typeThinningParameters *par
     fprintf( f, " ... cyclesBeforeEnding   = %d\n", par->cyclesBeforeEnding );
     fprintf( f, " ... valueBeforeEnding    = %d\n", par->valueBeforeEnding );
     fprintf( f, " ... max. iterations      = %d\n", par->maxIteration );
+    fprintf( f, " ... typeScheme           = " );
+    switch ( par->typeScheme ) {
+    default : fprintf( f, "unknown" ); break;
+    case _SEQUENTIAL_THINNING_ : fprintf( f, "SEQUENTIAL" ); break;
+    case _SUBFIELD_THINNING_   : fprintf( f, "SUBFIELD" ); break;
+    }
+    fprintf( f, "\n" );
 
 }
 
@@ -554,11 +567,15 @@ static int _check3DThickness( int *neighb,
 typedef int (*typeIsPointSimple)( int *,
                                   int *,
                                   int *,
-                                  enumTypeChange typeChanging );
+                                  enumTypeChange typeChanging,
+                                  unsigned char * );
+
+typedef void (*typeComputeTopologicalNumbers)( int *, int *, int * );
 
 
 
-static int _is2DPointSimple( int *neighb, int *t04, int *t08, enumTypeChange typeChanging )
+static int _is2DPointSimple( int *neighb, int *t04, int *t08, enumTypeChange typeChanging,
+                             unsigned char *table __attribute__ ((unused)) )
 {
   int checkT04, checkT08;
   int n;
@@ -598,7 +615,11 @@ static int _is2DPointSimple( int *neighb, int *t04, int *t08, enumTypeChange typ
           fprintf( stderr, " t04=%d, t08=%d\n", checkT04, checkT08 );
           fprintfNeighborhood( stderr, neighb, 9 );
       }
-      if ( checkT04 != 1 || checkT08 != 1 ) return( 0 );
+      if ( checkT04 != 1 || checkT08 != 1 ) {
+        *t04 = checkT04;
+        *t08 = checkT08;
+        return( 0 );
+      }
 
       for ( n=0; n<9; n++ )
         if ( neighb[n] == _TOBECHANGED_ )
@@ -619,7 +640,8 @@ static int _is2DPointSimple( int *neighb, int *t04, int *t08, enumTypeChange typ
 
 
 
-static int _is3DPointSimple( int *neighb, int *t06, int *t26, enumTypeChange typeChanging )
+static int _is3DPointSimple( int *neighb, int *t06, int *t26, enumTypeChange typeChanging,
+                             unsigned char *table __attribute__ ((unused)) )
 {
   int checkT06, checkT26;
   int n;
@@ -674,6 +696,169 @@ static int _is3DPointSimple( int *neighb, int *t06, int *t26, enumTypeChange typ
 
 
 
+/**************************************************
+ *
+ * fast simple point tests
+ *
+ * only the simplicity is required (both topological
+ * numbers are equal to 1)
+ * - 2D: a configuration is coded with the 8 neighbors
+ *   (the central point is excluded), a neighbor with a
+ *   non-null value being in the foreground. The 256
+ *   configurations are computed once into a look-up table.
+ * - 3D: a table of the 2^26 configurations would be too large
+ *   to be computed (and to stay in cache), IsA3DPointSimple()
+ *   (issimple3D.c) is used instead: it is a decision tree
+ *   that stops as soon as the answer is known.
+ *
+ * The topological numbers are only computed for non-simple
+ * points, and only if required (end point conditions),
+ * thus they are set to -1 when they have to be computed.
+ *
+ **************************************************/
+
+
+
+static int _use_fast_simple_point_test_ = 1;
+
+void setFastSimplePointTestInTopologicalThinning( int t )
+{
+  _use_fast_simple_point_test_ = t;
+}
+
+
+
+#define _2D_SIMPLE_POINT_TABLE_SIZE_ 256
+
+
+
+static void _fill2DSimplePointTable( unsigned char *table )
+{
+  int neighb[9];
+  int c, n, b, t04, t08;
+
+  for ( c=0; c<_2D_SIMPLE_POINT_TABLE_SIZE_; c++ ) {
+    for ( n=0, b=0; n<9; n++ ) {
+      if ( n == 4 ) {
+        neighb[n] = _FOREGROUND_VALUE_;
+        continue;
+      }
+      neighb[n] = ( c & (1 << b) ) ? _FOREGROUND_VALUE_ : _BACKGROUND_VALUE_;
+      b ++;
+    }
+    Compute_T04_and_T08( neighb, &t04, &t08 );
+    table[c] = ( t04 == 1 && t08 == 1 ) ? 1 : 0;
+  }
+}
+
+
+
+static int _is2DConfigurationSimple( int *neighb, unsigned char *table )
+{
+  int c = 0;
+
+  if ( neighb[0] ) c |= 0x01;
+  if ( neighb[1] ) c |= 0x02;
+  if ( neighb[2] ) c |= 0x04;
+  if ( neighb[3] ) c |= 0x08;
+  if ( neighb[5] ) c |= 0x10;
+  if ( neighb[6] ) c |= 0x20;
+  if ( neighb[7] ) c |= 0x40;
+  if ( neighb[8] ) c |= 0x80;
+  return( table[c] );
+}
+
+
+
+static int _is3DConfigurationSimple( int *neighb, unsigned char *table __attribute__ ((unused)) )
+{
+  return( IsA3DPointSimple( neighb ) );
+}
+
+
+
+/* same tests than _is2DPointSimple() and _is3DPointSimple()
+ */
+static int _isPointSimpleFast( int *neighb, int nneighbors,
+                                    int *tback, int *tfore,
+                                    enumTypeChange typeChanging,
+                                    unsigned char *table,
+                                    int (*isConfigurationSimple)( int *, unsigned char * ) )
+{
+  int n;
+
+  switch( typeChanging ) {
+  default :
+  case _FOREGROUND_TO_BACKGROUND_ :
+
+      *tback = *tfore = -1;
+      if ( (*isConfigurationSimple)( neighb, table ) == 0 ) return( 0 );
+      *tback = *tfore = 1;
+
+      for ( n=0; n<nneighbors; n++ )
+        if ( neighb[n] == _TOBECHANGED_ )
+          neighb[n] = _BACKGROUND_VALUE_;
+
+      if ( (*isConfigurationSimple)( neighb, table ) == 0 ) return( 0 );
+
+      break;
+
+  case _BACKGROUND_TO_FOREGROUND_ :
+
+      for ( n=0; n<nneighbors; n++ )
+        if ( neighb[n] == _CANBECHANGED_ )
+          neighb[n] = _BACKGROUND_VALUE_;
+
+      *tback = *tfore = -1;
+      if ( (*isConfigurationSimple)( neighb, table ) == 0 ) return( 0 );
+      *tback = *tfore = 1;
+
+      for ( n=0; n<nneighbors; n++ )
+        if ( neighb[n] == _TOBECHANGED_ )
+          neighb[n] = _BACKGROUND_VALUE_;
+
+      if ( (*isConfigurationSimple)( neighb, table ) == 0 ) return( 0 );
+
+      break;
+  }
+
+  return( 1 );
+}
+
+
+
+static int _is2DPointSimpleFast( int *neighb, int *t04, int *t08, enumTypeChange typeChanging,
+                                      unsigned char *table )
+{
+  if ( _isPointSimpleFast( neighb, 9, t04, t08, typeChanging,
+                                table, &_is2DConfigurationSimple ) == 1 )
+    return( 1 );
+  /* in 2D, for thickening, _is2DPointSimple() returns the
+     topological numbers of the second configuration
+  */
+  if ( typeChanging == _BACKGROUND_TO_FOREGROUND_ )
+    *t04 = *t08 = -1;
+  return( 0 );
+}
+
+
+
+static int _is3DPointSimpleFast( int *neighb, int *t06, int *t26, enumTypeChange typeChanging,
+                                      unsigned char *table )
+{
+  return( _isPointSimpleFast( neighb, 27, t06, t26, typeChanging,
+                                   table, &_is3DConfigurationSimple ) );
+}
+
+
+
+
+
+
+
+
+
+
 /**************************************************
  *
  * end point tests
@@ -1194,6 +1379,266 @@ int chamferBasedThinning( unsigned char *theBuf,
 
 
 
+/* one pass of thinning: the points of the list are examined
+ * for one direction, and are marked either as _TOBECHANGED_
+ * or as _ENDPOINT_
+ */
+
+typedef struct _typeThinningPass {
+  unsigned char *theBuf;
+  int *theDim;
+  typeNeighborhood *offsetForSimplicity;
+  typeThinningParameters *par;
+
+  typeCheckThickness checkThickness;
+  typeIsPointSimple isPointSimple;
+  typeComputeTopologicalNumbers computeTopologicalNumbers;
+  typeEndConditionSimplePoint endConditionSimplePoint;
+  typeEndConditionNonSimplePoint endConditionNonSimplePoint;
+  unsigned char *table;
+
+  topologicalPointList *valueList;
+  int direction;
+  int index;
+  int incIndexList;
+  int cycle;
+  int subfield;
+} _typeThinningPass;
+
+
+
+/* returns 1 if the point has been marked, 0 else
+ */
+static int _markPoint( _typeThinningPass *t, topologicalPoint *ptrPoint )
+{
+  typeThinningParameters *par = t->par;
+  int neighb[27];
+  int tback, tfore;
+
+  /* get the neighborhood
+   */
+  extractNeighborhood( neighb, ptrPoint,
+                       t->theBuf, t->theDim,
+                       t->offsetForSimplicity );
+
+  /* check the thickness for the direction
+   */
+  if ( (*t->checkThickness)( neighb, par->typeThickness, par->typeChanging, t->direction ) == 0 )
+    return( 0 );
+
+  /* test the simplicity
+     if simple and not endpoint, it is marked for deletion
+   */
+  if ( (*t->isPointSimple)( neighb, &tback, &tfore, par->typeChanging, t->table ) == 1 ) {
+    /* if there is an end condition for simple points,
+       it is to be tested here
+    */
+    if ( (*t->endConditionSimplePoint)( neighb ) == 0 ) {
+      ptrPoint->type = t->theBuf[ ptrPoint->i ] = _TOBECHANGED_;
+      return( 1 );
+    }
+    return( 0 );
+  }
+
+  /* shrinking: no further test
+   */
+  if ( par->typeEndPoint == _NO_END_POINT_ )
+    return( 0 );
+
+  /* end point condition for non-simple points
+     - check whether it is deep enough
+       1. the distance/index is large enough
+       2. the number of cycles is large enough
+          recall that a cycle is the spanning of all directions
+          for a given 'index', thus a plateau of constant 'index'
+          has been eroded by this number of cycle before
+          end points may appears
+      - if yes, it can be considered as a end point candidate
+     else it will be deleted
+   */
+  if ( par->valueBeforeEnding > 0
+       && ( (t->incIndexList > 0 && t->index < par->valueBeforeEnding)
+            || (t->incIndexList < 0 && t->index > par->valueBeforeEnding) ) )
+    return( 0 );
+  if ( par->cyclesBeforeEnding > 0 && t->cycle < par->cyclesBeforeEnding )
+    return( 0 );
+
+  /* topological numbers have not been computed
+     by the simple point test
+   */
+  if ( tback < 0 )
+    (*t->computeTopologicalNumbers)( neighb, &tback, &tfore );
+
+  /* check whether the non-simple point satisfies an end point condition
+   */
+  if ( (*t->endConditionNonSimplePoint)( neighb, tback, tfore, par->typeEndPoint ) == 1 ) {
+    ptrPoint->type = t->theBuf[ ptrPoint->i ] = _ENDPOINT_;
+    return( 1 );
+  }
+
+  return( 0 );
+}
+
+
+
+/* points are split into subfields with respect to the parity
+ * of their coordinates: two points of the same subfield are not
+ * neighbors, so the points of a subfield can be examined
+ * independently (and then in parallel)
+ */
+
+static int _subfield( topologicalPoint *pt )
+{
+  return( (pt->x & 1) | ((pt->y & 1) << 1) | ((pt->z & 1) << 2) );
+}
+
+
+
+typedef struct _typeThinningSubfieldChunk {
+  _typeThinningPass *pass;
+  int nbMarkedPts;
+} _typeThinningSubfieldChunk;
+
+
+
+static void *_markSubfieldPointsSubroutine( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  _typeThinningSubfieldChunk *c = (_typeThinningSubfieldChunk*)parameter;
+  _typeThinningPass *t = c->pass;
+  topologicalPoint *ptrPoint;
+  size_t p;
+
+  c->nbMarkedPts = 0;
+  for ( p=first; p<=last; p++ ) {
+    ptrPoint = &(t->valueList->data[p]);
+    if ( _subfield( ptrPoint ) != t->subfield ) continue;
+    c->nbMarkedPts += _markPoint( t, ptrPoint );
+  }
+
+  chunk->ret = 1;
+  return( (void*)NULL );
+}
+
+
+
+/* returns the number of marked points of the subfield,
+ * or -1 in case of error
+ */
+static int _markSubfieldPoints( _typeThinningPass *t )
+{
+  char *proc = "_markSubfieldPoints";
+  typeChunks chunks;
+  _typeThinningSubfieldChunk *aux;
+  int n, nbMarkedPts = 0;
+
+  if ( t->valueList->n_data <= 0 ) return( 0 );
+
+  initChunks( &chunks );
+  if ( buildChunks( &chunks, 0, t->valueList->n_data-1, proc ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to compute chunks\n", proc );
+    return( -1 );
+  }
+
+  aux = (_typeThinningSubfieldChunk*)vtmalloc( chunks.n_allocated_chunks * sizeof(_typeThinningSubfieldChunk),
+                                               "aux", proc );
+  if ( aux == (_typeThinningSubfieldChunk*)NULL ) {
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate auxiliary array\n", proc );
+    return( -1 );
+  }
+  for ( n=0; n<chunks.n_allocated_chunks; n++ ) {
+    aux[n].pass = t;
+    aux[n].nbMarkedPts = 0;
+    chunks.data[n].parameters = (void*)(&aux[n]);
+  }
+
+  if ( processChunks( &_markSubfieldPointsSubroutine, &chunks, proc ) != 1 ) {
+    vtfree( aux );
+    freeChunks( &chunks );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to process subfield\n", proc );
+    return( -1 );
+  }
+
+  for ( n=0; n<chunks.n_allocated_chunks; n++ )
+    nbMarkedPts += aux[n].nbMarkedPts;
+
+  vtfree( aux );
+  freeChunks( &chunks );
+  return( nbMarkedPts );
+}
+
+
+
+/* update points and image after one pass:
+ * marked points are changed and removed from the list
+ */
+static void _changeMarkedPoints( topologicalPointList *valueList,
+                                 unsigned char *theBuf,
+                                 typeThinningParameters *par,
+                                 int *nbDelPts, int *nbEndPts )
+{
+  char *proc = "_changeMarkedPoints";
+  topologicalPoint *ptrPoint, tmpPoint;
+  int p;
+
+  for ( p = 0; p < valueList->n_data; p ++ ) {
+    ptrPoint = &(valueList->data[p]);
+    switch( ptrPoint->type ) {
+    default :
+    case _BACKGROUND_ :
+    case _ANCHOR_ :
+      fprintf( stderr, "%s: WARNING this case should not occur\n", proc );
+      break;
+    case _CANBECHANGED_ :
+      break;
+    case _TOBECHANGED_ :
+      switch( par->typeChanging ) {
+      default :
+      case _FOREGROUND_TO_BACKGROUND_ :
+          ptrPoint->type = theBuf[ ptrPoint->i ] = _BACKGROUND_VALUE_;
+          break;
+      case _BACKGROUND_TO_FOREGROUND_ :
+          ptrPoint->type = theBuf[ ptrPoint->i ] = _FOREGROUND_VALUE_;
+          break;
+      }
+      (*nbDelPts) ++;
+    case _ENDPOINT_ :
+      if ( ptrPoint->type == _ENDPOINT_ ) {
+          switch( par->typeChanging ) {
+          default :
+              break;
+          case _FOREGROUND_TO_BACKGROUND_ :
+              ptrPoint->type = theBuf[ ptrPoint->i ] = _FOREGROUND_VALUE_;
+              break;
+          }
+          (*nbEndPts) ++;
+      }
+      tmpPoint = valueList->data[ valueList->n_data-1 ];
+      valueList->data[ valueList->n_data-1 ] = *ptrPoint;
+      *ptrPoint = tmpPoint;
+      valueList->n_data --;
+      p --;
+      break;
+    }
+  }
+}
+
+
+
+
+
+
+
+
+
 /* theBuf is assumed to be pre-processed/threholded
  * it contains 3 values :
  * - _BACKGROUND_VALUE_      0
@@ -1222,12 +1667,12 @@ int valueBasedThinning( unsigned char *theBuf,
   int nbPoints;
 
   typeNeighborhood offsetForSimplicity;
-  typeCheckThickness _checkThickness = (typeCheckThickness)NULL;
-  typeIsPointSimple _isPointSimple = (typeIsPointSimple)NULL;
-  typeEndConditionSimplePoint _endConditionSimplePoint = &_defaultEndConditionCurveSimplePoint;
-  typeEndConditionNonSimplePoint _endConditionNonSimplePoint = (typeEndConditionNonSimplePoint)NULL;
+  _typeThinningPass pass;
+  unsigned char *table = (unsigned char*)NULL;
 
   int ndirection = 0;
+  int nsubfield = 1;
+  int subfield;
 
   int successfuliteration, iteration;
 
@@ -1239,15 +1684,9 @@ int valueBasedThinning( unsigned char *theBuf,
   int nbDelPtsDirection, nbEndPtsDirection;
 
   int nbMarkedPts, nbPtsValue;
+  int nbDelPts, nbEndPts;
   int p, i;
   topologicalPointList *valueList;
-  /*
-  topologicalPoint *arrayPoint;
-  */
-  topologicalPoint *ptrPoint, tmpPoint;
-
-  int neighb[27];
-  int tback, tfore;
 
   int v = theDim[0]*theDim[1]*theDim[2];
 
@@ -1374,35 +1813,56 @@ int valueBasedThinning( unsigned char *theBuf,
 
 
 
+  pass.theBuf = theBuf;
+  pass.theDim = theDim;
+  pass.offsetForSimplicity = &offsetForSimplicity;
+  pass.par = par;
+  pass.endConditionSimplePoint = &_defaultEndConditionCurveSimplePoint;
+
   if ( theDim[2] == 1 ) {
     defineNeighborsForSimplicity( &offsetForSimplicity, theDim, 8 );
-    _checkThickness = &_check2DThickness;
-    _isPointSimple = &_is2DPointSimple;
-    _endConditionNonSimplePoint = &_endCondition2DNonSimplePoint;
+    pass.checkThickness = &_check2DThickness;
+    pass.isPointSimple = &_is2DPointSimple;
+    pass.computeTopologicalNumbers = &Compute_T04_and_T08;
+    pass.endConditionNonSimplePoint = &_endCondition2DNonSimplePoint;
     ndirection = 4;
+    if ( par->typeScheme == _SUBFIELD_THINNING_ ) nsubfield = 4;
     switch ( par->typeEndPoint ) {
     default :
       break;
     case _SURFACE_ :
     case _CURVE_ :
-      _endConditionSimplePoint = &_endConditionCurve2DSimplePoint;
+      pass.endConditionSimplePoint = &_endConditionCurve2DSimplePoint;
       break;
     }
+    if ( _use_fast_simple_point_test_ ) {
+      table = (unsigned char*)vtmalloc( _2D_SIMPLE_POINT_TABLE_SIZE_ * sizeof(unsigned char),
+                                        "table", proc );
+      if ( table != (unsigned char*)NULL ) {
+        _fill2DSimplePointTable( table );
+        pass.isPointSimple = &_is2DPointSimpleFast;
+      }
+    }
   }
   else {
     defineNeighborsForSimplicity( &offsetForSimplicity, theDim, 26 );
-    _checkThickness = &_check3DThickness;
-    _isPointSimple = &_is3DPointSimple;
-    _endConditionNonSimplePoint = &_endCondition3DNonSimplePoint;
+    pass.checkThickness = &_check3DThickness;
+    pass.isPointSimple = &_is3DPointSimple;
+    pass.computeTopologicalNumbers = &Compute_T06_and_T26;
+    pass.endConditionNonSimplePoint = &_endCondition3DNonSimplePoint;
     ndirection = 6;
+    if ( par->typeScheme == _SUBFIELD_THINNING_ ) nsubfield = 8;
     switch ( par->typeEndPoint ) {
     default :
       break;
     case _CURVE_ :
-      _endConditionSimplePoint = &_endConditionCurve3DSimplePoint;
+      pass.endConditionSimplePoint = &_endConditionCurve3DSimplePoint;
       break;
     }
+    if ( _use_fast_simple_point_test_ )
+      pass.isPointSimple = &_is3DPointSimpleFast;
   }
+  pass.table = table;
 
   
   
@@ -1497,123 +1957,58 @@ int valueBasedThinning( unsigned char *theBuf,
 
       for ( direction = 0; direction < ndirection; direction ++ ) {
 
-        /* loop on points for one direction
-         */
         nbDelPtsDirection = nbEndPtsDirection = 0;
-        nbMarkedPts = 0;
         nbPtsValue = valueList->n_data;
 
-        for ( p = 0; p < valueList->n_data; p ++ ) {
-
-           ptrPoint = &(valueList->data[p]);
+        pass.valueList = valueList;
+        pass.direction = direction;
+        pass.index = index;
+        pass.incIndexList = incIndexList;
+        pass.cycle = cycle;
 
-          /* get the neighborhood
-           */
-          extractNeighborhood( neighb, ptrPoint,
-                               theBuf, theDim,
-                               &offsetForSimplicity );
-
-          /* check the thickness for the direction
-           */
-          if ( (*_checkThickness)( neighb, par->typeThickness, par->typeChanging, direction ) == 0 )
-            continue;
+        /* loop on subfields (there is only one subfield
+           for sequential thinning)
+         */
+        for ( subfield = 0; subfield < nsubfield; subfield ++ ) {
 
-          /* test the simplicity
-             if simple and not endpoint, it is marked for deletion
+          /* loop on points for one direction (and one subfield)
            */
-          if ( (*_isPointSimple)( neighb, &tback, &tfore, par->typeChanging ) == 1 ) {
-            /* if there is an end condition for simple points,
-               it is to be tested here
-            */
-            if ( (*_endConditionSimplePoint)( neighb ) == 0 ) {
-              ptrPoint->type = theBuf[ ptrPoint->i ] = _TOBECHANGED_;
-              nbMarkedPts ++;
+          if ( par->typeScheme == _SUBFIELD_THINNING_ ) {
+            pass.subfield = subfield;
+            nbMarkedPts = _markSubfieldPoints( &pass );
+            if ( nbMarkedPts < 0 ) {
+              if ( table != (unsigned char*)NULL ) vtfree( table );
+              freeTopologicalPointListList( &pointListList );
+              if ( _verbose_ )
+                fprintf( stderr, "%s: error when processing subfield\n", proc );
+              return( -1 );
             }
-            continue;
           }
-
-           /* shrinking: no further test
-           */
-          if ( par->typeEndPoint == _NO_END_POINT_ )
-            continue;
-
-          /* end point condition for non-simple points
-             - check whether it is deep enough
-               1. the distance/index is large enough
-               2. the number of cycles is large enough
-                  recall that a cycle is the spanning of all directions
-                  for a given 'index', thus a plateau of constant 'index'
-                  has been eroded by this number of cycle before
-                  end points may appears
-              - if yes, it can be considered as a end point candidate
-             else it will be deleted
+          else {
+            nbMarkedPts = 0;
+            for ( p = 0; p < valueList->n_data; p ++ )
+              nbMarkedPts += _markPoint( &pass, &(valueList->data[p]) );
+          }
+          /* end of loop on points for one direction
            */
-          if ( par->valueBeforeEnding > 0
-               && ( (incIndexList > 0 && index < par->valueBeforeEnding)
-                    || (incIndexList < 0 && index > par->valueBeforeEnding) ) )
-            continue;
-          if ( par->cyclesBeforeEnding > 0 && cycle < par->cyclesBeforeEnding )
-            continue;
-
-          /* check whether the non-simple point satisfies an end point condition
+
+          /* update points and image for one direction
            */
-          if ( (*_endConditionNonSimplePoint)( neighb, tback, tfore, par->typeEndPoint ) == 1 ) {
-            ptrPoint->type = theBuf[ ptrPoint->i ] = _ENDPOINT_;
-            nbMarkedPts ++;
+          if ( nbMarkedPts > 0 ) {
+            nbDelPts = nbEndPts = 0;
+            _changeMarkedPoints( valueList, theBuf, par, &nbDelPts, &nbEndPts );
+            nbDelPtsDirection += nbDelPts;
+            nbEndPtsDirection += nbEndPts;
           }
+          /* end of update points and image for one direction
+           */
         }
-        /* end of loop on points for one direction
+        /* end of loop on subfields
          */
 
-        /* update points and image for one direction
-         */
-        if ( nbMarkedPts > 0 ) {
-          for ( p = 0; p < valueList->n_data; p ++ ) {
-            ptrPoint = &(valueList->data[p]);
-            switch( ptrPoint->type ) {
-            default :
-            case _BACKGROUND_ :
-            case _ANCHOR_ :
-              fprintf( stderr, "%s: WARNING this case should not occur\n", proc );
-              break;
-            case _CANBECHANGED_ :
-              break;
-            case _TOBECHANGED_ :
-              switch( par->typeChanging ) {
-              default :
-              case _FOREGROUND_TO_BACKGROUND_ :
-                  ptrPoint->type = theBuf[ ptrPoint->i ] = _BACKGROUND_VALUE_;
-                  break;
-              case _BACKGROUND_TO_FOREGROUND_ :
-                  ptrPoint->type = theBuf[ ptrPoint->i ] = _FOREGROUND_VALUE_;
-                  break;
-              }
-              nbDelPtsDirection ++;
-            case _ENDPOINT_ :
-              if ( ptrPoint->type == _ENDPOINT_ ) {
-                  switch( par->typeChanging ) {
-                  default :
-                      break;
-                  case _FOREGROUND_TO_BACKGROUND_ :
-                      ptrPoint->type = theBuf[ ptrPoint->i ] = _FOREGROUND_VALUE_;
-                      break;
-                  }
-                  nbEndPtsDirection ++;
-              }
-              tmpPoint = valueList->data[ valueList->n_data-1 ];
-              valueList->data[ valueList->n_data-1 ] = *ptrPoint;
-              *ptrPoint = tmpPoint;
-              valueList->n_data --;
-              p --;
-              break;
-            }
-          }
-          nbDelPtsCycle += nbDelPtsDirection;
-          nbEndPtsCycle += nbEndPtsDirection;
-          totDelPts += nbDelPtsDirection;
-        }
-        /* end of update points and image for one direction
-         */
+        nbDelPtsCycle += nbDelPtsDirection;
+        nbEndPtsCycle += nbEndPtsDirection;
+        totDelPts += nbDelPtsDirection;
 
         if ( _verbose_ >= 2 ) {
           fprintf( stderr, " #%8d", iteration );
@@ -1687,6 +2082,7 @@ int valueBasedThinning( unsigned char *theBuf,
 
   /* release memory
   */
+  if ( table != (unsigned char*)NULL ) vtfree( table );
   freeTopologicalPointListList( &pointListList );
 
 
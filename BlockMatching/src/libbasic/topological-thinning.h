@@ -36,6 +36,12 @@ extern void incrementDebugInTopologicalThinning( );
 extern void decrementDebugInTopologicalThinning( );
 extern void setTimeInTopologicalThinning( int v );
 
+/* simple points are tested with a look-up table in 2D,
+ * and with a decision tree in 3D (default), the topological
+ * numbers being computed only when required
+ */
+extern void setFastSimplePointTestInTopologicalThinning( int t );
+
 
 
 
@@ -74,6 +80,22 @@ typedef enum enumTypeChange {
 
 
 
+/* _SEQUENTIAL_THINNING_: points are examined sequentially
+ *   (for each direction), the result depends on the point order
+ * _SUBFIELD_THINNING_: points are split into 4 (2D) or 8 (3D)
+ *   subfields with respect to the parity of their coordinates.
+ *   Points of the same subfield are not neighbors, and are
+ *   examined in parallel (see chunks.h), subfields being
+ *   processed one after the other. The result does not
+ *   depend on the number of chunks.
+ */
+typedef enum enumTypeThinningScheme {
+  _SEQUENTIAL_THINNING_,
+  _SUBFIELD_THINNING_
+} enumTypeThinningScheme;
+
+
+
 typedef struct typeThinningParameters {
   /* list construction: bin size
    */
@@ -113,6 +135,10 @@ typedef struct typeThinningParameters {
    */
   int maxIteration;
 
+  /* processing scheme
+   */
+  enumTypeThinningScheme typeScheme;
+
 } typeThinningParameters;
 
 
@@ -15,9 +15,16 @@
 
 
 
+/* posix_memalign(), madvise()
+ */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 
 
 #include <vtmalloc.h>
@@ -268,6 +275,8 @@ static void _fprintfAllocationSize( FILE *f, char *str, size_t size )
 
 
 
+static void _fprintfPoolStatistics( FILE *f );
+
 static void _fprintfAllocationList( FILE *f, _allocationList *l )
 {
   int i;
@@ -289,6 +298,7 @@ static void _fprintfAllocationList( FILE *f, _allocationList *l )
   fprintf( f, "\n" );
 
   fprintf( f, "- pointers freed but not traced = %d\n", l->n_other_free );
+  _fprintfPoolStatistics( f );
   fprintf( f, "warning, some allocations may have not been traced\n" );
 }
 
@@ -296,6 +306,854 @@ static void _fprintfAllocationList( FILE *f, _allocationList *l )
 
 
 
+/*--------------------------------------------------
+ *
+ * address tables
+ *
+ * hash tables (open addressing, linear probing) of buffers,
+ * used to recognize the buffers given to vtfree()
+ *
+ --------------------------------------------------*/
+
+
+
+typedef struct _addressEntry {
+  void *ptr;
+  size_t size;
+  int value;
+} _addressEntry;
+
+typedef struct _addressTable {
+  _addressEntry *data;
+  size_t n_data;
+  size_t n_allocated_data;
+} _addressTable;
+
+
+
+static size_t _hashAddress( void *ptr, size_t n )
+{
+  size_t h = (size_t)ptr;
+  h ^= h >> 21;
+  h *= 2654435761UL;
+  return( (h >> 7) & (n-1) );
+}
+
+
+
+static _addressEntry *_findAddress( _addressTable *t, void *ptr )
+{
+  size_t i;
+
+  if ( t->n_data == 0 ) return( (_addressEntry*)NULL );
+  for ( i=_hashAddress( ptr, t->n_allocated_data );
+        t->data[i].ptr != (void*)NULL;
+        i=(i+1) & (t->n_allocated_data-1) ) {
+    if ( t->data[i].ptr == ptr ) return( &(t->data[i]) );
+  }
+  return( (_addressEntry*)NULL );
+}
+
+
+
+static int _addAddress( _addressTable *t, void *ptr, size_t size, int value )
+{
+  _addressEntry *old = t->data;
+  size_t n = t->n_allocated_data;
+  size_t i, j;
+
+  /* the table is kept less than half full
+   */
+  if ( 2 * (t->n_data+1) > t->n_allocated_data ) {
+    t->n_allocated_data = ( n == 0 ) ? 256 : 2*n;
+    t->data = (_addressEntry*)calloc( t->n_allocated_data, sizeof(_addressEntry) );
+    if ( t->data == (_addressEntry*)NULL ) {
+      t->data = old;
+      t->n_allocated_data = n;
+      return( -1 );
+    }
+    for ( i=0; i<n; i++ ) {
+      if ( old[i].ptr == (void*)NULL ) continue;
+      for ( j=_hashAddress( old[i].ptr, t->n_allocated_data );
+            t->data[j].ptr != (void*)NULL;
+            j=(j+1) & (t->n_allocated_data-1) )
+        ;
+      t->data[j] = old[i];
+    }
+    if ( old != (_addressEntry*)NULL ) free( old );
+  }
+
+  for ( j=_hashAddress( ptr, t->n_allocated_data );
+        t->data[j].ptr != (void*)NULL;
+        j=(j+1) & (t->n_allocated_data-1) )
+    ;
+  t->data[j].ptr = ptr;
+  t->data[j].size = size;
+  t->data[j].value = value;
+  t->n_data ++;
+  return( 1 );
+}
+
+
+
+/* linear probing: the following entries are moved back
+ */
+static void _removeAddress( _addressTable *t, _addressEntry *e )
+{
+  size_t n = t->n_allocated_data;
+  size_t i = (size_t)(e - t->data);
+  size_t j, k;
+
+  t->n_data --;
+  t->data[i].ptr = (void*)NULL;
+
+  for ( j=(i+1) & (n-1); t->data[j].ptr != (void*)NULL; j=(j+1) & (n-1) ) {
+    k = _hashAddress( t->data[j].ptr, n );
+    if ( (i <= j) ? (i < k && k <= j) : (i < k || k <= j) ) continue;
+    t->data[i] = t->data[j];
+    t->data[j].ptr = (void*)NULL;
+    i = j;
+  }
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * buffer pool
+ *
+ * large buffers (at least _pool_threshold_ bytes) are rounded up
+ * to a size class (4 classes per power of 2) and, when freed,
+ * are kept in a free list of their class to be reused by a next
+ * allocation of the same class, instead of being given back to
+ * the system (and page-faulted again).
+ *
+ * The pool is active either globally (setPoolInVtMalloc()) or
+ * between beginVtMallocArena() and endVtMallocArena(): the kept
+ * buffers are released at the end of the outermost arena.
+ *
+ * Pooled buffers are registered (hash table on the address) so
+ * that vtfree() can recognize them, vtfree() may still be called
+ * on pointers allocated with malloc().
+ *
+ --------------------------------------------------*/
+
+
+
+#define _HUGE_PAGE_SIZE_ 2097152
+
+static int _pool_ = 0;
+static int _arena_depth_ = 0;
+static size_t _pool_threshold_ = 1048576;
+static size_t _pool_size_ = 1073741824;
+
+static pthread_mutex_t _pool_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+typedef struct _freeBlock {
+  struct _freeBlock *next;
+} _freeBlock;
+
+#define _POOL_CLASSES_ 256
+
+typedef struct _bufferPool {
+  /* registered blocks ('value' is 1 for blocks in use)
+   */
+  _addressTable blocks;
+  /* free lists, indexed by size class
+   */
+  _freeBlock *free[_POOL_CLASSES_];
+  size_t free_size;
+  /* statistics
+   */
+  size_t requests;
+  size_t reused;
+  size_t fresh;
+  size_t released;
+  size_t max_free_size;
+  size_t max_pooled_size;
+  size_t pooled_size;
+} _bufferPool;
+
+static _bufferPool bufferPool;
+
+
+
+void setPoolInVtMalloc( int p )
+{
+  _pool_ = p;
+  if ( _pool_ == 0 && _arena_depth_ == 0 )
+    releaseVtMallocPool();
+}
+
+void setPoolThresholdInVtMalloc( size_t s )
+{
+  if ( s > 0 ) _pool_threshold_ = s;
+}
+
+void setPoolSizeInVtMalloc( size_t s )
+{
+  _pool_size_ = s;
+}
+
+
+
+/* class c is (4 + c%4) * 2^(c/4) bytes
+ */
+static int _sizeClass( size_t size, size_t *class_size )
+{
+  int c = 0;
+  size_t s = 4;
+
+  while ( s * 2 <= size ) {
+    s *= 2;
+    c += 4;
+  }
+  /* s <= size < 2s, classes are s, 5s/4, 3s/2, 7s/4 and 2s
+   */
+  if ( size == s ) { *class_size = s; return( c ); }
+  if ( size <= s + s/4 ) { *class_size = s + s/4; return( c+1 ); }
+  if ( size <= s + s/2 ) { *class_size = s + s/2; return( c+2 ); }
+  if ( size <= s + 3*(s/4) ) { *class_size = s + 3*(s/4); return( c+3 ); }
+  *class_size = 2*s;
+  return( c+4 );
+}
+
+
+
+static void *_allocPoolBuffer( size_t size )
+{
+  void *ptr = (void*)NULL;
+
+  if ( size < _HUGE_PAGE_SIZE_ )
+    return( malloc( size ) );
+
+  /* transparent huge pages need aligned buffers
+   */
+  if ( posix_memalign( &ptr, _HUGE_PAGE_SIZE_, size ) != 0 )
+    return( (void*)NULL );
+#ifdef MADV_HUGEPAGE
+  (void)madvise( ptr, size, MADV_HUGEPAGE );
+#endif
+  return( ptr );
+}
+
+
+
+/* returns NULL if the pool is not used
+ */
+static void *_poolMalloc( size_t size )
+{
+  size_t class_size;
+  int c;
+  _freeBlock *f;
+  _addressEntry *b;
+  void *ptr = (void*)NULL;
+
+  if ( _pool_ == 0 && _arena_depth_ == 0 ) return( (void*)NULL );
+  if ( size < _pool_threshold_ ) return( (void*)NULL );
+  c = _sizeClass( size, &class_size );
+  if ( c >= _POOL_CLASSES_ ) return( (void*)NULL );
+
+  pthread_mutex_lock( &_pool_mutex_ );
+  bufferPool.requests ++;
+  f = bufferPool.free[c];
+  if ( f != (_freeBlock*)NULL ) {
+    bufferPool.free[c] = f->next;
+    bufferPool.free_size -= class_size;
+    b = _findAddress( &(bufferPool.blocks), (void*)f );
+    if ( b != (_addressEntry*)NULL ) b->value = 1;
+    bufferPool.reused ++;
+    ptr = (void*)f;
+  }
+  else {
+    ptr = _allocPoolBuffer( class_size );
+    if ( ptr != (void*)NULL ) {
+      if ( _addAddress( &(bufferPool.blocks), ptr, class_size, 1 ) == 1 ) {
+        bufferPool.fresh ++;
+        bufferPool.pooled_size += class_size;
+        if ( bufferPool.max_pooled_size < bufferPool.pooled_size )
+          bufferPool.max_pooled_size = bufferPool.pooled_size;
+      }
+      else {
+        free( ptr );
+        ptr = (void*)NULL;
+      }
+    }
+  }
+  pthread_mutex_unlock( &_pool_mutex_ );
+
+  return( ptr );
+}
+
+
+
+/* returns 1 if ptr was a pooled buffer
+ */
+static int _poolFree( void *ptr )
+{
+  _addressEntry *b;
+  _freeBlock *f;
+  size_t class_size;
+  int c;
+
+  pthread_mutex_lock( &_pool_mutex_ );
+  if ( bufferPool.blocks.n_data == 0 ) {
+    pthread_mutex_unlock( &_pool_mutex_ );
+    return( 0 );
+  }
+  b = _findAddress( &(bufferPool.blocks), ptr );
+  if ( b == (_addressEntry*)NULL || b->value == 0 ) {
+    pthread_mutex_unlock( &_pool_mutex_ );
+    return( 0 );
+  }
+
+  c = _sizeClass( b->size, &class_size );
+  if ( (_pool_ || _arena_depth_ > 0)
+       && bufferPool.free_size + b->size <= _pool_size_ ) {
+    b->value = 0;
+    f = (_freeBlock*)ptr;
+    f->next = bufferPool.free[c];
+    bufferPool.free[c] = f;
+    bufferPool.free_size += b->size;
+    if ( bufferPool.max_free_size < bufferPool.free_size )
+      bufferPool.max_free_size = bufferPool.free_size;
+  }
+  else {
+    bufferPool.pooled_size -= b->size;
+    _removeAddress( &(bufferPool.blocks), b );
+    free( ptr );
+    bufferPool.released ++;
+  }
+  pthread_mutex_unlock( &_pool_mutex_ );
+
+  return( 1 );
+}
+
+
+
+void releaseVtMallocPool( )
+{
+  _freeBlock *f;
+  _addressEntry *b;
+  int c;
+
+  pthread_mutex_lock( &_pool_mutex_ );
+  for ( c=0; c<_POOL_CLASSES_; c++ ) {
+    while ( bufferPool.free[c] != (_freeBlock*)NULL ) {
+      f = bufferPool.free[c];
+      bufferPool.free[c] = f->next;
+      b = _findAddress( &(bufferPool.blocks), (void*)f );
+      if ( b != (_addressEntry*)NULL ) {
+        bufferPool.pooled_size -= b->size;
+        _removeAddress( &(bufferPool.blocks), b );
+      }
+      free( (void*)f );
+      bufferPool.released ++;
+    }
+  }
+  bufferPool.free_size = 0;
+  pthread_mutex_unlock( &_pool_mutex_ );
+}
+
+
+
+void beginVtMallocArena( )
+{
+  pthread_mutex_lock( &_pool_mutex_ );
+  _arena_depth_ ++;
+  pthread_mutex_unlock( &_pool_mutex_ );
+}
+
+
+
+void endVtMallocArena( )
+{
+  int release = 0;
+
+  pthread_mutex_lock( &_pool_mutex_ );
+  if ( _arena_depth_ > 0 ) _arena_depth_ --;
+  if ( _arena_depth_ == 0 && _pool_ == 0 ) release = 1;
+  pthread_mutex_unlock( &_pool_mutex_ );
+
+  if ( release ) releaseVtMallocPool();
+}
+
+
+
+static void _fprintfPoolStatistics( FILE *f )
+{
+  if ( bufferPool.requests == 0 ) return;
+  fprintf( f, "- buffer pool: %lu requests, %lu reused, %lu allocated, %lu released\n",
+           bufferPool.requests, bufferPool.reused, bufferPool.fresh, bufferPool.released );
+  fprintf( f, "- buffer pool: maximum kept (free) size = " );
+  _fprintfAllocationSize( f, "- buffer pool: maximum kept (free) size = ", bufferPool.max_free_size );
+  fprintf( f, "\n" );
+  fprintf( f, "- buffer pool: maximum pooled size = " );
+  _fprintfAllocationSize( f, "- buffer pool: maximum pooled size = ", bufferPool.max_pooled_size );
+  fprintf( f, "\n" );
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * memory profile
+ *
+ * when enabled, the buffers allocated by vtmalloc() are registered
+ * with their size and the current stage, so that the live size and
+ * its maximum can be attributed to each stage.
+ *
+ * A stage is the path of the tags set with setVtMallocTag(), eg
+ * "blockmatching / level 2 / pairing". The tag at depth d replaces
+ * the one at depth d, and removes the deeper ones.
+ *
+ * Tags are kept per thread. Threads that never set a tag (eg the
+ * OpenMP or chunk threads) are accounted to the current stage of
+ * the first thread that set one (usually the main thread).
+ *
+ * The full profile (mode 1) registers every buffer in an address
+ * table under a mutex, this serializes the allocations of
+ * concurrent threads. The counter profile (mode 2) only counts the
+ * allocations and the allocated bytes per stage with atomic
+ * additions (and the calls to vtfree()): it is cheap enough to be
+ * left on, but gives neither the live sizes nor the peaks.
+ *
+ * The profile is enabled either by setProfileInVtMalloc() or by
+ * setting the VTMALLOC_PROFILE environment variable to the name
+ * of a file where a JSON report is written at exit. Setting
+ * VTMALLOC_PROFILE_MODE to 'counters' selects the counter profile.
+ *
+ --------------------------------------------------*/
+
+
+
+#define _PROFILE_DEPTH_ 8
+#define _PROFILE_TAG_LENGTH_ 41
+#define _PROFILE_STAGE_LENGTH_ (_PROFILE_DEPTH_*(_PROFILE_TAG_LENGTH_+3))
+#define _PROFILE_STAGES_ 1024
+
+/* -1: the environment has not been checked yet
+ * 0: no profile, 1: full profile, 2: counter profile
+ */
+static int _profile_ = -1;
+static char _profile_name_[1024];
+
+static pthread_mutex_t _profile_mutex_ = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+typedef struct _stageProfile {
+  char name[_PROFILE_STAGE_LENGTH_];
+  size_t visits;
+  size_t allocations;
+  size_t allocated_size;
+  /* live size of the buffers allocated in this stage
+   */
+  size_t live_size;
+  size_t max_live_size;
+  /* maximal total live size while in this stage
+   */
+  size_t max_total_size;
+  /* maximal resident set size (kilobytes) when leaving this stage
+   */
+  long int maxrss;
+} _stageProfile;
+
+typedef struct _memoryProfile {
+  /* registered buffers ('value' is the stage index)
+   */
+  _addressTable buffers;
+  /* stage of the threads that did not set any tag
+   */
+  int main_stage;
+  int has_main_thread;
+  pthread_t main_thread;
+  _stageProfile stages[_PROFILE_STAGES_];
+  int n_stages;
+  size_t allocations;
+  size_t frees;
+  size_t live_size;
+  size_t max_live_size;
+  int max_stage;
+} _memoryProfile;
+
+static _memoryProfile *memoryProfile = (_memoryProfile*)NULL;
+
+/* tags of a thread
+ */
+typedef struct _threadTags {
+  char tags[_PROFILE_DEPTH_][_PROFILE_TAG_LENGTH_];
+  int depth;
+  int stage;
+} _threadTags;
+
+static pthread_key_t _profile_key_;
+
+
+
+static long int _maxrss( )
+{
+  struct rusage r;
+  if ( getrusage( RUSAGE_SELF, &r ) != 0 ) return( 0 );
+  return( r.ru_maxrss );
+}
+
+
+
+static void _addToCounter( size_t *c, size_t v )
+{
+#if defined(__GNUC__)
+  (void)__sync_fetch_and_add( c, v );
+#else
+  pthread_mutex_lock( &_profile_mutex_ );
+  *c += v;
+  pthread_mutex_unlock( &_profile_mutex_ );
+#endif
+}
+
+
+
+static int _getMainStage( _memoryProfile *p )
+{
+#if defined(__GNUC__)
+  return( __sync_fetch_and_add( &(p->main_stage), 0 ) );
+#else
+  int s;
+  pthread_mutex_lock( &_profile_mutex_ );
+  s = p->main_stage;
+  pthread_mutex_unlock( &_profile_mutex_ );
+  return( s );
+#endif
+}
+
+
+
+static int _currentStage( _memoryProfile *p )
+{
+  _threadTags *t = (_threadTags*)pthread_getspecific( _profile_key_ );
+  if ( t != (_threadTags*)NULL ) return( t->stage );
+  return( _getMainStage( p ) );
+}
+
+
+
+static void _writeProfileAtExit( )
+{
+  (void)writeVtMallocProfile( _profile_name_ );
+}
+
+
+
+/* to be called with _profile_mutex_ locked
+ */
+static int _initProfile( )
+{
+  if ( memoryProfile != (_memoryProfile*)NULL ) return( 1 );
+  if ( pthread_key_create( &_profile_key_, free ) != 0 ) return( -1 );
+  memoryProfile = (_memoryProfile*)calloc( 1, sizeof(_memoryProfile) );
+  if ( memoryProfile == (_memoryProfile*)NULL ) {
+    (void)pthread_key_delete( _profile_key_ );
+    return( -1 );
+  }
+  (void)strcpy( memoryProfile->stages[0].name, "(none)" );
+  memoryProfile->stages[0].visits = 1;
+  memoryProfile->n_stages = 1;
+  return( 1 );
+}
+
+
+
+static int _checkProfile( )
+{
+  char *name, *mode;
+
+  if ( _profile_ >= 0 ) return( _profile_ );
+
+  pthread_mutex_lock( &_profile_mutex_ );
+  if ( _profile_ < 0 ) {
+    _profile_ = 0;
+    name = getenv( "VTMALLOC_PROFILE" );
+    if ( name != (char*)NULL && name[0] != '\0'
+         && strlen( name ) < sizeof(_profile_name_)
+         && _initProfile() == 1 ) {
+      (void)strcpy( _profile_name_, name );
+      (void)atexit( _writeProfileAtExit );
+      mode = getenv( "VTMALLOC_PROFILE_MODE" );
+      if ( mode != (char*)NULL && strcmp( mode, "counters" ) == 0 )
+        _profile_ = 2;
+      else
+        _profile_ = 1;
+    }
+  }
+  pthread_mutex_unlock( &_profile_mutex_ );
+
+  return( _profile_ );
+}
+
+
+
+/* switching between the full and the counter profile while
+ * buffers are allocated makes the live sizes meaningless
+ */
+void setProfileInVtMalloc( int p )
+{
+  (void)_checkProfile();
+  pthread_mutex_lock( &_profile_mutex_ );
+  if ( p <= 0 )
+    _profile_ = 0;
+  else if ( _initProfile() == 1 )
+    _profile_ = ( p == 2 ) ? 2 : 1;
+  pthread_mutex_unlock( &_profile_mutex_ );
+}
+
+
+
+void setVtMallocTag( int depth, char *tag )
+{
+  _memoryProfile *p;
+  _threadTags *t;
+  char name[_PROFILE_STAGE_LENGTH_];
+  int d, s;
+
+  if ( _checkProfile() == 0 ) return;
+
+  t = (_threadTags*)pthread_getspecific( _profile_key_ );
+  if ( t == (_threadTags*)NULL ) {
+    t = (_threadTags*)calloc( 1, sizeof(_threadTags) );
+    if ( t == (_threadTags*)NULL ) return;
+    if ( pthread_setspecific( _profile_key_, (void*)t ) != 0 ) {
+      free( t );
+      return;
+    }
+  }
+
+  pthread_mutex_lock( &_profile_mutex_ );
+  p = memoryProfile;
+
+  if ( p->has_main_thread == 0 ) {
+    p->main_thread = pthread_self();
+    p->has_main_thread = 1;
+  }
+
+  p->stages[t->stage].maxrss = _maxrss();
+
+  /* tags can not be set below the current depth
+   */
+  if ( depth < 0 ) depth = 0;
+  if ( depth > t->depth ) depth = t->depth;
+  if ( tag == (char*)NULL || tag[0] == '\0' ) {
+    t->depth = depth;
+  }
+  else if ( depth < _PROFILE_DEPTH_ ) {
+    (void)strncpy( t->tags[depth], tag, _PROFILE_TAG_LENGTH_ );
+    t->tags[depth][_PROFILE_TAG_LENGTH_-1] = '\0';
+    t->depth = depth+1;
+  }
+
+  if ( t->depth == 0 ) {
+    (void)strcpy( name, "(none)" );
+  }
+  else {
+    name[0] = '\0';
+    for ( d=0; d<t->depth; d++ ) {
+      if ( d > 0 ) (void)strcat( name, " / " );
+      (void)strcat( name, t->tags[d] );
+    }
+  }
+
+  for ( s=0; s<p->n_stages; s++ ) {
+    if ( strcmp( p->stages[s].name, name ) == 0 ) break;
+  }
+  if ( s == p->n_stages ) {
+    /* too many stages: the last one collects the others
+     */
+    if ( s == _PROFILE_STAGES_ ) {
+      s = _PROFILE_STAGES_ - 1;
+      (void)strcpy( p->stages[s].name, "(others)" );
+    }
+    else {
+      (void)strcpy( p->stages[s].name, name );
+      p->n_stages ++;
+    }
+  }
+
+  t->stage = s;
+  if ( pthread_equal( p->main_thread, pthread_self() ) ) {
+#if defined(__GNUC__)
+    (void)__sync_lock_test_and_set( &(p->main_stage), s );
+#else
+    p->main_stage = s;
+#endif
+  }
+  p->stages[s].visits ++;
+  if ( p->stages[s].max_total_size < p->live_size )
+    p->stages[s].max_total_size = p->live_size;
+  pthread_mutex_unlock( &_profile_mutex_ );
+}
+
+
+
+static void _profileMalloc( void *ptr, size_t size )
+{
+  _memoryProfile *p = memoryProfile;
+  _stageProfile *s;
+  int stage = _currentStage( p );
+
+  pthread_mutex_lock( &_profile_mutex_ );
+  if ( _addAddress( &(p->buffers), ptr, size, stage ) != 1 ) {
+    pthread_mutex_unlock( &_profile_mutex_ );
+    return;
+  }
+  s = &(p->stages[stage]);
+  s->allocations ++;
+  s->allocated_size += size;
+  s->live_size += size;
+  if ( s->max_live_size < s->live_size )
+    s->max_live_size = s->live_size;
+  p->allocations ++;
+  p->live_size += size;
+  if ( s->max_total_size < p->live_size )
+    s->max_total_size = p->live_size;
+  if ( p->max_live_size < p->live_size ) {
+    p->max_live_size = p->live_size;
+    p->max_stage = stage;
+  }
+  pthread_mutex_unlock( &_profile_mutex_ );
+}
+
+
+
+/* no address table nor lock: the stage table is only appended
+ * (under the mutex) and the counters are atomically updated
+ */
+static void _countMalloc( size_t size )
+{
+  _memoryProfile *p = memoryProfile;
+  _stageProfile *s = &(p->stages[_currentStage( p )]);
+
+  _addToCounter( &(s->allocations), 1 );
+  _addToCounter( &(s->allocated_size), size );
+  _addToCounter( &(p->allocations), 1 );
+}
+
+
+
+/* buffers that have not been registered (allocated before the
+ * profile was enabled, or with malloc()) are ignored
+ */
+static void _profileFree( void *ptr )
+{
+  _memoryProfile *p;
+  _addressEntry *b;
+
+  pthread_mutex_lock( &_profile_mutex_ );
+  p = memoryProfile;
+  b = _findAddress( &(p->buffers), ptr );
+  if ( b != (_addressEntry*)NULL ) {
+    p->stages[b->value].live_size -= b->size;
+    p->live_size -= b->size;
+    p->frees ++;
+    _removeAddress( &(p->buffers), b );
+  }
+  pthread_mutex_unlock( &_profile_mutex_ );
+}
+
+
+
+static void _fprintfJSONString( FILE *f, char *str )
+{
+  char *c;
+
+  fprintf( f, "\"" );
+  for ( c=str; *c != '\0'; c++ ) {
+    if ( *c == '"' || *c == '\\' ) fprintf( f, "\\%c", *c );
+    else if ( (unsigned char)*c < 32 ) fprintf( f, " " );
+    else fprintf( f, "%c", *c );
+  }
+  fprintf( f, "\"" );
+}
+
+
+
+void fprintfVtMallocProfile( FILE *f )
+{
+  _memoryProfile *p;
+  _stageProfile *s;
+  int i;
+
+  if ( memoryProfile == (_memoryProfile*)NULL ) return;
+
+  pthread_mutex_lock( &_profile_mutex_ );
+  p = memoryProfile;
+  p->stages[_currentStage( p )].maxrss = _maxrss();
+
+  fprintf( f, "{\n" );
+  fprintf( f, "  \"mode\": \"%s\",\n", ( _profile_ == 2 ) ? "counters" : "full" );
+  fprintf( f, "  \"allocations\": %lu,\n", p->allocations );
+  fprintf( f, "  \"frees\": %lu,\n", p->frees );
+  if ( _profile_ != 2 ) {
+    fprintf( f, "  \"live_bytes\": %lu,\n", p->live_size );
+    fprintf( f, "  \"peak_bytes\": %lu,\n", p->max_live_size );
+    fprintf( f, "  \"peak_stage\": " );
+    _fprintfJSONString( f, p->stages[p->max_stage].name );
+    fprintf( f, ",\n" );
+  }
+  fprintf( f, "  \"maxrss_kbytes\": %ld,\n", _maxrss() );
+  fprintf( f, "  \"pool\": { \"requests\": %lu, \"reused\": %lu, \"allocated\": %lu, \"released\": %lu, \"max_kept_bytes\": %lu, \"max_pooled_bytes\": %lu },\n",
+           bufferPool.requests, bufferPool.reused, bufferPool.fresh, bufferPool.released,
+           bufferPool.max_free_size, bufferPool.max_pooled_size );
+  fprintf( f, "  \"stages\": [\n" );
+  for ( i=0; i<p->n_stages; i++ ) {
+    s = &(p->stages[i]);
+    fprintf( f, "    { \"stage\": " );
+    _fprintfJSONString( f, s->name );
+    if ( _profile_ == 2 )
+      fprintf( f, ", \"visits\": %lu, \"allocations\": %lu, \"allocated_bytes\": %lu, \"maxrss_kbytes\": %ld }%s\n",
+               s->visits, s->allocations, s->allocated_size, s->maxrss,
+               ( i < p->n_stages-1 ) ? "," : "" );
+    else
+      fprintf( f, ", \"visits\": %lu, \"allocations\": %lu, \"allocated_bytes\": %lu, \"live_bytes\": %lu, \"peak_own_bytes\": %lu, \"peak_bytes\": %lu, \"maxrss_kbytes\": %ld }%s\n",
+               s->visits, s->allocations, s->allocated_size, s->live_size,
+               s->max_live_size, s->max_total_size, s->maxrss,
+               ( i < p->n_stages-1 ) ? "," : "" );
+  }
+  fprintf( f, "  ]\n" );
+  fprintf( f, "}\n" );
+  pthread_mutex_unlock( &_profile_mutex_ );
+}
+
+
+
+int writeVtMallocProfile( char *name )
+{
+  char *proc = "writeVtMallocProfile";
+  FILE *f;
+
+  if ( name == (char*)NULL || name[0] == '\0' || strcmp( name, "-" ) == 0 ) {
+    fprintfVtMallocProfile( stdout );
+    return( 1 );
+  }
+  f = fopen( name, "w" );
+  if ( f == (FILE*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to open '%s' for writing\n", proc, name );
+    return( -1 );
+  }
+  fprintfVtMallocProfile( f );
+  fclose( f );
+  return( 1 );
+}
+
+
+
+
+
 /*--------------------------------------------------
  *
  *
@@ -317,6 +1175,9 @@ void vtfree( void *ptr )
     }
     if ( f == 0 ) allocationList.n_other_free ++;
   }
+  if ( _profile_ == 1 ) _profileFree( ptr );
+  else if ( _profile_ == 2 ) _addToCounter( &(memoryProfile->frees), 1 );
+  if ( _poolFree( ptr ) == 1 ) return;
   free( ptr );
 }
 
@@ -337,7 +1198,9 @@ void *vtmalloc( size_t size, char *var, char *from )
     return( (void*)NULL );
   }
 
-  ptr = malloc( size );
+  ptr = _poolMalloc( size );
+  if ( ptr == (void*)NULL )
+    ptr = malloc( size );
   if ( ptr == (void*)NULL ) {
     if ( _verbose_ ) {
       fprintf( stderr, "%s: allocation failed\n", proc );
@@ -351,6 +1214,12 @@ void *vtmalloc( size_t size, char *var, char *from )
     return( (void*)NULL );
   }
 
+  switch ( _checkProfile() ) {
+  default : break;
+  case 1 : _profileMalloc( ptr, size ); break;
+  case 2 : _countMalloc( size ); break;
+  }
+
   if ( _trace_allocations_ ) {
     _initAllocation( &a );
     a.ptr = ptr;
@@ -32,6 +32,25 @@ extern void setAllocationsInVtMalloc( int a );
 extern void vtfree( void *ptr );
 extern void *vtmalloc( size_t size, char *var, char *from );
 
+/* buffer pool for large buffers (see vtmalloc.c)
+ */
+extern void setPoolInVtMalloc( int p );
+extern void setPoolThresholdInVtMalloc( size_t s );
+extern void setPoolSizeInVtMalloc( size_t s );
+extern void beginVtMallocArena( );
+extern void endVtMallocArena( );
+extern void releaseVtMallocPool( );
+
+/* memory profile per stage (see vtmalloc.c)
+ * p = 0: no profile, 1: full profile (live sizes and peaks),
+ * 2: counters only (allocations and allocated bytes)
+ * tags are set per thread
+ */
+extern void setProfileInVtMalloc( int p );
+extern void setVtMallocTag( int depth, char *tag );
+extern void fprintfVtMallocProfile( FILE *f );
+extern int writeVtMallocProfile( char *name );
+
 extern void clearVtMalloc( );
 void fprintfVtMallocTrace( FILE *f );
 
@@ -14,6 +14,9 @@
  *
  * ADDITIONS, CHANGES
  *
+ * - Mon Oct 19 2026
+ *   hierarchical queue / priority queue flooding (_WATERSHED_QUEUE_),
+ *   and parallel flooding of slabs (_WATERSHED_PARALLEL_QUEUE_)
  *
  *
  *
@@ -136,6 +139,37 @@ void watershed_setMaxNumberOfIterations( int n )
 
 
 
+static enumWatershedAlgorithm _algorithm_ = _WATERSHED_QUEUE_;
+
+void watershed_setalgorithm( enumWatershedAlgorithm algorithm )
+{
+  _algorithm_ = algorithm;
+}
+
+
+
+/* parallel queue: the image is cut into slabs of _slab_thickness_
+   z-slices, that are flooded independently with _slab_margin_
+   additional z-slices on both sides (the decomposition does not
+   depend on the number of threads). In the margins, points that
+   get different labels from the two neighboring slabs are then 
+   flooded again (sequentially) from the other points.
+*/
+static int _slab_thickness_ = 32;
+static int _slab_margin_ = 4;
+
+void watershed_setSlabThickness( int n )
+{
+  if ( n > 0 ) _slab_thickness_ = n;
+}
+
+void watershed_setSlabMargin( int n )
+{
+  if ( n >= 0 ) _slab_margin_ = n;
+}
+
+
+
 
 
 
@@ -177,7 +211,7 @@ static void initPointList( typePointList *l )
 
 static void freePointList( typePointList *l )
 {
-  if ( l->pt != NULL ) free ( l-> pt );
+  if ( l->pt != NULL ) vtfree ( l-> pt );
   initPointList( l );
 }
 
@@ -286,7 +320,7 @@ static void initExtendedPointList( typeExtendedPointList *l )
 
 static void freeExtendedPointList( typeExtendedPointList *l )
 {
-  if ( l->pt != NULL ) free ( l-> pt );
+  if ( l->pt != NULL ) vtfree ( l-> pt );
   initExtendedPointList( l );
 }
 
@@ -935,6 +969,100 @@ static int _is_in_array( int l, int *tab, int N )
 
 
 
+/* choice of the label to be set to a point (x,y,z)
+   - labels[] are the labels of its labeled 6-neighbors
+   - l is the label of the neighbor that put it in the list
+   - label is its current value (for messages)
+*/
+static int _choose_label( int *labels, int nlabels, int l,
+                          int x, int y, int z, int label, int maxLabel )
+{
+  int n_original_neighbor;
+  int mainLabel;
+
+  if ( nlabels == 0 ) {
+
+    /* pas de voisins etiquetes dans le voisinage ... tres surprenant
+       on lui donne neanmoins l'etiquette de celui qui l'a conduit ici
+    */
+
+    if ( _verbose_ ) {
+      fprintf( stderr, "no neighbors for (%d,%d,%d) = %d (max=%d)\n",
+               x, y, z, label, maxLabel );
+    }
+    return( l );
+  }
+
+  if ( nlabels == 1 ) {
+
+    /* un seul voisin : cas ideal
+     */
+
+    if ( labels[ 0 ] != l ) {
+      if ( _verbose_ )
+        fprintf( stderr, "only one neighbor but conflicting labels for (%d,%d,%d) = %d (max=%d)\n",
+                 x, y, z, label, maxLabel );
+    }
+    return( l );
+  }
+
+  /* plusieurs voisins etiquetes : cas embetant
+   */
+
+  if ( (n_original_neighbor = _is_in_array( l, labels, nlabels )) == 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "original neighbor (label=%d) not in neighborhood for (%d,%d,%d) = %d (max=%d)\n",
+               l, x, y, z, label, maxLabel );
+  }
+
+  /* on trie (par ordre croissant) les labels des voisins
+   */
+  _sort_array( labels, nlabels );
+
+  /* Attribution de l'etiquette
+   */
+  if ( labels[0] == labels[ nlabels-1 ] ) {
+
+    /* cas simple : une seule etiquette dans le voisinage
+     */
+    return( labels[ 0 ] );
+  }
+
+  /* cas difficile, plusieurs etiquettes dans le voisinage
+   */
+
+  switch( _choice_ ) {
+  default :
+  case _FIRST_ENCOUNTERED_NEIGHBOR_ :
+    /* premier 6-voisin rencontre lors de la mise dans la liste
+       comportement historique par defaut
+       NOTE : j'avais aussi essaye le premier label rencontre dans le
+       voisinage (ie labels[0] avant tri), mais j'avais note que cela ne
+       marchait pas.
+    */
+    return( l );
+
+  case _MIN_LABEL_ :
+    /* plus petit label
+     */
+    return( labels[0] );
+
+  case _MOST_REPRESENTED_ :
+    /* label avec le plus de representants
+       On compare avec le nombre de representants du label original,
+       et on choisit ce dernier si les nombres de representants sont egaux
+    */
+    mainLabel =  _main_representative( labels, nlabels );
+    if ( _is_in_array( labels[mainLabel], labels, nlabels ) > n_original_neighbor )
+      return( labels[mainLabel] );
+    return( l );
+  }
+
+  return( l );
+}
+
+
+
 static void _process_worklist( typeExtendedPointList *theExtPointList,
                               u16 *theLabels,  int *theDim, int maxLabel,
                               int first, int last )
@@ -949,9 +1077,6 @@ static void _process_worklist( typeExtendedPointList *theExtPointList,
 
   typeExtendedPoint *ept = NULL;
 
-  int n_original_neighbor;
-  int mainLabel;
-
   /* attribution d'etiquettes aux points de la sous-liste de travail
    */
   for ( j = first; j <=last; j++ ) {
@@ -978,101 +1103,775 @@ static void _process_worklist( typeExtendedPointList *theExtPointList,
     if ( z > 0      && theLabels[i-dimxy] > 0 && theLabels[i-dimxy] <= maxLabel )
       ept->labels[ ept->nlabels ++ ] = theLabels[i-dimxy];
     
-    
-    if ( ept->nlabels == 0 ) {
-      
-      /* pas de voisins etiquetes dans le voisinage ... tres surprenant
-         on lui donne neanmoins l'etiquette de celui qui l'a conduit ici
-      */
-      
+    ept->labeltobeset = _choose_label( ept->labels, ept->nlabels, ept->l,
+                                       x, y, z, theLabels[ i ], maxLabel );
+  }
+
+}
+
+
+
+
+
+/*************************************************************
+ *
+ * queue based watershed
+ *
+ *************************************************************/
+
+
+
+/* Points to be processed are stored in a queue
+   - a hierarchical queue (one FIFO per gradient value) for integer 
+     gradient images, the FIFOs are linked lists through next[]
+   - a priority queue (binary heap) for real gradient images,
+     points with the same gradient value are ordered by insertion 
+     order
+
+   As in watershed() with point lists, all the points of the
+   lowest gradient value present in the queue (a wave) are 
+   labeled together (labels are written after having been all 
+   computed), then their neighbors are added in the queue. 
+   This yields the same labels, whatever the processing order.
+*/
+
+typedef struct typeHeapElement {
+  r64 value;
+  int index;
+  int order;
+} typeHeapElement;
+
+typedef struct typeWatershedQueue {
+  /* hierarchical queue
+   */
+  int *head;
+  int *tail;
+  int nlevels;
+  int current;
+  /* priority queue
+   */
+  typeHeapElement *heap;
+  int nheap;
+  int nAllocatedHeap;
+  int order;
+  /* points extracted from the queue
+   */
+  typePointList wave;
+} typeWatershedQueue;
+
+typedef struct typeWatershedQueueParameter {
+  void *theGradient;
+  bufferType theGradientType;
+  int minGradient;
+  int maxGradient;
+  u16 *theLabels;
+  u16 *from; /* label du voisin qui l'a fait mettre dans la file,
+                puis label a attribuer */
+  int *next;
+  int *theDim;
+  int maxLabel;
+  int isInQueue;
+  int maxIterations;
+  /* parallel flooding of slabs
+   */
+  void *theLabelsInput;
+  bufferType theLabelsType;
+  int nslabs;
+  int slabThickness;
+  int slabMargin;
+} typeWatershedQueueParameter;
+
+
+
+static void initWatershedQueue( typeWatershedQueue *q )
+{
+  q->head = (int*)NULL;
+  q->tail = (int*)NULL;
+  q->nlevels = 0;
+  q->current = 0;
+  q->heap = (typeHeapElement*)NULL;
+  q->nheap = 0;
+  q->nAllocatedHeap = 0;
+  q->order = 0;
+  initPointList( &(q->wave) );
+}
+
+
+
+static void freeWatershedQueue( typeWatershedQueue *q )
+{
+  if ( q->head != (int*)NULL ) vtfree( q->head );
+  if ( q->heap != (typeHeapElement*)NULL ) vtfree( q->heap );
+  freePointList( &(q->wave) );
+  initWatershedQueue( q );
+}
+
+
+
+static int allocWatershedQueue( typeWatershedQueue *q,
+                                typeWatershedQueueParameter *p )
+{
+  char *proc = "allocWatershedQueue";
+  int n;
+
+  switch( p->theGradientType ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such gradient type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+  case USHORT :
+  case SSHORT :
+    q->nlevels = p->maxGradient - p->minGradient + 1;
+    q->head = (int*)vtmalloc( 2 * q->nlevels * sizeof(int), "q->head", proc );
+    if ( q->head == (int*)NULL ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: allocation failed\n", proc );
+      return( -1 );
+    }
+    q->tail = q->head + q->nlevels;
+    for ( n=0; n<2*q->nlevels; n++ ) q->head[n] = -1;
+    q->current = q->nlevels;
+    break;
+  case FLOAT :
+  case DOUBLE :
+    break;
+  }
+  return( 1 );
+}
+
+
+
+static int _heapIsBefore( typeHeapElement *a, typeHeapElement *b )
+{
+  if ( a->value < b->value ) return( 1 );
+  if ( a->value > b->value ) return( 0 );
+  return( a->order < b->order );
+}
+
+
+
+static int addPointToQueue( typeWatershedQueue *q,
+                            typeWatershedQueueParameter *p, int i )
+{
+  char *proc = "addPointToQueue";
+  int l, n, f;
+  typeHeapElement *heap, e;
+
+  switch( p->theGradientType ) {
+  default :
+    return( -1 );
+  case UCHAR :
+    l = ((u8*)p->theGradient)[i] - p->minGradient;  break;
+  case USHORT :
+    l = ((u16*)p->theGradient)[i] - p->minGradient; break;
+  case SSHORT :
+    l = ((s16*)p->theGradient)[i] - p->minGradient; break;
+  case FLOAT :
+    e.value = ((r32*)p->theGradient)[i]; l = -1;     break;
+  case DOUBLE :
+    e.value = ((r64*)p->theGradient)[i]; l = -1;     break;
+  }
+
+  /* hierarchical queue
+   */
+  if ( l >= 0 ) {
+    p->next[i] = -1;
+    if ( q->head[l] < 0 ) q->head[l] = i;
+    else p->next[ q->tail[l] ] = i;
+    q->tail[l] = i;
+    if ( q->current > l ) q->current = l;
+    return( 1 );
+  }
+
+  /* priority queue
+   */
+  if ( q->nheap == q->nAllocatedHeap ) {
+    n = ( q->nAllocatedHeap < _nPointsToBeAllocated_ ) ? _nPointsToBeAllocated_ : 2 * q->nAllocatedHeap;
+    heap = (typeHeapElement*)vtmalloc( n * sizeof(typeHeapElement), "heap", proc );
+    if ( heap == (typeHeapElement*)NULL ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: can not reallocate priority queue\n", proc );
+      return( -1 );
+    }
+    if ( q->heap != (typeHeapElement*)NULL ) {
+      (void)memcpy( (void*)heap, (void*)q->heap, q->nheap * sizeof(typeHeapElement) );
+      vtfree( q->heap );
+    }
+    q->heap = heap;
+    q->nAllocatedHeap = n;
+  }
+
+  e.index = i;
+  e.order = q->order ++;
+  for ( n = q->nheap ++; n > 0; n = f ) {
+    f = (n-1)/2;
+    if ( _heapIsBefore( &(q->heap[f]), &e ) ) break;
+    q->heap[n] = q->heap[f];
+  }
+  q->heap[n] = e;
+  return( 1 );
+}
+
+
+
+static int popPointFromHeap( typeWatershedQueue *q )
+{
+  int i = q->heap[0].index;
+  int n, c;
+  typeHeapElement e = q->heap[ -- q->nheap ];
+
+  for ( n=0; (c = 2*n+1) < q->nheap; n = c ) {
+    if ( c+1 < q->nheap && _heapIsBefore( &(q->heap[c+1]), &(q->heap[c]) ) ) c++;
+    if ( _heapIsBefore( &e, &(q->heap[c]) ) ) break;
+    q->heap[n] = q->heap[c];
+  }
+  if ( q->nheap > 0 ) q->heap[n] = e;
+  return( i );
+}
+
+
+
+/* extract the wave (all the points with the lowest gradient value) 
+   from the queue into q->wave
+   returns the number of points, 0 if the queue is empty, 
+   or -1 in case of error
+*/
+static int extractWaveFromQueue( typeWatershedQueue *q,
+                                 typeWatershedQueueParameter *p )
+{
+  int dimx  = p->theDim[0];
+  int dimxy = p->theDim[0] * p->theDim[1];
+  int i, x, y, z;
+  r64 value;
+
+#define _ADD_POINT_TO_WAVE_ {                                     \
+    z = i / dimxy;                                                \
+    y = (i - z*dimxy) / dimx;                                     \
+    x = i - z*dimxy - y*dimx;                                     \
+    if ( addPointToList( &(q->wave), x, y, z, i, (int)p->from[i] ) <= 0 ) \
+      return( -1 );                                               \
+  }
+
+  q->wave.nPoints = 0;
+
+  if ( q->head != (int*)NULL ) {
+    while ( q->current < q->nlevels && q->head[q->current] < 0 )
+      q->current ++;
+    if ( q->current >= q->nlevels ) return( 0 );
+    for ( i = q->head[q->current]; i >= 0; i = p->next[i] )
+      _ADD_POINT_TO_WAVE_
+    q->head[q->current] = q->tail[q->current] = -1;
+    return( q->wave.nPoints );
+  }
+
+  if ( q->nheap == 0 ) return( 0 );
+  value = q->heap[0].value;
+  while ( q->nheap > 0 && q->heap[0].value == value ) {
+    i = popPointFromHeap( q );
+    _ADD_POINT_TO_WAVE_
+  }
+
+#undef _ADD_POINT_TO_WAVE_
+
+  return( q->wave.nPoints );
+}
+
+
+
+/* flooding of the z-slices [zfirst,zlast]
+   neighbors outside these slices are ignored
+*/
+static int _floodWithQueue( typeWatershedQueueParameter *p, int zfirst, int zlast )
+{
+  char *proc = "_floodWithQueue";
+  typeWatershedQueue q;
+  u16 *theLabels = p->theLabels;
+  u16 *from = p->from;
+  int dimx  = p->theDim[0];
+  int dimy  = p->theDim[1];
+  int dimxy = p->theDim[0] * p->theDim[1];
+  int dimx1 = p->theDim[0] - 1;
+  int dimy1 = p->theDim[1] - 1;
+  int isInQueue = p->isInQueue;
+  int maxLabel = p->maxLabel;
+  int labels[6];
+  int nlabels;
+  int i, j, nPoints, iteration;
+  int x, y, z;
+  typePoint *pt;
+
+  initWatershedQueue( &q );
+  q.wave.nMaxPoints = p->theDim[0] * p->theDim[1] * p->theDim[2];
+  if ( allocWatershedQueue( &q, p ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate queue\n", proc );
+    return( -1 );
+  }
+
+#define _ADD_NEIGHBOR_TO_QUEUE_( J ) {              \
+    if ( theLabels[J] == 0 ) {                      \
+      if ( addPointToQueue( &q, p, J ) != 1 ) {     \
+        freeWatershedQueue( &q );                   \
+        return( -1 );                               \
+      }                                             \
+      theLabels[J] = isInQueue;                     \
+      from[J] = theLabels[i];                       \
+    }                                               \
+  }
+
+#define _ADD_NEIGHBORS_TO_QUEUE_ {                                    \
+    if ( x < dimx1 ) _ADD_NEIGHBOR_TO_QUEUE_( i+1 );                  \
+    if ( x > 0 )     _ADD_NEIGHBOR_TO_QUEUE_( i-1 );                  \
+    if ( y < dimy1 ) _ADD_NEIGHBOR_TO_QUEUE_( i+dimx );               \
+    if ( y > 0 )     _ADD_NEIGHBOR_TO_QUEUE_( i-dimx );               \
+    if ( z < zlast ) _ADD_NEIGHBOR_TO_QUEUE_( i+dimxy );              \
+    if ( z > zfirst ) _ADD_NEIGHBOR_TO_QUEUE_( i-dimxy );             \
+  }
+
+  /* queue initialisation
+   */
+  for ( z=zfirst; z<=zlast; z++ )
+  for ( i=z*dimxy, y=0; y<dimy; y++ )
+  for ( x=0; x<dimx; x++, i++ ) {
+    if ( theLabels[i] == 0 || theLabels[i] == isInQueue ) continue;
+    _ADD_NEIGHBORS_TO_QUEUE_
+  }
+
+  /* waves
+   */
+  for ( iteration=0; p->maxIterations < 0 || iteration < p->maxIterations; iteration++ ) {
+
+    nPoints = extractWaveFromQueue( &q, p );
+    if ( nPoints < 0 ) {
+      freeWatershedQueue( &q );
+      return( -1 );
+    }
+    if ( nPoints == 0 ) break;
+
+    /* attribution d'etiquettes aux points de la vague
+     */
+    for ( j=0, pt=q.wave.pt; j<nPoints; j++, pt++ ) {
+      x = pt->x;
+      y = pt->y;
+      z = pt->z;
+      i = pt->i;
+      nlabels = 0;
+      if ( x < dimx1 && theLabels[i+1] > 0 && theLabels[i+1] <= maxLabel )
+        labels[ nlabels ++ ] = theLabels[i+1];
+      if ( x > 0     && theLabels[i-1] > 0 && theLabels[i-1] <= maxLabel )
+        labels[ nlabels ++ ] = theLabels[i-1];
+      if ( y < dimy1 && theLabels[i+dimx] > 0 && theLabels[i+dimx] <= maxLabel )
+        labels[ nlabels ++ ] = theLabels[i+dimx];
+      if ( y > 0     && theLabels[i-dimx] > 0 && theLabels[i-dimx] <= maxLabel )
+        labels[ nlabels ++ ] = theLabels[i-dimx];
+      if ( z < zlast && theLabels[i+dimxy] > 0 && theLabels[i+dimxy] <= maxLabel )
+        labels[ nlabels ++ ] = theLabels[i+dimxy];
+      if ( z > zfirst && theLabels[i-dimxy] > 0 && theLabels[i-dimxy] <= maxLabel )
+        labels[ nlabels ++ ] = theLabels[i-dimxy];
+      pt->l = _choose_label( labels, nlabels, pt->l, x, y, z, theLabels[i], maxLabel );
+    }
+
+    /* on ecrit les etiquettes apres les avoir toutes calculees,
+       et on ajoute les voisins des points traites
+       (seul le label du point courant est utilise)
+     */
+    for ( j=0, pt=q.wave.pt; j<nPoints; j++, pt++ ) {
+      x = pt->x;
+      y = pt->y;
+      z = pt->z;
+      i = pt->i;
+      theLabels[i] = (u16)pt->l;
+      _ADD_NEIGHBORS_TO_QUEUE_
+    }
+  }
+
+#undef _ADD_NEIGHBORS_TO_QUEUE_
+#undef _ADD_NEIGHBOR_TO_QUEUE_
+
+  if ( _verbose_ >= 2 )
+    fprintf( stderr, "%s: slices [%d %d] flooded in %d waves\n", proc, zfirst, zlast, iteration );
+
+  freeWatershedQueue( &q );
+  return( 1 );
+}
+
+
+
+/* fills labels[0...n-1] with the input labels from index 'first'
+   (negative labels are ignored)
+*/
+static int _copyInputLabels( u16 *labels, void *theLabelsInput, bufferType theLabelsType,
+                             int first, int n )
+{
+  char *proc = "_copyInputLabels";
+  int i;
+
+  switch( theLabelsType ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such label type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+    {
+      u8 *buf = (u8*)theLabelsInput + first;
+      for ( i=0; i<n; i++ ) labels[i] = buf[i];
+    }
+    break;
+  case USHORT :
+    {
+      u16 *buf = (u16*)theLabelsInput + first;
+      for ( i=0; i<n; i++ ) labels[i] = buf[i];
+    }
+    break;
+  case SSHORT :
+    {
+      s16 *buf = (s16*)theLabelsInput + first;
+      for ( i=0; i<n; i++ ) labels[i] = ( buf[i] > 0 ) ? buf[i] : 0;
+    }
+    break;
+  }
+  return( 1 );
+}
+
+
+
+/* a slab [zfirst,zlast] is flooded with its margins, 
+   ie [zfirst-margin,zlast+margin], in auxiliary buffers.
+   Labels of [zfirst,zlast] are written in p->theLabels, while 
+   labels of the margins are written in p->from, to be compared
+   with the labels of the neighboring slabs.
+*/
+static int _floodSlabWithQueue( typeWatershedQueueParameter *p, int zfirst, int zlast )
+{
+  char *proc = "_floodSlabWithQueue";
+  typeWatershedQueueParameter s = *p;
+  int dimxy = p->theDim[0] * p->theDim[1];
+  int theSlabDim[3];
+  int zs, ze, n;
+  size_t size;
+
+  zs = ( zfirst - p->slabMargin < 0 ) ? 0 : zfirst - p->slabMargin;
+  ze = ( zlast + p->slabMargin > p->theDim[2]-1 ) ? p->theDim[2]-1 : zlast + p->slabMargin;
+  n = (ze-zs+1) * dimxy;
+
+  switch( p->theGradientType ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such gradient type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :  size = sizeof(u8);  break;
+  case USHORT : size = sizeof(u16); break;
+  case SSHORT : size = sizeof(s16); break;
+  case FLOAT :  size = sizeof(r32); break;
+  case DOUBLE : size = sizeof(r64); break;
+  }
+
+  theSlabDim[0] = p->theDim[0];
+  theSlabDim[1] = p->theDim[1];
+  theSlabDim[2] = ze-zs+1;
+  s.theDim = theSlabDim;
+  s.theGradient = (void*)( (char*)p->theGradient + (size_t)zs * (size_t)dimxy * size );
+
+  s.theLabels = (u16*)vtmalloc( 2 * n * sizeof(u16), "s.theLabels", proc );
+  if ( s.theLabels == (u16*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( -1 );
+  }
+  s.from = s.theLabels + n;
+  s.next = (int*)vtmalloc( n * sizeof(int), "s.next", proc );
+  if ( s.next == (int*)NULL ) {
+    vtfree( s.theLabels );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( -1 );
+  }
+
+  if ( _copyInputLabels( s.theLabels, p->theLabelsInput, p->theLabelsType, zs*dimxy, n ) != 1
+       || _floodWithQueue( &s, 0, ze-zs ) != 1 ) {
+    vtfree( s.next );
+    vtfree( s.theLabels );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to flood slab [%d %d]\n", proc, zfirst, zlast );
+    return( -1 );
+  }
+
+  if ( zfirst > zs )
+    (void)memcpy( (void*)(p->from + zs*dimxy), (void*)s.theLabels,
+                  (zfirst-zs) * dimxy * sizeof(u16) );
+  (void)memcpy( (void*)(p->theLabels + zfirst*dimxy), (void*)(s.theLabels + (zfirst-zs)*dimxy),
+                (zlast-zfirst+1) * dimxy * sizeof(u16) );
+  if ( ze > zlast )
+    (void)memcpy( (void*)(p->from + (zlast+1)*dimxy), (void*)(s.theLabels + (zlast+1-zs)*dimxy),
+                  (ze-zlast) * dimxy * sizeof(u16) );
+
+  vtfree( s.next );
+  vtfree( s.theLabels );
+  return( 1 );
+}
+
+
+
+static void *_floodSlabsWithQueue( void *par )
+{
+  typeChunk *chunk = (typeChunk *)par;
+  void *parameter = chunk->parameters;
+  size_t first = chunk->first;
+  size_t last = chunk->last;
+
+  typeWatershedQueueParameter *p = (typeWatershedQueueParameter*)parameter;
+  int dimz = p->theDim[2];
+  int s, zfirst, zlast;
+
+  for ( s=first; s<=(int)last; s++ ) {
+    zfirst = s * p->slabThickness;
+    zlast = ( s == p->nslabs-1 ) ? dimz-1 : zfirst + p->slabThickness - 1;
+    if ( _floodSlabWithQueue( p, zfirst, zlast ) != 1 ) {
+      chunk->ret = -1;
+      return( (void*)NULL );
+    }
+  }
+  chunk->ret = 1;
+  return( (void*)NULL );
+}
+
+
+
+/* in the margins of the slab borders, points that have been given 
+   different labels by the two neighboring slabs (conflicts) are
+   reset, as well as points that remain in queue. They will be
+   flooded again from the other points.
+*/
+static void _resolveSlabConflicts( typeWatershedQueueParameter *p )
+{
+  char *proc = "_resolveSlabConflicts";
+  u16 *theLabels = p->theLabels;
+  int dimxy = p->theDim[0] * p->theDim[1];
+  int dimz = p->theDim[2];
+  int s, zs, ze, i;
+  int nconflicts = 0;
+
+  for ( i=0; i<dimxy*dimz; i++ )
+    if ( theLabels[i] == p->isInQueue ) theLabels[i] = 0;
+
+  for ( s=1; s<p->nslabs; s++ ) {
+    zs = s * p->slabThickness - p->slabMargin;
+    ze = s * p->slabThickness + p->slabMargin - 1;
+    if ( zs < 0 ) zs = 0;
+    if ( ze > dimz-1 ) ze = dimz-1;
+    for ( i=zs*dimxy; i<(ze+1)*dimxy; i++ ) {
+      if ( theLabels[i] == p->from[i] ) continue;
+      theLabels[i] = 0;
+      nconflicts ++;
+    }
+  }
+
+  if ( _verbose_ >= 2 )
+    fprintf( stderr, "%s: %d points out of %d to be flooded again\n", proc, nconflicts, dimxy*dimz );
+}
+
+
+
+static int _copyLabelsToOutput( u16 *theLabels, void *theLabelsOutput,
+                                bufferType theLabelsType, int *theDim )
+{
+  char *proc = "_copyLabelsToOutput";
+  int i;
+  int v = theDim[0]*theDim[1]*theDim[2];
+
+  switch( theLabelsType ) {
+  default :
+    if ( _verbose_ ) {
+      fprintf( stderr, "%s: such label type not handled yet\n", proc );
+    }
+    return( -1 );
+  case UCHAR :
+    {
+      u8 *buf = theLabelsOutput;
+      for ( i=0; i<v; i++ )
+        buf[i] = theLabels[i];
+    }
+    break;
+  case USHORT :
+    {
+      u16 *buf = theLabelsOutput;
+      for ( i=0; i<v; i++ )
+        buf[i] = theLabels[i];
+    }
+    break;
+  case SSHORT :
+    {
+      s16 *buf = theLabelsOutput;
+      for ( i=0; i<v; i++ )
+        buf[i] = theLabels[i];
+    }
+    break;
+  }
+  return( 1 );
+}
+
+
+
+static int _watershedWithQueue( void *theGradient, bufferType theGradientType,
+                                void *theLabelsInput, void *theLabelsOutput,
+                                bufferType theLabelsType,
+                                int *theDim )
+{
+  char *proc = "_watershedWithQueue";
+  int v = theDim[0]*theDim[1]*theDim[2];
+  typeWatershedQueueParameter p;
+  typeChunks chunks;
+  u16 *theLabels = (u16*)NULL;
+  int maxLabel = 0;
+  int nLabel;
+  int n;
+
+  p.theGradient = theGradient;
+  p.theGradientType = theGradientType;
+  p.minGradient = 0;
+  p.maxGradient = 0;
+  p.theDim = theDim;
+  p.maxIterations = _max_iterations_;
+
+  switch( theGradientType ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such gradient type not handled yet\n", proc );
+    return( -1 );
+  case UCHAR :
+  case USHORT :
+  case SSHORT :
+    if ( findGradientExtremalValues( theGradient, theGradientType, theDim,
+                                     &(p.minGradient), &(p.maxGradient) ) != 1 ) {
       if ( _verbose_ ) {
-        fprintf( stderr, "no neighbors for (%d,%d,%d) = %d (max=%d)\n",
-                 x, y, z, theLabels[ i ], maxLabel );
+        fprintf( stderr, "%s: unable to compute min and max from gradient image\n", proc );
       }
-      ept->labeltobeset = ept->l;
+      return( -1 );
     }
-    
-    else if ( ept->nlabels == 1 ) {
-      
-      /* un seul voisin : cas ideal
-       */
-      
-      if ( ept->labels[ 0 ] != ept->l ) {
-        if ( _verbose_ )
-          fprintf( stderr, "only one neighbor but conflicting labels for (%d,%d,%d) = %d (max=%d)\n",
-                   x, y, z, theLabels[ i ], maxLabel );
-      }
-      ept->labeltobeset = ept->l;
+    break;
+  case FLOAT :
+  case DOUBLE :
+    break;
+  }
+
+
+
+  /* labels preparation
+   */
+  theLabels = (u16*)vtmalloc( 2 * v * sizeof(u16), "theLabels", proc );
+  if ( theLabels == NULL ) {
+    if ( _verbose_ ) 
+      fprintf( stderr, "%s: unable to auxiliary label image\n", proc );
+    return( -1 );
+  }
+  p.theLabels = theLabels;
+  p.from = theLabels + v;
+
+  p.next = (int*)vtmalloc( v * sizeof(int), "p.next", proc );
+  if ( p.next == NULL ) {
+    if ( _verbose_ ) 
+      fprintf( stderr, "%s: unable to allocate queue links\n", proc );
+    vtfree( theLabels );
+    return( -1 );
+  }
+
+  if ( initializeLabelArray( theLabels, theLabelsInput, theLabelsType, theDim, &maxLabel, &nLabel ) < 0 ) {
+    if ( _verbose_ ) 
+      fprintf( stderr, "%s: unable to fill auxiliary label image\n", proc );
+    vtfree( p.next );
+    vtfree( theLabels );
+    return( -1 );
+  }
+
+  if ( maxLabel <= 1 || nLabel == v ) {
+    if ( _verbose_ ) {
+      fprintf( stderr, "%s: weird label image", proc ); 
+      if ( maxLabel <= 1 ) fprintf( stderr, ", one or no label?" );
+      if ( nLabel == v ) fprintf( stderr, ", as many labels as voxels?" );
+      fprintf( stderr, "\n");
     }
-    
-    else {
-      
-      /* plusieurs voisins etiquetes : cas embetant
-       */
-      
-      if ( (n_original_neighbor = _is_in_array( ept->l, ept->labels, ept->nlabels )) == 0 ) {
-        if ( _verbose_ )
-          fprintf( stderr, "original neighbor (label=%d) not in neighborhood for (%d,%d,%d) = %d (max=%d)\n",
-                   ept->l, x, y, z, theLabels[ i ], maxLabel );
-      }
-      
-      /* on trie (par ordre croissant) les labels des voisins
-       */
-      _sort_array( ept->labels, ept->nlabels );
-      
-      /* Attribution de l'etiquette
-       */
-      if ( ept->labels[0] == ept->labels[ ept->nlabels-1 ] ) {
+    vtfree( p.next );
+    vtfree( theLabels );
+    return( -1 );
+  }
 
-        /* cas simple : une seule etiquette dans le voisinage
-         */
-        ept->labeltobeset = ept->labels[ 0 ];
-      }
-      else {
-
-        /* cas difficile, plusieurs etiquettes dans le voisinage
-         */
-
-        switch( _choice_ ) {
-        default :
-        case _FIRST_ENCOUNTERED_NEIGHBOR_ :
-          /* premier 6-voisin rencontre lors de la mise dans la liste
-             comportement historique par defaut
-             NOTE : j'avais aussi essaye le premier label rencontre dans le
-             voisinage (ie labels[0] avant tri), mais j'avais note que cela ne
-             marchait pas.
-          */
-          ept->labeltobeset = ept->l;
-          break;
-
-        case _MIN_LABEL_ :
-          /* plus petit label
-           */
-          ept->labeltobeset = ept->labels[0];
-          break;
-
-        case _MOST_REPRESENTED_ :
-          /* label avec le plus de representants
-             On compare avec le nombre de representants du label original,
-             et on choisit ce dernier si les nombres de representants sont egaux
-          */
-          mainLabel =  _main_representative( ept->labels, ept->nlabels );
-          if ( _is_in_array( ept->labels[mainLabel], ept->labels, ept->nlabels ) > n_original_neighbor )
-            ept->labeltobeset = ept->labels[mainLabel];
-          else
-            ept->labeltobeset = ept->l;
-          break;
-        }
-      }
+  if ( maxLabel == 65535 ) {
+    if ( _verbose_ ) 
+      fprintf( stderr, "%s: too many labels\n", proc );
+    vtfree( p.next );
+    vtfree( theLabels );
+    return( -1 );
+  }
+
+  p.maxLabel = maxLabel;
+  p.isInQueue = maxLabel+1;
+
+
+
+  /* parallel flooding of slabs, 
+     then slab borders are reset
+   */
+  p.theLabelsInput = theLabelsInput;
+  p.theLabelsType = theLabelsType;
+  p.slabThickness = _slab_thickness_;
+  p.slabMargin = ( _slab_margin_ < _slab_thickness_/2 ) ? _slab_margin_ : _slab_thickness_/2;
+  p.nslabs = theDim[2] / _slab_thickness_;
+
+  if ( _algorithm_ == _WATERSHED_PARALLEL_QUEUE_ && p.nslabs > 1 ) {
+
+    initChunks( &chunks );
+    if ( buildChunks( &chunks, 0, p.nslabs-1, proc ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to compute chunks\n", proc );
+      vtfree( p.next );
+      vtfree( theLabels );
+      return( -1 );
+    }
+    for ( n=0; n<chunks.n_allocated_chunks; n++ )
+      chunks.data[n].parameters = (void*)(&p);
+
+    if ( processChunks( &_floodSlabsWithQueue, &chunks, proc ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to flood slabs\n", proc );
+      freeChunks( &chunks );
+      vtfree( p.next );
+      vtfree( theLabels );
+      return( -1 );
     }
+    freeChunks( &chunks );
+
+    _resolveSlabConflicts( &p );
   }
 
+
+
+  /* flooding of the whole image
+   */
+  if ( _floodWithQueue( &p, 0, theDim[2]-1 ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to flood image\n", proc );
+    vtfree( p.next );
+    vtfree( theLabels );
+    return( -1 );
+  }
+  vtfree( p.next );
+
+  if ( _copyLabelsToOutput( theLabels, theLabelsOutput, theLabelsType, theDim ) != 1 ) {
+    vtfree( theLabels );
+    return( -1 );
+  }
+
+  vtfree( theLabels );
+  return( 1 );
 }
 
 
 
 
 
+
+
 /************************************************************
  *
  *
@@ -1108,6 +1907,12 @@ int watershed( void *theGradient, bufferType theGradientType,
 
 
 
+  if ( _algorithm_ != _WATERSHED_POINT_LISTS_
+       || theGradientType == FLOAT || theGradientType == DOUBLE )
+    return( _watershedWithQueue( theGradient, theGradientType,
+                                 theLabelsInput, theLabelsOutput,
+                                 theLabelsType, theDim ) );
+
 
 
   /***********************************************************************
@@ -1507,33 +2312,9 @@ int watershed( void *theGradient, bufferType theGradientType,
   freeChunks( &chunks );
 
 
-  switch( theLabelsType ) {
-  default :
-    if ( _verbose_ ) {
-      fprintf( stderr, "%s: such label type not handled yet\n", proc );
-    }
+  if ( _copyLabelsToOutput( theLabels, theLabelsOutput, theLabelsType, theDim ) != 1 ) {
     vtfree( theLabels );
     return( -1 );
-  case UCHAR :
-    {
-      u8 *buf = theLabelsOutput;
-      for ( i=0; i<v; i++ )
-        buf[i] = theLabels[i];
-    }
-    break;
-  case USHORT :
-    {
-      u16 *buf = theLabelsOutput;
-      for ( i=0; i<v; i++ )
-        buf[i] = theLabels[i];
-    }
-  case SSHORT :
-    {
-      s16 *buf = theLabelsOutput;
-      for ( i=0; i<v; i++ )
-        buf[i] = theLabels[i];
-    }
-    break;
   }
 
   vtfree( theLabels );
@@ -48,6 +48,20 @@ typedef enum enumWatershedLabelChoice {
 } enumWatershedLabelChoice;
 
 
+typedef enum enumWatershedAlgorithm {
+  /* listes de points par valeur de gradient, 
+     implementation historique */
+  _WATERSHED_POINT_LISTS_ = 0,
+  /* file d'attente hierarchique (une file par valeur de gradient)
+     pour les gradients entiers, file de priorite (tas) pour les
+     gradients reels. Meme resultat que les listes, en O(N) */
+  _WATERSHED_QUEUE_ = 1,
+  /* l'image est decoupee en tranches traitees en parallele,
+     puis les bords des tranches sont inondes a nouveau */
+  _WATERSHED_PARALLEL_QUEUE_ = 2
+} enumWatershedAlgorithm;
+
+
 extern void setVerboseInWatershed( int v );
 extern void incrementVerboseInWatershed(  );
 extern void decrementVerboseInWatershed(  );
@@ -66,6 +80,23 @@ extern int watershed_getNumberOfPointsForAllocation();
 
 extern void watershed_setMaxNumberOfIterations( int n );
 
+/* _WATERSHED_QUEUE_ is the default.
+   Real gradients (FLOAT, DOUBLE) are only handled by the
+   queue based algorithms.
+*/
+extern void watershed_setalgorithm( enumWatershedAlgorithm algorithm );
+
+/* _WATERSHED_PARALLEL_QUEUE_ : thickness of the slabs (in z-slices)
+   that are flooded in parallel, and of the margins (at most half the
+   thickness) added on both sides of a slab. Points of the margins
+   that get different labels from two neighboring slabs are flooded
+   again afterwards. Labels do not depend on the number of threads,
+   but may differ from the ones of the sequential flooding close to
+   the slab borders.
+*/
+extern void watershed_setSlabThickness( int n );
+extern void watershed_setSlabMargin( int n );
+
 
 
 extern int watershed( void *theGradient, bufferType theGradientType,
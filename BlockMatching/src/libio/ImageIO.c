@@ -15,8 +15,20 @@ char *strdup(const char *s);
 #include <limits.h>
 #include <math.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include <locale.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include <ImageIO.h>
 
 /* formats actuellement lus
@@ -47,6 +59,11 @@ char *strdup(const char *s);
 #endif
 #include "analyze.h"
 #include "raw.h"
+#include "shm.h"
+#ifdef ZLIB
+#include "bgzf.h"
+#include "chunked.h"
+#endif
 #include "nachos.h"
 #include <metaImage.h>
 
@@ -197,6 +214,11 @@ void _initImageFormat( PTRIMAGE_FORMAT format )
   format->writeImageHeader = NULL;
   format->writeImage = NULL;
 
+  format->readPyramidLevel = NULL;
+  format->writePyramidLevel = NULL;
+
+  format->readImageRegion = NULL;
+
   for ( i=0; i<IMAGE_FORMAT_NAME_LENGTH; i++ )
     format->fileExtension[i] = '\0';
   for ( i=0; i<IMAGE_FORMAT_NAME_LENGTH; i++ )
@@ -306,6 +328,11 @@ static void initSupportedFileFormat()
     addImageFormatAtEnd( f );
 #endif
 
+#ifdef ZLIB
+    f = createChunkedFormat();
+    addImageFormatAtEnd( f );
+#endif
+
 
     f = createBMPFormat();
     addImageFormatAtEnd( f );
@@ -473,7 +500,9 @@ static PTRIMAGE_FORMAT _getImageFormatFromMagicString( _image *im, const char *n
 
   /* standard file
    * get magic string for disk files
+   * (nothing is read from directories, eg chunked images)
    */
+  memset( magic, 0, 5 );
   ImageIO_read(im, magic, 4);
   magic[4] = '\0';
   ImageIO_seek(im, 0L, SEEK_SET);
@@ -515,6 +544,12 @@ static PTRIMAGE_FORMAT _getImageFormatFromName( const char *name )
     return( InrimageFormat );
   }
 
+  /* shared memory images are inrimages
+   */
+  if ( _isSharedMemoryName( name ) ) {
+    return( InrimageFormat );
+  }
+
   /* scan all formats; */
   length=strlen( name );
 
@@ -559,6 +594,12 @@ static PTRIMAGE_FORMAT _getImageFormatForReading( _image *im, const char *name )
 {
   PTRIMAGE_FORMAT f;
 
+  /* shared memory images are inrimages
+   */
+  if ( _isSharedMemoryName( name ) ) {
+    return( InrimageFormat );
+  }
+
   f = _getImageFormatFromMagicString( im, name );
   if ( f != NULL ) {
     return( f );
@@ -662,7 +703,12 @@ _image *_initImage() {
 
   /* no file associated to image */
   im->fd = NULL;
+  im->openedFileName = NULL;
   im->openMode = OM_CLOSE;
+
+  /* data are not mapped */
+  im->mapAddress = NULL;
+  im->mapLength = 0;
   im->endianness = _getEndianness();
 
   /* unknown data kind
@@ -720,8 +766,21 @@ void _freeImage( _image *im )
 {
   if ( im == NULL ) return;
 
-  /* free data if any */
-  if(im->data != NULL) ImageIO_free(im->data);
+  /* free data if any
+     (data may have been replaced after the mapping)
+   */
+  if ( im->mapAddress != NULL ) {
+    if ( im->data != NULL
+         && ( (char*)im->data < (char*)im->mapAddress
+              || (char*)im->data >= (char*)im->mapAddress + im->mapLength ) )
+      ImageIO_free(im->data);
+#ifndef WIN32
+    (void)munmap( im->mapAddress, im->mapLength );
+#endif
+    im->mapAddress = NULL;
+    im->mapLength = 0;
+  }
+  else if(im->data != NULL) ImageIO_free(im->data);
   im->data = NULL;
 
   _freeImageStructure( im );
@@ -729,6 +788,28 @@ void _freeImage( _image *im )
 
 
 
+/* Free the data of an image descriptor, if any
+   (the descriptor is kept)
+ */
+static void _freeImageData( _image *im )
+{
+  if ( im->mapAddress != NULL ) {
+    if ( im->data != NULL
+         && ( (char*)im->data < (char*)im->mapAddress
+              || (char*)im->data >= (char*)im->mapAddress + im->mapLength ) )
+      ImageIO_free(im->data);
+#ifndef WIN32
+    (void)munmap( im->mapAddress, im->mapLength );
+#endif
+    im->mapAddress = NULL;
+    im->mapLength = 0;
+  }
+  else if(im->data != NULL) ImageIO_free(im->data);
+  im->data = NULL;
+}
+
+
+
 void _swapImageData( _image *im )
 {
   char *proc = "_swapImageData";
@@ -813,6 +894,509 @@ void _swapImageData( _image *im )
 
 
 
+/*--------------------------------------------------
+ *
+ * memory mapping of data
+ *
+ --------------------------------------------------*/
+
+
+
+static int _ImageIO_memory_mapping_ = 0;
+
+void _SetMemoryMappingInImageIO( int m )
+{
+  _ImageIO_memory_mapping_ = m;
+}
+
+int _GetMemoryMappingInImageIO( )
+{
+  return( _ImageIO_memory_mapping_ );
+}
+
+
+
+int _mapImageData( _image *im, const char *name, size_t offset )
+{
+#ifndef WIN32
+  char *proc = "_mapImageData";
+  size_t size, pagesize, aligned;
+  unsigned char magic[2];
+  struct stat st;
+  void *addr;
+  int fd;
+
+  /* shared memory images are always mapped
+   */
+  if ( _ImageIO_memory_mapping_ == 0 && !_isSharedMemoryName( name ) ) return( 0 );
+  if ( im->data != NULL || name == NULL || im->dataMode != DM_BINARY ) return( 0 );
+
+  size = (size_t)im->xdim * (size_t)im->ydim * (size_t)im->zdim * (size_t)im->vdim * (size_t)im->wdim;
+  if ( size == 0 ) return( 0 );
+
+  /* data have to be aligned with respect to the word size
+   */
+  if ( im->wdim > 1 && offset % im->wdim != 0 ) return( 0 );
+
+  if ( _isSharedMemoryName( name ) )
+    fd = _openSharedMemory( name, 0 );
+  else
+    fd = open( name, O_RDONLY );
+  if ( fd < 0 ) return( 0 );
+
+  /* regular (or shared memory) and large enough file
+   */
+  if ( fstat( fd, &st ) != 0
+       || ( !S_ISREG( st.st_mode ) && !_isSharedMemoryName( name ) )
+       || (size_t)st.st_size < offset + size ) {
+    close( fd );
+    return( 0 );
+  }
+
+  /* gzipped file (as recognized by gzopen())
+   */
+  if ( read( fd, magic, 2 ) == 2 && magic[0] == 0x1f && magic[1] == 0x8b ) {
+    close( fd );
+    return( 0 );
+  }
+
+  /* the mapping offset has to be a multiple of the page size
+   */
+  pagesize = (size_t)sysconf( _SC_PAGESIZE );
+  aligned = offset - offset % pagesize;
+
+  addr = mmap( NULL, size + offset - aligned, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE, fd, (off_t)aligned );
+  close( fd );
+  if ( addr == MAP_FAILED ) {
+    if ( _ImageIO_debug_ )
+      fprintf( stderr, "%s: unable to map '%s', data will be read\n", proc, name );
+    return( 0 );
+  }
+
+  im->mapAddress = addr;
+  im->mapLength = size + offset - aligned;
+  im->data = (void*)((char*)addr + (offset - aligned));
+
+  if ( _ImageIO_debug_ >= 2 )
+    fprintf( stderr, "%s: map %lu bytes of '%s' at %p\n", proc, size, name, im->data );
+
+  /* the mapping is private, swapped pages are copied
+   */
+  _swapImageData( im );
+
+  return( 1 );
+#else
+  return( 0 );
+#endif
+}
+
+
+
+int _unmapImageData( _image *im )
+{
+  char *proc = "_unmapImageData";
+  size_t size;
+  void *data;
+
+  if ( im->mapAddress == NULL ) return( 1 );
+
+  /* data are no more in the mapping
+   */
+  if ( im->data == NULL
+       || (char*)im->data < (char*)im->mapAddress
+       || (char*)im->data >= (char*)im->mapAddress + im->mapLength ) {
+#ifndef WIN32
+    (void)munmap( im->mapAddress, im->mapLength );
+#endif
+    im->mapAddress = NULL;
+    im->mapLength = 0;
+    return( 1 );
+  }
+
+  size = (size_t)im->xdim * (size_t)im->ydim * (size_t)im->zdim * (size_t)im->vdim * (size_t)im->wdim;
+  data = ImageIO_alloc( size );
+  if ( data == NULL ) {
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: image buffer allocation failed\n", proc );
+    return( -1 );
+  }
+  (void)memcpy( data, im->data, size );
+
+#ifndef WIN32
+  (void)munmap( im->mapAddress, im->mapLength );
+#endif
+  im->mapAddress = NULL;
+  im->mapLength = 0;
+  im->data = data;
+
+  return( 1 );
+}
+
+
+
+/* position in the opened file if it is not compressed, -1 else
+ */
+static long _ImageIO_direct_tell( const _image *im )
+{
+  switch ( im->openMode ) {
+  default :
+    return( -1 );
+#ifdef ZLIB
+  case OM_GZ :
+    if ( gzdirect( im->fd ) == 0 ) return( -1 );
+    return( (long)gztell( im->fd ) );
+#endif
+  case OM_FILE :
+    return( ftell( (FILE*)im->fd ) );
+  }
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * shared memory images
+ *
+ --------------------------------------------------*/
+
+
+
+static int _ImageIO_shm_unlink_ = 0;
+
+void _SetSharedMemoryUnlinkInImageIO( int u )
+{
+  _ImageIO_shm_unlink_ = u;
+}
+
+int _GetSharedMemoryUnlinkInImageIO( )
+{
+  return( _ImageIO_shm_unlink_ );
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * parallel reading and writing
+ *
+ --------------------------------------------------*/
+
+
+
+static int _ImageIO_max_threads_ = 0;
+
+void _SetMaxThreadsInImageIO( int n )
+{
+  _ImageIO_max_threads_ = n;
+}
+
+int _GetMaxThreadsInImageIO( )
+{
+  return( _ImageIO_max_threads_ );
+}
+
+int _GetNumberOfThreadsInImageIO( int n )
+{
+  int t = 1;
+#ifdef _OPENMP
+  t = omp_get_max_threads();
+#endif
+  if ( _ImageIO_max_threads_ > 0 && t > _ImageIO_max_threads_ ) t = _ImageIO_max_threads_;
+  if ( n > 0 && t > n ) t = n;
+  if ( t < 1 ) t = 1;
+  return( t );
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * BGZF (blocked gzip) files
+ *
+ --------------------------------------------------*/
+
+
+
+static int _ImageIO_bgzf_writing_ = 0;
+
+void _SetBgzfWritingInImageIO( int b )
+{
+  _ImageIO_bgzf_writing_ = b;
+}
+
+int _GetBgzfWritingInImageIO( )
+{
+  return( _ImageIO_bgzf_writing_ );
+}
+
+
+
+int _readBgzfImageData( _image *im, const char *name, size_t offset )
+{
+#ifdef ZLIB
+  char *proc = "_readBgzfImageData";
+  bgzfIndex index;
+  size_t size;
+  int allocated = 0;
+
+  if ( name == NULL || im->dataMode != DM_BINARY ) return( 0 );
+
+  size = (size_t)im->xdim * (size_t)im->ydim * (size_t)im->zdim * (size_t)im->vdim * (size_t)im->wdim;
+  if ( size == 0 ) return( 0 );
+
+  switch ( bgzfBuildIndex( &index, name ) ) {
+  default :
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: unable to build index of '%s'\n", proc, name );
+    return( -1 );
+  case 0 :
+    return( 0 );
+  case 1 :
+    break;
+  }
+
+  if ( !im->data ) {
+    im->data = ImageIO_alloc( size );
+    if ( !im->data ) {
+      bgzfFreeIndex( &index );
+      if ( _ImageIO_verbose_ )
+        fprintf( stderr, "%s: image buffer allocation failed\n", proc );
+      return( -1 );
+    }
+    allocated = 1;
+  }
+
+  if ( bgzfRead( &index, offset, im->data, size ) != 1 ) {
+    bgzfFreeIndex( &index );
+    if ( allocated ) {
+      ImageIO_free( im->data );
+      im->data = NULL;
+    }
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: unable to read data of '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  if ( _ImageIO_debug_ >= 2 )
+    fprintf( stderr, "%s: read %lu bytes from %d members of '%s'\n",
+             proc, size, index.n, name );
+
+  bgzfFreeIndex( &index );
+  _swapImageData( im );
+  return( 1 );
+#else
+  return( 0 );
+#endif
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * image region reading
+ *
+ --------------------------------------------------*/
+
+
+
+static int _isImageRegionValid( const _image *im, size_t *first, size_t *dim )
+{
+  if ( dim[0] == 0 || dim[1] == 0 || dim[2] == 0 ) return( 0 );
+  if ( first[0] + dim[0] > im->xdim
+       || first[1] + dim[1] > im->ydim
+       || first[2] + dim[2] > im->zdim ) return( 0 );
+  return( 1 );
+}
+
+
+
+int _readImageRegionData( _image *im, const char *name, size_t offset,
+                          size_t *first, size_t *dim )
+{
+  char *proc = "_readImageRegionData";
+  size_t voxelsize, rowsize, size, pos, y, z;
+  unsigned char *data, *row;
+#ifdef ZLIB
+  bgzfIndex index;
+  unsigned char *span = NULL;
+  size_t spansize;
+  gzFile f;
+#else
+  FILE *f;
+#endif
+
+  if ( name == NULL ) return( -1 );
+
+  if ( _isImageRegionValid( im, first, dim ) != 1 ) {
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: region %lu x %lu x %lu at (%lu,%lu,%lu) is not in image %lu x %lu x %lu\n",
+               proc, dim[0], dim[1], dim[2], first[0], first[1], first[2], im->xdim, im->ydim, im->zdim );
+    return( -1 );
+  }
+
+  voxelsize = (size_t)im->vdim * (size_t)im->wdim;
+  rowsize = dim[0] * voxelsize;
+  size = dim[0] * dim[1] * dim[2] * voxelsize;
+
+  data = (unsigned char*)ImageIO_alloc( size );
+  if ( data == NULL ) {
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: image buffer allocation failed\n", proc );
+    return( -1 );
+  }
+
+#ifdef ZLIB
+  /* BGZF files: one read per plane, from the first to the last
+     voxel of the region in the plane (only the members
+     containing them are uncompressed)
+   */
+  switch ( bgzfBuildIndex( &index, name ) ) {
+  default :
+    ImageIO_free( data );
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: unable to build index of '%s'\n", proc, name );
+    return( -1 );
+  case 0 :
+    break;
+  case 1 :
+    spansize = ( (dim[1]-1) * im->xdim + dim[0] ) * voxelsize;
+    span = (unsigned char*)ImageIO_alloc( spansize );
+    if ( span == NULL ) {
+      bgzfFreeIndex( &index );
+      ImageIO_free( data );
+      if ( _ImageIO_verbose_ )
+        fprintf( stderr, "%s: auxiliary buffer allocation failed\n", proc );
+      return( -1 );
+    }
+    for ( row=data, z=0; z<dim[2]; z++ ) {
+      pos = offset + ( ((first[2]+z) * im->ydim + first[1]) * im->xdim + first[0] ) * voxelsize;
+      if ( bgzfRead( &index, pos, span, spansize ) != 1 ) {
+        ImageIO_free( span );
+        bgzfFreeIndex( &index );
+        ImageIO_free( data );
+        if ( _ImageIO_verbose_ )
+          fprintf( stderr, "%s: unable to read plane #%lu of '%s'\n", proc, first[2]+z, name );
+        return( -1 );
+      }
+      for ( y=0; y<dim[1]; y++, row+=rowsize )
+        (void)memcpy( row, span + y * im->xdim * voxelsize, rowsize );
+    }
+    ImageIO_free( span );
+    bgzfFreeIndex( &index );
+    if ( _ImageIO_debug_ >= 2 )
+      fprintf( stderr, "%s: read %lu bytes from BGZF file '%s'\n", proc, size, name );
+    im->xdim = dim[0];
+    im->ydim = dim[1];
+    im->zdim = dim[2];
+    im->data = data;
+    _swapImageData( im );
+    return( 1 );
+  }
+
+  /* other files: one read per row
+     gzipped files are uncompressed up to the last row
+   */
+  f = gzopen( name, "rb" );
+#else
+  f = fopen( name, "rb" );
+#endif
+  if ( f == NULL ) {
+    ImageIO_free( data );
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: unable to open '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  for ( row=data, z=0; z<dim[2]; z++ )
+  for ( y=0; y<dim[1]; y++, row+=rowsize ) {
+    pos = offset + ( ((first[2]+z) * im->ydim + first[1]+y) * im->xdim + first[0] ) * voxelsize;
+#ifdef ZLIB
+    if ( gzseek( f, (z_off_t)pos, SEEK_SET ) < 0
+         || gzread( f, row, (unsigned int)rowsize ) != (int)rowsize ) {
+      gzclose( f );
+#else
+    if ( fseek( f, (long)pos, SEEK_SET ) != 0
+         || fread( row, 1, rowsize, f ) != rowsize ) {
+      fclose( f );
+#endif
+      ImageIO_free( data );
+      if ( _ImageIO_verbose_ )
+        fprintf( stderr, "%s: unable to read row #%lu of plane #%lu of '%s'\n",
+                 proc, first[1]+y, first[2]+z, name );
+      return( -1 );
+    }
+  }
+
+#ifdef ZLIB
+  gzclose( f );
+#else
+  fclose( f );
+#endif
+
+  im->xdim = dim[0];
+  im->ydim = dim[1];
+  im->zdim = dim[2];
+  im->data = data;
+  _swapImageData( im );
+  return( 1 );
+}
+
+
+
+
+
+/*--------------------------------------------------
+ *
+ * pyramid levels stored in image files
+ *
+ --------------------------------------------------*/
+
+
+
+int _readImagePyramidLevel( const char *name, _image *im, float *sigma, int *info )
+{
+  char *proc = "_readImagePyramidLevel";
+  PTRIMAGE_FORMAT f;
+
+  if ( name == NULL || im == NULL || im->data == NULL ) return( 0 );
+
+  f = _getImageFormatFromName( name );
+  if ( f == NULL || f->readPyramidLevel == NULL ) return( 0 );
+
+  if ( _ImageIO_debug_ )
+    fprintf( stderr, "%s: looking for a %lu x %lu x %lu level in '%s'\n",
+             proc, im->xdim, im->ydim, im->zdim, name );
+
+  return( (*f->readPyramidLevel)( name, im, sigma, info ) );
+}
+
+
+
+int _writeImagePyramidLevel( const char *name, _image *im, float *sigma, int *info )
+{
+  PTRIMAGE_FORMAT f;
+
+  if ( name == NULL || im == NULL || im->data == NULL ) return( 0 );
+
+  f = _getImageFormatFromName( name );
+  if ( f == NULL || f->writePyramidLevel == NULL ) return( 0 );
+
+  return( (*f->writePyramidLevel)( name, im, sigma, info ) );
+}
+
+
+
+
+
 /*--------------------------------------------------
  *
  * mimics standard routines
@@ -908,6 +1492,9 @@ size_t ImageIO_write(const _image *im, const void *buf, size_t len)
     }
     return ( len - to_be_written );
     break;
+  case OM_BGZ :
+    return( bgzfWrite( (bgzfFile*)im->fd, buf, len ) );
+    break;
 #endif
   case OM_FILE:
     while ( (to_be_written > 0) && ((l = fwrite(b, 1, stepWrite, (FILE*)im->fd)) > 0) ) {
@@ -1091,6 +1678,9 @@ int ImageIO_close( _image* im )
   case OM_STD :
     ret = gzclose( im->fd );
     break;
+  case OM_BGZ :
+    ret = bgzfClose( (bgzfFile*)im->fd );
+    break;
 #else
   case OM_STD :
     break;
@@ -1100,6 +1690,8 @@ int ImageIO_close( _image* im )
   }
   im->fd = NULL;
   im->openMode = OM_CLOSE;
+  if ( im->openedFileName != NULL ) free( im->openedFileName );
+  im->openedFileName = NULL;
 
   return ret;
 }
@@ -1139,6 +1731,23 @@ void _openReadImage(_image* im, const char *name) {
       im->openMode = OM_STD;
     }
 
+    /* shared memory object
+     */
+    else if ( _isSharedMemoryName( name ) ) {
+      int fd = _openSharedMemory( name, 0 );
+      if ( fd >= 0 ) {
+#ifdef ZLIB
+        im->fd = gzdopen(fd, "rb");
+        if(im->fd) im->openMode = OM_GZ;
+#else
+        im->fd = fdopen(fd, "rb");
+        if(im->fd) im->openMode = OM_FILE;
+#endif
+        if(!im->fd) close(fd);
+      }
+      if(im->fd) im->openedFileName = strdup(name);
+    }
+
     else {
 #ifdef ZLIB
       im->fd = gzopen(name, "rb");
@@ -1147,6 +1756,8 @@ void _openReadImage(_image* im, const char *name) {
       im->fd = fopen(name, "rb");
       if(im->fd) im->openMode = OM_FILE;
 #endif
+      /* keep the name for a possible memory mapping of the data */
+      if(im->fd) im->openedFileName = strdup(name);
 
     }
 
@@ -1164,6 +1775,7 @@ void _openReadImage(_image* im, const char *name) {
    openMode will have one of the following value:
    - OM_STD (for stdout)
    - OM_GZ
+   - OM_BGZ (if _SetBgzfWritingInImageIO() has been set)
    - OM_FILE
 */
 void _openWriteImage(_image* im, const char *name)
@@ -1186,6 +1798,18 @@ void _openWriteImage(_image* im, const char *name)
     im->openMode = OM_STD;
   }
 
+  /* shared memory object (never compressed)
+   */
+  else if ( _isSharedMemoryName( name ) ) {
+    int fd = _openSharedMemory( name, 1 );
+    im->fd = NULL;
+    if ( fd >= 0 ) {
+      im->fd = (_ImageIO_file) fdopen(fd, "wb");
+      if ( !im->fd ) close( fd );
+    }
+    if ( im->fd ) im->openMode = OM_FILE;
+  }
+
   else{
 #ifdef ZLIB
 
@@ -1198,7 +1822,15 @@ void _openWriteImage(_image* im, const char *name)
        be used for regular files.
     */
 
-    if( !strncmp(name+strlen(name)-3, ".gz", 3) )
+    if( !strncmp(name+strlen(name)-3, ".gz", 3) && _ImageIO_bgzf_writing_ )
+      {
+        im->fd = (_ImageIO_file)bgzfOpenWrite( name, -1 );
+        /* im->fd is NULL in case of failure, that is
+           reported by the caller
+         */
+        if ( im->fd ) im->openMode = OM_BGZ;
+      }
+    else if( !strncmp(name+strlen(name)-3, ".gz", 3) )
       {
 #ifdef _MSC_VER
         int ffd=_open(name,_O_RDWR | _O_CREAT| _O_TRUNC | _O_BINARY, _S_IREAD|_S_IWRITE);
@@ -1370,6 +2002,7 @@ _image *_readImageHeader( const char *name ) {
 int _readImageData(_image *im) {
   char *proc = "_readImageData";
   size_t size, nread;
+  long offset;
 
   if(im->openMode != OM_CLOSE) {
     if ( _ImageIO_debug_ ) {
@@ -1379,6 +2012,29 @@ int _readImageData(_image *im) {
 
     if ( size <= 0 ) return -3;
 
+    /* memory mapping of uncompressed data
+     */
+    if( !im->data && ( _ImageIO_memory_mapping_ || _isSharedMemoryName( im->openedFileName ) ) ) {
+      offset = _ImageIO_direct_tell( im );
+      if ( offset >= 0 && _mapImageData( im, im->openedFileName, (size_t)offset ) == 1 )
+        return 1;
+    }
+
+#ifdef ZLIB
+    /* parallel uncompression of BGZF files
+     */
+    if ( im->openMode == OM_GZ && gzdirect( im->fd ) == 0 && im->openedFileName != NULL ) {
+      switch ( _readBgzfImageData( im, im->openedFileName, (size_t)gztell( im->fd ) ) ) {
+      default :
+        break;
+      case 1 :
+        return 1;
+      case -1 :
+        return( -1 );
+      }
+    }
+#endif
+
     /* image buffer may have been allocated
      */
     if( !im->data ) {
@@ -1417,6 +2073,33 @@ int _readImageData(_image *im) {
 
 
 
+/* set geometry
+ * if qform_code is set,
+ *   compute quaternion, translation and orientation
+ * else if either quaternion, translation or orientation are set
+ *   compute matrix
+ *
+ */
+static void _setImageGeometry( _image *im )
+{
+  if ( im->qform_code ) {
+    if ( ! im->t_is_set || ! im->q_is_set || ! im->qfac_is_set ) {
+      _nifti_mat44_to_quatern( im );
+      im->t_is_set = im->q_is_set = im->qfac_is_set = 1;
+    }
+  }
+  else {
+    if ( im->t_is_set || im->q_is_set || im->qfac_is_set ) {
+      _nifti_quatern_to_mat44( im );
+      im->qform_code = 1;
+    }
+  }
+}
+
+
+
+
+
 /* Reads an image from a file and returns an image descriptor or NULL if
    reading failed.
    Reads from stdin if image name is NULL. */
@@ -1430,26 +2113,8 @@ _image* _readImage(const char *name) {
   im = _readImageHeader( name );
 
   /* set geometry
-   * if qform_code is set,
-   *   compute quaternion, translation and orientation
-   * else if either quaternion, translation or orientation are set
-   *   compute matrix
-   *
    */
-  if ( im != NULL ) {
-    if ( im->qform_code ) {
-      if ( ! im->t_is_set || ! im->q_is_set || ! im->qfac_is_set ) {
-        _nifti_mat44_to_quatern( im );
-        im->t_is_set = im->q_is_set = im->qfac_is_set = 1;
-      }
-    }
-    else {
-      if ( im->t_is_set || im->q_is_set || im->qfac_is_set ) {
-        _nifti_quatern_to_mat44( im );
-        im->qform_code = 1;
-      }
-    }
-  }
+  if ( im != NULL ) _setImageGeometry( im );
 
 
   /* read data
@@ -1474,6 +2139,15 @@ _image* _readImage(const char *name) {
     ImageIO_close(im);
   }
 
+  /* the mapped data remain valid once the segment is removed
+   */
+  if ( im != NULL && _ImageIO_shm_unlink_ && _isSharedMemoryName( name ) ) {
+    if ( _removeSharedMemory( name ) != 1 ) {
+      if ( _ImageIO_verbose_ )
+        fprintf( stderr, "_readImage: unable to remove shared memory '%s'\n", name );
+    }
+  }
+
   _set_LC_NUMERIC_LOCALE_back();
 
   return im;
@@ -1481,6 +2155,236 @@ _image* _readImage(const char *name) {
 
 
 
+/* the geometry of a region is the one of the image
+   translated by its first voxel (the geometry has been set,
+   see _setImageGeometry())
+ */
+static void _translateImageGeometry( _image *im, size_t *first )
+{
+  int i;
+
+  if ( first[0] == 0 && first[1] == 0 && first[2] == 0 ) return;
+
+  if ( im->qform_code ) {
+    for ( i=0; i<3; i++ )
+      im->qform_toreal[i][3] += im->qform_toreal[i][0] * (double)first[0]
+        + im->qform_toreal[i][1] * (double)first[1]
+        + im->qform_toreal[i][2] * (double)first[2];
+    im->tx = im->qform_toreal[0][3];
+    im->ty = im->qform_toreal[1][3];
+    im->tz = im->qform_toreal[2][3];
+  }
+  else {
+    im->tx = (double)first[0] * im->vx;
+    im->ty = (double)first[1] * im->vy;
+    im->tz = (double)first[2] * im->vz;
+    im->t_is_set = 1;
+    _setImageGeometry( im );
+  }
+
+  if ( im->sform_code ) {
+    for ( i=0; i<3; i++ )
+      im->sform_toreal[i][3] += im->sform_toreal[i][0] * (double)first[0]
+        + im->sform_toreal[i][1] * (double)first[1]
+        + im->sform_toreal[i][2] * (double)first[2];
+  }
+}
+
+
+
+/* extraction of a region from the whole data
+ */
+static int _extractImageRegion( _image *im, size_t *first, size_t *dim )
+{
+  char *proc = "_extractImageRegion";
+  size_t voxelsize, rowsize, nv, v, y, z;
+  unsigned char *data, *row, *buf;
+
+  if ( _isImageRegionValid( im, first, dim ) != 1 ) {
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: region %lu x %lu x %lu at (%lu,%lu,%lu) is not in image %lu x %lu x %lu\n",
+               proc, dim[0], dim[1], dim[2], first[0], first[1], first[2], im->xdim, im->ydim, im->zdim );
+    return( -1 );
+  }
+
+  /* non interlaced vectors are vdim scalar images
+   */
+  if ( im->vectMode == VM_NON_INTERLACED ) {
+    nv = im->vdim;
+    voxelsize = im->wdim;
+  }
+  else {
+    nv = 1;
+    voxelsize = (size_t)im->vdim * (size_t)im->wdim;
+  }
+  rowsize = dim[0] * voxelsize;
+
+  data = (unsigned char*)ImageIO_alloc( dim[0] * dim[1] * dim[2] * nv * voxelsize );
+  if ( data == NULL ) {
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: image buffer allocation failed\n", proc );
+    return( -1 );
+  }
+
+  for ( row=data, v=0; v<nv; v++ )
+  for ( z=0; z<dim[2]; z++ )
+  for ( y=0; y<dim[1]; y++, row+=rowsize ) {
+    buf = (unsigned char*)im->data
+      + ( ((v * im->zdim + first[2]+z) * im->ydim + first[1]+y) * im->xdim + first[0] ) * voxelsize;
+    (void)memcpy( row, buf, rowsize );
+  }
+
+  _freeImageData( im );
+  im->xdim = dim[0];
+  im->ydim = dim[1];
+  im->zdim = dim[2];
+  im->data = data;
+  return( 1 );
+}
+
+
+
+/* Reads a region of an image file.
+   - formats with a region reader read it
+   - the data of formats read by _readImageData() (raw data
+     following the header) are read with _readImageRegionData()
+   - else the whole image is read and the region is extracted
+ */
+_image* _readImageRegion( const char *name, size_t *first, size_t *dim )
+{
+  char *proc = "_readImageRegion";
+  PTRIMAGE_FORMAT f;
+  _image *im = NULL;
+  char *dataName;
+  long offset = -1;
+  int res;
+
+  if ( name == NULL || name[0] == '\0'
+       || (name[0] == '-' && name[1] == '\0')
+       || (name[0] == '<' && name[1] == '\0') ) {
+    if ( _ImageIO_verbose_ )
+      fprintf( stderr, "%s: can not read a region from standard input\n", proc );
+    return( NULL );
+  }
+
+  _set_LC_NUMERIC_LOCALE_to_C();
+
+  /* formats with a dedicated region reader
+   */
+  initSupportedFileFormat();
+  f = _getImageFormatFromName( name );
+  if ( f != NULL && f->readImageRegion != NULL ) {
+    im = _initImage();
+    if ( im == NULL ) {
+      _set_LC_NUMERIC_LOCALE_back();
+      return( NULL );
+    }
+    im->imageFormat = f;
+    res = (*f->readImageRegion)( name, im, first, dim );
+    if ( res < 0 ) {
+      if ( _ImageIO_verbose_ || _ImageIO_debug_ )
+        fprintf( stderr, "%s: unable to read region of '%s' using format '%s'\n",
+                 proc, name, f->realName );
+      _freeImage( im );
+      _set_LC_NUMERIC_LOCALE_back();
+      return( NULL );
+    }
+    if ( res == 0 ) {
+      _freeImage( im );
+      im = NULL;
+    }
+  }
+
+  if ( im == NULL ) {
+
+    im = _readImageHeader( name );
+    if ( im == NULL ) {
+      if ( _ImageIO_verbose_ || _ImageIO_debug_ )
+        fprintf( stderr, "%s: unable to read header of '%s'\n", proc, name );
+      _set_LC_NUMERIC_LOCALE_back();
+      return( NULL );
+    }
+
+    /* header only
+     */
+    if ( first == NULL || dim == NULL ) {
+      ImageIO_close( im );
+      _freeImageData( im );
+    }
+
+    /* raw data following the header
+     * (shared memory data are mapped, then extracted)
+     */
+    else if ( im->openMode != OM_CLOSE
+              && !_isSharedMemoryName( im->openedFileName )
+              && im->imageFormat->readImageData == &_readImageData
+              && im->openedFileName != NULL
+              && im->dataMode == DM_BINARY
+              && im->vectMode != VM_NON_INTERLACED ) {
+      switch ( im->openMode ) {
+      default :
+        break;
+#ifdef ZLIB
+      case OM_GZ :
+        offset = (long)gztell( im->fd );
+        break;
+#endif
+      case OM_FILE :
+        offset = ftell( (FILE*)im->fd );
+        break;
+      }
+      dataName = strdup( im->openedFileName );
+      ImageIO_close( im );
+      if ( offset < 0 || dataName == NULL
+           || _readImageRegionData( im, dataName, (size_t)offset, first, dim ) != 1 ) {
+        if ( _ImageIO_verbose_ || _ImageIO_debug_ )
+          fprintf( stderr, "%s: unable to read region of '%s'\n", proc, name );
+        if ( dataName != NULL ) free( dataName );
+        _freeImage( im );
+        _set_LC_NUMERIC_LOCALE_back();
+        return( NULL );
+      }
+      free( dataName );
+    }
+
+    /* whole data
+     */
+    else {
+      if ( im->openMode != OM_CLOSE ) {
+        if ( im->imageFormat->readImageData
+             && (*(im->imageFormat)->readImageData)(im) < 0 ) {
+          if ( _ImageIO_verbose_ || _ImageIO_debug_ )
+            fprintf(stderr, "%s: error: invalid data encountered in \'%s\'\n",
+                    proc, name);
+          _freeImage( im );
+          _set_LC_NUMERIC_LOCALE_back();
+          return( NULL );
+        }
+        ImageIO_close( im );
+      }
+      if ( _extractImageRegion( im, first, dim ) != 1 ) {
+        if ( _ImageIO_verbose_ || _ImageIO_debug_ )
+          fprintf( stderr, "%s: unable to extract region of '%s'\n", proc, name );
+        _freeImage( im );
+        _set_LC_NUMERIC_LOCALE_back();
+        return( NULL );
+      }
+    }
+  }
+
+  /* set geometry
+   */
+  _setImageGeometry( im );
+  if ( first != NULL && dim != NULL )
+    _translateImageGeometry( im, first );
+
+  _set_LC_NUMERIC_LOCALE_back();
+
+  return( im );
+}
+
+
+
 /*--------------------------------------------------
  *
  * image writing procedures
@@ -1548,6 +2452,14 @@ int _writeImage(_image *im, char *name_to_be_written )
 
   if ( im == NULL ) return -1;
 
+  /* the file to be written may be the mapped one
+   */
+  if ( _unmapImageData( im ) != 1 ) {
+    if ( _ImageIO_verbose_ || _ImageIO_debug_ )
+      fprintf( stderr, "%s: unable to unmap data\n", proc );
+    return( ImageIO_WRITING_DATA );
+  }
+
   _set_LC_NUMERIC_LOCALE_to_C();
 
   /* set geometry
@@ -93,6 +93,30 @@ typedef int (*READ_IMAGE_DATA)(struct point_image *);
 typedef int (*WRITE_IMAGE_HEADER)(char *,struct point_image *);
 typedef int (*WRITE_IMAGE)(char *,struct point_image *);
 
+/** defines the type of functions called to read/write a pyramid
+    level, i.e. a downsampled copy of the image stored in the image
+    file itself. The first parameter is the file name, the second one
+    an _image structure (see _readImagePyramidLevel()), the third one
+    the sigma of the gaussian filtering (in voxels of the full
+    resolution image) applied before downsampling, the fourth one
+    describes how the level was computed (see _readImagePyramidLevel()).
+    The output value is 1 in case of success, 0 if no such level
+    is available (reading only) and <0 otherwise */
+typedef int (*READ_PYRAMID_LEVEL)(const char *,struct point_image *,float *,int *);
+typedef int (*WRITE_PYRAMID_LEVEL)(const char *,struct point_image *,float *,int *);
+
+/** defines the type of function called to read a region of an
+    image (see _readImageRegion()) without reading the whole data.
+    The first parameter is the file name, the second one an _image
+    structure, the third and fourth ones the first voxel and the
+    dimensions of the region (if they are NULL, only the header is
+    read). The _image structure is filled with the header of the whole
+    image and the data of the region: its dimensions are the ones
+    of the region.
+    The output value is 1 in case of success, 0 if the region can not
+    be read this way (then the whole image is read) and <0 otherwise */
+typedef int (*READ_IMAGE_REGION)(const char *,struct point_image *,size_t *,size_t *);
+
 
 
 /** Image Format descriptor */
@@ -110,6 +134,15 @@ typedef struct imformat {
   WRITE_IMAGE_HEADER writeImageHeader;
   WRITE_IMAGE writeImage;
 
+  /** pointers on functions that read/write pyramid levels stored
+      in the image file, NULL if the format can not store them */
+  READ_PYRAMID_LEVEL readPyramidLevel;
+  WRITE_PYRAMID_LEVEL writePyramidLevel;
+
+  /** a pointer on a function that reads a region of the image,
+      NULL if the format has no dedicated reader */
+  READ_IMAGE_REGION readImageRegion;
+
   /* the file extension of format (including a dot ".": if several
      extensions may be used, they should be separed with a
      comma ".inr,.inr.gz" */
@@ -171,6 +204,8 @@ typedef enum OPEN_MODE {
   /** file is gzipped */
 #ifdef ZLIB
   OM_GZ,
+  /** file is written as BGZF (blocked gzip, see bgzf.h) */
+  OM_BGZ,
 #endif
   /** normal file */
   OM_FILE
@@ -301,6 +336,14 @@ typedef struct point_image {
 
   /** Image file descriptor */
   _ImageIO_file fd;
+  /** Name of the file opened for reading (see _openReadImage()) */
+  char *openedFileName;
+
+  /** Memory mapping of the file containing the data (see _mapImageData()).
+      If not NULL, data points into it and the mapping is released
+      by _freeImage() */
+  void *mapAddress;
+  size_t mapLength;
 
 
   /** Kind of image file descriptor */
@@ -320,6 +363,7 @@ _image *_initImage();
 
 /* desallocates the _image structure
  * except for the data
+ * (mapped data have to be unmapped before, see _unmapImageData())
  */
 extern void _freeImageStructure( _image *im );
 
@@ -330,6 +374,161 @@ void _freeImage(_image *im);
 void _swapImageData( _image *im );
 
 
+
+/*--------------------------------------------------
+ *
+ * memory mapping of data
+ *
+ --------------------------------------------------*/
+
+/** enable (m != 0) or disable (default) memory mapping of data.
+    When enabled, the data of uncompressed files (INR, Analyze,
+    NIfTI, MetaImage, ...) are not read but mapped (private
+    copy-on-write mapping): no buffer is allocated, pages
+    are read on demand and shared with other processes through
+    the page cache. Mapped files must not be truncated
+    (e.g. re-written) while the image is in use.
+ */
+extern void _SetMemoryMappingInImageIO( int m );
+extern int _GetMemoryMappingInImageIO( );
+
+/** maps the 'xdim*ydim*zdim*vdim*wdim' bytes located at 'offset' in the
+    file 'name' into im->data (im->data has to be NULL), the data
+    are swapped (if required) after the mapping.
+    return 1 if the data have been mapped, 0 if they can not be
+    (mapping disabled, compressed or too small file, misaligned
+    data, ...), then they have to be read.
+ */
+extern int _mapImageData( _image *im, const char *name, size_t offset );
+
+/** if the data are mapped, replace them by an allocated copy
+    (the copy is then owned by the caller when the descriptor
+    is freed by _freeImageStructure()).
+    return 1 in case of success, -1 else
+ */
+extern int _unmapImageData( _image *im );
+
+
+
+/*--------------------------------------------------
+ *
+ * shared memory images
+ *
+ --------------------------------------------------*/
+
+/** enable (u != 0) or disable (default) the removal of shared
+    memory images ('shm://name', see shm.h) once they have been
+    read by _readImage(). The data remain mapped (and valid) until
+    the image is freed, the memory is given back to the system
+    afterwards. Else segments persist until they are removed
+    (with _removeSharedMemory() or by deleting /dev/shm/name).
+ */
+extern void _SetSharedMemoryUnlinkInImageIO( int u );
+extern int _GetSharedMemoryUnlinkInImageIO( );
+
+
+
+/*--------------------------------------------------
+ *
+ * parallel reading and writing
+ *
+ --------------------------------------------------*/
+
+/** maximal number of threads used to read (TIFF pages, BGZF
+    members) or to write (BGZF members) data in parallel.
+    n <= 0 (default) means no other limit than the OpenMP one,
+    n = 1 means sequential reading and writing.
+ */
+extern void _SetMaxThreadsInImageIO( int n );
+extern int _GetMaxThreadsInImageIO( );
+
+/** number of threads to be used for 'n' independent tasks
+    (n <= 0 means an unknown number of tasks)
+ */
+extern int _GetNumberOfThreadsInImageIO( int n );
+
+
+
+/*--------------------------------------------------
+ *
+ * BGZF (blocked gzip) files
+ *
+ --------------------------------------------------*/
+
+/** enable (b != 0) or disable (default) the writing of gzipped
+    files (.gz) as BGZF files (see bgzf.h), i.e. as a series of
+    gzip members compressed in parallel. Such files remain
+    readable by gzip.
+ */
+extern void _SetBgzfWritingInImageIO( int b );
+extern int _GetBgzfWritingInImageIO( );
+
+/** if 'name' is a BGZF file, uncompresses (in parallel) the
+    'xdim*ydim*zdim*vdim*wdim' bytes located at 'offset' (in the
+    uncompressed data) into im->data (that is allocated if NULL),
+    the data are swapped (if required).
+    return 1 if the data have been read, 0 if 'name' is not a
+    BGZF file (then the data have to be read), -1 in case of error.
+    BGZF files are read this way independently of
+    _SetBgzfWritingInImageIO().
+ */
+extern int _readBgzfImageData( _image *im, const char *name, size_t offset );
+
+
+
+/*--------------------------------------------------
+ *
+ * image region reading
+ *
+ --------------------------------------------------*/
+
+/** 'im' describes the whole image (xdim, ydim, zdim, vdim, wdim,
+    endianness) whose scalar or interlaced data are located at
+    'offset' (in the uncompressed data) in the file 'name'.
+    Reads only the data of the dim[0] x dim[1] x dim[2] region whose
+    first voxel is (first[0], first[1], first[2]) into im->data (that
+    is allocated), the data are swapped (if required) and the
+    dimensions of 'im' become the ones of the region.
+    Uncompressed files are read row by row, BGZF files are read plane
+    by plane, other gzipped files are uncompressed up to the last row
+    of the region.
+    return 1 in case of success, -1 else.
+ */
+extern int _readImageRegionData( _image *im, const char *name, size_t offset,
+                                 size_t *first, size_t *dim );
+
+
+
+/*--------------------------------------------------
+ *
+ * pyramid levels stored in image files
+ *
+ --------------------------------------------------*/
+
+/** some formats (KLB) can store downsampled copies of the
+    image (pyramid levels) after the full resolution data.
+    'im' describes the expected level (xdim, ydim, zdim, vdim,
+    wdim, wordKind, sign) and im->data has to be allocated: the
+    level stored in 'name' with the same dimensions and type, and
+    whose gaussian filtering was 'sigma' (in voxels of the full
+    resolution image, NULL means no filtering) is read into im->data.
+    'info' describes how the level was computed (info[0] is the type
+    of gaussian filter, info[1] the normalization of the input image,
+    they are not interpreted by libio), the stored level is read only
+    if it was written with the same values (the filter type is only
+    compared for filtered levels).
+    return 1 if such a level has been read, 0 if there is none
+    (then it has to be computed), -1 in case of error.
+ */
+extern int _readImagePyramidLevel( const char *name, _image *im, float *sigma, int *info );
+
+/** appends 'im' as a pyramid level to the (already written)
+    image file 'name'. return 1 in case of success, 0 if the format
+    of 'name' can not store pyramid levels, -1 in case of error.
+ */
+extern int _writeImagePyramidLevel( const char *name, _image *im, float *sigma, int *info );
+
+
 /*--------------------------------------------------
  *
  * mimics standard routines
@@ -477,6 +676,26 @@ int _readImageData(_image *im);
    @param name image file name or NULL for stdin */
 _image* _readImage(const char *name);
 
+/** Reads the dim[0] x dim[1] x dim[2] region of an image file whose
+    first voxel is (first[0], first[1], first[2]), all the vectorial
+    components are read. Returns an image descriptor whose dimensions
+    are the ones of the region and whose geometry is the one of the
+    region (ie the one of the whole image translated by 'first'),
+    or NULL if reading failed.
+    Only the data of the region are read for KLB files, Zarr/N5
+    directories (only the chunks intersecting the region), and for
+    uncompressed or gzipped inrimage and nifti files (see
+    _readImageRegionData()). Other files are read entirely and the
+    region is extracted.
+    If 'first' or 'dim' is NULL, only the header is read (the data
+    are not read, even for formats whose header reader reads them)
+    and the data field is NULL.
+
+   @param name image file name (stdin is not allowed)
+   @param first first voxel of the region
+   @param dim dimensions of the region */
+_image* _readImageRegion( const char *name, size_t *first, size_t *dim );
+
 
 
 /*--------------------------------------------------
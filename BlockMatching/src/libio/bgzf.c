@@ -0,0 +1,504 @@
+/*************************************************************************
+ * bgzf.c -
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026, all rights reserved
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <zlib.h>
+
+#include <ImageIO.h>
+#include <bgzf.h>
+
+
+static int _verbose_ = 1;
+
+
+
+/* maximal size of a member */
+#define BGZF_BLOCK_SIZE 0x10000
+/* maximal size of the uncompressed data of a member */
+#define BGZF_DATA_SIZE 0xff00
+/* size of the member header and trailer */
+#define BGZF_HEADER_SIZE 18
+#define BGZF_TRAILER_SIZE 8
+/* number of members compressed in parallel */
+#define BGZF_BATCH 64
+
+/* empty member ending a BGZF file */
+static unsigned char _bgzf_eof_[28] = {
+  0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0xff, 0x06, 0x00, 0x42, 0x43, 0x02, 0x00,
+  0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00
+};
+
+
+
+
+
+/************************************************************
+ *
+ * writing
+ *
+ ************************************************************/
+
+
+
+struct bgzfFile {
+  FILE *f;
+  int level;
+  /* pending uncompressed data */
+  unsigned char *buffer;
+  size_t length;
+  /* compressed members */
+  unsigned char *output;
+  size_t outputLength[BGZF_BATCH];
+};
+
+
+
+static void _writeLittleEndian( unsigned char *p, unsigned long v, int n )
+{
+  int i;
+  for ( i=0; i<n; i++, v >>= 8 ) p[i] = (unsigned char)(v & 0xff);
+}
+
+
+
+/* compresses 'len' (<= BGZF_DATA_SIZE) bytes into one member,
+   returns the member size, 0 in case of error
+ */
+static size_t _compressMember( unsigned char *dst, const unsigned char *src,
+                               size_t len, int level )
+{
+  z_stream zs;
+  int ret;
+
+  for ( ;; ) {
+    (void)memset( &zs, 0, sizeof(z_stream) );
+    if ( deflateInit2( &zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+      return( 0 );
+    zs.next_in = (Bytef*)src;
+    zs.avail_in = (uInt)len;
+    zs.next_out = dst + BGZF_HEADER_SIZE;
+    zs.avail_out = BGZF_BLOCK_SIZE - BGZF_HEADER_SIZE - BGZF_TRAILER_SIZE;
+    ret = deflate( &zs, Z_FINISH );
+    (void)deflateEnd( &zs );
+    if ( ret == Z_STREAM_END ) break;
+    /* incompressible data: stored blocks always fit
+     */
+    if ( level == 0 ) return( 0 );
+    level = 0;
+  }
+
+  dst[0] = 0x1f;   dst[1] = 0x8b;
+  dst[2] = 0x08;   dst[3] = 0x04;
+  _writeLittleEndian( dst+4, 0, 4 );
+  dst[8] = 0x00;   dst[9] = 0xff;
+  _writeLittleEndian( dst+10, 6, 2 );
+  dst[12] = 'B';   dst[13] = 'C';
+  _writeLittleEndian( dst+14, 2, 2 );
+  _writeLittleEndian( dst+16, BGZF_HEADER_SIZE + zs.total_out + BGZF_TRAILER_SIZE - 1, 2 );
+  _writeLittleEndian( dst + BGZF_HEADER_SIZE + zs.total_out,
+                      crc32( crc32( 0L, Z_NULL, 0 ), src, (uInt)len ), 4 );
+  _writeLittleEndian( dst + BGZF_HEADER_SIZE + zs.total_out + 4, len, 4 );
+
+  return( BGZF_HEADER_SIZE + zs.total_out + BGZF_TRAILER_SIZE );
+}
+
+
+
+/* compresses (in parallel) and writes at most BGZF_BATCH members
+ */
+static int _writeMembers( bgzfFile *f, const unsigned char *buf, size_t len )
+{
+  char *proc = "_writeMembers";
+  int n = (int)((len + BGZF_DATA_SIZE - 1) / BGZF_DATA_SIZE);
+  int i, error = 0;
+  int nthreads = _GetNumberOfThreadsInImageIO( n );
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( nthreads ) reduction( | : error )
+#endif
+  for ( i=0; i<n; i++ ) {
+    size_t l = len - (size_t)i * BGZF_DATA_SIZE;
+    if ( l > BGZF_DATA_SIZE ) l = BGZF_DATA_SIZE;
+    f->outputLength[i] = _compressMember( f->output + (size_t)i * BGZF_BLOCK_SIZE,
+                                          buf + (size_t)i * BGZF_DATA_SIZE, l, f->level );
+    if ( f->outputLength[i] == 0 ) error = 1;
+  }
+
+  if ( error ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: compression failed\n", proc );
+    return( -1 );
+  }
+
+  for ( i=0; i<n; i++ ) {
+    if ( fwrite( f->output + (size_t)i * BGZF_BLOCK_SIZE, 1, f->outputLength[i], f->f )
+         != f->outputLength[i] ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to write compressed data\n", proc );
+      return( -1 );
+    }
+  }
+  return( 1 );
+}
+
+
+
+bgzfFile *bgzfOpenWrite( const char *name, int level )
+{
+  char *proc = "bgzfOpenWrite";
+  bgzfFile *f;
+
+  f = (bgzfFile*)malloc( sizeof(bgzfFile) );
+  if ( f == (bgzfFile*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( (bgzfFile*)NULL );
+  }
+  f->level = ( level < 0 ) ? Z_DEFAULT_COMPRESSION : level;
+  f->length = 0;
+
+  f->buffer = (unsigned char*)malloc( (size_t)BGZF_BATCH * BGZF_DATA_SIZE );
+  f->output = (unsigned char*)malloc( (size_t)BGZF_BATCH * BGZF_BLOCK_SIZE );
+  if ( f->buffer == (unsigned char*)NULL || f->output == (unsigned char*)NULL ) {
+    if ( f->buffer != (unsigned char*)NULL ) free( f->buffer );
+    if ( f->output != (unsigned char*)NULL ) free( f->output );
+    free( f );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( (bgzfFile*)NULL );
+  }
+
+  f->f = fopen( name, "wb" );
+  if ( f->f == (FILE*)NULL ) {
+    free( f->buffer );
+    free( f->output );
+    free( f );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to open '%s'\n", proc, name );
+    return( (bgzfFile*)NULL );
+  }
+
+  return( f );
+}
+
+
+
+size_t bgzfWrite( bgzfFile *f, const void *buf, size_t len )
+{
+  const unsigned char *b = (const unsigned char*)buf;
+  size_t batch = (size_t)BGZF_BATCH * BGZF_DATA_SIZE;
+  size_t l, written = 0;
+
+  if ( f == (bgzfFile*)NULL ) return( 0 );
+
+  while ( written < len ) {
+    /* large writes are compressed from the given buffer
+     */
+    if ( f->length == 0 && len - written >= batch ) {
+      if ( _writeMembers( f, b + written, batch ) != 1 ) return( written );
+      written += batch;
+      continue;
+    }
+    l = batch - f->length;
+    if ( l > len - written ) l = len - written;
+    (void)memcpy( f->buffer + f->length, b + written, l );
+    f->length += l;
+    written += l;
+    if ( f->length == batch ) {
+      if ( _writeMembers( f, f->buffer, batch ) != 1 ) return( written - l );
+      f->length = 0;
+    }
+  }
+
+  return( written );
+}
+
+
+
+int bgzfClose( bgzfFile *f )
+{
+  char *proc = "bgzfClose";
+  int ret = 0;
+
+  if ( f == (bgzfFile*)NULL ) return( -1 );
+
+  if ( f->length > 0 ) {
+    if ( _writeMembers( f, f->buffer, f->length ) != 1 ) ret = -1;
+  }
+  if ( fwrite( _bgzf_eof_, 1, 28, f->f ) != 28 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to write end-of-file marker\n", proc );
+    ret = -1;
+  }
+  if ( fclose( f->f ) != 0 ) ret = -1;
+
+  free( f->buffer );
+  free( f->output );
+  free( f );
+  return( ret );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * reading
+ *
+ ************************************************************/
+
+
+
+void bgzfInitIndex( bgzfIndex *index )
+{
+  index->map = (unsigned char*)NULL;
+  index->mapLength = 0;
+  index->n = 0;
+  index->coffset = (size_t*)NULL;
+  index->uoffset = (size_t*)NULL;
+}
+
+
+
+void bgzfFreeIndex( bgzfIndex *index )
+{
+  if ( index->map != (unsigned char*)NULL )
+    (void)munmap( index->map, index->mapLength );
+  if ( index->coffset != (size_t*)NULL ) free( index->coffset );
+  if ( index->uoffset != (size_t*)NULL ) free( index->uoffset );
+  bgzfInitIndex( index );
+}
+
+
+
+static unsigned long _readLittleEndian( const unsigned char *p, int n )
+{
+  unsigned long v = 0;
+  int i;
+  for ( i=n-1; i>=0; i-- ) v = (v << 8) | p[i];
+  return( v );
+}
+
+
+
+/* size of the member at 'p' (at most 'len' bytes are available),
+   0 if it is not a BGZF member
+ */
+static size_t _memberSize( const unsigned char *p, size_t len, size_t *headerSize )
+{
+  size_t xlen, i, slen;
+
+  if ( len < BGZF_HEADER_SIZE + BGZF_TRAILER_SIZE ) return( 0 );
+  if ( p[0] != 0x1f || p[1] != 0x8b || p[2] != 0x08 || (p[3] & 0x04) == 0 ) return( 0 );
+  xlen = _readLittleEndian( p+10, 2 );
+  if ( 12 + xlen > len ) return( 0 );
+
+  for ( i=12; i+4 <= 12+xlen; i+=4+slen ) {
+    slen = _readLittleEndian( p+i+2, 2 );
+    if ( p[i] == 'B' && p[i+1] == 'C' && slen == 2 ) {
+      *headerSize = 12 + xlen;
+      slen = _readLittleEndian( p+i+4, 2 ) + 1;
+      if ( slen > len || slen < 12 + xlen + BGZF_TRAILER_SIZE ) return( 0 );
+      return( slen );
+    }
+  }
+  return( 0 );
+}
+
+
+
+int bgzfBuildIndex( bgzfIndex *index, const char *name )
+{
+  char *proc = "bgzfBuildIndex";
+  struct stat st;
+  size_t pos, size, hsize, u = 0;
+  int fd, nalloc = 0;
+  void *addr;
+  size_t *tmp;
+
+  bgzfInitIndex( index );
+
+  fd = open( name, O_RDONLY );
+  if ( fd < 0 ) return( 0 );
+  if ( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) || st.st_size < 28 ) {
+    close( fd );
+    return( 0 );
+  }
+
+  addr = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+  close( fd );
+  if ( addr == MAP_FAILED ) return( 0 );
+  index->map = (unsigned char*)addr;
+  index->mapLength = (size_t)st.st_size;
+
+  /* quick test on the first member
+   */
+  if ( _memberSize( index->map, index->mapLength, &hsize ) == 0 ) {
+    bgzfFreeIndex( index );
+    return( 0 );
+  }
+
+  for ( pos=0; pos<index->mapLength; pos+=size ) {
+    size = _memberSize( index->map+pos, index->mapLength-pos, &hsize );
+    if ( size == 0 ) {
+      bgzfFreeIndex( index );
+      return( 0 );
+    }
+    if ( index->n+1 >= nalloc ) {
+      nalloc += 4096;
+      tmp = (size_t*)realloc( index->coffset, nalloc * sizeof(size_t) );
+      if ( tmp == (size_t*)NULL ) {
+        bgzfFreeIndex( index );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: allocation failed\n", proc );
+        return( -1 );
+      }
+      index->coffset = tmp;
+      tmp = (size_t*)realloc( index->uoffset, nalloc * sizeof(size_t) );
+      if ( tmp == (size_t*)NULL ) {
+        bgzfFreeIndex( index );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: allocation failed\n", proc );
+        return( -1 );
+      }
+      index->uoffset = tmp;
+    }
+    index->coffset[index->n] = pos;
+    index->uoffset[index->n] = u;
+    u += _readLittleEndian( index->map+pos+size-4, 4 );
+    index->n ++;
+  }
+  index->uoffset[index->n] = u;
+
+  return( 1 );
+}
+
+
+
+/* uncompresses member #i into 'dst'
+ */
+static int _uncompressMember( bgzfIndex *index, int i, unsigned char *dst )
+{
+  unsigned char *p = index->map + index->coffset[i];
+  size_t len = index->uoffset[i+1] - index->uoffset[i];
+  size_t size, hsize;
+  z_stream zs;
+  int ret;
+
+  size = _memberSize( p, index->mapLength - index->coffset[i], &hsize );
+  if ( size == 0 ) return( -1 );
+  if ( len == 0 ) return( 1 );
+
+  (void)memset( &zs, 0, sizeof(z_stream) );
+  if ( inflateInit2( &zs, -15 ) != Z_OK ) return( -1 );
+  zs.next_in = p + hsize;
+  zs.avail_in = (uInt)(size - hsize - BGZF_TRAILER_SIZE);
+  zs.next_out = dst;
+  zs.avail_out = (uInt)len;
+  ret = inflate( &zs, Z_FINISH );
+  (void)inflateEnd( &zs );
+  if ( ret != Z_STREAM_END || zs.total_out != len ) return( -1 );
+  return( 1 );
+}
+
+
+
+int bgzfRead( bgzfIndex *index, size_t offset, void *buf, size_t len )
+{
+  char *proc = "bgzfRead";
+  unsigned char *b = (unsigned char*)buf;
+  int first, last, i, j, k, error = 0;
+  int nthreads;
+
+  if ( len == 0 ) return( 1 );
+  if ( index->n == 0 || offset + len > index->uoffset[index->n] ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: data out of the file\n", proc );
+    return( -1 );
+  }
+
+  /* first member containing offset,
+     last member containing offset+len-1
+  */
+  for ( i=0, j=index->n-1; i<j; ) {
+    k = (i+j+1)/2;
+    if ( index->uoffset[k] <= offset ) i = k;
+    else j = k-1;
+  }
+  first = i;
+  for ( j=index->n-1; i<j; ) {
+    k = (i+j+1)/2;
+    if ( index->uoffset[k] <= offset+len-1 ) i = k;
+    else j = k-1;
+  }
+  last = i;
+
+  nthreads = _GetNumberOfThreadsInImageIO( last-first+1 );
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,16) num_threads( nthreads ) reduction( | : error )
+#endif
+  for ( i=first; i<=last; i++ ) {
+    size_t ustart = index->uoffset[i];
+    size_t uend = index->uoffset[i+1];
+    unsigned char *tmp;
+
+    if ( uend == ustart ) continue;
+    if ( ustart >= offset && uend <= offset+len ) {
+      if ( _uncompressMember( index, i, b + (ustart-offset) ) != 1 ) error = 1;
+      continue;
+    }
+    /* member partially in the range
+     */
+    tmp = (unsigned char*)malloc( uend - ustart );
+    if ( tmp == (unsigned char*)NULL ) {
+      error = 1;
+      continue;
+    }
+    if ( _uncompressMember( index, i, tmp ) != 1 ) {
+      error = 1;
+    }
+    else {
+      size_t s = ( ustart > offset ) ? ustart : offset;
+      size_t e = ( uend < offset+len ) ? uend : offset+len;
+      (void)memcpy( b + (s-offset), tmp + (s-ustart), e-s );
+    }
+    free( tmp );
+  }
+
+  if ( error ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to uncompress data\n", proc );
+    return( -1 );
+  }
+  return( 1 );
+}
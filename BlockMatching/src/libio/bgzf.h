@@ -0,0 +1,83 @@
+
+#ifndef BGZF_H
+#define BGZF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+
+
+
+/* BGZF (blocked gzip) files, as specified for BAM files
+   (see the SAM/BAM format specification)
+
+   a BGZF file is a series of gzip members (it is then a valid
+   gzip file) whose uncompressed size is at most 0xff00 bytes, and
+   whose header contains the size of the compressed member (in an
+   extra subfield 'BC'). The members, being independent, are
+   compressed and uncompressed in parallel (with OpenMP), and the
+   member sizes make an index that allows to uncompress only the
+   members containing a given range of data.
+*/
+
+
+
+/* writing
+ */
+
+typedef struct bgzfFile bgzfFile;
+
+/* level is the zlib compression level
+   (Z_DEFAULT_COMPRESSION if < 0)
+ */
+extern bgzfFile *bgzfOpenWrite( const char *name, int level );
+
+/* returns the number of written bytes
+ */
+extern size_t bgzfWrite( bgzfFile *f, const void *buf, size_t len );
+
+/* writes the pending data and the end-of-file marker,
+   returns 0 in case of success
+ */
+extern int bgzfClose( bgzfFile *f );
+
+
+
+/* reading
+ */
+
+typedef struct bgzfIndex {
+  /* mapped compressed file */
+  unsigned char *map;
+  size_t mapLength;
+  /* number of members */
+  int n;
+  /* offset of the members in the compressed file */
+  size_t *coffset;
+  /* offset of the members in the uncompressed data,
+     uoffset[n] is the uncompressed length */
+  size_t *uoffset;
+} bgzfIndex;
+
+extern void bgzfInitIndex( bgzfIndex *index );
+
+/* returns 1 if 'name' is a BGZF file (the index is then built),
+   0 if not, -1 in case of error
+ */
+extern int bgzfBuildIndex( bgzfIndex *index, const char *name );
+
+/* uncompresses the 'len' bytes at 'offset' (in the uncompressed data)
+   into 'buf'. Only the members containing the data are uncompressed.
+   returns 1 in case of success, -1 else
+ */
+extern int bgzfRead( bgzfIndex *index, size_t offset, void *buf, size_t len );
+
+extern void bgzfFreeIndex( bgzfIndex *index );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1505 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+char *strdup(const char *s);
+#include <ctype.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <zlib.h>
+
+#include <chunked.h>
+
+
+static int _verbose_ = 1;
+
+
+
+
+
+/************************************************************
+ *
+ * writing parameters
+ *
+ ************************************************************/
+
+
+
+static int _chunk_size_[3] = { 64, 64, 64 };
+static int _chunk_compression_ = 1;
+
+void _SetChunkSizeInImageIO( int x, int y, int z )
+{
+  if ( x > 0 ) _chunk_size_[0] = x;
+  if ( y > 0 ) _chunk_size_[1] = y;
+  if ( z > 0 ) _chunk_size_[2] = z;
+}
+
+void _GetChunkSizeInImageIO( int *x, int *y, int *z )
+{
+  *x = _chunk_size_[0];
+  *y = _chunk_size_[1];
+  *z = _chunk_size_[2];
+}
+
+void _SetChunkCompressionInImageIO( int level )
+{
+  _chunk_compression_ = ( level < 0 ) ? 0 : ( ( level > 9 ) ? 9 : level );
+}
+
+int _GetChunkCompressionInImageIO( )
+{
+  return( _chunk_compression_ );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * header
+ *
+ ************************************************************/
+
+
+
+typedef enum _chunkedLayout {
+  CHUNKED_ZARR,
+  CHUNKED_N5
+} _chunkedLayout;
+
+typedef enum _chunkedCodec {
+  CHUNKED_RAW,
+  CHUNKED_ZLIB,
+  CHUNKED_GZIP
+} _chunkedCodec;
+
+/* dimensions are in x, y, z order (the reverse of the Zarr one)
+ */
+typedef struct _chunkedHeader {
+  _chunkedLayout layout;
+  _chunkedCodec codec;
+  int level;
+  int ndim;
+  size_t dim[3];
+  size_t chunk[3];
+  unsigned int wdim;
+  WORD_KIND wordKind;
+  SIGN sign;
+  /* byte order of the chunks */
+  ENDIANNESS endianness;
+  /* Zarr chunk name separator */
+  char separator;
+  double fill;
+  double voxel[3];
+} _chunkedHeader;
+
+
+
+static void _initChunkedHeader( _chunkedHeader *h )
+{
+  int i;
+  h->layout = CHUNKED_ZARR;
+  h->codec = CHUNKED_RAW;
+  h->level = 1;
+  h->ndim = 3;
+  for ( i=0; i<3; i++ ) {
+    h->dim[i] = h->chunk[i] = 1;
+    h->voxel[i] = 1.0;
+  }
+  h->wdim = 0;
+  h->wordKind = WK_UNKNOWN;
+  h->sign = SGN_UNKNOWN;
+  h->endianness = END_UNKNOWN;
+  h->separator = '.';
+  h->fill = 0.0;
+}
+
+
+
+/* the layout is given by the extension of the directory
+ */
+static int _getChunkedLayout( const char *name, _chunkedLayout *layout )
+{
+  size_t l;
+
+  if ( name == (char*)NULL ) return( -1 );
+  l = strlen( name );
+  while ( l > 1 && name[l-1] == '/' ) l--;
+
+  if ( l > 5 && strncmp( name+l-5, ".zarr", 5 ) == 0 ) {
+    *layout = CHUNKED_ZARR;
+    return( 1 );
+  }
+  if ( l > 3 && strncmp( name+l-3, ".n5", 3 ) == 0 ) {
+    *layout = CHUNKED_N5;
+    return( 1 );
+  }
+  return( -1 );
+}
+
+
+
+/* directory name without the trailing '/'
+ * (to be freed)
+ */
+static char *_getChunkedDirectory( const char *name )
+{
+  char *dir = strdup( name );
+  size_t l;
+
+  if ( dir == (char*)NULL ) return( dir );
+  l = strlen( dir );
+  while ( l > 1 && dir[l-1] == '/' ) dir[--l] = '\0';
+  return( dir );
+}
+
+
+
+static int _setChunkedType( _chunkedHeader *h, char kind, int wdim )
+{
+  switch ( kind ) {
+  default :
+    return( -1 );
+  case 'u' :
+  case 'i' :
+    if ( wdim != 1 && wdim != 2 && wdim != 4 && wdim != 8 ) return( -1 );
+    h->wordKind = WK_FIXED;
+    h->sign = ( kind == 'u' ) ? SGN_UNSIGNED : SGN_SIGNED;
+    break;
+  case 'f' :
+    if ( wdim != 4 && wdim != 8 ) return( -1 );
+    h->wordKind = WK_FLOAT;
+    h->sign = SGN_SIGNED;
+    break;
+  }
+  h->wdim = wdim;
+  return( 1 );
+}
+
+
+
+static char _getChunkedTypeKind( _chunkedHeader *h )
+{
+  if ( h->wordKind == WK_FLOAT ) return( 'f' );
+  return( ( h->sign == SGN_SIGNED ) ? 'i' : 'u' );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * minimal JSON parsing (attributes files)
+ *
+ ************************************************************/
+
+
+
+static char *_readTextFile( const char *name )
+{
+  FILE *f;
+  long n;
+  char *text;
+
+  f = fopen( name, "r" );
+  if ( f == (FILE*)NULL ) return( (char*)NULL );
+  if ( fseek( f, 0L, SEEK_END ) != 0 || (n = ftell( f )) < 0 || fseek( f, 0L, SEEK_SET ) != 0 ) {
+    fclose( f );
+    return( (char*)NULL );
+  }
+  text = (char*)malloc( n+1 );
+  if ( text == (char*)NULL ) {
+    fclose( f );
+    return( (char*)NULL );
+  }
+  n = (long)fread( text, 1, n, f );
+  text[n] = '\0';
+  fclose( f );
+  return( text );
+}
+
+
+
+static char *_skipJsonSpaces( char *p )
+{
+  while ( *p != '\0' && isspace( (unsigned char)*p ) ) p++;
+  return( p );
+}
+
+
+
+/* returns the value of 'key' in the JSON object beginning
+ * at 'text' (keys of nested objects are not considered),
+ * NULL if not found
+ */
+static char *_getJsonValue( char *text, const char *key )
+{
+  char *p, *s, *v;
+  size_t l = strlen( key );
+  int depth = 0;
+
+  if ( text == (char*)NULL ) return( (char*)NULL );
+
+  for ( p = text; *p != '\0'; ) {
+    switch ( *p ) {
+    default :
+      p++;
+      break;
+    case '{' :
+    case '[' :
+      depth ++;
+      p++;
+      break;
+    case '}' :
+    case ']' :
+      depth --;
+      p++;
+      if ( depth <= 0 ) return( (char*)NULL );
+      break;
+    case '"' :
+      for ( s = ++p; *p != '\0' && *p != '"'; p++ )
+        if ( *p == '\\' && p[1] != '\0' ) p++;
+      if ( *p == '\0' ) return( (char*)NULL );
+      if ( depth == 1 && (size_t)(p-s) == l && strncmp( s, key, l ) == 0 ) {
+        v = _skipJsonSpaces( p+1 );
+        if ( *v == ':' ) return( _skipJsonSpaces( v+1 ) );
+      }
+      p++;
+      break;
+    }
+  }
+  return( (char*)NULL );
+}
+
+
+
+static int _isJsonNull( char *v )
+{
+  return( v == (char*)NULL || strncmp( v, "null", 4 ) == 0 );
+}
+
+
+
+/* parses an array of at most n numbers,
+ * returns the number of values, -1 in case of error
+ */
+static int _getJsonNumbers( char *v, double *values, int n )
+{
+  char *e;
+  int i = 0;
+
+  if ( v == (char*)NULL || *v != '[' ) return( -1 );
+  for ( v++; ; ) {
+    v = _skipJsonSpaces( v );
+    if ( *v == ']' ) return( i );
+    if ( i >= n ) return( -1 );
+    values[i] = strtod( v, &e );
+    if ( e == v ) return( -1 );
+    i++;
+    v = _skipJsonSpaces( e );
+    if ( *v == ',' ) v++;
+    else if ( *v != ']' ) return( -1 );
+  }
+}
+
+
+
+static int _getJsonString( char *v, char *s, size_t length )
+{
+  size_t i;
+
+  if ( v == (char*)NULL || *v != '"' ) return( -1 );
+  for ( i=0, v++; *v != '\0' && *v != '"'; v++ ) {
+    if ( i+1 >= length ) return( -1 );
+    s[i++] = *v;
+  }
+  if ( *v != '"' ) return( -1 );
+  s[i] = '\0';
+  return( 1 );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * attributes files
+ *
+ ************************************************************/
+
+
+
+static int _readZarrHeader( const char *dir, _chunkedHeader *h )
+{
+  char *proc = "_readZarrHeader";
+  char *path, *text, *v;
+  char str[64];
+  double values[3];
+  int i, n;
+
+  path = (char*)malloc( strlen(dir) + 16 );
+  if ( path == (char*)NULL ) return( -1 );
+
+  sprintf( path, "%s/.zarray", dir );
+  text = _readTextFile( path );
+  if ( text == (char*)NULL ) {
+    free( path );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read '%s/.zarray'\n", proc, dir );
+    return( -1 );
+  }
+
+  v = _getJsonValue( text, "zarr_format" );
+  if ( v == (char*)NULL || atoi( v ) != 2 ) {
+    free( text ); free( path );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: only Zarr version 2 is handled\n", proc );
+    return( -1 );
+  }
+
+  /* shape and chunks are in z, y, x order
+   */
+  n = _getJsonNumbers( _getJsonValue( text, "shape" ), values, 3 );
+  if ( n < 1 ) {
+    free( text ); free( path );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid or unhandled shape (only 1 to 3 dimensions)\n", proc );
+    return( -1 );
+  }
+  h->ndim = n;
+  for ( i=0; i<n; i++ ) h->dim[i] = (size_t)values[n-1-i];
+  if ( _getJsonNumbers( _getJsonValue( text, "chunks" ), values, 3 ) != n ) {
+    free( text ); free( path );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid chunks\n", proc );
+    return( -1 );
+  }
+  for ( i=0; i<n; i++ ) h->chunk[i] = (size_t)values[n-1-i];
+
+  /* type
+   */
+  if ( _getJsonString( _getJsonValue( text, "dtype" ), str, 64 ) != 1
+       || strlen( str ) < 3
+       || _setChunkedType( h, str[1], atoi( str+2 ) ) != 1 ) {
+    free( text ); free( path );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid or unhandled dtype\n", proc );
+    return( -1 );
+  }
+  h->endianness = ( str[0] == '>' ) ? END_BIG : END_LITTLE;
+
+  if ( _getJsonString( _getJsonValue( text, "order" ), str, 64 ) != 1 || strcmp( str, "C" ) != 0 ) {
+    free( text ); free( path );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: only C order is handled\n", proc );
+    return( -1 );
+  }
+
+  /* compressor
+   */
+  v = _getJsonValue( text, "compressor" );
+  if ( _isJsonNull( v ) ) {
+    h->codec = CHUNKED_RAW;
+  }
+  else {
+    if ( _getJsonString( _getJsonValue( v, "id" ), str, 64 ) != 1 ) str[0] = '\0';
+    if ( strcmp( str, "zlib" ) == 0 ) h->codec = CHUNKED_ZLIB;
+    else if ( strcmp( str, "gzip" ) == 0 ) h->codec = CHUNKED_GZIP;
+    else {
+      free( text ); free( path );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unhandled compressor '%s' (only zlib, gzip or none)\n", proc, str );
+      return( -1 );
+    }
+  }
+
+  if ( !_isJsonNull( _getJsonValue( text, "filters" ) ) ) {
+    free( text ); free( path );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: filters are not handled\n", proc );
+    return( -1 );
+  }
+
+  v = _getJsonValue( text, "dimension_separator" );
+  if ( v != (char*)NULL ) {
+    if ( _getJsonString( v, str, 64 ) != 1 || (strcmp( str, "." ) != 0 && strcmp( str, "/" ) != 0) ) {
+      free( text ); free( path );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: invalid dimension separator\n", proc );
+      return( -1 );
+    }
+    h->separator = str[0];
+  }
+
+  /* "NaN" or "Infinity" fill values are replaced by 0
+   */
+  v = _getJsonValue( text, "fill_value" );
+  if ( !_isJsonNull( v ) && *v != '"' ) h->fill = strtod( v, (char**)NULL );
+
+  free( text );
+
+  /* optional voxel size
+   */
+  sprintf( path, "%s/.zattrs", dir );
+  text = _readTextFile( path );
+  if ( text != (char*)NULL ) {
+    if ( _getJsonNumbers( _getJsonValue( text, "resolution" ), values, 3 ) == h->ndim )
+      for ( i=0; i<h->ndim; i++ ) h->voxel[i] = values[h->ndim-1-i];
+    free( text );
+  }
+
+  free( path );
+  return( 1 );
+}
+
+
+
+static int _readN5Header( const char *dir, _chunkedHeader *h )
+{
+  char *proc = "_readN5Header";
+  char *path, *text, *v, *u;
+  char str[64];
+  double values[3];
+  int i, n;
+
+  path = (char*)malloc( strlen(dir) + 20 );
+  if ( path == (char*)NULL ) return( -1 );
+
+  sprintf( path, "%s/attributes.json", dir );
+  text = _readTextFile( path );
+  free( path );
+  if ( text == (char*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read '%s/attributes.json'\n", proc, dir );
+    return( -1 );
+  }
+
+  n = _getJsonNumbers( _getJsonValue( text, "dimensions" ), values, 3 );
+  if ( n < 1 ) {
+    free( text );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid or unhandled dimensions (only 1 to 3 dimensions)\n", proc );
+    return( -1 );
+  }
+  h->ndim = n;
+  for ( i=0; i<n; i++ ) h->dim[i] = (size_t)values[i];
+  if ( _getJsonNumbers( _getJsonValue( text, "blockSize" ), values, 3 ) != n ) {
+    free( text );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid block size\n", proc );
+    return( -1 );
+  }
+  for ( i=0; i<n; i++ ) h->chunk[i] = (size_t)values[i];
+
+  /* type, data are big endian
+   */
+  if ( _getJsonString( _getJsonValue( text, "dataType" ), str, 64 ) != 1
+       || ( strncmp( str, "uint", 4 ) == 0 && _setChunkedType( h, 'u', atoi( str+4 ) / 8 ) != 1 )
+       || ( strncmp( str, "int", 3 ) == 0 && _setChunkedType( h, 'i', atoi( str+3 ) / 8 ) != 1 )
+       || ( strncmp( str, "float", 5 ) == 0 && _setChunkedType( h, 'f', atoi( str+5 ) / 8 ) != 1 )
+       || h->wdim == 0 ) {
+    free( text );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid or unhandled data type\n", proc );
+    return( -1 );
+  }
+  h->endianness = END_BIG;
+
+  /* compression, either {"type": ...} or (older versions) "compressionType"
+   */
+  v = _getJsonValue( text, "compression" );
+  if ( v != (char*)NULL && *v == '{' ) {
+    if ( _getJsonString( _getJsonValue( v, "type" ), str, 64 ) != 1 ) str[0] = '\0';
+    u = _getJsonValue( v, "useZlib" );
+    if ( strcmp( str, "gzip" ) == 0 && u != (char*)NULL && strncmp( u, "true", 4 ) == 0 )
+      strcpy( str, "zlib" );
+  }
+  else if ( _getJsonString( _getJsonValue( text, "compressionType" ), str, 64 ) != 1 ) {
+    strcpy( str, "raw" );
+  }
+
+  /* optional voxel size
+   */
+  if ( _getJsonNumbers( _getJsonValue( text, "resolution" ), values, 3 ) == h->ndim )
+    for ( i=0; i<h->ndim; i++ ) h->voxel[i] = values[i];
+
+  free( text );
+
+  if ( strcmp( str, "raw" ) == 0 ) h->codec = CHUNKED_RAW;
+  else if ( strcmp( str, "gzip" ) == 0 ) h->codec = CHUNKED_GZIP;
+  else if ( strcmp( str, "zlib" ) == 0 ) h->codec = CHUNKED_ZLIB;
+  else {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unhandled compression '%s' (only gzip or raw)\n", proc, str );
+    return( -1 );
+  }
+
+  return( 1 );
+}
+
+
+
+static int _readChunkedHeader( const char *dir, _chunkedHeader *h )
+{
+  int i;
+
+  switch ( h->layout ) {
+  default :
+    return( -1 );
+  case CHUNKED_ZARR :
+    if ( _readZarrHeader( dir, h ) != 1 ) return( -1 );
+    break;
+  case CHUNKED_N5 :
+    if ( _readN5Header( dir, h ) != 1 ) return( -1 );
+    break;
+  }
+
+  for ( i=0; i<3; i++ ) {
+    if ( h->dim[i] == 0 || h->chunk[i] == 0 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "_readChunkedHeader: null dimension or chunk dimension\n" );
+      return( -1 );
+    }
+  }
+  return( 1 );
+}
+
+
+
+static int _writeChunkedHeader( const char *dir, _chunkedHeader *h )
+{
+  char *proc = "_writeChunkedHeader";
+  char *path;
+  FILE *f;
+
+  if ( mkdir( dir, 0777 ) != 0 && errno != EEXIST ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to create directory '%s'\n", proc, dir );
+    return( -1 );
+  }
+
+  path = (char*)malloc( strlen(dir) + 20 );
+  if ( path == (char*)NULL ) return( -1 );
+
+  switch ( h->layout ) {
+  default :
+    free( path );
+    return( -1 );
+
+  case CHUNKED_ZARR :
+    sprintf( path, "%s/.zarray", dir );
+    f = fopen( path, "w" );
+    if ( f == (FILE*)NULL ) break;
+    fprintf( f, "{\n" );
+    fprintf( f, "    \"zarr_format\": 2,\n" );
+    fprintf( f, "    \"shape\": [%lu, %lu, %lu],\n", h->dim[2], h->dim[1], h->dim[0] );
+    fprintf( f, "    \"chunks\": [%lu, %lu, %lu],\n", h->chunk[2], h->chunk[1], h->chunk[0] );
+    fprintf( f, "    \"dtype\": \"%c%c%u\",\n",
+             ( h->wdim == 1 ) ? '|' : ( ( h->endianness == END_BIG ) ? '>' : '<' ),
+             _getChunkedTypeKind( h ), h->wdim );
+    if ( h->codec == CHUNKED_RAW )
+      fprintf( f, "    \"compressor\": null,\n" );
+    else
+      fprintf( f, "    \"compressor\": {\"id\": \"%s\", \"level\": %d},\n",
+               ( h->codec == CHUNKED_GZIP ) ? "gzip" : "zlib", h->level );
+    fprintf( f, "    \"fill_value\": 0,\n" );
+    fprintf( f, "    \"order\": \"C\",\n" );
+    fprintf( f, "    \"filters\": null,\n" );
+    fprintf( f, "    \"dimension_separator\": \"%c\"\n", h->separator );
+    fprintf( f, "}\n" );
+    if ( fclose( f ) != 0 ) break;
+
+    sprintf( path, "%s/.zattrs", dir );
+    f = fopen( path, "w" );
+    if ( f == (FILE*)NULL ) break;
+    fprintf( f, "{\n    \"resolution\": [%.17g, %.17g, %.17g]\n}\n",
+             h->voxel[2], h->voxel[1], h->voxel[0] );
+    if ( fclose( f ) != 0 ) break;
+    free( path );
+    return( 1 );
+
+  case CHUNKED_N5 :
+    sprintf( path, "%s/attributes.json", dir );
+    f = fopen( path, "w" );
+    if ( f == (FILE*)NULL ) break;
+    fprintf( f, "{\"dimensions\":[%lu,%lu,%lu],", h->dim[0], h->dim[1], h->dim[2] );
+    fprintf( f, "\"blockSize\":[%lu,%lu,%lu],", h->chunk[0], h->chunk[1], h->chunk[2] );
+    fprintf( f, "\"dataType\":\"%s%u\",",
+             ( h->wordKind == WK_FLOAT ) ? "float" : ( ( h->sign == SGN_SIGNED ) ? "int" : "uint" ),
+             8 * h->wdim );
+    if ( h->codec == CHUNKED_RAW )
+      fprintf( f, "\"compression\":{\"type\":\"raw\"}," );
+    else
+      fprintf( f, "\"compression\":{\"type\":\"gzip\",\"level\":%d%s},", h->level,
+               ( h->codec == CHUNKED_ZLIB ) ? ",\"useZlib\":true" : "" );
+    fprintf( f, "\"resolution\":[%.17g,%.17g,%.17g]}\n", h->voxel[0], h->voxel[1], h->voxel[2] );
+    if ( fclose( f ) != 0 ) break;
+    free( path );
+    return( 1 );
+  }
+
+  if ( _verbose_ )
+    fprintf( stderr, "%s: unable to write '%s'\n", proc, path );
+  free( path );
+  return( -1 );
+}
+
+
+
+static void _chunkedHeaderToImage( _chunkedHeader *h, _image *im )
+{
+  im->xdim = h->dim[0];
+  im->ydim = h->dim[1];
+  im->zdim = h->dim[2];
+  im->vdim = 1;
+  im->vx = h->voxel[0];
+  im->vy = h->voxel[1];
+  im->vz = h->voxel[2];
+  im->wdim = h->wdim;
+  im->wordKind = h->wordKind;
+  im->sign = h->sign;
+  /* chunks are converted when read
+   */
+  im->endianness = _getEndianness();
+}
+
+
+
+static int _imageToChunkedHeader( _image *im, _chunkedHeader *h )
+{
+  char *proc = "_imageToChunkedHeader";
+  int i;
+
+  if ( im->vdim != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: vectorial images are not handled\n", proc );
+    return( -1 );
+  }
+  if ( _setChunkedType( h, ( im->wordKind == WK_FLOAT ) ? 'f' : ( ( im->sign == SGN_SIGNED ) ? 'i' : 'u' ),
+                        im->wdim ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such image type not handled\n", proc );
+    return( -1 );
+  }
+
+  h->ndim = 3;
+  h->dim[0] = im->xdim;
+  h->dim[1] = im->ydim;
+  h->dim[2] = im->zdim;
+  h->voxel[0] = im->vx;
+  h->voxel[1] = im->vy;
+  h->voxel[2] = im->vz;
+  for ( i=0; i<3; i++ )
+    h->chunk[i] = ( (size_t)_chunk_size_[i] < h->dim[i] ) ? (size_t)_chunk_size_[i] : h->dim[i];
+
+  h->level = _chunk_compression_;
+  if ( h->level == 0 ) h->codec = CHUNKED_RAW;
+  else h->codec = ( h->layout == CHUNKED_N5 ) ? CHUNKED_GZIP : CHUNKED_ZLIB;
+
+  h->endianness = ( h->layout == CHUNKED_N5 ) ? END_BIG : _getEndianness();
+  h->separator = '.';
+  h->fill = 0.0;
+  return( 1 );
+}
+
+
+
+
+
+/************************************************************
+ *
+ * chunks
+ *
+ ************************************************************/
+
+
+
+static void _getChunkPath( char *path, const char *dir, _chunkedHeader *h, size_t *c )
+{
+  char s = ( h->layout == CHUNKED_N5 ) ? '/' : h->separator;
+
+  /* Zarr chunk indices are in z, y, x order
+   */
+  switch ( h->ndim ) {
+  default :
+  case 3 :
+    if ( h->layout == CHUNKED_N5 )
+      sprintf( path, "%s/%lu%c%lu%c%lu", dir, c[0], s, c[1], s, c[2] );
+    else
+      sprintf( path, "%s/%lu%c%lu%c%lu", dir, c[2], s, c[1], s, c[0] );
+    break;
+  case 2 :
+    if ( h->layout == CHUNKED_N5 )
+      sprintf( path, "%s/%lu%c%lu", dir, c[0], s, c[1] );
+    else
+      sprintf( path, "%s/%lu%c%lu", dir, c[1], s, c[0] );
+    break;
+  case 1 :
+    sprintf( path, "%s/%lu", dir, c[0] );
+    break;
+  }
+}
+
+
+
+/* origin and dimensions of the chunk
+ * N5 chunks are truncated at the image border, Zarr ones are not
+ */
+static void _getChunkExtent( _chunkedHeader *h, size_t *c, size_t *origin, size_t *ext )
+{
+  int i;
+  for ( i=0; i<3; i++ ) {
+    origin[i] = c[i] * h->chunk[i];
+    ext[i] = h->chunk[i];
+    if ( h->layout == CHUNKED_N5 && origin[i] + ext[i] > h->dim[i] )
+      ext[i] = h->dim[i] - origin[i];
+  }
+}
+
+
+
+static void _swapChunk( unsigned char *buf, size_t n, unsigned int wdim )
+{
+  size_t i;
+  unsigned int j;
+  unsigned char t;
+
+  for ( i=0; i<n; i++, buf+=wdim ) {
+    for ( j=0; j<wdim/2; j++ ) {
+      t = buf[j];
+      buf[j] = buf[wdim-1-j];
+      buf[wdim-1-j] = t;
+    }
+  }
+}
+
+
+
+static void _fillChunk( unsigned char *buf, size_t n, _chunkedHeader *h )
+{
+  unsigned char value[8];
+  size_t i;
+
+  if ( h->fill == 0.0 ) {
+    memset( buf, 0, n * h->wdim );
+    return;
+  }
+
+  switch ( h->wordKind ) {
+  default :
+  case WK_FIXED :
+    switch ( h->wdim ) {
+    default :
+    case 1 :
+      if ( h->sign == SGN_SIGNED ) *((signed char*)value) = (signed char)h->fill;
+      else *((unsigned char*)value) = (unsigned char)h->fill;
+      break;
+    case 2 :
+      if ( h->sign == SGN_SIGNED ) *((short int*)value) = (short int)h->fill;
+      else *((unsigned short int*)value) = (unsigned short int)h->fill;
+      break;
+    case 4 :
+      if ( h->sign == SGN_SIGNED ) *((int*)value) = (int)h->fill;
+      else *((unsigned int*)value) = (unsigned int)h->fill;
+      break;
+    case 8 :
+      if ( h->sign == SGN_SIGNED ) *((long long int*)value) = (long long int)h->fill;
+      else *((unsigned long long int*)value) = (unsigned long long int)h->fill;
+      break;
+    }
+    break;
+  case WK_FLOAT :
+    if ( h->wdim == 4 ) *((float*)value) = (float)h->fill;
+    else *((double*)value) = h->fill;
+    break;
+  }
+
+  for ( i=0; i<n; i++, buf+=h->wdim )
+    memcpy( buf, value, h->wdim );
+}
+
+
+
+/* reads the chunk file 'path' into 'buf' (ext[0] x ext[1] x ext[2]
+ * voxels, converted to the hardware byte order)
+ * returns 1 in case of success, 0 if the chunk file does not exist
+ * (then it has to be filled with the fill value), -1 else
+ */
+static int _readChunk( const char *path, _chunkedHeader *h, unsigned char *buf, size_t *ext )
+{
+  char *proc = "_readChunk";
+  FILE *f;
+  unsigned char *file, *p;
+  long length;
+  size_t size, n, i, offset = 0;
+  z_stream z;
+  int ndim;
+
+  f = fopen( path, "rb" );
+  if ( f == (FILE*)NULL ) {
+    if ( errno == ENOENT ) return( 0 );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to open '%s'\n", proc, path );
+    return( -1 );
+  }
+  if ( fseek( f, 0L, SEEK_END ) != 0 || (length = ftell( f )) < 0 || fseek( f, 0L, SEEK_SET ) != 0 ) {
+    fclose( f );
+    return( -1 );
+  }
+  file = (unsigned char*)malloc( length > 0 ? length : 1 );
+  if ( file == (unsigned char*)NULL ) {
+    fclose( f );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( -1 );
+  }
+  if ( fread( file, 1, length, f ) != (size_t)length ) {
+    free( file );
+    fclose( f );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read '%s'\n", proc, path );
+    return( -1 );
+  }
+  fclose( f );
+
+  /* N5 chunk header (big endian): mode (uint16), number of
+   * dimensions (uint16) and dimensions (uint32) of the chunk
+   */
+  if ( h->layout == CHUNKED_N5 ) {
+    if ( length < 4 || ((file[0] << 8) | file[1]) != 0 ) {
+      free( file );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: invalid or unhandled chunk mode in '%s'\n", proc, path );
+      return( -1 );
+    }
+    ndim = (file[2] << 8) | file[3];
+    if ( ndim != h->ndim || (size_t)length < 4 + 4 * (size_t)ndim ) {
+      free( file );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: invalid chunk header in '%s'\n", proc, path );
+      return( -1 );
+    }
+    for ( i=0; i<(size_t)ndim; i++ ) {
+      p = file + 4 + 4*i;
+      n = ((size_t)p[0] << 24) | ((size_t)p[1] << 16) | ((size_t)p[2] << 8) | (size_t)p[3];
+      if ( n != ext[i] ) {
+        free( file );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unexpected chunk dimensions in '%s'\n", proc, path );
+        return( -1 );
+      }
+    }
+    offset = 4 + 4 * (size_t)ndim;
+  }
+
+  size = ext[0] * ext[1] * ext[2] * h->wdim;
+
+  switch ( h->codec ) {
+  default :
+    free( file );
+    return( -1 );
+  case CHUNKED_RAW :
+    if ( (size_t)length - offset < size ) {
+      free( file );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: truncated chunk '%s'\n", proc, path );
+      return( -1 );
+    }
+    memcpy( buf, file + offset, size );
+    break;
+  case CHUNKED_ZLIB :
+  case CHUNKED_GZIP :
+    /* zlib or gzip header is detected
+     */
+    memset( &z, 0, sizeof(z_stream) );
+    if ( inflateInit2( &z, 15+32 ) != Z_OK ) {
+      free( file );
+      return( -1 );
+    }
+    z.next_in = file + offset;
+    z.avail_in = (uInt)( (size_t)length - offset );
+    z.next_out = buf;
+    z.avail_out = (uInt)size;
+    if ( inflate( &z, Z_FINISH ) != Z_STREAM_END || z.total_out != size ) {
+      inflateEnd( &z );
+      free( file );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to uncompress '%s'\n", proc, path );
+      return( -1 );
+    }
+    inflateEnd( &z );
+    break;
+  }
+
+  free( file );
+
+  if ( h->wdim > 1 && h->endianness != _getEndianness() )
+    _swapChunk( buf, ext[0] * ext[1] * ext[2], h->wdim );
+
+  return( 1 );
+}
+
+
+
+/* creates the directories of 'path' after its 'from' first characters
+ */
+static int _makeChunkDirectories( char *path, size_t from )
+{
+  char *p;
+
+  for ( p = path + from; *p != '\0'; p++ ) {
+    if ( *p != '/' ) continue;
+    *p = '\0';
+    if ( mkdir( path, 0777 ) != 0 && errno != EEXIST ) {
+      *p = '/';
+      return( -1 );
+    }
+    *p = '/';
+  }
+  return( 1 );
+}
+
+
+
+/* writes 'buf' (ext[0] x ext[1] x ext[2] voxels in the
+ * byte order of the chunks) into the chunk file 'path'
+ * the chunk is written in a temporary file that is then renamed,
+ * so that a reader (or a concurrent writer of the same chunk)
+ * never sees a partially written chunk
+ */
+static int _writeChunk( const char *path, _chunkedHeader *h, unsigned char *buf, size_t *ext )
+{
+  char *proc = "_writeChunk";
+  FILE *f;
+  char *tmpPath;
+  unsigned char header[16];
+  unsigned char *out = buf;
+  size_t size = ext[0] * ext[1] * ext[2] * h->wdim;
+  size_t length = size, hlength = 0;
+  z_stream z;
+  int i;
+
+  if ( h->layout == CHUNKED_N5 ) {
+    header[0] = header[1] = 0;
+    header[2] = 0;
+    header[3] = (unsigned char)h->ndim;
+    for ( i=0; i<h->ndim; i++ ) {
+      header[4+4*i]   = (unsigned char)((ext[i] >> 24) & 0xff);
+      header[4+4*i+1] = (unsigned char)((ext[i] >> 16) & 0xff);
+      header[4+4*i+2] = (unsigned char)((ext[i] >> 8) & 0xff);
+      header[4+4*i+3] = (unsigned char)(ext[i] & 0xff);
+    }
+    hlength = 4 + 4 * h->ndim;
+  }
+
+  if ( h->codec != CHUNKED_RAW ) {
+    memset( &z, 0, sizeof(z_stream) );
+    if ( deflateInit2( &z, h->level, Z_DEFLATED, ( h->codec == CHUNKED_GZIP ) ? 15+16 : 15,
+                       8, Z_DEFAULT_STRATEGY ) != Z_OK ) {
+      return( -1 );
+    }
+    length = deflateBound( &z, (uLong)size );
+    out = (unsigned char*)malloc( length );
+    if ( out == (unsigned char*)NULL ) {
+      deflateEnd( &z );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: allocation failed\n", proc );
+      return( -1 );
+    }
+    z.next_in = buf;
+    z.avail_in = (uInt)size;
+    z.next_out = out;
+    z.avail_out = (uInt)length;
+    if ( deflate( &z, Z_FINISH ) != Z_STREAM_END ) {
+      deflateEnd( &z );
+      free( out );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to compress '%s'\n", proc, path );
+      return( -1 );
+    }
+    length = z.total_out;
+    deflateEnd( &z );
+  }
+
+  /* the process id makes the temporary name unique among
+   * processes, a chunk is written by a single thread
+   */
+  tmpPath = (char*)malloc( strlen( path ) + 32 );
+  if ( tmpPath == (char*)NULL ) {
+    if ( out != buf ) free( out );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( -1 );
+  }
+  sprintf( tmpPath, "%s.%ld.tmp", path, (long int)getpid() );
+
+  f = fopen( tmpPath, "wb" );
+  if ( f == (FILE*)NULL
+       || ( hlength > 0 && fwrite( header, 1, hlength, f ) != hlength )
+       || fwrite( out, 1, length, f ) != length ) {
+    if ( f != (FILE*)NULL ) {
+      fclose( f );
+      (void)remove( tmpPath );
+    }
+    if ( out != buf ) free( out );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to write '%s'\n", proc, tmpPath );
+    free( tmpPath );
+    return( -1 );
+  }
+  if ( out != buf ) free( out );
+  if ( fclose( f ) != 0 ) {
+    (void)remove( tmpPath );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to write '%s'\n", proc, tmpPath );
+    free( tmpPath );
+    return( -1 );
+  }
+
+  if ( rename( tmpPath, path ) != 0 ) {
+    (void)remove( tmpPath );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to rename '%s' into '%s'\n", proc, tmpPath, path );
+    free( tmpPath );
+    return( -1 );
+  }
+
+  free( tmpPath );
+  return( 1 );
+}
+
+
+
+/* copies the intersection of the chunk (buffer 'buf' of ext
+ * voxels at 'origin') and of the region (buffer 'data' of dim voxels
+ * at 'first') from the chunk to the region (toRegion = 1)
+ * or from the region to the chunk (toRegion = 0)
+ */
+static void _copyChunk( _chunkedHeader *h, unsigned char *buf, size_t *origin, size_t *ext,
+                        unsigned char *data, size_t *first, size_t *dim, int toRegion )
+{
+  size_t lo[3], hi[3], y, z, l;
+  unsigned char *c, *r;
+  int i;
+
+  for ( i=0; i<3; i++ ) {
+    lo[i] = ( origin[i] > first[i] ) ? origin[i] : first[i];
+    hi[i] = origin[i] + ext[i];
+    if ( hi[i] > first[i] + dim[i] ) hi[i] = first[i] + dim[i];
+    if ( hi[i] > h->dim[i] ) hi[i] = h->dim[i];
+    if ( lo[i] >= hi[i] ) return;
+  }
+
+  l = (hi[0] - lo[0]) * h->wdim;
+  for ( z=lo[2]; z<hi[2]; z++ )
+  for ( y=lo[1]; y<hi[1]; y++ ) {
+    c = buf + ( ((z - origin[2]) * ext[1] + (y - origin[1])) * ext[0] + (lo[0] - origin[0]) ) * h->wdim;
+    r = data + ( ((z - first[2]) * dim[1] + (y - first[1])) * dim[0] + (lo[0] - first[0]) ) * h->wdim;
+    if ( toRegion ) memcpy( r, c, l );
+    else memcpy( c, r, l );
+  }
+}
+
+
+
+
+
+/************************************************************
+ *
+ * parallel reading and writing of the chunks of a region
+ *
+ ************************************************************/
+
+
+
+static int _readChunkedData( const char *dir, _chunkedHeader *h, unsigned char *data,
+                             size_t *first, size_t *dim )
+{
+  char *proc = "_readChunkedData";
+  size_t c0[3], nc[3];
+  int i, n, error = 0;
+
+  for ( i=0; i<3; i++ ) {
+    c0[i] = first[i] / h->chunk[i];
+    nc[i] = (first[i] + dim[i] - 1) / h->chunk[i] - c0[i] + 1;
+  }
+  n = (int)(nc[0] * nc[1] * nc[2]);
+
+#ifdef _OPENMP
+#pragma omp parallel private( i )
+#endif
+  {
+    unsigned char *buf = (unsigned char*)malloc( h->chunk[0] * h->chunk[1] * h->chunk[2] * h->wdim );
+    char *path = (char*)malloc( strlen(dir) + 80 );
+    size_t c[3], origin[3], ext[3];
+
+    if ( buf == (unsigned char*)NULL || path == (char*)NULL ) error = 1;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for ( i=0; i<n; i++ ) {
+      if ( error ) continue;
+      c[0] = c0[0] + (size_t)i % nc[0];
+      c[1] = c0[1] + ((size_t)i / nc[0]) % nc[1];
+      c[2] = c0[2] + (size_t)i / (nc[0] * nc[1]);
+      _getChunkExtent( h, c, origin, ext );
+      _getChunkPath( path, dir, h, c );
+      switch ( _readChunk( path, h, buf, ext ) ) {
+      default :
+        error = 1;
+        continue;
+      case 0 :
+        _fillChunk( buf, ext[0] * ext[1] * ext[2], h );
+        break;
+      case 1 :
+        break;
+      }
+      _copyChunk( h, buf, origin, ext, data, first, dim, 1 );
+    }
+
+    if ( path != (char*)NULL ) free( path );
+    if ( buf != (unsigned char*)NULL ) free( buf );
+  }
+
+  if ( error ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: error when reading chunks of '%s'\n", proc, dir );
+    return( -1 );
+  }
+  return( 1 );
+}
+
+
+
+static int _writeChunkedData( const char *dir, _chunkedHeader *h, unsigned char *data,
+                              size_t *first, size_t *dim )
+{
+  char *proc = "_writeChunkedData";
+  size_t c0[3], nc[3];
+  size_t dirLength = strlen( dir );
+  int i, n, error = 0;
+
+  for ( i=0; i<3; i++ ) {
+    c0[i] = first[i] / h->chunk[i];
+    nc[i] = (first[i] + dim[i] - 1) / h->chunk[i] - c0[i] + 1;
+  }
+  n = (int)(nc[0] * nc[1] * nc[2]);
+
+#ifdef _OPENMP
+#pragma omp parallel private( i )
+#endif
+  {
+    unsigned char *buf = (unsigned char*)malloc( h->chunk[0] * h->chunk[1] * h->chunk[2] * h->wdim );
+    char *path = (char*)malloc( dirLength + 80 );
+    size_t c[3], origin[3], ext[3];
+    int j, covered, padded;
+
+    if ( buf == (unsigned char*)NULL || path == (char*)NULL ) error = 1;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for ( i=0; i<n; i++ ) {
+      if ( error ) continue;
+      c[0] = c0[0] + (size_t)i % nc[0];
+      c[1] = c0[1] + ((size_t)i / nc[0]) % nc[1];
+      c[2] = c0[2] + (size_t)i / (nc[0] * nc[1]);
+      _getChunkExtent( h, c, origin, ext );
+      _getChunkPath( path, dir, h, c );
+
+      /* chunks partially covered by the region are read first,
+       * Zarr chunks crossing the image border are padded
+       */
+      for ( covered=1, padded=0, j=0; j<3; j++ ) {
+        if ( first[j] > origin[j] ) covered = 0;
+        if ( origin[j] + ext[j] > h->dim[j] ) {
+          padded = 1;
+          if ( first[j] + dim[j] < h->dim[j] ) covered = 0;
+        }
+        else if ( first[j] + dim[j] < origin[j] + ext[j] ) covered = 0;
+      }
+      if ( !covered ) {
+        switch ( _readChunk( path, h, buf, ext ) ) {
+        default :
+          error = 1;
+          continue;
+        case 0 :
+          _fillChunk( buf, ext[0] * ext[1] * ext[2], h );
+          break;
+        case 1 :
+          break;
+        }
+      }
+      else if ( padded ) {
+        _fillChunk( buf, ext[0] * ext[1] * ext[2], h );
+      }
+
+      _copyChunk( h, buf, origin, ext, data, first, dim, 0 );
+
+      if ( h->wdim > 1 && h->endianness != _getEndianness() )
+        _swapChunk( buf, ext[0] * ext[1] * ext[2], h->wdim );
+
+      if ( _makeChunkDirectories( path, dirLength+1 ) != 1
+           || _writeChunk( path, h, buf, ext ) != 1 )
+        error = 1;
+    }
+
+    if ( path != (char*)NULL ) free( path );
+    if ( buf != (unsigned char*)NULL ) free( buf );
+  }
+
+  if ( error ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: error when writing chunks of '%s'\n", proc, dir );
+    return( -1 );
+  }
+  return( 1 );
+}
+
+
+
+
+
+/************************************************************
+ *
+ *
+ *
+ ************************************************************/
+
+
+
+int testChunkedHeader( char *magic __attribute__ ((unused)),
+                       const char *name )
+{
+  _chunkedLayout layout;
+
+  if ( _getChunkedLayout( name, &layout ) == 1 )
+    return( 0 );
+  return( -1 );
+}
+
+
+
+int readChunkedImageRegion( const char *name, _image *im, size_t *first, size_t *dim )
+{
+  char *proc = "readChunkedImageRegion";
+  _chunkedHeader h;
+  char *dir;
+  int i;
+
+  _initChunkedHeader( &h );
+  if ( _getChunkedLayout( name, &(h.layout) ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: '%s' is not a .zarr or .n5 directory\n", proc, name );
+    return( -1 );
+  }
+  dir = _getChunkedDirectory( name );
+  if ( dir == (char*)NULL ) return( -1 );
+
+  if ( _readChunkedHeader( dir, &h ) != 1 ) {
+    free( dir );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read header of '%s'\n", proc, name );
+    return( -1 );
+  }
+  _chunkedHeaderToImage( &h, im );
+
+  /* header only
+   */
+  if ( first == (size_t*)NULL || dim == (size_t*)NULL ) {
+    free( dir );
+    return( 1 );
+  }
+
+  for ( i=0; i<3; i++ ) {
+    if ( dim[i] == 0 || first[i] + dim[i] > h.dim[i] ) {
+      free( dir );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: region %lu x %lu x %lu at (%lu,%lu,%lu) is not in image %lu x %lu x %lu\n",
+                 proc, dim[0], dim[1], dim[2], first[0], first[1], first[2], h.dim[0], h.dim[1], h.dim[2] );
+      return( -1 );
+    }
+  }
+
+  im->data = ImageIO_alloc( dim[0] * dim[1] * dim[2] * h.wdim );
+  if ( im->data == (void*)NULL ) {
+    free( dir );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( -1 );
+  }
+
+  if ( _readChunkedData( dir, &h, (unsigned char*)im->data, first, dim ) != 1 ) {
+    ImageIO_free( im->data );
+    im->data = (void*)NULL;
+    free( dir );
+    return( -1 );
+  }
+  free( dir );
+
+  im->xdim = dim[0];
+  im->ydim = dim[1];
+  im->zdim = dim[2];
+  return( 1 );
+}
+
+
+
+int readChunkedImage( const char *name, _image *im )
+{
+  _chunkedHeader h;
+  size_t first[3] = { 0, 0, 0 };
+  size_t dim[3];
+  char *dir;
+
+  _initChunkedHeader( &h );
+  if ( _getChunkedLayout( name, &(h.layout) ) != 1 ) return( -1 );
+  dir = _getChunkedDirectory( name );
+  if ( dir == (char*)NULL ) return( -1 );
+  if ( _readChunkedHeader( dir, &h ) != 1 ) {
+    free( dir );
+    return( -1 );
+  }
+  free( dir );
+
+  dim[0] = h.dim[0];
+  dim[1] = h.dim[1];
+  dim[2] = h.dim[2];
+  if ( readChunkedImageRegion( name, im, first, dim ) != 1 )
+    return( -1 );
+  return( 1 );
+}
+
+
+
+int writeChunkedImage( char *name, _image *im )
+{
+  char *proc = "writeChunkedImage";
+  _chunkedHeader h;
+  size_t first[3] = { 0, 0, 0 };
+  char *dir;
+
+  _initChunkedHeader( &h );
+  if ( _getChunkedLayout( name, &(h.layout) ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: '%s' is not a .zarr or .n5 directory\n", proc, name );
+    return( -1 );
+  }
+  if ( im->data == (void*)NULL || _imageToChunkedHeader( im, &h ) != 1 )
+    return( -1 );
+
+  dir = _getChunkedDirectory( name );
+  if ( dir == (char*)NULL ) return( -1 );
+
+  if ( _writeChunkedHeader( dir, &h ) != 1
+       || _writeChunkedData( dir, &h, (unsigned char*)im->data, first, h.dim ) != 1 ) {
+    free( dir );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to write '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  free( dir );
+  return( 1 );
+}
+
+
+
+int writeChunkedImageRegion( const char *name, _image *im, size_t *first )
+{
+  char *proc = "writeChunkedImageRegion";
+  _chunkedHeader h;
+  size_t dim[3];
+  char *dir;
+  int i;
+
+  _initChunkedHeader( &h );
+  if ( _getChunkedLayout( name, &(h.layout) ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: '%s' is not a .zarr or .n5 directory\n", proc, name );
+    return( -1 );
+  }
+  dir = _getChunkedDirectory( name );
+  if ( dir == (char*)NULL ) return( -1 );
+
+  if ( _readChunkedHeader( dir, &h ) != 1 ) {
+    free( dir );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read header of '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  if ( im->data == (void*)NULL || im->vdim != 1 || im->wdim != h.wdim
+       || im->wordKind != h.wordKind || ( h.wordKind == WK_FIXED && im->sign != h.sign ) ) {
+    free( dir );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: image and '%s' have different types\n", proc, name );
+    return( -1 );
+  }
+
+  dim[0] = im->xdim;
+  dim[1] = im->ydim;
+  dim[2] = im->zdim;
+  for ( i=0; i<3; i++ ) {
+    if ( dim[i] == 0 || first[i] + dim[i] > h.dim[i] ) {
+      free( dir );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: region %lu x %lu x %lu at (%lu,%lu,%lu) is not in image %lu x %lu x %lu\n",
+                 proc, dim[0], dim[1], dim[2], first[0], first[1], first[2], h.dim[0], h.dim[1], h.dim[2] );
+      return( -1 );
+    }
+  }
+
+  if ( h.codec != CHUNKED_RAW )
+    h.level = ( _chunk_compression_ > 0 ) ? _chunk_compression_ : Z_DEFAULT_COMPRESSION;
+
+  if ( _writeChunkedData( dir, &h, (unsigned char*)im->data, first, dim ) != 1 ) {
+    free( dir );
+    return( -1 );
+  }
+
+  free( dir );
+  return( 1 );
+}
+
+
+
+
+
+/************************************************************
+ *
+ *
+ *
+ ************************************************************/
+
+
+
+PTRIMAGE_FORMAT createChunkedFormat()
+{
+  PTRIMAGE_FORMAT f=(PTRIMAGE_FORMAT) ImageIO_alloc(sizeof(IMAGE_FORMAT));
+  _initImageFormat( f );
+
+  f->testImageFormat = &testChunkedHeader;
+  f->readImageHeader = &readChunkedImage;
+  f->readImageData = NULL;
+  f->writeImageHeader = NULL;
+  f->writeImage = &writeChunkedImage;
+  f->readImageRegion = &readChunkedImageRegion;
+
+  strcpy(f->fileExtension,".zarr,.n5,.zarr/,.n5/");
+  strcpy(f->realName,"Zarr/N5");
+  return f;
+}
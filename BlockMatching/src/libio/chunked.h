@@ -0,0 +1,58 @@
+#ifndef CHUNKED_H
+#define CHUNKED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <ImageIO.h>
+
+
+
+/* chunked directory images, in Zarr (version 2) or N5 layout
+
+   the image is a directory ('.zarr' or '.n5') containing a JSON
+   attributes file ('.zarray' and '.zattrs' for Zarr, 'attributes.json'
+   for N5) and one file per chunk, each chunk being compressed
+   (zlib or gzip) or raw. The chunks are read and written in parallel
+   (with OpenMP), and only the chunks intersecting a region are read.
+
+   Regions can be written into an existing image with
+   writeChunkedImageRegion(): the chunks being independent files,
+   several processes can write disjoint regions concurrently
+   (provided they do not share chunks, ie the regions are aligned
+   on the chunks).
+*/
+
+
+
+/* chunk dimensions used for writing (default is 64 x 64 x 64)
+ */
+extern void _SetChunkSizeInImageIO( int x, int y, int z );
+extern void _GetChunkSizeInImageIO( int *x, int *y, int *z );
+
+/* compression level used for writing: 0 means raw chunks,
+   1 to 9 are zlib (Zarr) or gzip (N5) levels (default is 1)
+ */
+extern void _SetChunkCompressionInImageIO( int level );
+extern int _GetChunkCompressionInImageIO( );
+
+extern int readChunkedImage( const char *name, _image *im );
+extern int readChunkedImageRegion( const char *name, _image *im, size_t *first, size_t *dim );
+
+extern int writeChunkedImage( char *name, _image *im );
+
+/* writes the data of 'im' at 'first' in the existing image 'name'
+   (with the same type), chunks partially covered by the region
+   are read before being written.
+   returns 1 in case of success, -1 else
+ */
+extern int writeChunkedImageRegion( const char *name, _image *im, size_t *first );
+
+extern PTRIMAGE_FORMAT createChunkedFormat();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
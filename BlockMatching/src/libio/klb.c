@@ -1,5 +1,6 @@
 
 
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
@@ -31,33 +32,101 @@ int testKlbHeader( char *magic __attribute__ ((unused)), const char *name __attr
 
 
 
+/************************************************************
+ *
+ * time point selection
+ * files written with appendKLBtimePoint() (see klb_Cwrapper.h)
+ * contain one block series per time point: only one of them
+ * can be read (-1 means all time points)
+ *
+ ************************************************************/
+
+
+
+static int _klb_time_point_ = -1;
+
+/* the reader keeps its threads and buffers from one
+ * file to the next (see klb_imageReader.h), it is released
+ * at exit (or by _freeKlbReader())
+ */
+static klb_imageReader *_klb_reader_ = (klb_imageReader*)NULL;
+static int _klb_reader_at_exit_ = 0;
+
+void _freeKlbReader( )
+{
+  if ( _klb_reader_ != (klb_imageReader*)NULL )
+    deleteKLBreader( _klb_reader_ );
+  _klb_reader_ = (klb_imageReader*)NULL;
+}
+
+static klb_imageReader *_getKlbReader( )
+{
+  if ( _klb_reader_ == (klb_imageReader*)NULL ) {
+    /* -1 is numThreads
+     * numThreads <= 0 means as many threads as possible
+     */
+    _klb_reader_ = createKLBreader( -1 );
+    if ( _klb_reader_ != (klb_imageReader*)NULL && _klb_reader_at_exit_ == 0 ) {
+      if ( atexit( _freeKlbReader ) == 0 )
+        _klb_reader_at_exit_ = 1;
+    }
+  }
+  return( _klb_reader_ );
+}
+
+void _SetKlbTimePointInImageIO( int t )
+{
+  _klb_time_point_ = t;
+}
+
+int _GetKlbTimePointInImageIO( )
+{
+  return( _klb_time_point_ );
+}
+
+
+
+
+
 /************************************************************
  *
  *
  *
  ************************************************************/
 
-int readKlbImage( const char *name, _image *im )
+/* reads the header: word type, dimensions (xyzctR[4] is 1 if
+ * a time point is selected) and voxel sizes
+ */
+static int _readKlbHeader( const char *name, _image *im, uint32_t *xyzctR )
 {
-  char *proc = "readKlbImage";
-  uint32_t	xyzctR[KLB_DATA_DIMS];
+  char *proc = "_readKlbHeader";
   uint32_t	blockSizeR[KLB_DATA_DIMS];
   char metadataR[KLB_METADATA_SIZE];
   enum KLB_DATA_TYPE dataTypeR;
   enum KLB_COMPRESSION_TYPE compressionTypeR;
   float32_t pixelSizeR[KLB_METADATA_SIZE];
-  void *imRead = (void*)NULL;
 
   ImageIO_close(im);
   im->fd = NULL;
 
-  /* -1 is numThreads
-   * numThreads <= 0 means as many threads as possible
+  if ( _getKlbReader() == (klb_imageReader*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to create reader\n", proc );
+    return( -1 );
+  }
+
+  /* only the header is read here, the data
+   * is read once the type is known
    */
-  imRead = (void*)readKLBstack( name, xyzctR, &dataTypeR, -1, pixelSizeR, blockSizeR, &compressionTypeR, metadataR );
-  if ( imRead == (void*)NULL ) {
+  if ( readKLBreaderHeader( _klb_reader_, name, xyzctR, &dataTypeR, pixelSizeR, blockSizeR, &compressionTypeR, metadataR ) != 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: error when reading header of file '%s'\n", proc, name );
+    return( -1 );
+  }
+  if ( _klb_time_point_ >= 0 && (uint32_t)_klb_time_point_ >= xyzctR[4] ) {
     if ( _verbose_ )
-      fprintf( stderr, "%s: error when reading file '%s'\n", proc, name );
+      fprintf( stderr, "%s: time point #%d not in file '%s' (%u time points)\n",
+               proc, _klb_time_point_, name, xyzctR[4] );
     return( -1 );
   }
 
@@ -82,7 +151,6 @@ int readKlbImage( const char *name, _image *im )
    */
   switch( dataTypeR ) {
   default :
-      free( imRead );
       if ( _verbose_ )
         fprintf( stderr, "%s: such datatype (%d) not handled yet\n",
                  proc, dataTypeR );
@@ -139,13 +207,14 @@ int readKlbImage( const char *name, _image *im )
       break;
   }
 
-  /* dimensions
+  /* dimensions (of the selected time point)
    */
+  if ( _klb_time_point_ >= 0 )
+    xyzctR[4] = 1;
   im->xdim = xyzctR[0];
   im->ydim = xyzctR[1];
   im->zdim = xyzctR[2];
   if ( xyzctR[3] > 1 && xyzctR[4] > 1 ) {
-      free( imRead );
       if ( _verbose_ )
         fprintf( stderr, "%s: can not handle both c>1 and t>1\n",
                  proc );
@@ -162,6 +231,123 @@ int readKlbImage( const char *name, _image *im )
   im->vy = pixelSizeR[1];
   im->vz = pixelSizeR[2];
 
+  return( 1 );
+}
+
+
+
+int readKlbImage( const char *name, _image *im )
+{
+  char *proc = "readKlbImage";
+  uint32_t	xyzctR[KLB_DATA_DIMS];
+  void *imRead = (void*)NULL;
+  uint32_t xyzctLB[KLB_DATA_DIMS];
+  uint32_t xyzctUB[KLB_DATA_DIMS];
+  int i;
+
+  if ( _readKlbHeader( name, im, xyzctR ) != 1 )
+    return( -1 );
+
+  /* data (of the selected time point)
+   * it is directly decompressed into the image buffer
+   */
+  imRead = ImageIO_alloc( (size_t)xyzctR[0] * xyzctR[1] * xyzctR[2] * xyzctR[3] * xyzctR[4] * im->wdim );
+  if ( imRead == (void*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( -1 );
+  }
+  if ( _klb_time_point_ < 0 ) {
+    if ( readKLBreaderStackInPlace( _klb_reader_, name, imRead ) != 0 ) {
+      ImageIO_free( imRead );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: error when reading file '%s'\n", proc, name );
+      return( -1 );
+    }
+  }
+  else {
+    xyzctLB[0] = xyzctLB[1] = xyzctLB[2] = xyzctLB[3] = 0;
+    for ( i=0; i<4; i++ ) xyzctUB[i] = xyzctR[i] - 1;
+    xyzctLB[4] = xyzctUB[4] = _klb_time_point_;
+    if ( readKLBreaderRoiInPlace( _klb_reader_, name, imRead, xyzctLB, xyzctUB ) != 0 ) {
+      ImageIO_free( imRead );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: error when reading time point #%d of file '%s'\n",
+                 proc, _klb_time_point_, name );
+      return( -1 );
+    }
+  }
+
+  im->data = (unsigned char *) imRead;
+
+  return( 1 );
+}
+
+
+
+/* only the blocks intersecting the region are uncompressed
+ * (see _readImageRegion())
+ * vector images are written with their interlaced components
+ * as the c or t axis (see writeKlbImage()): a KLB region does
+ * not match an image region, 0 is returned so that the whole
+ * image is read then cropped
+ */
+int readKlbImageRegion( const char *name, _image *im, size_t *first, size_t *dim )
+{
+  char *proc = "readKlbImageRegion";
+  uint32_t	xyzctR[KLB_DATA_DIMS];
+  void *imRead = (void*)NULL;
+  uint32_t xyzctLB[KLB_DATA_DIMS];
+  uint32_t xyzctUB[KLB_DATA_DIMS];
+  int i;
+
+  if ( _readKlbHeader( name, im, xyzctR ) != 1 )
+    return( -1 );
+
+  /* header only
+   */
+  if ( first == (size_t*)NULL || dim == (size_t*)NULL )
+    return( 1 );
+
+  if ( im->vdim > 1 )
+    return( 0 );
+
+  for ( i=0; i<3; i++ ) {
+    if ( dim[i] == 0 || first[i] + dim[i] > xyzctR[i] ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: region %lu x %lu x %lu at (%lu,%lu,%lu) is not in image %u x %u x %u\n",
+                 proc, dim[0], dim[1], dim[2], first[0], first[1], first[2], xyzctR[0], xyzctR[1], xyzctR[2] );
+      return( -1 );
+    }
+    xyzctLB[i] = first[i];
+    xyzctUB[i] = first[i] + dim[i] - 1;
+  }
+  xyzctLB[3] = 0;
+  xyzctUB[3] = xyzctR[3] - 1;
+  if ( _klb_time_point_ >= 0 ) {
+    xyzctLB[4] = xyzctUB[4] = _klb_time_point_;
+  }
+  else {
+    xyzctLB[4] = 0;
+    xyzctUB[4] = xyzctR[4] - 1;
+  }
+
+  imRead = ImageIO_alloc( dim[0] * dim[1] * dim[2] * xyzctR[3] * xyzctR[4] * im->wdim );
+  if ( imRead == (void*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: allocation failed\n", proc );
+    return( -1 );
+  }
+  if ( readKLBreaderRoiInPlace( _klb_reader_, name, imRead, xyzctLB, xyzctUB ) != 0 ) {
+    ImageIO_free( imRead );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: error when reading region of file '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  im->xdim = dim[0];
+  im->ydim = dim[1];
+  im->zdim = dim[2];
   im->data = (unsigned char *) imRead;
 
   return( 1 );
@@ -177,27 +363,22 @@ int readKlbImage( const char *name, _image *im )
  *
  ************************************************************/
 
-int writeKlbImage( char *name, _image *im )
+static int _getKlbDataType( _image *im, enum KLB_DATA_TYPE *dataType )
 {
-  char *proc = "writeKlbImage";
-  uint32_t	xyzctR[KLB_DATA_DIMS];
-  enum KLB_DATA_TYPE dataTypeR;
-  enum KLB_COMPRESSION_TYPE compressionTypeR = BZIP2;
-  float32_t pixelSizeR[KLB_METADATA_SIZE];
-  int error;
+  char *proc = "_getKlbDataType";
 
   switch ( im->wordKind ) {
   case WK_FIXED :
     switch( im->sign ) {
     case SGN_UNSIGNED :
       if ( im->wdim  == sizeof( unsigned char ) ) {
-          dataTypeR = UINT8_TYPE;
+          *dataType = UINT8_TYPE;
       }
       else if ( im->wdim  == sizeof( unsigned short int ) ) {
-          dataTypeR = UINT16_TYPE;
+          *dataType = UINT16_TYPE;
       }
       else if ( im->wdim  == sizeof( unsigned int ) ) {
-          dataTypeR = UINT32_TYPE;
+          *dataType = UINT32_TYPE;
       }
       else {
         if ( _verbose_ )
@@ -207,13 +388,13 @@ int writeKlbImage( char *name, _image *im )
       break;
     case SGN_SIGNED :
       if ( im->wdim  == sizeof( char ) ) {
-          dataTypeR = INT8_TYPE;
+          *dataType = INT8_TYPE;
       }
       else if ( im->wdim  == sizeof( short int ) ) {
-          dataTypeR = INT16_TYPE;
+          *dataType = INT16_TYPE;
       }
       else if ( im->wdim  == sizeof( int ) ) {
-          dataTypeR = INT32_TYPE;
+          *dataType = INT32_TYPE;
       }
       else {
         if ( _verbose_ )
@@ -229,10 +410,10 @@ int writeKlbImage( char *name, _image *im )
     break;
   case WK_FLOAT :
     if ( im->wdim  == sizeof( float ) ) {
-        dataTypeR = FLOAT32_TYPE;
+        *dataType = FLOAT32_TYPE;
     }
     else if ( im->wdim  == sizeof( double ) ) {
-        dataTypeR = FLOAT64_TYPE;
+        *dataType = FLOAT64_TYPE;
     }
     else {
       if ( _verbose_ )
@@ -246,21 +427,53 @@ int writeKlbImage( char *name, _image *im )
     return( -1 );
   }
 
-  xyzctR[0] = im->xdim;
-  xyzctR[1] = im->ydim;
-  xyzctR[2] = im->zdim;
-  if ( im->vdim == 3 && dataTypeR == UINT8_TYPE ) {
-    xyzctR[3] = im->vdim;
-    xyzctR[4] = 1;
+  return( 1 );
+}
+
+
+
+static void _getKlbDimensions( _image *im, enum KLB_DATA_TYPE dataType, uint32_t *xyzct )
+{
+  xyzct[0] = im->xdim;
+  xyzct[1] = im->ydim;
+  xyzct[2] = im->zdim;
+  if ( im->vdim == 3 && dataType == UINT8_TYPE ) {
+    xyzct[3] = im->vdim;
+    xyzct[4] = 1;
   }
   else if ( im->vdim > 1 ) {
-    xyzctR[3] = 1;
-    xyzctR[4] = im->vdim;
+    xyzct[3] = 1;
+    xyzct[4] = im->vdim;
   }
   else {
-    xyzctR[3] = 1;
-    xyzctR[4] = 1;
+    xyzct[3] = 1;
+    xyzct[4] = 1;
   }
+}
+
+
+
+
+
+/************************************************************
+ *
+ *
+ *
+ ************************************************************/
+
+int writeKlbImage( char *name, _image *im )
+{
+  char *proc = "writeKlbImage";
+  uint32_t	xyzctR[KLB_DATA_DIMS];
+  enum KLB_DATA_TYPE dataTypeR;
+  enum KLB_COMPRESSION_TYPE compressionTypeR = BZIP2;
+  float32_t pixelSizeR[KLB_METADATA_SIZE];
+  int error;
+
+  if ( _getKlbDataType( im, &dataTypeR ) != 1 )
+    return( -1 );
+
+  _getKlbDimensions( im, dataTypeR, xyzctR );
 
   pixelSizeR[0] = im->vx;
   pixelSizeR[1] = im->vy;
@@ -283,6 +496,148 @@ int writeKlbImage( char *name, _image *im )
 
 
 
+/************************************************************
+ *
+ * pyramid levels
+ * (see readKLBpyramidLevelHeader() in klb_Cwrapper.h)
+ *
+ ************************************************************/
+
+
+
+static int _sameKlbSigma( float32_t *stored, float *sigma )
+{
+  int i;
+  double s, e;
+
+  for ( i=0; i<3; i++ ) {
+    s = ( sigma == (float*)NULL || sigma[i] < 0.0 ) ? 0.0 : sigma[i];
+    e = ( s > 1.0 ) ? 1e-3 * s : 1e-3;
+    if ( stored[i] < s - e || stored[i] > s + e ) return( 0 );
+  }
+  return( 1 );
+}
+
+
+
+/* the filter type only matters for filtered levels,
+ * unknown (-1) stored values never match
+ */
+static int _sameKlbFilterInfo( int32_t *stored, int *info, float *sigma )
+{
+  int i, filtered = 0;
+
+  if ( info == (int*)NULL ) return( 1 );
+  if ( sigma != (float*)NULL ) {
+    for ( i=0; i<3; i++ )
+      if ( sigma[i] > 0.0 ) filtered = 1;
+  }
+  if ( filtered && stored[0] != info[0] ) return( 0 );
+  if ( stored[1] != info[1] ) return( 0 );
+  return( 1 );
+}
+
+
+
+int readKlbPyramidLevel( const char *name, _image *im, float *sigma, int *info )
+{
+  char *proc = "readKlbPyramidLevel";
+  uint32_t xyzct[KLB_DATA_DIMS];
+  uint32_t xyzctR[KLB_DATA_DIMS];
+  enum KLB_DATA_TYPE dataType;
+  enum KLB_DATA_TYPE dataTypeR;
+  float32_t sigmaR[3];
+  int32_t infoR[2];
+  int l, n;
+
+  if ( _getKlbDataType( im, &dataType ) != 1 )
+    return( -1 );
+  _getKlbDimensions( im, dataType, xyzct );
+
+  n = getKLBnumPyramidLevels( name );
+
+  for ( l=1; l<=n; l++ ) {
+    if ( readKLBpyramidLevelHeader( name, l, xyzctR, &dataTypeR, NULL, sigmaR, infoR ) != 0 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to read header of level #%d of '%s'\n", proc, l, name );
+      return( -1 );
+    }
+    if ( dataTypeR != dataType
+         || memcmp( xyzctR, xyzct, KLB_DATA_DIMS * sizeof(uint32_t) ) != 0
+         || _sameKlbSigma( sigmaR, sigma ) == 0
+         || _sameKlbFilterInfo( infoR, info, sigma ) == 0 )
+      continue;
+
+    if ( _debug_ )
+      fprintf( stderr, "%s: read level #%d (%u x %u x %u) of '%s'\n",
+               proc, l, xyzctR[0], xyzctR[1], xyzctR[2], name );
+    if ( readKLBpyramidLevelInPlace( name, l, im->data, -1 ) != 0 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: error when reading level #%d of '%s'\n", proc, l, name );
+      return( -1 );
+    }
+    return( 1 );
+  }
+
+  return( 0 );
+}
+
+
+
+int writeKlbPyramidLevel( const char *name, _image *im, float *sigma, int *info )
+{
+  char *proc = "writeKlbPyramidLevel";
+  uint32_t xyzct[KLB_DATA_DIMS];
+  uint32_t xyzctR[KLB_DATA_DIMS];
+  uint32_t blockSizeR[KLB_DATA_DIMS];
+  char metadataR[KLB_METADATA_SIZE];
+  enum KLB_DATA_TYPE dataType;
+  enum KLB_DATA_TYPE dataTypeR;
+  enum KLB_COMPRESSION_TYPE compressionTypeR;
+  float32_t pixelSizeR[KLB_DATA_DIMS];
+  float32_t sigmaR[3] = {0.0, 0.0, 0.0};
+  int32_t infoR[2] = {-1, -1};
+  int i;
+
+  if ( _getKlbDataType( im, &dataType ) != 1 )
+    return( -1 );
+  _getKlbDimensions( im, dataType, xyzct );
+
+  /* levels are written with the data type of the full resolution image
+   */
+  if ( readKLBheader( name, xyzctR, &dataTypeR, pixelSizeR, blockSizeR, &compressionTypeR, metadataR ) != 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read header of '%s'\n", proc, name );
+    return( -1 );
+  }
+  if ( dataTypeR != dataType ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: level and '%s' have different types\n", proc, name );
+    return( -1 );
+  }
+
+  if ( sigma != (float*)NULL ) {
+    for ( i=0; i<3; i++ )
+      sigmaR[i] = ( sigma[i] > 0.0 ) ? sigma[i] : 0.0;
+  }
+  if ( info != (int*)NULL ) {
+    infoR[0] = info[0];
+    infoR[1] = info[1];
+  }
+
+  if ( writeKLBpyramidLevel( (const void*)im->data, name, xyzct, sigmaR, infoR, -1 ) != 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: error when writing level in '%s'\n", proc, name );
+    return( -1 );
+  }
+
+  return( 1 );
+}
+
+
+
+
+
 /************************************************************
  *
  *
@@ -302,6 +657,11 @@ PTRIMAGE_FORMAT createKlbFormat()
   f->writeImageHeader = NULL;
   f->writeImage = &writeKlbImage;
 
+  f->readPyramidLevel = &readKlbPyramidLevel;
+  f->writePyramidLevel = &writeKlbPyramidLevel;
+
+  f->readImageRegion = &readKlbImageRegion;
+
   strcpy(f->fileExtension,".klb");
   strcpy(f->realName,"Klb");
   return f;
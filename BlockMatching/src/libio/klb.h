@@ -9,6 +9,19 @@ extern "C" {
 #include <ImageIO.h>
 
 
+extern void _SetKlbTimePointInImageIO( int t );
+extern int _GetKlbTimePointInImageIO( );
+
+/* releases the threads and buffers of the KLB reader
+ * (done at exit), they are re-created by the next read
+ */
+extern void _freeKlbReader( );
+
+extern int readKlbImageRegion( const char *name, _image *im, size_t *first, size_t *dim );
+
+extern int readKlbPyramidLevel( const char *name, _image *im, float *sigma, int *info );
+extern int writeKlbPyramidLevel( const char *name, _image *im, float *sigma, int *info );
+
 extern PTRIMAGE_FORMAT createKlbFormat();
 
 #ifdef __cplusplus
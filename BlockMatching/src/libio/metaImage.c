@@ -415,24 +415,13 @@ int readMetaImage( const char *name, _image *im )
       size = im->xdim * im->ydim * im->zdim * im->vdim * im->wdim;
 
       if ( _testTag( tagarg, "LOCAL", (char**)NULL ) == 1 && tagarg[5] == '\0' ) {
-        if( !im->data ) {
-          im->data = (unsigned char *) ImageIO_alloc(size);
-          if ( _debug_ >= 2 ) {
-              fprintf( stderr, "%s: allocate %lu bytes at %p\n", proc, size, im->data );
-          }
-          if ( !im->data ) {
-            if ( _verbose_ )
-              fprintf( stderr, "%s: image buffer allocation failed\n", proc );
-            return( -2 );
-          }
-        }
-        nread = ImageIO_read(im, im->data, size);
-        if ( nread != size ) {
+        /* data are either mapped or read (and swapped)
+         */
+        if ( _readImageData( im ) != 1 ) {
             if ( _verbose_ )
               fprintf( stderr, "%s: image buffer reading failed\n", proc );
             return( -1 );
         }
-        _swapImageData( im );
         return( 1 );
       }
 
@@ -461,6 +450,24 @@ int readMetaImage( const char *name, _image *im )
         ImageIO_close(im);
         _openReadImage( im, rawname );
 
+        /* compute offset
+         */
+        if ( headersize == -1 ) {
+          headersize = (int)(getFileSize( rawname ) - (off_t)size);
+        }
+
+        if ( headersize >= 0 && _mapImageData( im, rawname, (size_t)headersize ) == 1 )
+          return( 1 );
+
+        switch ( _readBgzfImageData( im, rawname, (headersize > 0) ? (size_t)headersize : 0 ) ) {
+        default :
+          break;
+        case 1 :
+          return( 1 );
+        case -1 :
+          return( -1 );
+        }
+
         if( !im->data ) {
           im->data = (unsigned char *) ImageIO_alloc(size);
           if ( _debug_ >= 2 ) {
@@ -473,11 +480,6 @@ int readMetaImage( const char *name, _image *im )
           }
         }
 
-        /* compute offset
-         */
-        if ( headersize == -1 ) {
-          headersize = size - getFileSize( rawname );
-        }
         /* skip offset
          */
         if ( headersize > 0 ) {
@@ -278,7 +278,7 @@ int readNiftiImage( const char *name, _image *im )
    * \param read_data Flag, true=read data blob, false=don't read blob.
    * \return A pointer to the nifti_image data structure.
    */
-  nim = nifti_image_read( name, 1 ) ;
+  nim = nifti_image_read( name, 0 ) ;
   if ( _niftiImageToImageIOImage( nim, im ) != 1 ) {
     nifti_image_free( nim );
     if ( _verbose_ )
@@ -286,6 +286,45 @@ int readNiftiImage( const char *name, _image *im )
     return( -1 );
   }
 
+  /* scalar data are either mapped (uncompressed data) or
+     uncompressed in parallel (BGZF data), else they are read
+   */
+  if ( im->vdim == 1 && nim->iname != NULL && nim->iname_offset >= 0 ) {
+    /* byte order is 1 (little endian) or 2 (big endian) */
+    im->endianness = ( nim->byteorder == 2 ) ? END_BIG : END_LITTLE;
+    if ( !nifti_is_gzfile( nim->iname ) ) {
+      if ( _GetMemoryMappingInImageIO()
+           && _mapImageData( im, nim->iname, (size_t)nim->iname_offset ) == 1 ) {
+        im->endianness = _getEndianness();
+        nifti_image_free( nim );
+        return( 1 );
+      }
+    }
+    else {
+      switch ( _readBgzfImageData( im, nim->iname, (size_t)nim->iname_offset ) ) {
+      default :
+        break;
+      case 1 :
+        im->endianness = _getEndianness();
+        nifti_image_free( nim );
+        return( 1 );
+      case -1 :
+        nifti_image_free( nim );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to read nifti data\n", proc );
+        return( -1 );
+      }
+    }
+    im->endianness = _getEndianness();
+  }
+
+  if ( nifti_image_load( nim ) < 0 ) {
+    nifti_image_free( nim );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read nifti data\n", proc );
+    return( -1 );
+  }
+
   im->data = (unsigned char *) ImageIO_alloc( nim->nvox * nim->nbyper );
   if ( im->data == (unsigned char *)NULL ) {
     nifti_image_free( nim );
@@ -311,6 +350,58 @@ int readNiftiImage( const char *name, _image *im )
 
 
 
+/* only the data of the region are read (scalar images, see
+   _readImageRegionData()), else the whole image is read
+   (see _readImageRegion())
+ */
+int readNiftiImageRegion( const char *name, _image *im, size_t *first, size_t *dim )
+{
+  char *proc = "readNiftiImageRegion";
+  nifti_image *nim;
+
+  nim = nifti_image_read( name, 0 ) ;
+  if ( nim == NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read nifti header of '%s'\n", proc, name );
+    return( -1 );
+  }
+  if ( _niftiImageToImageIOImage( nim, im ) != 1 ) {
+    nifti_image_free( nim );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to translate nifti header\n", proc );
+    return( -1 );
+  }
+
+  /* header only
+   */
+  if ( first == (size_t*)NULL || dim == (size_t*)NULL ) {
+    nifti_image_free( nim );
+    return( 1 );
+  }
+
+  if ( im->vdim != 1 || nim->iname == NULL || nim->iname_offset < 0 ) {
+    nifti_image_free( nim );
+    return( 0 );
+  }
+
+  /* byte order is 1 (little endian) or 2 (big endian) */
+  im->endianness = ( nim->byteorder == 2 ) ? END_BIG : END_LITTLE;
+  if ( _readImageRegionData( im, nim->iname, (size_t)nim->iname_offset, first, dim ) != 1 ) {
+    nifti_image_free( nim );
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to read region of nifti data\n", proc );
+    return( -1 );
+  }
+  im->endianness = _getEndianness();
+
+  nifti_image_free( nim );
+  return( 1 );
+}
+
+
+
+
+
 /************************************************************
  *
  *
@@ -725,6 +816,8 @@ PTRIMAGE_FORMAT createNiftiFormat()
   f->writeImageHeader = &writeNiftiImageHeader;
   f->writeImage = &writeNiftiImage;
 
+  f->readImageRegion = &readNiftiImageRegion;
+
   strcpy(f->fileExtension,".nia,.nii,.nii.gz,.hdr,.img,.img.gz");
   strcpy(f->realName,"Nifti");
   return f;
@@ -0,0 +1,117 @@
+/*************************************************************************
+ * shm.c -
+ *
+ * $Id$
+ *
+ * Copyright (c) INRIA 2026, all rights reserved
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <shm.h>
+
+
+static int _verbose_ = 1;
+
+
+
+#define SHM_PREFIX "shm://"
+#define SHM_PREFIX_LENGTH 6
+
+
+
+int _isSharedMemoryName( const char *name )
+{
+  if ( name == (char*)NULL ) return( 0 );
+  return( strncmp( name, SHM_PREFIX, SHM_PREFIX_LENGTH ) == 0 );
+}
+
+
+
+/* 'shm://name' -> '/name'
+ * the object name can not contain any other '/'
+ */
+static char *_getSharedMemoryObjectName( const char *name )
+{
+  char *proc = "_getSharedMemoryObjectName";
+  const char *s = name + SHM_PREFIX_LENGTH;
+  char *object;
+
+  if ( s[0] == '\0' || strchr( s, '/' ) != (char*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: invalid shared memory name '%s'\n", proc, name );
+    return( (char*)NULL );
+  }
+  object = (char*)malloc( strlen( s ) + 2 );
+  if ( object == (char*)NULL ) return( object );
+  object[0] = '/';
+  strcpy( object+1, s );
+  return( object );
+}
+
+
+
+int _openSharedMemory( const char *name, int writing )
+{
+#ifndef WIN32
+  char *proc = "_openSharedMemory";
+  char *object;
+  int fd;
+
+  if ( !_isSharedMemoryName( name ) ) return( -1 );
+  object = _getSharedMemoryObjectName( name );
+  if ( object == (char*)NULL ) return( -1 );
+
+  if ( writing )
+    fd = shm_open( object, O_RDWR | O_CREAT | O_TRUNC, 0666 );
+  else
+    fd = shm_open( object, O_RDONLY, 0 );
+
+  if ( fd < 0 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to open shared memory object '%s'\n", proc, object );
+  }
+  free( object );
+  return( fd );
+#else
+  return( -1 );
+#endif
+}
+
+
+
+int _removeSharedMemory( const char *name )
+{
+#ifndef WIN32
+  char *object;
+  int r;
+
+  if ( !_isSharedMemoryName( name ) ) return( -1 );
+  object = _getSharedMemoryObjectName( name );
+  if ( object == (char*)NULL ) return( -1 );
+  r = shm_unlink( object );
+  free( object );
+  return( ( r == 0 ) ? 1 : -1 );
+#else
+  return( -1 );
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef SHM_H
+#define SHM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/* POSIX shared memory images
+
+   'shm://name' designates the shared memory object '/name'
+   (/dev/shm/name on Linux). Such images are written as inrimages
+   (header followed by raw data) and their data are mapped, not
+   copied, when read (see _mapImageData()), so that processes can
+   exchange images without disk I/O.
+   As for mapped files, a segment must not be re-written while an
+   image read from it is in use; segments persist until they are
+   removed (with _removeSharedMemory() or by deleting /dev/shm/name),
+   or once read if _SetSharedMemoryUnlinkInImageIO() has been set.
+*/
+
+
+
+/* returns 1 if 'name' is a 'shm://' name, 0 else
+ */
+extern int _isSharedMemoryName( const char *name );
+
+/* opens the shared memory object, for reading (writing = 0) or
+   for writing (then it is created or truncated)
+   returns a file descriptor, -1 in case of error
+ */
+extern int _openSharedMemory( const char *name, int writing );
+
+/* returns 1 in case of success, -1 else
+ */
+extern int _removeSharedMemory( const char *name );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
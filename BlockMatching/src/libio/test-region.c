@@ -0,0 +1,127 @@
+/*************************************************************************
+ * test-region.c -
+ *
+ * Copyright (c) INRIA 2026
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ *
+ * region reading: the region read with _readImageRegion() is the
+ * same as the one cropped from the whole image read with _readImage(),
+ * for scalar and vector images
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ImageIO.h>
+
+
+
+static char *_names[] = { "test-region.inr",
+#ifdef _KLB_
+                          "test-region.klb",
+#endif
+                          NULL };
+
+typedef struct {
+  int vdim;
+  int wdim;
+} _testCase;
+
+static _testCase _cases[] = { { 1, 2 }, { 3, 1 }, { 2, 2 }, { 0, 0 } };
+
+
+
+static _image *_buildImage( int vdim, int wdim )
+{
+  _image *im;
+  unsigned char *buf;
+  size_t i, n;
+
+  im = _initImage();
+  im->xdim = 13;
+  im->ydim = 11;
+  im->zdim = 7;
+  im->vdim = vdim;
+  im->wdim = wdim;
+  im->wordKind = WK_FIXED;
+  im->sign = SGN_UNSIGNED;
+  if ( vdim > 1 ) im->vectMode = VM_INTERLACED;
+  n = im->xdim * im->ydim * im->zdim * im->vdim * im->wdim;
+  im->data = ImageIO_alloc( n );
+  buf = (unsigned char*)im->data;
+  for ( i=0; i<n; i++ )
+    buf[i] = (unsigned char)( (i * 7) % 251 );
+  return( im );
+}
+
+
+
+/* compares the region with the crop of the whole image
+ */
+static int _sameRegion( _image *whole, _image *region, size_t *first, size_t *dim )
+{
+  size_t voxelsize = (size_t)whole->vdim * (size_t)whole->wdim;
+  size_t rowsize = dim[0] * voxelsize;
+  size_t y, z;
+  unsigned char *r, *w;
+
+  if ( region->xdim != dim[0] || region->ydim != dim[1] || region->zdim != dim[2]
+       || region->vdim != whole->vdim || region->wdim != whole->wdim )
+    return( 0 );
+
+  for ( r=(unsigned char*)region->data, z=0; z<dim[2]; z++ )
+  for ( y=0; y<dim[1]; y++, r+=rowsize ) {
+    w = (unsigned char*)whole->data
+      + ( ((first[2]+z) * whole->ydim + first[1]+y) * whole->xdim + first[0] ) * voxelsize;
+    if ( memcmp( r, w, rowsize ) != 0 ) return( 0 );
+  }
+  return( 1 );
+}
+
+
+
+int main( )
+{
+  size_t first[3] = { 2, 3, 1 };
+  size_t dim[3] = { 5, 4, 3 };
+  _image *theIm, *wholeIm, *regionIm;
+  int n, c;
+  int failures = 0;
+
+  for ( n=0; _names[n] != NULL; n++ )
+  for ( c=0; _cases[c].vdim > 0; c++ ) {
+
+    theIm = _buildImage( _cases[c].vdim, _cases[c].wdim );
+    if ( _writeImage( theIm, _names[n] ) != 0 ) {
+      fprintf( stderr, "'%s' (vdim=%d): unable to write image\n", _names[n], _cases[c].vdim );
+      _freeImage( theIm );
+      failures ++;
+      continue;
+    }
+    _freeImage( theIm );
+
+    wholeIm = _readImage( _names[n] );
+    regionIm = _readImageRegion( _names[n], first, dim );
+    if ( wholeIm == NULL || regionIm == NULL ) {
+      fprintf( stderr, "'%s' (vdim=%d): unable to read image or region\n", _names[n], _cases[c].vdim );
+      failures ++;
+    }
+    else if ( _sameRegion( wholeIm, regionIm, first, dim ) == 0 ) {
+      fprintf( stderr, "'%s' (vdim=%d): region differs from the cropped image\n", _names[n], _cases[c].vdim );
+      failures ++;
+    }
+    if ( wholeIm != NULL ) _freeImage( wholeIm );
+    if ( regionIm != NULL ) _freeImage( regionIm );
+    (void)remove( _names[n] );
+  }
+
+  return( failures == 0 ? 0 : 1 );
+}
@@ -0,0 +1,116 @@
+/*************************************************************************
+ * test-shm.c -
+ *
+ * Copyright (c) INRIA 2026
+ *
+ * AUTHOR:
+ * Gregoire Malandain (gregoire.malandain@inria.fr)
+ *
+ * CREATION DATE:
+ * Mon Oct 19 2026
+ *
+ * ADDITIONS, CHANGES
+ *
+ *
+ * shared memory images: read-back of a written image, the segment
+ * persists after reading, and is removed once read (with valid data)
+ * if _SetSharedMemoryUnlinkInImageIO() has been set
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ImageIO.h>
+#include <shm.h>
+
+
+
+static int _segmentExists( char *name )
+{
+  int fd = _openSharedMemory( name, 0 );
+  if ( fd < 0 ) return( 0 );
+  close( fd );
+  return( 1 );
+}
+
+
+
+static int _sameImages( _image *im1, _image *im2 )
+{
+  if ( im1->xdim != im2->xdim || im1->ydim != im2->ydim || im1->zdim != im2->zdim
+       || im1->vdim != im2->vdim || im1->wdim != im2->wdim
+       || im1->wordKind != im2->wordKind || im1->sign != im2->sign )
+    return( 0 );
+  if ( memcmp( im1->data, im2->data, im1->xdim*im1->ydim*im1->zdim*im1->vdim*im1->wdim ) != 0 )
+    return( 0 );
+  return( 1 );
+}
+
+
+
+int main( )
+{
+  char name[64];
+  _image *theIm, *readIm;
+  unsigned short int *buf;
+  size_t i, n;
+  int failures = 0;
+
+  sprintf( name, "shm://vt-test-shm-%ld", (long int)getpid() );
+
+  theIm = _initImage();
+  theIm->xdim = 23;
+  theIm->ydim = 17;
+  theIm->zdim = 9;
+  theIm->vdim = 1;
+  theIm->wdim = 2;
+  theIm->wordKind = WK_FIXED;
+  theIm->sign = SGN_UNSIGNED;
+  n = theIm->xdim * theIm->ydim * theIm->zdim;
+  theIm->data = ImageIO_alloc( n * theIm->wdim );
+  buf = (unsigned short int*)theIm->data;
+  for ( i=0; i<n; i++ )
+    buf[i] = (unsigned short int)( (i * 37) % 65521 );
+
+  if ( _writeImage( theIm, name ) != 0 ) {
+    fprintf( stderr, "unable to write '%s'\n", name );
+    _freeImage( theIm );
+    return( 1 );
+  }
+
+  /* default: the segment persists after reading
+   */
+  _SetSharedMemoryUnlinkInImageIO( 0 );
+  readIm = _readImage( name );
+  if ( readIm == NULL || _sameImages( theIm, readIm ) == 0 ) {
+    fprintf( stderr, "'%s' is not read back\n", name );
+    failures ++;
+  }
+  if ( readIm != NULL ) _freeImage( readIm );
+  if ( _segmentExists( name ) == 0 ) {
+    fprintf( stderr, "'%s' has been removed by reading\n", name );
+    failures ++;
+  }
+
+  /* the segment is removed once read, the data remain valid
+   */
+  _SetSharedMemoryUnlinkInImageIO( 1 );
+  readIm = _readImage( name );
+  if ( _segmentExists( name ) == 1 ) {
+    fprintf( stderr, "'%s' has not been removed by reading\n", name );
+    failures ++;
+  }
+  if ( readIm == NULL || _sameImages( theIm, readIm ) == 0 ) {
+    fprintf( stderr, "'%s' is not valid after removal\n", name );
+    failures ++;
+  }
+  if ( readIm != NULL ) _freeImage( readIm );
+  _SetSharedMemoryUnlinkInImageIO( 0 );
+
+  if ( _segmentExists( name ) == 1 )
+    (void)_removeSharedMemory( name );
+  _freeImage( theIm );
+
+  return( failures == 0 ? 0 : 1 );
+}
@@ -1,5 +1,9 @@
 #include <string.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include <tiffio.h>
 
 #include <tif.h>
@@ -14,6 +18,62 @@ static int _debug_ = 0;
  */
 #define TIFF_BE_MAGIC "\115\115\000\052"
 
+/** above this data size, files are written as BigTIFF
+ * (classic TIFF offsets are 32 bits, some margin is kept
+ * for the directories and for incompressible data)
+ */
+#define TIFF_CLASSIC_MAX_SIZE 3221225472UL
+
+
+
+/************************************************************
+ *
+ * writing parameters
+ * - compression is one of the COMPRESSION_* values of tiff.h
+ *   (1: none, 5: LZW, 8: deflate, 32773: packbits)
+ * - strip size is in bytes (0 means libtiff default, ie 8 KB),
+ *   it is rounded to a number of rows
+ * - BigTIFF is used if required by the image size, or always
+ *   if set
+ *
+ ************************************************************/
+
+
+
+static int _tiff_compression_ = COMPRESSION_NONE;
+static size_t _tiff_strip_size_ = 0;
+static int _tiff_bigtiff_ = 0;
+
+void _SetTiffCompressionInImageIO( int c )
+{
+  _tiff_compression_ = c;
+}
+
+int _GetTiffCompressionInImageIO( )
+{
+  return( _tiff_compression_ );
+}
+
+void _SetTiffStripSizeInImageIO( size_t s )
+{
+  _tiff_strip_size_ = s;
+}
+
+size_t _GetTiffStripSizeInImageIO( )
+{
+  return( _tiff_strip_size_ );
+}
+
+void _SetBigTiffWritingInImageIO( int b )
+{
+  _tiff_bigtiff_ = b;
+}
+
+int _GetBigTiffWritingInImageIO( )
+{
+  return( _tiff_bigtiff_ );
+}
+
 
 
 
@@ -288,12 +348,13 @@ static int _CanReadInternalTiffImage( _internalTiffImage *im )
                   || im->m_Photometrics == PHOTOMETRIC_MINISWHITE
                   || im->m_Photometrics == PHOTOMETRIC_MINISBLACK
                   || ( im->m_Photometrics == PHOTOMETRIC_PALETTE
-                       && im->m_BitsPerSample != 32 )
+                       && ( im->m_BitsPerSample == 8 || im->m_BitsPerSample == 16 ) )
                   )
              && ( im->m_PlanarConfig == PLANARCONFIG_CONTIG )
              && ( im->m_Orientation == ORIENTATION_TOPLEFT
                   || im->m_Orientation == ORIENTATION_BOTLEFT )
-             && ( im->m_BitsPerSample == 8 || im->m_BitsPerSample == 16 || im->m_BitsPerSample == 32 ) );
+             && ( im->m_BitsPerSample == 8 || im->m_BitsPerSample == 16
+                  || im->m_BitsPerSample == 32 || im->m_BitsPerSample == 64 ) );
 
 }
 
@@ -556,8 +617,8 @@ static int _readTiffPage( _internalTiffImage *tiffImage, _image *im )
      * one has to implement the equivalent of
      * TIFFImageIO::InitializeColors() here
      */
-    if ( ( im->wordKind == WK_FIXED && (im->wdim == 1 || im->wdim == 2) )
-         || ( im->wordKind == WK_FLOAT && im->wdim == 4 ) ) {
+    if ( ( im->wordKind == WK_FIXED && (im->wdim == 1 || im->wdim == 2 || im->wdim == 4) )
+         || ( im->wordKind == WK_FLOAT && (im->wdim == 4 || im->wdim == 8) ) ) {
       if ( _ReadGenericImage( tiffImage, im ) != 1 ) {
         if ( _verbose_ )
           fprintf( stderr, "%s: error when reading image\n", proc );
@@ -601,7 +662,11 @@ static int _readTiffVolume( _internalTiffImage *tiffImage, _image *im )
       }
     }
 
-    _readTiffPage( tiffImage, im );
+    if ( _readTiffPage( tiffImage, im ) != 1 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: error when reading page #%d\n", proc, page );
+      return( -1 );
+    }
 
     if ( page < tiffImage->m_NumberOfPages-1 )
         tiffImage->m_Buffer += im->xdim * im->ydim * im->vdim * im->wdim;
@@ -615,6 +680,214 @@ static int _readTiffVolume( _internalTiffImage *tiffImage, _image *im )
 
 
 
+/* pages are decoded in parallel, each thread having its own
+ * TIFF handle, strip by strip (or tile by tile) with
+ * TIFFReadEncodedStrip() (or TIFFReadEncodedTile()) directly
+ * into the image buffer. It requires grayscale or RGB (no palette)
+ * images whose pages all have the same dimensions and type.
+ */
+static int _CanReadInParallelInternalTiffImage( _internalTiffImage *tiffImage, _image *im )
+{
+    return ( tiffImage->m_Image && ( tiffImage->m_Width > 0 ) && ( tiffImage->m_Height > 0 )
+             && ( TIFFIsCODECConfigured(tiffImage->m_Compression) == 1 )
+             && ( tiffImage->m_IgnoredSubFiles == 0 )
+             && ( tiffImage->m_HasValidPhotometricInterpretation )
+             && ( tiffImage->m_ImageFormat == FORMAT_GRAYSCALE
+                  || tiffImage->m_ImageFormat == FORMAT_RGB )
+             && ( tiffImage->m_Photometrics != PHOTOMETRIC_YCBCR )
+             && ( tiffImage->m_SamplesPerPixel == im->vdim )
+             && ( tiffImage->m_PlanarConfig == PLANARCONFIG_CONTIG )
+             && ( tiffImage->m_Orientation == ORIENTATION_TOPLEFT
+                  || tiffImage->m_Orientation == ORIENTATION_BOTLEFT )
+             && ( tiffImage->m_BitsPerSample == 8 * im->wdim ) );
+}
+
+
+
+/* reads the current directory of 'tif' into 'page'
+ * 'aux' is an auxiliary buffer (for tiles and row flipping)
+ * of at least 'auxSize' bytes, it is reallocated if required
+ */
+static int _readTiffDirectoryData( TIFF *tif, _internalTiffImage *tiffImage, _image *im,
+                                   unsigned char *page,
+                                   unsigned char **aux, size_t *auxSize )
+{
+  char *proc = "_readTiffDirectoryData";
+  uint32 width = 0, height = 0, rowsPerStrip = 0, tileWidth = 0, tileHeight = 0;
+  uint16 spp = 0, bps = 0, planar = 0, orientation = 0;
+  size_t rowSize = (size_t)im->xdim * im->vdim * im->wdim;
+  size_t pixSize = (size_t)im->vdim * im->wdim;
+  size_t size, w;
+  uint32 row, nrows, x, y, r;
+  tstrip_t s, nstrips;
+  unsigned char *tmp;
+
+  if ( !TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width)
+       || !TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height) ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to get image length or width\n", proc );
+    return( -1 );
+  }
+  TIFFGetFieldDefaulted( tif, TIFFTAG_SAMPLESPERPIXEL, &spp );
+  TIFFGetFieldDefaulted( tif, TIFFTAG_BITSPERSAMPLE, &bps );
+  TIFFGetFieldDefaulted( tif, TIFFTAG_PLANARCONFIG, &planar );
+  TIFFGetFieldDefaulted( tif, TIFFTAG_ORIENTATION, &orientation );
+
+  if ( width != im->xdim || height != im->ydim || spp != tiffImage->m_SamplesPerPixel
+       || bps != tiffImage->m_BitsPerSample || planar != tiffImage->m_PlanarConfig
+       || orientation != tiffImage->m_Orientation ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: pages have different dimensions or types\n", proc );
+    return( -1 );
+  }
+
+  if ( TIFFIsTiled(tif) ) {
+    if ( !TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tileWidth)
+         || !TIFFGetField(tif, TIFFTAG_TILELENGTH, &tileHeight)
+         || tileWidth == 0 || tileHeight == 0 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to get tile length or width\n", proc );
+      return( -1 );
+    }
+    size = (size_t)TIFFTileSize(tif);
+    if ( size < rowSize ) size = rowSize;
+  }
+  else {
+    size = rowSize;
+  }
+  if ( size > *auxSize ) {
+    tmp = (unsigned char*)realloc( *aux, size );
+    if ( tmp == (unsigned char*)NULL ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to allocate auxiliary buffer\n", proc );
+      return( -1 );
+    }
+    *aux = tmp;
+    *auxSize = size;
+  }
+
+  if ( TIFFIsTiled(tif) ) {
+    for ( y=0; y<height; y+=tileHeight )
+    for ( x=0; x<width; x+=tileWidth ) {
+      if ( TIFFReadEncodedTile( tif, TIFFComputeTile(tif, x, y, 0, 0), *aux, (tmsize_t)size ) < 0 ) {
+        if ( _verbose_ )
+          fprintf( stderr, "%s: problem reading tile (%u,%u)\n", proc, x, y );
+        return( -1 );
+      }
+      w = ( x + tileWidth <= width ) ? tileWidth : width - x;
+      for ( r=0; r<tileHeight && y+r<height; r++ )
+        memcpy( page + (size_t)(y+r) * rowSize + (size_t)x * pixSize,
+                *aux + (size_t)r * tileWidth * pixSize, w * pixSize );
+    }
+  }
+  else {
+    TIFFGetFieldDefaulted( tif, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip );
+    if ( rowsPerStrip == 0 || rowsPerStrip > height ) rowsPerStrip = height;
+    nstrips = TIFFNumberOfStrips( tif );
+    for ( s=0, row=0; s<nstrips && row<height; s++, row+=rowsPerStrip ) {
+      nrows = ( row + rowsPerStrip <= height ) ? rowsPerStrip : height - row;
+      if ( TIFFReadEncodedStrip( tif, s, page + (size_t)row * rowSize,
+                                 (tmsize_t)(nrows * rowSize) ) < (tmsize_t)(nrows * rowSize) ) {
+        if ( _verbose_ )
+          fprintf( stderr, "%s: problem reading strip #%u\n", proc, s );
+        return( -1 );
+      }
+    }
+  }
+
+  /* bottom left: rows are flipped
+   */
+  if ( orientation == ORIENTATION_BOTLEFT ) {
+    for ( row=0; row<height/2; row++ ) {
+      memcpy( *aux, page + (size_t)row * rowSize, rowSize );
+      memcpy( page + (size_t)row * rowSize, page + (size_t)(height-1-row) * rowSize, rowSize );
+      memcpy( page + (size_t)(height-1-row) * rowSize, *aux, rowSize );
+    }
+  }
+
+  return( 1 );
+}
+
+
+
+static int _readTiffVolumeInParallel( const char *name, _internalTiffImage *tiffImage, _image *im )
+{
+  char *proc = "_readTiffVolumeInParallel";
+  int npages = tiffImage->m_NumberOfPages;
+  size_t pageSize = (size_t)im->xdim * im->ydim * im->vdim * im->wdim;
+  toff_t *offsets;
+  int page, error = 0;
+  int nthreads = _GetNumberOfThreadsInImageIO( npages );
+
+  /* directory offsets, so that each thread can go
+   * directly to its pages
+   */
+  offsets = (toff_t*)malloc( npages * sizeof(toff_t) );
+  if ( offsets == (toff_t*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to allocate offsets\n", proc );
+    return( -1 );
+  }
+  TIFFSetDirectory( tiffImage->m_Image, 0 );
+  for ( page = 0; page < npages; page++ ) {
+    offsets[page] = TIFFCurrentDirOffset( tiffImage->m_Image );
+    if ( page < npages-1 && TIFFReadDirectory( tiffImage->m_Image ) != 1 ) {
+      free( offsets );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to read directory #%d\n", proc, page+1 );
+      return( -1 );
+    }
+  }
+  TIFFSetDirectory( tiffImage->m_Image, 0 );
+
+  /* each thread stops at its first error, errors are
+   * gathered at the end
+   */
+#ifdef _OPENMP
+#pragma omp parallel private( page ) num_threads( nthreads ) reduction( | : error )
+#endif
+  {
+    TIFF *tif = TIFFOpen( name, "r" );
+    unsigned char *aux = (unsigned char*)NULL;
+    size_t auxSize = 0;
+    int threadError = 0;
+
+    if ( tif == (TIFF*)NULL ) threadError = 1;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for ( page = 0; page < npages; page++ ) {
+      if ( threadError ) continue;
+      if ( _debug_ ) {
+        fprintf( stderr, "%s: read page #%d/%d\n", proc, page, npages );
+      }
+      if ( TIFFSetSubDirectory( tif, offsets[page] ) != 1
+           || _readTiffDirectoryData( tif, tiffImage, im,
+                                      (unsigned char*)im->data + (size_t)page * pageSize,
+                                      &aux, &auxSize ) != 1 ) {
+        threadError = 1;
+      }
+    }
+
+    if ( aux != (unsigned char*)NULL ) free( aux );
+    if ( tif != (TIFF*)NULL ) TIFFClose( tif );
+    error |= threadError;
+  }
+
+  free( offsets );
+
+  if ( error ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: error when reading '%s'\n", proc, name );
+    return( -1 );
+  }
+  return( 1 );
+}
+
+
+
+
 
 
 /* inspired from TIFFImageIO::ReadImageInformation()
@@ -706,7 +979,23 @@ static int _tiffImageToImageIOImage( _internalTiffImage *m_InternalImage, _image
         im->wdim = 4;
         im->wordKind = WK_FLOAT;
         im->sign = SGN_SIGNED;
-      }
+    }
+    else if ( m_InternalImage->m_SampleFormat == 2 ) {
+        im->wdim = 4;
+        im->wordKind = WK_FIXED;
+        im->sign = SGN_SIGNED;
+    }
+    else {
+        im->wdim = 4;
+        im->wordKind = WK_FIXED;
+        im->sign = SGN_UNSIGNED;
+    }
+  }
+  else if ( m_InternalImage->m_BitsPerSample == 64
+            && m_InternalImage->m_SampleFormat == 3 ) {
+        im->wdim = 8;
+        im->wordKind = WK_FLOAT;
+        im->sign = SGN_SIGNED;
   }
   else {
       if ( _verbose_ )
@@ -762,7 +1051,19 @@ int readTiffImage( const char *name, _image *im )
     return( -1 );
   }
 
-  if ( tiffImage.m_NumberOfPages > 0 ) {
+  if ( _CanReadInParallelInternalTiffImage( &tiffImage, im ) ) {
+
+    if ( _readTiffVolumeInParallel( name, &tiffImage, im ) != 1 ) {
+      _freeImage( im );
+      _CleanInternalTiffImage( &(tiffImage) );
+      _InitInternalTiffImage( &tiffImage );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: error when reading tiff pages\n", proc );
+      return( -1 );
+    }
+
+  }
+  else if ( tiffImage.m_NumberOfPages > 0 ) {
 
     if ( _readTiffVolume( &tiffImage, im ) != 1 ) {
       _freeImage( im );
@@ -809,6 +1110,160 @@ int readTiffImage( const char *name, _image *im )
 
 
 
+/************************************************************
+ *
+ * writing: one directory (page) per plane, data are
+ * written strip by strip with TIFFWriteEncodedStrip()
+ *
+ ************************************************************/
+
+
+
+int writeTiffImage( char *name, _image *im )
+{
+  char *proc = "writeTiffImage";
+  TIFF *tif;
+  size_t rowSize = (size_t)im->xdim * im->vdim * im->wdim;
+  size_t pageSize = rowSize * im->ydim;
+  size_t size = pageSize * im->zdim;
+  uint32 rowsPerStrip = 0, row, nrows;
+  uint16 sampleFormat;
+  tstrip_t s;
+  unsigned int z;
+  char *mode = "w";
+  unsigned char *strip = (unsigned char*)NULL;
+
+  if ( im->data == (void*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: no data to be written\n", proc );
+    return( -1 );
+  }
+
+  if ( im->vdim != 1 && ( im->vdim != 3 || im->vectMode == VM_NON_INTERLACED ) ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such vectorial dimension (%u) not handled\n", proc, im->vdim );
+    return( -1 );
+  }
+
+  switch ( im->wordKind ) {
+  default :
+    if ( _verbose_ )
+      fprintf( stderr, "%s: such word kind not handled\n", proc );
+    return( -1 );
+  case WK_FIXED :
+    if ( im->wdim != 1 && im->wdim != 2 && im->wdim != 4 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: such word dimension not handled\n", proc );
+      return( -1 );
+    }
+    sampleFormat = ( im->sign == SGN_SIGNED ) ? SAMPLEFORMAT_INT : SAMPLEFORMAT_UINT;
+    break;
+  case WK_FLOAT :
+    if ( im->wdim != 4 && im->wdim != 8 ) {
+      if ( _verbose_ )
+        fprintf( stderr, "%s: such word dimension not handled\n", proc );
+      return( -1 );
+    }
+    sampleFormat = SAMPLEFORMAT_IEEEFP;
+    break;
+  }
+
+  if ( TIFFIsCODECConfigured( (uint16)_tiff_compression_ ) != 1 ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: compression scheme %d not available\n", proc, _tiff_compression_ );
+    return( -1 );
+  }
+
+  if ( _tiff_bigtiff_ || size > TIFF_CLASSIC_MAX_SIZE ) mode = "w8";
+
+  tif = TIFFOpen( name, mode );
+  if ( tif == (TIFF*)NULL ) {
+    if ( _verbose_ )
+      fprintf( stderr, "%s: unable to open '%s' for writing\n", proc, name );
+    return( -1 );
+  }
+
+  if ( _tiff_strip_size_ > 0 ) {
+    rowsPerStrip = ( _tiff_strip_size_ > rowSize ) ? (uint32)(_tiff_strip_size_ / rowSize) : 1;
+    if ( rowsPerStrip > im->ydim ) rowsPerStrip = im->ydim;
+  }
+
+  for ( z=0; z<im->zdim; z++ ) {
+
+    TIFFSetField( tif, TIFFTAG_IMAGEWIDTH, (uint32)im->xdim );
+    TIFFSetField( tif, TIFFTAG_IMAGELENGTH, (uint32)im->ydim );
+    TIFFSetField( tif, TIFFTAG_SAMPLESPERPIXEL, (uint16)im->vdim );
+    TIFFSetField( tif, TIFFTAG_BITSPERSAMPLE, (uint16)(8 * im->wdim) );
+    TIFFSetField( tif, TIFFTAG_SAMPLEFORMAT, sampleFormat );
+    TIFFSetField( tif, TIFFTAG_PHOTOMETRIC, ( im->vdim == 3 ) ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK );
+    TIFFSetField( tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG );
+    TIFFSetField( tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT );
+    TIFFSetField( tif, TIFFTAG_COMPRESSION, (uint16)_tiff_compression_ );
+    if ( _tiff_compression_ == COMPRESSION_LZW
+         || _tiff_compression_ == COMPRESSION_ADOBE_DEFLATE
+         || _tiff_compression_ == COMPRESSION_DEFLATE ) {
+      TIFFSetField( tif, TIFFTAG_PREDICTOR,
+                    ( im->wordKind == WK_FLOAT ) ? PREDICTOR_FLOATINGPOINT : PREDICTOR_HORIZONTAL );
+    }
+    if ( im->zdim > 1 ) {
+      TIFFSetField( tif, TIFFTAG_SUBFILETYPE, FILETYPE_PAGE );
+      TIFFSetField( tif, TIFFTAG_PAGENUMBER, (uint16)z, (uint16)im->zdim );
+    }
+    /* voxel sizes are in mm
+     */
+    if ( im->vx > 0.0 && im->vy > 0.0 ) {
+      TIFFSetField( tif, TIFFTAG_RESOLUTIONUNIT, RESUNIT_CENTIMETER );
+      TIFFSetField( tif, TIFFTAG_XRESOLUTION, (float)(10.0 / im->vx) );
+      TIFFSetField( tif, TIFFTAG_YRESOLUTION, (float)(10.0 / im->vy) );
+    }
+    if ( _tiff_strip_size_ == 0 )
+      rowsPerStrip = TIFFDefaultStripSize( tif, 0 );
+    TIFFSetField( tif, TIFFTAG_ROWSPERSTRIP, rowsPerStrip );
+
+    /* the strip is copied, since libtiff may modify it
+     * (predictor, byte swapping)
+     */
+    if ( strip == (unsigned char*)NULL ) {
+      strip = (unsigned char*)malloc( (size_t)rowsPerStrip * rowSize );
+      if ( strip == (unsigned char*)NULL ) {
+        TIFFClose( tif );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to allocate strip buffer\n", proc );
+        return( -1 );
+      }
+    }
+
+    for ( s=0, row=0; row<im->ydim; s++, row+=rowsPerStrip ) {
+      nrows = ( row + rowsPerStrip <= im->ydim ) ? rowsPerStrip : im->ydim - row;
+      memcpy( strip, (unsigned char*)im->data + z * pageSize + (size_t)row * rowSize, nrows * rowSize );
+      if ( TIFFWriteEncodedStrip( tif, s, strip, (tmsize_t)(nrows * rowSize) ) < 0 ) {
+        free( strip );
+        TIFFClose( tif );
+        if ( _verbose_ )
+          fprintf( stderr, "%s: unable to write strip #%u of plane #%u\n", proc, s, z );
+        return( -1 );
+      }
+    }
+
+    if ( TIFFWriteDirectory( tif ) != 1 ) {
+      free( strip );
+      TIFFClose( tif );
+      if ( _verbose_ )
+        fprintf( stderr, "%s: unable to write directory of plane #%u\n", proc, z );
+      return( -1 );
+    }
+  }
+
+  free( strip );
+  TIFFClose( tif );
+  return( 1 );
+}
+
+
+
+
+
+
 PTRIMAGE_FORMAT createTifFormat()
 {
   PTRIMAGE_FORMAT f=(PTRIMAGE_FORMAT) ImageIO_alloc(sizeof(IMAGE_FORMAT));
@@ -818,7 +1273,7 @@ PTRIMAGE_FORMAT createTifFormat()
   f->readImageHeader = &readTiffImage;
   f->readImageData = NULL;
   f->writeImageHeader = NULL;
-  f->writeImage = NULL;
+  f->writeImage = &writeTiffImage;
 
   strcpy(f->fileExtension,".tif,.TIF,.tiff,.TIFF");
   strcpy(f->realName,"Tiff");
@@ -8,6 +8,17 @@ extern "C" {
 #include <ImageIO.h>
 
 
+extern void _SetTiffCompressionInImageIO( int c );
+extern int _GetTiffCompressionInImageIO( );
+
+extern void _SetTiffStripSizeInImageIO( size_t s );
+extern size_t _GetTiffStripSizeInImageIO( );
+
+extern void _SetBigTiffWritingInImageIO( int b );
+extern int _GetBigTiffWritingInImageIO( );
+
+extern int writeTiffImage( char *name, _image *im );
+
 extern PTRIMAGE_FORMAT createTifFormat();
 
 #ifdef __cplusplus